@@ -0,0 +1,56 @@
+#include "balance.hpp"
+#include <algorithm>
+
+namespace moros {
+
+Balancer::Balancer(double threshold) noexcept : threshold_(threshold) {}
+
+bool Balancer::decide(const std::vector<BencherLoad>& loads, Migration& m) {
+    const std::vector<BencherLoad> last = std::move(last_);
+    last_ = loads;
+    if (last.size() != loads.size() || loads.size() < 2) {
+        return false;
+    }
+    if (cooldown_) {
+        cooldown_ = false;
+        return false;
+    }
+
+    // 每个连接在这个周期内完成的请求数, 以及 timer 的平均延迟
+    std::vector<double> rate(loads.size()), lag(loads.size());
+    for (std::size_t i = 0; i < loads.size(); ++i) {
+        rate[i] = static_cast<double>(loads[i].completes - last[i].completes) /
+                  std::max<std::size_t>(loads[i].connections, 1);
+        const std::uint64_t ticks = loads[i].ticks - last[i].ticks;
+        lag[i] = ticks ? static_cast<double>(loads[i].lag_us - last[i].lag_us) / ticks : 0;
+    }
+
+    // 至少留下一个连接
+    std::size_t from = loads.size(), to = 0;
+    for (std::size_t i = 0; i < loads.size(); ++i) {
+        if (loads[i].connections > 1 && (from == loads.size() || rate[i] < rate[from])) {
+            from = i;
+        }
+        if (rate[i] > rate[to]) {
+            to = i;
+        }
+    }
+    if (from == loads.size() || from == to || rate[to] == 0 ||
+        rate[from] >= threshold_ * rate[to] || lag[from] < 1000 ||
+        lag[from] < 2 * lag[to]) {
+        return false;
+    }
+
+    // 移动差距的一半, 每次至多 1/4, 避免来回振荡
+    const std::size_t n = loads[from].connections;
+    const double gap = 1 - rate[from] / rate[to];
+    m.from = from;
+    m.to = to;
+    m.count = std::min(std::max<std::size_t>(static_cast<std::size_t>(n * gap / 2), 1),
+                       std::max<std::size_t>(n / 4, 1));
+    moved_ += m.count;
+    cooldown_ = true;
+    return true;
+}
+
+}
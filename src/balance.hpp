@@ -0,0 +1,51 @@
+#ifndef MOROS_BALANCE_HPP_
+#define MOROS_BALANCE_HPP_
+
+#include <cstdint>
+#include <vector>
+
+// --rebalance: 主线程定期比较同一进程内各 bencher 的进度, 把落后线程上的
+// 连接迁移到较快的线程, 连接总数不变
+
+namespace moros {
+
+// 某个 bencher 此刻的状态, 计数均为累计值
+struct BencherLoad {
+    std::uint64_t completes;
+    // 当前拥有的连接数
+    std::size_t connections;
+    // 周期 timer 的执行次数, 以及累计晚于预定时刻的时间
+    std::uint64_t ticks;
+    std::uint64_t lag_us;
+};
+
+struct Migration {
+    std::size_t from, to;
+    std::size_t count;
+};
+
+class Balancer {
+public:
+    // 每个连接的吞吐低于最快者的 threshold 倍, 且 event loop 的平均延迟
+    // 至少 1ms 并是对方的两倍以上时认为落后
+    explicit Balancer(double threshold = 0.8) noexcept;
+
+    // 传入各 bencher 的当前状态, 与上一次比较. 需要迁移时返回 true 并填写 m.
+    // 迁移后的下一个周期两侧都在调整, 跳过不比较
+    bool decide(const std::vector<BencherLoad>& loads, Migration& m);
+
+    // 累计请求迁移的连接数
+    std::size_t moved() const noexcept {
+        return moved_;
+    }
+
+private:
+    const double threshold_;
+    std::vector<BencherLoad> last_;
+    bool cooldown_ = false;
+    std::size_t moved_ = 0;
+};
+
+}
+
+#endif
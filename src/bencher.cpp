@@ -1,32 +1,65 @@
 #include "bencher.hpp"
+#include "connection.hpp"
+#include "h2.hpp"
 #include "stats.hpp"
-#include <boost/scope_exit.hpp>
-
-#include <fcntl.h>
-#include <arpa/inet.h>
-#include <sys/types.h>
-#include <sys/socket.h>
-#include <netinet/tcp.h>
+#include <algorithm>
 
 extern std::unique_ptr<moros::Stats> requests;
 extern std::unique_ptr<moros::Stats> latency;
 
 namespace moros {
 
-Bencher::Bencher(struct addrinfo addr, std::size_t nconn,
-                 const std::string& host, const std::string& req,
+Bencher::Bencher(const Config& cfg, std::size_t id, struct addrinfo addr,
+                 const std::string& host,
+                 const std::vector<Endpoint>& endpoints,
                  const SslContext* ssl_ctx, Plugin& plugin)
-    : ev_loop_(nconn), addr_(addr), plugin_(plugin) {
-    for (std::size_t i = 0; i < nconn; ++i) {
-        std::shared_ptr<Connection> c =
-            ssl_ctx ? std::make_shared<SslConnection>(ev_loop_, *this, host, req, Ssl(*ssl_ctx), plugin)
-                    : std::make_shared<Connection>(ev_loop_, *this, host, req, Ssl(), plugin);
-        c->connect();
-    }
+    : cfg_(cfg),
+      id_(id),
+      seed_(deriveSeed(cfg.seed, id)),
+      ev_loop_(cfg.connections),
+      addr_(addr),
+      sockopts_(parseSocketOptions(cfg.sockopt)),
+      endpoints_(endpoints),
+      picker_(endpoints, deriveSeed(seed_, 0)),
+      plugin_(plugin),
+      latency_(cfg.timeout.count() * 1000),
+      phases_(static_cast<std::size_t>(Phase::MAX),
+              Stats(cfg.timeout.count() * 1000000)),
+      hooks_(cfg.timeout.count() * 1000000),
+      jitter_(deriveSeed(seed_, std::uint64_t(-1))),
+      think_(cfg.think),
+      arrival_(cfg.arrival),
+      paced_(!think_.none() || !arrival_.none()),
+      open_loop_(!arrival_.none()),
+      pace_rng_(deriveSeed(seed_, std::uint64_t(-2))),
+      host_(host),
+      replaying_(!cfg.replay.empty()),
+      tracing_(!cfg.trace.empty() || cfg.slowest),
+      slowest_(cfg.slowest) {
+    launch_ = [this, host, ssl_ctx] {
+        if (cfg_.protocol == Protocol::HTTP1) {
+            spawn<Connection>(cfg_.connections, host, ssl_ctx);
+            if (cfg_.rebalance) {
+                plugin_.loaded() ? receive<Connection<TcpTransport, PluginHooks>>(host)
+                                 : receive<Connection<TcpTransport, NoHooks>>(host);
+            }
+        } else {
+            spawn<H2Connection>(cfg_.connections, host, ssl_ctx);
+        }
+    };
+
+    owned_.store(cfg.connections, std::memory_order_relaxed);
 
     start_ = std::chrono::steady_clock::now();
     requests_ = 0;
     ev_loop_.addTimerEvent(std::chrono::milliseconds(100), [this]() {
+        // warmup 期间的请求不计入 Req/Sec
+        if (!Metrics::getInstance().enabled()) {
+            requests_ = 0;
+            start_ = std::chrono::steady_clock::now();
+            return;
+        }
+
         if (requests_ > 0) {
             const auto elapsed =
                 std::chrono::duration_cast<std::chrono::milliseconds>(
@@ -39,253 +72,435 @@ Bencher::Bencher(struct addrinfo addr, std::size_t nconn,
         }
     });
 
-    plugin_.init();
-}
+    if (cfg.interval.count()) {
+        for (auto& st : intervals_) {
+            st = std::make_unique<Stats>(cfg.timeout.count() * 1000);
+        }
+        ev_loop_.addTimerEvent(cfg.interval, [this] { rotate(); });
+    }
 
-void Bencher::run() noexcept {
-    ev_loop_.run();
-}
+    if (cfg.conn_churn > 0) {
+        const double benchers = std::max<std::size_t>(cfg.processes, 1) * cfg.threads;
+        const double tick = cfg.conn_churn / std::max(benchers, 1.0) / 100;
+        ev_loop_.addTimerEvent(std::chrono::milliseconds(10), [this, tick] {
+            churn_ = std::min(churn_ + tick, static_cast<double>(cfg_.connections));
+        });
+    }
 
-void Bencher::stop() noexcept {
-    ev_loop_.stop();
-}
+    if (!cfg.replay.empty()) {
+        replay_ = std::make_unique<AccessLog>(cfg.replay);
+    }
 
-const struct addrinfo& Bencher::addr() const noexcept {
-    return addr_;
-}
+    if (!cfg.trace.empty()) {
+        trace_ = std::make_unique<TraceRing>(cfg.trace_size);
+    }
 
-void Bencher::countReq() noexcept {
-    ++requests_;
+    plugin_.init();
 }
 
-void Bencher::summary() {
-    plugin_.summary();
+Bencher::~Bencher() {
+    // 测试结束时尚未接管的连接
+    for (Handoff* h = inbox_.exchange(nullptr, std::memory_order_acquire); h;) {
+        Handoff* next = h->next;
+        ::close(h->fd);
+        delete h;
+        h = next;
+    }
 }
 
-Connection::Connection(EventLoop& ev_loop, Bencher& b, const std::string& host,
-                       const std::string& req, Ssl ssl, Plugin& plugin)
-    : ev_loop_(ev_loop),
-      bencher_(b),
-      ssl_(std::move(ssl)),
-      host_(host),
-      req_(req),
-      written_(0),
-      plugin_(plugin) {
-    http_parser_init(&parser_, HTTP_RESPONSE);
-    parser_.data = this;
-
-    http_parser_settings_init(&parser_settings_);
-    parser_settings_.on_message_complete = [](http_parser* parser) {
-        auto c = static_cast<Connection*>(parser->data);
-
-        const unsigned status = parser->status_code;
+template <template <typename, typename> class C>
+void Bencher::spawn(std::size_t nconn, const std::string& host,
+                    const SslContext* ssl_ctx) {
+    if (ssl_ctx) {
+        plugin_.loaded() ? launch<C<SslTransport, PluginHooks>>(nconn, host, ssl_ctx)
+                         : launch<C<SslTransport, NoHooks>>(nconn, host, ssl_ctx);
+    } else {
+        plugin_.loaded() ? launch<C<TcpTransport, PluginHooks>>(nconn, host, ssl_ctx)
+                         : launch<C<TcpTransport, NoHooks>>(nconn, host, ssl_ctx);
+    }
+}
 
-        Metrics::getInstance().count(Metrics::Kind::COMPLETES);
-        c->bencher_.countReq();
+template <typename C>
+void Bencher::launch(std::size_t nconn, const std::string& host,
+                     const SslContext* ssl_ctx) {
+    auto pending = std::make_shared<std::deque<std::shared_ptr<C>>>();
+    for (std::size_t i = 0; i < nconn; ++i) {
+        pending->push_back(
+            std::make_shared<C>(ev_loop_, *this, host, ssl_ctx, plugin_));
+    }
 
-        if (status > 399) {
-            Metrics::getInstance().count(Metrics::Kind::ESTATUS);
+    if (cfg_.ramp_up.count() == 0) {
+        for (auto& c : *pending) {
+            c->connect();
         }
+        return;
+    }
 
-        const auto elapsed =
-            std::chrono::duration_cast<std::chrono::milliseconds>(
-                std::chrono::steady_clock::now() - c->start_);
-        if (!latency->record(elapsed.count())) {
-            Metrics::getInstance().count(Metrics::Kind::ETIMEOUT);
+    // 在 ramp_up 时间内匀速建立连接, 避免瞬间的 SYN 风暴
+    const auto begin = std::chrono::steady_clock::now();
+    const auto period =
+        std::chrono::duration_cast<std::chrono::milliseconds>(cfg_.ramp_up);
+    ramp_timer_ = ev_loop_.addTimerEvent(std::chrono::milliseconds(10), [=] {
+        auto conns = pending;
+
+        const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+            std::chrono::steady_clock::now() - begin);
+        const std::size_t target =
+            std::min<std::size_t>(nconn, nconn * elapsed.count() / period.count());
+
+        while (nconn - conns->size() < target) {
+            conns->front()->connect();
+            conns->pop_front();
         }
 
-        c->plugin_.response(status, std::move(c->headers_), std::move(c->body_));
-
-        if (!http_should_keep_alive(parser)) {
-            c->reconnect();
-        } else {
-            c->written_ = 0;
-            c->body_.clear();
-            c->headers_.clear();
-            c->header_state_ = HeaderState::FIELD;
-            http_parser_init(parser, HTTP_RESPONSE);
+        if (conns->empty()) {
+            ev_loop_.delTimerEvent(ramp_timer_);
         }
+    });
+}
 
-        return 0;
+template <typename C>
+void Bencher::receive(const std::string& host) {
+    adopt_ = [this, host](Handoff& h) {
+        auto c = std::make_shared<C>(ev_loop_, *this, host, nullptr, plugin_, std::move(h.tpl));
+        c->adopt(h);
     };
+}
 
-    if (plugin.wantResponseHeaders()) {
-        parser_settings_.on_header_field = [](http_parser* parser,
-                                              const char* s, std::size_t len) {
-            auto c = static_cast<Connection*>(parser->data);
-            if (c->header_state_ == HeaderState::VALUE) {
-                c->headers_.push_back('\x01');
-                c->header_state_ = HeaderState::FIELD;
+void Bencher::run() noexcept {
+    if (cfg_.perf_counters) {
+        perf_.open();
+    }
+    if (cfg_.rebalance) {
+        // 自己计算 timer 的延迟, event loop 的 lag 统计只能在结束后读取
+        const auto period = std::chrono::milliseconds(10);
+        tick_ = std::chrono::steady_clock::now() + period;
+        ev_loop_.addTimerEvent(period, [this, period] {
+            const auto now = std::chrono::steady_clock::now();
+            if (now > tick_) {
+                lag_us_.store(lag_us_.load(std::memory_order_relaxed) +
+                                  std::chrono::duration_cast<std::chrono::microseconds>(
+                                      now - tick_).count(),
+                              std::memory_order_relaxed);
             }
-            c->headers_.append(s, len);
-
-            return 0;
-        };
-
-        parser_settings_.on_header_value = [](http_parser* parser,
-                                              const char* s, std::size_t len) {
-            auto c = static_cast<Connection*>(parser->data);
-            if (c->header_state_ == HeaderState::FIELD) {
-                c->headers_.push_back(':');
-                c->header_state_ = HeaderState::VALUE;
+            ticks_.store(ticks_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            while (tick_ <= now) {
+                tick_ += period;
             }
-            c->headers_.append(s, len);
-
-            return 0;
-        };
+            adopt();
+        });
+    }
+    replay_start_ = std::chrono::steady_clock::now();
+    if (launch_) {
+        launch_();
+        launch_ = nullptr;
     }
+    ev_loop_.run();
+}
+
+void Bencher::endConnect() noexcept {
+    --connecting_;
+}
 
-    if (plugin.wantResponseBody()) {
-        parser_settings_.on_body = [](http_parser* parser, const char* s,
-                                      std::size_t len) {
-            auto c = static_cast<Connection*>(parser->data);
-            c->body_.append(s, len);
+void Bencher::retryConnect(unsigned failures, std::function<void()> fn) {
+    // 10ms 起每次翻倍, 至多 1s. 取其一半加随机的另一半, 避免同时失败的
+    // 连接又同时重试
+    const auto base = std::chrono::milliseconds(10);
+    const auto cap = std::chrono::milliseconds(1000);
+    const auto backoff = std::min<std::chrono::milliseconds>(
+        cap, base * (std::uint64_t(1) << std::min(failures - 1, 7u)));
+    const auto delay = backoff / 2 +
+                       std::chrono::milliseconds(jitter_() % (backoff.count() / 2 + 1));
+
+    retries_.push({std::chrono::steady_clock::now() + delay, std::move(fn)});
+    schedulePump();
+}
 
-            return 0;
-        };
+std::chrono::steady_clock::time_point Bencher::nextRequest(
+    std::chrono::steady_clock::time_point due, std::chrono::steady_clock::time_point now) {
+    // 开环时落后于计划的连接不等待, 直到追上为止
+    if (!arrival_.none()) {
+        return due + arrival_(pace_rng_);
     }
+    return now + think_(pace_rng_);
+}
+
+void Bencher::defer(std::chrono::steady_clock::time_point due, std::function<void()> fn) {
+    deferred_.push({due, std::move(fn)});
+    schedulePump();
 }
 
-void Connection::reconnect() {
-    // 延长生命周期，delEvent 会删除 Connection 的拷贝
-    auto self = shared_from_this();
+bool Bencher::replay(std::string& req, std::chrono::steady_clock::time_point& due,
+                     std::function<void()> fn) {
+    const auto now = std::chrono::steady_clock::now();
+    refill(now);
 
-    ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+    if (replayed_.empty() || replayed_.front().due > now) {
+        if (replay_ || !replayed_.empty()) {
+            idle_.push_back(std::move(fn));
+            schedulePump();
+        }
+        return false;
+    }
 
-    close();
-    ::close(fd_);
-    connect();
+    // 交换以复用连接一侧字符串的容量
+    req.swap(replayed_.front().req);
+    due = replayed_.front().due;
+    replayed_.pop_front();
+    return true;
 }
 
-void Connection::connect() {
-    bool dismiss = false;
-    BOOST_SCOPE_EXIT_ALL(&) {
-        if (!dismiss) {
-            Metrics::getInstance().count(Metrics::Kind::ECONNECT);
+void Bencher::refill(std::chrono::steady_clock::time_point now) {
+    // 预先解析 100ms 内的请求; 落后于计划时至多积压这么多条, 其余留在
+    // 日志中, 之后解析出的计划时间不变, 落后的时间仍被如实记录
+    const auto lookahead = std::chrono::milliseconds(100);
+    const std::size_t backlog = 65536;
+    const std::size_t benchers = std::max<std::size_t>(cfg_.processes, 1) * cfg_.threads;
+
+    ReplayEntry e;
+    while (replay_ && replayed_.size() < backlog &&
+           (replayed_.empty() || replayed_.back().due <= now + lookahead)) {
+        if (!replay_->next(e)) {
+            replay_.reset();
+            break;
+        }
+        if (replay_seq_++ % benchers != id_) {
+            continue;
         }
-    };
 
-    int fd = ::socket(bencher_.addr().ai_family,
-                      bencher_.addr().ai_socktype | O_NONBLOCK,
-                      bencher_.addr().ai_protocol);
-    if (fd == -1) {
-        return;
+        std::vector<std::string> headers = std::move(e.headers);
+        headers.insert(headers.end(), cfg_.headers.begin(), cfg_.headers.end());
+        const auto offset = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double, std::micro>(e.offset.count() / cfg_.replay_speed));
+        replayed_.push_back(
+            {replay_start_ + offset, buildHead(e.method, e.uri, host_, headers) + "\r\n"});
     }
+}
 
-    if (::connect(fd, bencher_.addr().ai_addr, bencher_.addr().ai_addrlen) == -1) {
-        if (errno != EINPROGRESS) {
-            ::close(fd);
-            return;
-        }
-    }
+void Bencher::refuseH2() noexcept {
+    h2_refused_ = true;
+}
 
-    const int flags = 1;
-    ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+bool Bencher::h2Refused() const noexcept {
+    return h2_refused_;
+}
 
-    auto self = shared_from_this();
-    if (!ev_loop_.addEvent(fd, Mask::WRITABLE, [self] { self->connected(); }) ||
-        !ev_loop_.addEvent(fd, Mask::READABLE, [self] { self->response(); })) {
+void Bencher::trace(TraceRecord& r, const std::string& request) {
+    if (!Metrics::getInstance().enabled()) {
         return;
     }
+    r.thread = static_cast<std::uint16_t>(id_);
+    if (trace_) {
+        trace_->push(r);
+    }
+    if (slowest_.qualifies(r.latency())) {
+        slowest_.add(r, request);
+    }
+}
 
-    dismiss = true;
+const TraceRing* Bencher::traceRing() const noexcept {
+    return trace_.get();
+}
 
-    fd_ = fd;
-    written_ = 0;
-    body_.clear();
-    headers_.clear();
-    header_state_ = HeaderState::FIELD;
-    http_parser_init(&parser_, HTTP_RESPONSE);
+const SlowestRequests& Bencher::slowest() const noexcept {
+    return slowest_;
 }
 
-void Connection::connected() {
-    auto self = shared_from_this();
-    if (!ev_loop_.addEvent(fd_, Mask::WRITABLE, [self] { self->request(); })) {
-        return;
+BencherLoad Bencher::load() const noexcept {
+    return {progress_.load(std::memory_order_relaxed),
+            owned_.load(std::memory_order_relaxed),
+            ticks_.load(std::memory_order_relaxed),
+            lag_us_.load(std::memory_order_relaxed)};
+}
+
+void Bencher::migrate(Bencher& to, std::size_t n) noexcept {
+    donate_.store(0, std::memory_order_relaxed);
+    donee_.store(&to, std::memory_order_relaxed);
+    donate_.store(n, std::memory_order_release);
+}
+
+void Bencher::handoff(Bencher& to, Handoff* h) noexcept {
+    owned_.store(owned_.load(std::memory_order_relaxed) - 1, std::memory_order_relaxed);
+
+    h->next = to.inbox_.load(std::memory_order_relaxed);
+    while (!to.inbox_.compare_exchange_weak(h->next, h, std::memory_order_release,
+                                            std::memory_order_relaxed)) {
     }
+}
 
-    request();
+void Bencher::adopt() noexcept {
+    for (Handoff* h = inbox_.exchange(nullptr, std::memory_order_acquire); h;) {
+        Handoff* next = h->next;
+        adopt_(*h);
+        owned_.store(owned_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        delete h;
+        h = next;
+    }
 }
 
-void Connection::request() {
-    if (written_ == 0) {
-        plugin_.request(req_);
+void Bencher::schedulePump() {
+    if (pump_timer_ == -1) {
+        pump_timer_ = ev_loop_.addTimerEvent(std::chrono::milliseconds(1), [this] { pump(); });
+    }
+}
 
-        start_ = std::chrono::steady_clock::now();
+void Bencher::pump() noexcept {
+    const auto now = std::chrono::steady_clock::now();
+    while (!retries_.empty() && retries_.top().due <= now) {
+        waiting_.push_back(retries_.top().fn);
+        retries_.pop();
     }
 
-    while (written_ < req_.size()) {
-        const char* buf = req_.data() + written_;
-        const std::size_t len = req_.size() - written_;
+    // fn 可能再次 defer, 只处理此刻已到期的
+    while (!deferred_.empty() && deferred_.top().due <= now) {
+        auto fn = deferred_.top().fn;
+        deferred_.pop();
+        fn();
+    }
 
-        const ssize_t n = write(buf, len);
-        if (n >= 0) {
-            written_ += static_cast<std::size_t>(n);
-        } else if (errno == EAGAIN) {
-            break;
-        } else {
-            Metrics::getInstance().count(Metrics::Kind::EWRITE);
-            reconnect();
+    // 被唤醒的连接立即取走一条请求, 尚未建立的则在建立后再取
+    if (!idle_.empty()) {
+        refill(now);
+        while (!idle_.empty() && !replayed_.empty() && replayed_.front().due <= now) {
+            auto fn = std::move(idle_.front());
+            idle_.pop_front();
+            fn();
         }
+        if (!replay_ && replayed_.empty()) {
+            idle_.clear();
+        }
+    }
+
+    // fn 重新调用 connect, 总能占到名额
+    while (!waiting_.empty() &&
+           (!cfg_.connect_concurrency || connecting_ < cfg_.connect_concurrency)) {
+        auto fn = std::move(waiting_.front());
+        waiting_.pop_front();
+        fn();
+    }
+
+    if (waiting_.empty() && retries_.empty() && deferred_.empty() && idle_.empty()) {
+        ev_loop_.delTimerEvent(pump_timer_);
+        pump_timer_ = -1;
     }
 }
 
-void Connection::response() {
-    ssize_t n = 0;
-    while ((n = read(buf_, sizeof(buf_))) > 0) {
-        Metrics::getInstance().count(Metrics::Kind::BYTES, n);
+void Bencher::stop() noexcept {
+    ev_loop_.stop();
+}
+
+TemplateState Bencher::templateState() noexcept {
+    const std::size_t k = nconn_++;
+    return TemplateState(deriveSeed(seed_, k + 1), id_ * cfg_.connections + k,
+                         std::max<std::size_t>(std::max<std::size_t>(cfg_.processes, 1) *
+                                                   cfg_.threads * cfg_.connections, 1));
+}
 
-        if (http_parser_execute(&parser_, &parser_settings_, buf_, n) != static_cast<std::size_t>(n)) {
-            Metrics::getInstance().count(Metrics::Kind::EREAD);
-            reconnect();
-            return;
-        }
+void Bencher::complete(std::size_t ep, unsigned status, std::uint64_t ms) noexcept {
+    ++requests_;
+    progress_.store(progress_.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+    // warmup 期间全局与 endpoint 的计数和 latency 都不记录, 主线程在打开
+    // 之前清零, 之后读到 true 的线程不会与之竞争
+    if (!Metrics::getInstance().enabled()) {
+        return;
     }
 
-    if (n == 0) {
-        if (!http_body_is_final(&parser_)) {
-            Metrics::getInstance().count(Metrics::Kind::EREAD);
-        }
-        reconnect();
-    } else if (errno != EAGAIN) {
-        Metrics::getInstance().count(Metrics::Kind::EREAD);
-        reconnect();
+    Metrics& metrics = *endpoints_[ep].metrics;
+    Metrics::getInstance().count(Metrics::Kind::COMPLETES);
+    metrics.count(Metrics::Kind::COMPLETES);
+    if (status > 399) {
+        Metrics::getInstance().count(Metrics::Kind::ESTATUS);
+        metrics.count(Metrics::Kind::ESTATUS);
+    }
+
+    ++completes_;
+    if (intervals_[active_]) {
+        intervals_[active_]->record(ms);
+    }
+    latency_.record(ms);
+    endpoints_[ep].latency->record(ms);
+    if (!::latency->record(ms)) {
+        Metrics::getInstance().count(Metrics::Kind::ETIMEOUT);
+        metrics.count(Metrics::Kind::ETIMEOUT);
     }
 }
 
-int Connection::read(char buf[], std::size_t len) noexcept {
-    return ::read(fd_, buf, len);
+void Bencher::fail(std::size_t ep, Metrics::Kind k) noexcept {
+    if (!Metrics::getInstance().enabled()) {
+        return;
+    }
+    Metrics::getInstance().count(k);
+    endpoints_[ep].metrics->count(k);
 }
 
-int Connection::write(const char buf[], std::size_t len) noexcept {
-    return ::write(fd_, buf, len);
+void Bencher::phase(Phase p, std::chrono::steady_clock::duration d) noexcept {
+    // 连接多在 warmup 期间建立, 每个连接一次的阶段照常记录
+    if (!Metrics::getInstance().enabled() && p != Phase::CONNECT && p != Phase::TLS &&
+        p != Phase::ACCEPT) {
+        return;
+    }
+    phases_[static_cast<std::size_t>(p)].record(
+        std::chrono::duration_cast<std::chrono::microseconds>(d).count());
 }
 
-int Connection::close() noexcept {
-    return 0;
+void Bencher::hook(std::chrono::steady_clock::duration d) noexcept {
+    if (!Metrics::getInstance().enabled()) {
+        return;
+    }
+    hooks_.record(std::chrono::duration_cast<std::chrono::microseconds>(d).count());
 }
 
-void SslConnection::connected() {
-    auto self = shared_from_this();
-    if (!ev_loop_.addEvent(fd_, Mask::WRITABLE, [self]() { self->request(); })) {
+void Bencher::rotate() noexcept {
+    // reporter 还未取走上一个 interval, 继续累积到当前一侧
+    if (published_.load(std::memory_order_acquire)) {
         return;
     }
 
-    ssl_.fd(fd_);
-    ssl_.sni(host_.c_str());
-    ssl_.connect();
+    active_ ^= 1;
+    published_.store(true, std::memory_order_release);
+}
+
+bool Bencher::collect(Stats& st) noexcept {
+    if (!published_.load(std::memory_order_acquire)) {
+        return false;
+    }
+
+    // active_ 只在 published_ 为 false 时才会被 bencher 线程修改
+    auto& retired = *intervals_[active_ ^ 1];
+    st.merge(retired);
+    retired.reset();
+
+    published_.store(false, std::memory_order_release);
+    return true;
+}
+
+void Bencher::summary() {
+    plugin_.summary();
+}
+
+std::uint64_t Bencher::completes() const noexcept {
+    return completes_;
+}
+
+const Stats& Bencher::latency() const noexcept {
+    return latency_;
+}
+
+const Stats& Bencher::phase(Phase p) const noexcept {
+    return phases_[static_cast<std::size_t>(p)];
 }
 
-int SslConnection::read(char buf[], std::size_t len) noexcept {
-    return ssl_.read(buf, len);
+const LoopStats& Bencher::loop() const noexcept {
+    return ev_loop_.stats();
 }
 
-int SslConnection::write(const char buf[], std::size_t len) noexcept {
-    return ssl_.write(buf, len);
+const Stats& Bencher::hooks() const noexcept {
+    return hooks_;
 }
 
-int SslConnection::close() noexcept {
-    return ssl_.close();
+const PerfCounters& Bencher::perf() const noexcept {
+    return perf_;
 }
 
 }
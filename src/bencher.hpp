@@ -3,99 +3,357 @@
 
 #include "ev.hpp"
 #include "ssl.hpp"
+#include "config.hpp"
+#include "delay.hpp"
+#include "replay.hpp"
+#include "sockopt.hpp"
 #include "plugin.hpp"
-#include "http_parser.h"
+#include "perf.hpp"
+#include "stats.hpp"
+#include "scenario.hpp"
+#include "balance.hpp"
+#include "trace.hpp"
 #include <chrono>
 #include <string>
 #include <memory>
 #include <atomic>
+#include <deque>
+#include <queue>
+#include <random>
+#include <functional>
 #include <netdb.h>
 
 namespace moros {
 
+// --rebalance: 在两个请求之间从一个 bencher 移交给另一个的连接.
+// 发送方已将 fd 移出自己的 event loop
+struct Handoff {
+    int fd;
+    TemplateState tpl;
+    std::size_t served;
+    // 下一个请求计划的发出时间, paused 时尚未到期
+    std::chrono::steady_clock::time_point due;
+    bool paused;
+
+    Handoff* next;
+};
+
 class Bencher {
 public:
-    Bencher(struct addrinfo addr, std::size_t nconn, const std::string& host,
-            const std::string& req, const SslContext* ssl_ctx, Plugin& plugin);
+    Bencher(const Config& cfg, std::size_t id, struct addrinfo addr,
+            const std::string& host,
+            const std::vector<Endpoint>& endpoints, const SslContext* ssl_ctx,
+            Plugin& plugin);
+    ~Bencher();
 
     void run() noexcept;
     void stop() noexcept;
 
+    const Config& config() const noexcept;
+
     const struct addrinfo& addr() const noexcept;
 
-    void countReq() noexcept;
+    // --sockopt 的选项, dial 时设置
+    const SocketOptions& socketOptions() const noexcept;
+
+    const std::vector<Endpoint>& endpoints() const noexcept;
+
+    // 按权重挑选下一个请求的 endpoint
+    std::size_t pick() noexcept;
+
+    // 为新建的连接分配模板状态, seed 与序号只取决于 bencher 与连接的编号
+    TemplateState templateState() noexcept;
+
+    // bencher 线程: 一个请求完成, 更新全局, 本线程, 当前 interval
+    // 以及所属 endpoint 的统计
+    void complete(std::size_t ep, unsigned status, std::uint64_t ms) noexcept;
+
+    // 请求未能完成, 同时计入全局与 endpoint 的错误
+    void fail(std::size_t ep, Metrics::Kind k) noexcept;
+
+    // bencher 线程: 记录某个阶段的耗时
+    void phase(Phase p, std::chrono::steady_clock::duration d) noexcept;
+
+    // bencher 线程: 记录一次插件 hook 的耗时
+    void hook(std::chrono::steady_clock::duration d) noexcept;
+
+    // bencher 线程: 占用一个建立连接的名额. 已有 --connect-concurrency 个
+    // 连接在建立中时返回 false, 之后有名额时调用 fn 重新发起
+    template <typename F>
+    bool beginConnect(F&& fn);
+
+    // bencher 线程: 连接建立成功或失败, 归还名额
+    void endConnect() noexcept;
+
+    // bencher 线程: 连续第 failures 次连接失败, 指数退避后调用 fn 重连
+    void retryConnect(unsigned failures, std::function<void()> fn);
+
+    // 是否以 --think 或 --arrival 控制请求的发出时间
+    bool paced() const noexcept;
+
+    // --arrival 为开环, latency 从计划的发出时间算起
+    bool openLoop() const noexcept;
+
+    // bencher 线程: 上一个请求计划在 due 发出, 其响应在 now 完成,
+    // 返回下一个请求的计划发出时间
+    std::chrono::steady_clock::time_point nextRequest(
+        std::chrono::steady_clock::time_point due,
+        std::chrono::steady_clock::time_point now);
+
+    // bencher 线程: 到 due 时调用 fn, 精度为 1ms
+    void defer(std::chrono::steady_clock::time_point due, std::function<void()> fn);
+
+    // bencher 线程: 一个请求完成后询问是否按 --conn-churn 关闭该连接,
+    // 返回 true 时已占用一个名额
+    bool churn() noexcept;
+
+    // --replay 时连接按日志发出请求, 不再按权重挑选 endpoint
+    bool replaying() const noexcept;
+
+    // bencher 线程: 取出已到计划时间 due 的下一条日志请求到 req. 没有时
+    // 返回 false, 之后有请求到期时调用 fn; 日志已重放完则不再调用
+    bool replay(std::string& req, std::chrono::steady_clock::time_point& due,
+                std::function<void()> fn);
+
+    // bencher 线程: TLS 握手完成后对端没有经 ALPN 选择 h2, 该连接按
+    // 建立失败重试
+    void refuseH2() noexcept;
+
+    // 在 bencher 线程结束后读取, 是否有连接因未协商出 h2 而放弃
+    bool h2Refused() const noexcept;
+
+    // 是否逐请求记录, 即开启了 --trace 或 --slowest
+    bool tracing() const noexcept;
+
+    // bencher 线程: 记录一个完成的请求, request 为其完整的请求. warmup
+    // 期间不记录
+    void trace(TraceRecord& r, const std::string& request);
+
+    // 以下在 bencher 线程结束后读取, 未开启 --trace 时为 nullptr
+    const TraceRing* traceRing() const noexcept;
+
+    const SlowestRequests& slowest() const noexcept;
+
+    // 任何线程: 进度与 event loop 延迟的累计值, 供 Balancer 比较
+    BencherLoad load() const noexcept;
+
+    // 主线程: 让接下来完成请求的 n 个空闲连接移交给 to, 取代尚未完成的请求
+    void migrate(Bencher& to, std::size_t n) noexcept;
+
+    // bencher 线程: 一个请求完成后询问该连接是否应移交, 返回接收方
+    Bencher* donee() noexcept;
+
+    // bencher 线程: 把 h 交给 to, to 在下一个周期接管
+    void handoff(Bencher& to, Handoff* h) noexcept;
+
+    // reporter 线程: 合并最近发布的 interval 并清空, 尚未发布时返回 false
+    bool collect(Stats& st) noexcept;
 
     void summary();
 
+    // 以下在 bencher 线程结束后读取
+    std::uint64_t completes() const noexcept;
+
+    const Stats& latency() const noexcept;
+
+    const Stats& phase(Phase p) const noexcept;
+
+    const LoopStats& loop() const noexcept;
+
+    // 插件 hook 的耗时, 单位 us
+    const Stats& hooks() const noexcept;
+
+    // 任何时候都可读取, 未开启 --perf-counters 时没有可用的计数器
+    const PerfCounters& perf() const noexcept;
+
 private:
+    // 按 transport 与插件是否加载选择 Connection 的特化
+    template <template <typename, typename> class C>
+    void spawn(std::size_t nconn, const std::string& host,
+               const SslContext* ssl_ctx);
+
+    template <typename C>
+    void launch(std::size_t nconn, const std::string& host,
+                const SslContext* ssl_ctx);
+
+    // --rebalance: 以 C 接管移交来的连接
+    template <typename C>
+    void receive(const std::string& host);
+
+    // 接管 inbox 中的全部连接
+    void adopt() noexcept;
+
+    // 排队与退避到期的连接在有名额时发起, 调用到期的 defer, 并把到期的
+    // 日志请求交给空闲的连接
+    void pump() noexcept;
+    void schedulePump();
+
+    // 解析日志直到已解析的请求覆盖 now 之后的一段时间
+    void refill(std::chrono::steady_clock::time_point now);
+
+    const Config& cfg_;
+    const std::size_t id_;
+    const std::uint64_t seed_;
+    std::size_t nconn_ = 0;
+
     EventLoop ev_loop_;
 
     struct addrinfo addr_;
+    const SocketOptions sockopts_;
+
+    const std::vector<Endpoint>& endpoints_;
+    Picker picker_;
 
     Plugin& plugin_;
 
     std::chrono::steady_clock::time_point start_;
     std::uint64_t requests_;
-};
 
-class Connection : public std::enable_shared_from_this<Connection> {
-public:
-    Connection(EventLoop& ev_loop, Bencher& b, const std::string& host,
-               const std::string& req, Ssl ssl, Plugin& plugin);
+    std::uint64_t completes_ = 0;
+    bool h2_refused_ = false;
+    Stats latency_;
+    std::vector<Stats> phases_;
+    Stats hooks_;
 
-    void connect();
-    void reconnect();
+    // 只统计 bencher 线程, 由 run 在该线程中打开
+    PerfCounters perf_;
 
-    virtual void connected();
+    int ramp_timer_ = -1;
 
-    void request();
-    void response();
+    // 连接在 run 中, 即 bencher 线程上创建与发起
+    std::function<void()> launch_;
 
-private:
-    virtual int read(char buf[], std::size_t len) noexcept;
-    virtual int write(const char buf[], std::size_t len) noexcept;
-    virtual int close() noexcept;
+    std::size_t connecting_ = 0;
+    std::deque<std::function<void()>> waiting_;
 
-protected:
-    EventLoop& ev_loop_;
-    Bencher& bencher_;
+    struct Deferred {
+        std::chrono::steady_clock::time_point due;
+        std::function<void()> fn;
 
-    http_parser parser_;
-    http_parser_settings parser_settings_;
+        bool operator>(const Deferred& rhs) const noexcept {
+            return due > rhs.due;
+        }
+    };
+    using DeferredQueue =
+        std::priority_queue<Deferred, std::vector<Deferred>, std::greater<Deferred>>;
+    DeferredQueue retries_;
+    DeferredQueue deferred_;
+    std::minstd_rand jitter_;
+    int pump_timer_ = -1;
 
-    enum class HeaderState {
-        FIELD,
-        VALUE,
-    } header_state_ = HeaderState::FIELD;
-    std::string body_;
-    std::string headers_;
+    const DelayDistribution think_;
+    const DelayDistribution arrival_;
+    // 每个请求都要查询, 构造时算好以便内联
+    const bool paced_;
+    const bool open_loop_;
+    std::mt19937_64 pace_rng_;
 
-    int fd_ = -1;
-    Ssl ssl_;
+    // --conn-churn: 每 10ms 累积, 至多攒下一轮所有连接的名额
+    double churn_ = 0;
 
-    std::string host_;
+    // --replay: 各 bencher 各自 mmap 日志, 本 bencher 只重放序号模 bencher
+    // 总数等于 id_ 的记录. 时间从 run 开始算起
+    const std::string host_;
+    const bool replaying_;
+    std::unique_ptr<AccessLog> replay_;
+    std::size_t replay_seq_ = 0;
+    std::chrono::steady_clock::time_point replay_start_;
+    struct Replayed {
+        std::chrono::steady_clock::time_point due;
+        std::string req;
+    };
+    std::deque<Replayed> replayed_;
+    // 等待日志请求到期的连接
+    std::deque<std::function<void()>> idle_;
 
-    std::string req_;
-    std::size_t written_;
+    std::unique_ptr<TraceRing> trace_;
+    const bool tracing_;
+    SlowestRequests slowest_;
 
-    char buf_[8192];
+    // --rebalance: 其它 bencher 移交来的连接以无锁的栈传递, 本线程每 10ms
+    // 整个取走. 其余计数只由本线程写入, 供主线程读取
+    std::function<void(Handoff&)> adopt_;
+    std::atomic<Handoff*> inbox_{nullptr};
+    std::atomic<std::size_t> donate_{0};
+    std::atomic<Bencher*> donee_{nullptr};
+    std::atomic<std::uint64_t> progress_{0};
+    std::atomic<std::size_t> owned_{0};
+    std::atomic<std::uint64_t> ticks_{0};
+    std::atomic<std::uint64_t> lag_us_{0};
+    std::chrono::steady_clock::time_point tick_;
 
-    std::chrono::steady_clock::time_point start_;
+    // interval 双缓冲: bencher 线程只写 active_ 一侧, 定时切换后发布另一侧,
+    // reporter 读取并清空后再归还, 整个过程无需暂停 event loop
+    void rotate() noexcept;
 
-    Plugin& plugin_;
+    std::unique_ptr<Stats> intervals_[2];
+    unsigned active_ = 0;
+    std::atomic_bool published_{false};
 };
 
-class SslConnection : public Connection {
-public:
-    using Connection::Connection;
+// 以下在连接的每个请求上调用, 定义在头文件中以便内联
+inline const Config& Bencher::config() const noexcept {
+    return cfg_;
+}
 
-    void connected() override;
+inline const struct addrinfo& Bencher::addr() const noexcept {
+    return addr_;
+}
 
-private:
-    int read(char buf[], std::size_t len) noexcept override;
-    int write(const char buf[], std::size_t len) noexcept override;
-    int close() noexcept override;
-};
+inline const SocketOptions& Bencher::socketOptions() const noexcept {
+    return sockopts_;
+}
+
+inline const std::vector<Endpoint>& Bencher::endpoints() const noexcept {
+    return endpoints_;
+}
+
+inline std::size_t Bencher::pick() noexcept {
+    // 只有一个 endpoint 时不必调用 Picker
+    return endpoints_.size() > 1 ? picker_.pick() : 0;
+}
+
+inline bool Bencher::paced() const noexcept {
+    return paced_;
+}
+
+inline bool Bencher::openLoop() const noexcept {
+    return open_loop_;
+}
+
+inline bool Bencher::churn() noexcept {
+    if (churn_ < 1) {
+        return false;
+    }
+    churn_ -= 1;
+    return true;
+}
+
+inline bool Bencher::replaying() const noexcept {
+    return replaying_;
+}
+
+inline bool Bencher::tracing() const noexcept {
+    return tracing_;
+}
+
+inline Bencher* Bencher::donee() noexcept {
+    std::size_t n = donate_.load(std::memory_order_acquire);
+    while (n && !donate_.compare_exchange_weak(n, n - 1, std::memory_order_acquire)) {
+    }
+    return n ? donee_.load(std::memory_order_relaxed) : nullptr;
+}
+
+template <typename F>
+bool Bencher::beginConnect(F&& fn) {
+    if (cfg_.connect_concurrency && connecting_ >= cfg_.connect_concurrency) {
+        waiting_.emplace_back(std::forward<F>(fn));
+        schedulePump();
+        return false;
+    }
+    ++connecting_;
+    return true;
+}
 
 }
 
@@ -8,15 +8,67 @@
 
 namespace moros {
 
+enum class Protocol {
+    HTTP1,
+    H2,
+    H2C,
+};
+
+enum class Output {
+    TEXT,
+    JSON,
+    CSV,
+};
+
 struct Config {
     std::size_t threads;
     std::size_t connections;
     std::chrono::seconds duration;
     std::chrono::seconds timeout;
+    std::chrono::seconds warmup;
+    std::chrono::seconds ramp_up;
+    std::chrono::seconds interval;
     std::string url;
     std::string plugin;
+    std::string scenario;
     std::vector<std::string> headers;
     bool display_latency;
+    Protocol protocol;
+    std::size_t streams;
+    std::uint64_t seed;
+    Output output;
+    std::vector<double> percentiles;
+    std::string histogram_log;
+    bool timestamping;
+    // event loop 的 timer 延迟 p99 超过该值时认为客户端已饱和
+    std::chrono::milliseconds max_lag;
+    bool perf_counters;
+    // 每个 bencher 同时在建立中的连接数上限, 0 为不限
+    std::size_t connect_concurrency;
+    // DelayDistribution 的格式. think 为收到响应后到发出下一个请求的间隔,
+    // arrival 为同一连接上相邻请求计划发出时间的间隔, 至多一个为非空
+    std::string think;
+    std::string arrival;
+    // 每个连接最多发送的请求数, 之后由客户端关闭并重连, 0 为不限
+    std::size_t requests_per_conn;
+    // 所有 bencher 每秒共主动关闭并重连的连接数, 0 为不主动关闭
+    double conn_churn;
+    // 连接的 socket 选项, parseSocketOptions 的格式
+    std::string sockopt;
+    // 在同一进程的 bencher 之间迁移空闲连接, 平衡各线程的负载
+    bool rebalance;
+    // 按时间间隔重放的访问日志, 以及重放的倍速
+    std::string replay;
+    double replay_speed;
+    // fork 出的 worker 进程数, 每个进程有 threads 个 bencher
+    std::size_t processes;
+    // 主线程定期发布实时统计的文件, 供 moros-top 读取
+    std::string stats_file;
+    // 结束时写入逐请求记录的文件, 以及每个 bencher 保留的最近记录数
+    std::string trace;
+    std::size_t trace_size;
+    // 报告中列出的最慢请求数, 0 为不列出
+    std::size_t slowest;
 };
 
 }
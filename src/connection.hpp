@@ -0,0 +1,772 @@
+#ifndef MOROS_CONNECTION_HPP_
+#define MOROS_CONNECTION_HPP_
+
+#include "ev.hpp"
+#include "ssl.hpp"
+#include "stats.hpp"
+#include "plugin.hpp"
+#include "bencher.hpp"
+#include "timestamp.hpp"
+#include "sockopt.hpp"
+#include "http_parser.h"
+#include <chrono>
+#include <string>
+#include <memory>
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+
+extern std::unique_ptr<moros::Stats> requests;
+extern std::unique_ptr<moros::Stats> latency;
+
+namespace moros {
+
+// 发起非阻塞连接, 失败返回 -1. 开启 fastopen 时 connect 立即返回,
+// SYN 等到第一次写入时携带数据发出
+inline int dial(const struct addrinfo& addr, const SocketOptions& opts) noexcept {
+    int fd = ::socket(addr.ai_family, addr.ai_socktype | O_NONBLOCK,
+                      addr.ai_protocol);
+    if (fd == -1) {
+        return -1;
+    }
+
+    if (!applySocketOptions(fd, addr.ai_family, opts)) {
+        ::close(fd);
+        return -1;
+    }
+
+    // Unix socket 的连接立即完成, backlog 满时为 EAGAIN, 按失败计
+    if (::connect(fd, addr.ai_addr, addr.ai_addrlen) == -1) {
+        if (errno != EINPROGRESS) {
+            ::close(fd);
+            return -1;
+        }
+    }
+
+    if (addr.ai_family != AF_UNIX) {
+        const int flags = 1;
+        ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+    }
+
+    return fd;
+}
+
+// 非阻塞连接可写后确认是否真的建立成功
+inline bool established(int fd) noexcept {
+    int err = 0;
+    socklen_t len = sizeof(err);
+    return ::getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len) == 0 && err == 0;
+}
+
+// Transport 策略: 决定字节如何在 fd 上收发
+class TcpTransport {
+public:
+    explicit TcpTransport(const SslContext*) noexcept {}
+
+    static const char* scheme() noexcept {
+        return "http";
+    }
+
+    // 明文连接没有 ALPN, 由使用者事先约定协议
+    bool alpnAccepted(const char* proto) const noexcept {
+        (void)proto;
+        return true;
+    }
+
+    // 返回 true 表示可以立即发送请求
+    bool handshake(int fd, const std::string& host) noexcept {
+        (void)fd;
+        (void)host;
+        return true;
+    }
+
+    bool finishHandshake() noexcept {
+        return true;
+    }
+
+    // 开启后 read 改用 recvmsg 以取得内核时间戳
+    void timestamping(int fd) noexcept {
+        stamping_ = enableTimestamping(fd);
+        tx_ = rx_ = WireStamp();
+    }
+
+    int read(int fd, char buf[], std::size_t len) noexcept {
+        if (stamping_) {
+            drainTxStamps(fd, tx_);
+            return recvStamped(fd, buf, len, rx_);
+        }
+        return ::read(fd, buf, len);
+    }
+
+    int write(int fd, const char buf[], std::size_t len) noexcept {
+        return ::write(fd, buf, len);
+    }
+
+    // 请求最后一个字节发出到刚读到的数据到达, 均以内核时间计;
+    // 每个发送时间戳只用一次
+    bool wire(std::chrono::nanoseconds& d) noexcept {
+        if (!stamping_ || !wireTime(tx_, rx_, d)) {
+            return false;
+        }
+        tx_ = WireStamp();
+        return true;
+    }
+
+    int close() noexcept {
+        return 0;
+    }
+
+private:
+    bool stamping_ = false;
+    WireStamp tx_, rx_;
+};
+
+class SslTransport {
+public:
+    explicit SslTransport(const SslContext* ssl_ctx) : ssl_(*ssl_ctx) {}
+
+    static const char* scheme() noexcept {
+        return "https";
+    }
+
+    bool alpnAccepted(const char* proto) const {
+        return ssl_.alpn() == proto;
+    }
+
+    // 握手由后续的 SSL_write 驱动完成
+    bool handshake(int fd, const std::string& host) noexcept {
+        ssl_.fd(fd);
+        ssl_.sni(host.c_str());
+        ssl_.connect();
+        return false;
+    }
+
+    // 推进尚未完成的握手, 完成返回 true; 否则 errno 为 EAGAIN 时等待
+    // 下一次事件, 其它为握手失败
+    bool finishHandshake() noexcept {
+        return ssl_.connect() == 1;
+    }
+
+    int read(int fd, char buf[], std::size_t len) noexcept {
+        (void)fd;
+        return ssl_.read(buf, len);
+    }
+
+    int write(int fd, const char buf[], std::size_t len) noexcept {
+        (void)fd;
+        return ssl_.write(buf, len);
+    }
+
+    // SSL_read 拿不到 control message, 不支持内核时间戳
+    void timestamping(int fd) noexcept {
+        (void)fd;
+    }
+
+    bool wire(std::chrono::nanoseconds& d) noexcept {
+        (void)d;
+        return false;
+    }
+
+    int close() noexcept {
+        return ssl_.close();
+    }
+
+private:
+    Ssl ssl_;
+};
+
+// Hooks 策略: 未加载插件时所有 hook 在编译期消失
+class NoHooks {
+public:
+    static constexpr bool enabled = false;
+
+    NoHooks(Bencher&, Plugin&) noexcept {}
+
+    bool wantRequest() const noexcept {
+        return false;
+    }
+
+    bool wantResponseHeaders() const noexcept {
+        return false;
+    }
+
+    bool wantResponseBody() const noexcept {
+        return false;
+    }
+
+    void request(std::string&) noexcept {}
+
+    void response(std::uint32_t, std::string, std::string) noexcept {}
+};
+
+class PluginHooks {
+public:
+    static constexpr bool enabled = true;
+
+    PluginHooks(Bencher& b, Plugin& plugin) noexcept : bencher_(b), plugin_(plugin) {}
+
+    bool wantRequest() const noexcept {
+        return plugin_.wantRequest();
+    }
+
+    bool wantResponseHeaders() const noexcept {
+        return plugin_.wantResponseHeaders();
+    }
+
+    bool wantResponseBody() const noexcept {
+        return plugin_.wantResponseBody();
+    }
+
+    // 插件运行在 event loop 中, 其耗时计入 bencher 的 hook 统计
+    void request(std::string& req) {
+        const auto begin = std::chrono::steady_clock::now();
+        plugin_.request(req);
+        bencher_.hook(std::chrono::steady_clock::now() - begin);
+    }
+
+    void response(std::uint32_t status, std::string headers, std::string body) {
+        if (!plugin_.wantResponse()) {
+            return;
+        }
+        const auto begin = std::chrono::steady_clock::now();
+        plugin_.response(status, std::move(headers), std::move(body));
+        bencher_.hook(std::chrono::steady_clock::now() - begin);
+    }
+
+private:
+    Bencher& bencher_;
+    Plugin& plugin_;
+};
+
+
+template <typename Transport, typename Hooks>
+class Connection
+    : public std::enable_shared_from_this<Connection<Transport, Hooks>> {
+public:
+    Connection(EventLoop& ev_loop, Bencher& b, const std::string& host,
+               const SslContext* ssl_ctx, Plugin& plugin);
+    // 接管移交来的连接时沿用其模板状态
+    Connection(EventLoop& ev_loop, Bencher& b, const std::string& host,
+               const SslContext* ssl_ctx, Plugin& plugin, TemplateState tpl);
+
+    void connect();
+    void reconnect();
+
+    // 连接失败, 归还名额并在退避后重连
+    void failConnect();
+
+    void connected();
+
+    void request();
+    void response();
+
+    // --rebalance: 接管其它 bencher 移交来的已建立的连接
+    void adopt(Handoff& h);
+
+private:
+    // 把空闲的连接移交给 handoff_
+    void handoff();
+
+    static int onMessageComplete(http_parser* parser);
+
+    // --think 或 --arrival: 计划下一个请求, 未到时间则暂停发出.
+    // --replay 时等待日志中的请求到期同样暂停
+    void pace(std::chrono::steady_clock::time_point now);
+    void resume();
+
+    // --trace 或 --slowest: 记录刚在 now 完成的请求
+    void trace(std::chrono::steady_clock::time_point now, unsigned status);
+
+    EventLoop& ev_loop_;
+    Bencher& bencher_;
+
+    http_parser parser_;
+    http_parser_settings parser_settings_;
+
+    enum class HeaderState {
+        FIELD,
+        VALUE,
+    } header_state_ = HeaderState::FIELD;
+    std::string body_;
+    std::string headers_;
+
+    int fd_ = -1;
+    Transport transport_;
+
+    // 已占用建立连接的名额, 尚未确认建立成功
+    bool connecting_ = false;
+    unsigned failures_ = 0;
+
+    std::string host_;
+
+    // 当前请求所属的 endpoint, req_ 指向其预先生成的请求, 模板渲染出的
+    // 请求或插件生成的请求
+    std::size_t ep_ = 0;
+    const std::string* req_ = nullptr;
+    TemplateState tpl_;
+    std::string rendered_;
+    std::string scratch_;
+    std::string plugin_req_;
+    std::string replayed_;
+    std::size_t written_;
+
+    char buf_[8192];
+
+    // 各阶段的起点, 只在阶段切换的位置取时间
+    std::chrono::steady_clock::time_point connect_start_;
+    std::chrono::steady_clock::time_point handshake_start_;
+    std::chrono::steady_clock::time_point start_;
+    std::chrono::steady_clock::time_point first_byte_;
+    bool handshaking_ = false;
+    bool responding_ = false;
+
+    // 本连接已完成的请求数, 以及第一个请求是否还未收到响应
+    std::size_t served_ = 0;
+    bool fresh_ = false;
+
+    // 当前响应已读到的字节数, 以及尚未计入记录的建立连接耗时, us
+    std::uint32_t bytes_ = 0;
+    std::uint32_t connect_us_ = 0;
+
+    // 当前请求计划的发出时间, 未到时 paused_ 为 true
+    std::chrono::steady_clock::time_point due_;
+    bool paused_ = false;
+
+    // 当前请求完成后读空 fd 时移交给该 bencher
+    Bencher* handoff_ = nullptr;
+
+    Hooks hooks_;
+};
+
+template <typename Transport, typename Hooks>
+Connection<Transport, Hooks>::Connection(EventLoop& ev_loop, Bencher& b,
+                                         const std::string& host,
+                                         const SslContext* ssl_ctx,
+                                         Plugin& plugin)
+    : Connection(ev_loop, b, host, ssl_ctx, plugin, b.templateState()) {}
+
+template <typename Transport, typename Hooks>
+Connection<Transport, Hooks>::Connection(EventLoop& ev_loop, Bencher& b,
+                                         const std::string& host,
+                                         const SslContext* ssl_ctx,
+                                         Plugin& plugin, TemplateState tpl)
+    : ev_loop_(ev_loop),
+      bencher_(b),
+      transport_(ssl_ctx),
+      host_(host),
+      tpl_(tpl),
+      written_(0),
+      hooks_(b, plugin) {
+    http_parser_init(&parser_, HTTP_RESPONSE);
+    parser_.data = this;
+
+    http_parser_settings_init(&parser_settings_);
+    parser_settings_.on_message_complete = &Connection::onMessageComplete;
+
+    if (hooks_.wantResponseHeaders()) {
+        parser_settings_.on_header_field = [](http_parser* parser,
+                                              const char* s, std::size_t len) {
+            auto c = static_cast<Connection*>(parser->data);
+            if (c->header_state_ == HeaderState::VALUE) {
+                c->headers_.push_back('\x01');
+                c->header_state_ = HeaderState::FIELD;
+            }
+            c->headers_.append(s, len);
+
+            return 0;
+        };
+
+        parser_settings_.on_header_value = [](http_parser* parser,
+                                              const char* s, std::size_t len) {
+            auto c = static_cast<Connection*>(parser->data);
+            if (c->header_state_ == HeaderState::FIELD) {
+                c->headers_.push_back(':');
+                c->header_state_ = HeaderState::VALUE;
+            }
+            c->headers_.append(s, len);
+
+            return 0;
+        };
+    }
+
+    if (hooks_.wantResponseBody()) {
+        parser_settings_.on_body = [](http_parser* parser, const char* s,
+                                      std::size_t len) {
+            auto c = static_cast<Connection*>(parser->data);
+            c->body_.append(s, len);
+
+            return 0;
+        };
+    }
+}
+
+template <typename Transport, typename Hooks>
+int Connection<Transport, Hooks>::onMessageComplete(http_parser* parser) {
+    auto c = static_cast<Connection*>(parser->data);
+
+    const unsigned status = parser->status_code;
+
+    const auto now = std::chrono::steady_clock::now();
+    // 开环时排队等待发出的时间也计入, 避免 coordinated omission
+    const auto from = c->bencher_.openLoop() ? std::min(c->due_, c->start_) : c->start_;
+    const auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - from);
+    c->bencher_.complete(c->ep_, status, elapsed.count());
+    c->bencher_.phase(Phase::TRANSFER, now - c->first_byte_);
+    c->responding_ = false;
+    if (c->bencher_.tracing()) {
+        c->trace(now, status);
+    }
+
+    if (Hooks::enabled) {
+        c->hooks_.response(status, std::move(c->headers_), std::move(c->body_));
+    }
+
+    if (c->bencher_.paced()) {
+        c->pace(now);
+    }
+
+    // 由客户端关闭的连接同样经 reconnect 重建
+    const std::size_t limit = c->bencher_.config().requests_per_conn;
+    if (!http_should_keep_alive(parser) || (limit && ++c->served_ >= limit) ||
+        c->bencher_.churn()) {
+        c->reconnect();
+    } else {
+        c->written_ = 0;
+        if (Hooks::enabled) {
+            c->body_.clear();
+            c->headers_.clear();
+            c->header_state_ = HeaderState::FIELD;
+        }
+        http_parser_init(parser, HTTP_RESPONSE);
+        // 此时还可能读到数据, 等 response 读空 fd 后再移交
+        c->handoff_ = c->bencher_.donee();
+    }
+
+    return 0;
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::pace(std::chrono::steady_clock::time_point now) {
+    due_ = bencher_.nextRequest(due_, now);
+    if (due_ <= now) {
+        return;
+    }
+
+    // 期间断开的连接照常重连, 建立后等到 resume 才发出请求
+    paused_ = true;
+    auto self = this->shared_from_this();
+    bencher_.defer(due_, [self] { self->resume(); });
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::trace(std::chrono::steady_clock::time_point now,
+                                         unsigned status) {
+    TraceRecord r = {};
+    r.start = std::chrono::duration_cast<std::chrono::microseconds>(
+                  start_.time_since_epoch()).count();
+    // seq 每次递增 stride, 余数即初始值
+    r.conn = static_cast<std::uint32_t>(tpl_.seq % tpl_.stride);
+    r.bytes = bytes_;
+    r.connect = connect_us_;
+    if (bencher_.openLoop() && due_ < start_) {
+        r.wait = traceMicros(start_ - due_);
+    }
+    r.ttfb = traceMicros(first_byte_ - start_);
+    r.transfer = traceMicros(now - first_byte_);
+    r.endpoint = static_cast<std::uint16_t>(ep_);
+    r.status = static_cast<std::uint16_t>(status);
+    bencher_.trace(r, *req_);
+    connect_us_ = 0;
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::resume() {
+    paused_ = false;
+    // 建立中或排队等待名额时由 connected 发出请求
+    if (!connecting_ && fd_ != -1) {
+        request();
+    }
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::reconnect() {
+    // 延长生命周期，delEvent 会删除 Connection 的拷贝
+    auto self = this->shared_from_this();
+
+    ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+
+    transport_.close();
+    ::close(fd_);
+    // connect 可能排队等待名额, 在此之前 fd 号可能已被其它连接复用
+    fd_ = -1;
+    written_ = 0;
+    connect();
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::handoff() {
+    auto self = this->shared_from_this();
+
+    ev_loop_.detach(fd_);
+    bencher_.handoff(*handoff_, new Handoff{fd_, tpl_, served_, due_, paused_, nullptr});
+
+    // 暂停中的 resume 之后看到 fd_ 为 -1, 什么也不做
+    handoff_ = nullptr;
+    fd_ = -1;
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::adopt(Handoff& h) {
+    auto self = this->shared_from_this();
+
+    if (!ev_loop_.addEvent(h.fd, Mask::WRITABLE, [self] { self->request(); }) ||
+        !ev_loop_.addEvent(h.fd, Mask::READABLE, [self] { self->response(); })) {
+        ev_loop_.delEvent(h.fd, Mask::READABLE | Mask::WRITABLE);
+        ::close(h.fd);
+        connect();
+        return;
+    }
+
+    if (bencher_.config().timestamping) {
+        transport_.timestamping(h.fd);
+    }
+
+    fd_ = h.fd;
+    served_ = h.served;
+    due_ = h.due;
+    paused_ = h.paused;
+    if (paused_) {
+        bencher_.defer(due_, [self] { self->resume(); });
+    } else {
+        request();
+    }
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::connect() {
+    auto self = this->shared_from_this();
+
+    // 建立中的连接已达上限时排队, 有名额时再调用 connect
+    if (!bencher_.beginConnect([self] { self->connect(); })) {
+        return;
+    }
+    connecting_ = true;
+
+    connect_start_ = std::chrono::steady_clock::now();
+    const int fd = dial(bencher_.addr(), bencher_.socketOptions());
+    if (fd == -1) {
+        failConnect();
+        return;
+    }
+
+    if (!ev_loop_.addEvent(fd, Mask::WRITABLE, [self] { self->connected(); }) ||
+        !ev_loop_.addEvent(fd, Mask::READABLE, [self] { self->response(); })) {
+        ev_loop_.delEvent(fd, Mask::READABLE | Mask::WRITABLE);
+        ::close(fd);
+        failConnect();
+        return;
+    }
+
+    if (bencher_.config().timestamping) {
+        transport_.timestamping(fd);
+    }
+
+    fd_ = fd;
+    written_ = 0;
+    served_ = 0;
+    handoff_ = nullptr;
+    fresh_ = true;
+    handshaking_ = false;
+    responding_ = false;
+    body_.clear();
+    headers_.clear();
+    header_state_ = HeaderState::FIELD;
+    http_parser_init(&parser_, HTTP_RESPONSE);
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::failConnect() {
+    Metrics::getInstance().count(Metrics::Kind::ECONNECT);
+
+    connecting_ = false;
+    fd_ = -1;
+    bencher_.endConnect();
+
+    auto self = this->shared_from_this();
+    bencher_.retryConnect(++failures_, [self] { self->connect(); });
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::connected() {
+    const auto now = std::chrono::steady_clock::now();
+    auto self = this->shared_from_this();
+
+    if (!established(fd_)) {
+        ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+        ::close(fd_);
+        fd_ = -1;
+        failConnect();
+        return;
+    }
+
+    connecting_ = false;
+    failures_ = 0;
+    bencher_.endConnect();
+    bencher_.phase(Phase::CONNECT, now - connect_start_);
+    connect_us_ = traceMicros(now - connect_start_);
+
+    if (!ev_loop_.addEvent(fd_, Mask::WRITABLE, [self] { self->request(); })) {
+        return;
+    }
+
+    if (transport_.handshake(fd_, host_)) {
+        request();
+    } else {
+        handshaking_ = true;
+        handshake_start_ = now;
+    }
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::request() {
+    if (written_ == 0) {
+        if (paused_) {
+            return;
+        }
+
+        if (bencher_.replaying()) {
+            // 统计计入唯一的 endpoint
+            auto self = this->shared_from_this();
+            if (!bencher_.replay(replayed_, due_, [self] { self->resume(); })) {
+                paused_ = true;
+                return;
+            }
+            ep_ = 0;
+            req_ = &replayed_;
+        } else {
+            ep_ = bencher_.pick();
+
+            const Endpoint& ep = bencher_.endpoints()[ep_];
+            if (ep.dynamic()) {
+                ep.render(rendered_, scratch_, tpl_);
+                req_ = &rendered_;
+            } else {
+                req_ = &ep.req;
+            }
+        }
+
+        // 插件返回 NULL 时沿用其上一次的请求
+        if (Hooks::enabled && hooks_.wantRequest()) {
+            if (plugin_req_.empty()) {
+                plugin_req_ = *req_;
+            }
+            hooks_.request(plugin_req_);
+            req_ = &plugin_req_;
+        }
+
+        start_ = std::chrono::steady_clock::now();
+        bytes_ = 0;
+        if (bencher_.openLoop() && due_ == std::chrono::steady_clock::time_point()) {
+            due_ = start_;
+        }
+        if (bencher_.openLoop() || bencher_.replaying()) {
+            bencher_.phase(Phase::SCHEDULE, start_ - due_);
+        }
+    }
+
+    while (written_ < req_->size()) {
+        const char* buf = req_->data() + written_;
+        const std::size_t len = req_->size() - written_;
+
+        const ssize_t n = transport_.write(fd_, buf, len);
+        if (n >= 0) {
+            written_ += static_cast<std::size_t>(n);
+
+            // 首次写入成功即握手完成, 请求从此刻才真正发出
+            if (handshaking_) {
+                handshaking_ = false;
+                start_ = std::chrono::steady_clock::now();
+                bencher_.phase(Phase::TLS, start_ - handshake_start_);
+                connect_us_ += traceMicros(start_ - handshake_start_);
+            }
+        } else if (errno == EAGAIN) {
+            break;
+        } else {
+            bencher_.fail(ep_, Metrics::Kind::EWRITE);
+            reconnect();
+            return;
+        }
+    }
+}
+
+template <typename Transport, typename Hooks>
+void Connection<Transport, Hooks>::response() {
+    // 连接失败的 EPOLLERR 由 read callback 先收到
+    if (connecting_) {
+        connected();
+        // 失败或首次写入出错后已在重连, 此时的 fd 不再是本次事件的 fd
+        if (fd_ == -1 || connecting_) {
+            return;
+        }
+    }
+
+    ssize_t n = 0;
+    while ((n = transport_.read(fd_, buf_, sizeof(buf_))) > 0) {
+        Metrics::getInstance().count(Metrics::Kind::BYTES, n);
+        bytes_ += static_cast<std::uint32_t>(n);
+
+        if (!responding_) {
+            responding_ = true;
+            first_byte_ = std::chrono::steady_clock::now();
+
+            const auto ttfb = first_byte_ - start_;
+            bencher_.phase(Phase::TTFB, ttfb);
+            if (fresh_) {
+                fresh_ = false;
+                bencher_.phase(Phase::ACCEPT, ttfb);
+            }
+
+            std::chrono::nanoseconds wire;
+            if (transport_.wire(wire)) {
+                bencher_.phase(Phase::WIRE, wire);
+                bencher_.phase(Phase::OVERHEAD,
+                               std::max<std::chrono::nanoseconds>(
+                                   ttfb - wire, std::chrono::nanoseconds::zero()));
+            }
+        }
+
+        const std::size_t parsed = http_parser_execute(&parser_, &parser_settings_, buf_, n);
+        // 响应要求关闭时回调中已在重连, 不能再读 fd_
+        if (fd_ == -1 || connecting_) {
+            return;
+        }
+        if (parsed != static_cast<std::size_t>(n)) {
+            bencher_.fail(ep_, Metrics::Kind::EREAD);
+            reconnect();
+            return;
+        }
+    }
+
+    if (n == 0) {
+        if (!http_body_is_final(&parser_)) {
+            bencher_.fail(ep_, Metrics::Kind::EREAD);
+        }
+        reconnect();
+    } else if (errno != EAGAIN) {
+        bencher_.fail(ep_, Metrics::Kind::EREAD);
+        reconnect();
+    } else if (handoff_) {
+        handoff();
+    } else if (bencher_.socketOptions().quickack) {
+        quickAck(fd_);
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,125 @@
+#include "delay.hpp"
+#include <cmath>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace moros {
+
+namespace {
+
+// 非负的 ms 数, 否则返回 false
+bool parseMs(const std::string& s, double& v) {
+    char* end = nullptr;
+    v = std::strtod(s.c_str(), &end);
+    return !s.empty() && *end == '\0' && v >= 0;
+}
+
+}
+
+DelayDistribution::DelayDistribution(const std::string& spec) {
+    if (spec.empty()) {
+        return;
+    }
+
+    const auto invalid = [&] { return std::invalid_argument("Invalid delay: " + spec); };
+
+    const std::size_t colon = spec.find(':');
+    if (colon == std::string::npos) {
+        throw invalid();
+    }
+    const std::string kind = spec.substr(0, colon);
+
+    // 空行与 # 开头的行被忽略
+    if (kind == "file") {
+        const std::string path = spec.substr(colon + 1);
+        std::ifstream in(path);
+        if (!in) {
+            throw std::invalid_argument("Failed to open delay samples " + path);
+        }
+
+        auto samples = std::make_shared<std::vector<double>>();
+        std::size_t n = 0;
+        for (std::string line; std::getline(in, line);) {
+            ++n;
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \t\r") + 1);
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            double v;
+            if (!parseMs(line, v)) {
+                throw std::invalid_argument(path + ":" + std::to_string(n) +
+                                            ": invalid delay " + line);
+            }
+            samples->push_back(v);
+        }
+        if (samples->empty()) {
+            throw std::invalid_argument("No delay samples in " + path);
+        }
+
+        kind_ = Kind::FILE;
+        samples_ = std::move(samples);
+        return;
+    }
+
+    std::vector<double> args;
+    std::size_t pos = colon + 1;
+    for (;;) {
+        const std::size_t comma = spec.find(',', pos);
+        const std::string s = spec.substr(pos, comma == std::string::npos ? comma : comma - pos);
+
+        double v;
+        if (!parseMs(s, v)) {
+            throw invalid();
+        }
+        args.push_back(v);
+
+        if (comma == std::string::npos) {
+            break;
+        }
+        pos = comma + 1;
+    }
+
+    if (kind == "fixed" && args.size() == 1) {
+        kind_ = Kind::FIXED;
+        a_ = args[0];
+    } else if (kind == "uniform" && args.size() == 2 && args[0] <= args[1]) {
+        kind_ = Kind::UNIFORM;
+        a_ = args[0];
+        b_ = args[1];
+    } else if (kind == "exp" && args.size() == 1 && args[0] > 0) {
+        kind_ = Kind::EXP;
+        a_ = args[0];
+    } else {
+        throw invalid();
+    }
+}
+
+bool DelayDistribution::none() const noexcept {
+    return kind_ == Kind::NONE;
+}
+
+std::chrono::microseconds DelayDistribution::operator()(std::mt19937_64& rng) const {
+    double ms = 0;
+    switch (kind_) {
+    case Kind::NONE:
+        break;
+    case Kind::FIXED:
+        ms = a_;
+        break;
+    case Kind::UNIFORM:
+        ms = std::uniform_real_distribution<double>(a_, b_)(rng);
+        break;
+    case Kind::EXP:
+        ms = std::exponential_distribution<double>(1 / a_)(rng);
+        break;
+    case Kind::FILE:
+        ms = (*samples_)[std::uniform_int_distribution<std::size_t>(
+            0, samples_->size() - 1)(rng)];
+        break;
+    }
+    return std::chrono::microseconds(std::llround(ms * 1000));
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef MOROS_DELAY_HPP_
+#define MOROS_DELAY_HPP_
+
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace moros {
+
+// 延迟的分布, 单位 ms, 可带小数:
+//   fixed:D        固定延迟
+//   uniform:A,B    [A, B) 内均匀分布
+//   exp:MEAN       指数分布, 作为间隔时即泊松到达
+//   file:PATH      经验分布, 从文件每行一个的样本中等概率抽取
+// 空串表示没有延迟
+class DelayDistribution {
+public:
+    // 格式错误或文件无法读取时抛出 std::invalid_argument
+    explicit DelayDistribution(const std::string& spec = "");
+
+    bool none() const noexcept;
+
+    std::chrono::microseconds operator()(std::mt19937_64& rng) const;
+
+private:
+    enum class Kind {
+        NONE,
+        FIXED,
+        UNIFORM,
+        EXP,
+        FILE,
+    };
+
+    Kind kind_ = Kind::NONE;
+    double a_ = 0, b_ = 0;
+    // 拷贝之间共享
+    std::shared_ptr<const std::vector<double>> samples_;
+};
+
+}
+
+#endif
@@ -0,0 +1,502 @@
+#include "distributed.hpp"
+#include "histlog.hpp"
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <sstream>
+#include <thread>
+#include <stdexcept>
+
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/time.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <netdb.h>
+
+namespace moros {
+
+namespace {
+
+constexpr std::size_t KINDS = static_cast<std::size_t>(Metrics::Kind::MAX);
+
+// agent 在认证与接收参数时的限制, 防止对端占住子进程或耗尽内存
+constexpr std::size_t MAX_AGENT_ARGS = 256;
+constexpr std::size_t MAX_AGENT_LINE = 4096;
+constexpr int AGENT_HANDSHAKE_TIMEOUT = 10;
+
+std::runtime_error agentError(const std::string& name, const std::string& what) {
+    return std::runtime_error("agent " + name + ": " + what);
+}
+
+int connectTo(const std::string& agent) {
+    const std::size_t colon = agent.rfind(':');
+    if (colon == std::string::npos || colon == 0 || colon + 1 == agent.size()) {
+        throw std::runtime_error("invalid agent address " + agent);
+    }
+    std::string host = agent.substr(0, colon);
+    if (host.front() == '[' && host.back() == ']') {
+        host = host.substr(1, host.size() - 2);
+    }
+    const std::string port = agent.substr(colon + 1);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+
+    struct addrinfo* result = nullptr;
+    const int ret = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (ret != 0) {
+        throw agentError(agent, ::gai_strerror(ret));
+    }
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(
+        result, ::freeaddrinfo);
+
+    for (auto ai = result; ai; ai = ai->ai_next) {
+        const int fd = ::socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd == -1) {
+            continue;
+        }
+        if (::connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) {
+            const int flags = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+            return fd;
+        }
+        ::close(fd);
+    }
+    throw agentError(agent, std::strerror(errno));
+}
+
+// 比较耗时与 token 的内容无关
+bool sameToken(const std::string& given, const std::string& token) noexcept {
+    if (token.empty() || given.size() != token.size()) {
+        return false;
+    }
+    unsigned char diff = 0;
+    for (std::size_t i = 0; i < token.size(); ++i) {
+        diff |= static_cast<unsigned char>(given[i] ^ token[i]);
+    }
+    return diff == 0;
+}
+
+void receiveTimeout(int fd, int seconds) noexcept {
+    struct timeval tv = {seconds, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+}
+
+// 拆出 line 开头的命令, 其余部分留在 rest
+std::string command(const std::string& line, std::string& rest) {
+    const std::size_t sp = line.find(' ');
+    if (sp == std::string::npos) {
+        rest.clear();
+        return line;
+    }
+    rest = line.substr(sp + 1);
+    return line.substr(0, sp);
+}
+
+}
+
+void Snapshot::merge(const Snapshot& rhs) {
+    for (std::size_t i = 0; i < KINDS; ++i) {
+        counters[i] += rhs.counters[i];
+    }
+
+    if (!rhs.latency) {
+        return;
+    }
+    if (!latency) {
+        latency = std::make_unique<Stats>(*rhs.latency);
+    } else {
+        latency->merge(*rhs.latency);
+    }
+}
+
+Snapshot Snapshot::decode(const std::string& s) {
+    Snapshot snap;
+
+    std::istringstream is(s);
+    for (auto& c : snap.counters) {
+        if (!(is >> c)) {
+            throw std::runtime_error("invalid snapshot counters");
+        }
+    }
+
+    std::string hist;
+    is >> hist;
+    snap.latency = decodeHistogram(hist);
+    if (!snap.latency) {
+        throw std::runtime_error("invalid snapshot histogram");
+    }
+    return snap;
+}
+
+std::string encodeSnapshot(const std::uint64_t counters[], const Stats& latency) {
+    std::string out;
+    for (std::size_t i = 0; i < KINDS; ++i) {
+        out += std::to_string(counters[i]);
+        out.push_back(' ');
+    }
+    return out + encodeHistogram(latency);
+}
+
+std::string encodeSnapshot(const Metrics& m, const Stats& latency) {
+    std::uint64_t counters[KINDS];
+    for (std::size_t i = 0; i < KINDS; ++i) {
+        counters[i] = m[static_cast<Metrics::Kind>(i)];
+    }
+    return encodeSnapshot(counters, latency);
+}
+
+LineChannel::LineChannel(int fd) noexcept : fd_(fd) {}
+
+LineChannel::~LineChannel() {
+    ::close(fd_);
+}
+
+std::string LineChannel::read(std::size_t limit) {
+    for (;;) {
+        const std::size_t eol = buf_.find('\n');
+        if (eol != std::string::npos && eol <= limit) {
+            std::string line = buf_.substr(0, eol);
+            buf_.erase(0, eol + 1);
+            return line;
+        }
+        if (buf_.size() > limit) {
+            throw std::runtime_error("line too long");
+        }
+
+        char buf[4096];
+        const ssize_t n = ::recv(fd_, buf, sizeof(buf), 0);
+        if (n > 0) {
+            buf_.append(buf, n);
+        } else if (n == 0) {
+            throw std::runtime_error("connection closed");
+        } else if (errno != EINTR) {
+            throw std::runtime_error(std::strerror(errno));
+        }
+    }
+}
+
+void LineChannel::write(const std::string& line) {
+    const std::string data = line + '\n';
+    for (std::size_t off = 0; off < data.size();) {
+        const ssize_t n = ::send(fd_, data.data() + off, data.size() - off, MSG_NOSIGNAL);
+        if (n >= 0) {
+            off += n;
+        } else if (errno != EINTR) {
+            throw std::runtime_error(std::strerror(errno));
+        }
+    }
+}
+
+int listenAgent(const std::string& listen) {
+    std::string host = "127.0.0.1", port = listen;
+    const std::size_t colon = listen.rfind(':');
+    if (colon != std::string::npos) {
+        host = listen.substr(0, colon);
+        port = listen.substr(colon + 1);
+        if (host.size() > 1 && host.front() == '[' && host.back() == ']') {
+            host = host.substr(1, host.size() - 2);
+        }
+    }
+    if (host.empty() || port.empty() || port.size() > 5 ||
+        port.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoul(port) > 65535) {
+        throw std::runtime_error("invalid agent address " + listen);
+    }
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_UNSPEC;
+    hints.ai_socktype = SOCK_STREAM;
+    hints.ai_flags = AI_PASSIVE;
+
+    struct addrinfo* result = nullptr;
+    const int ret = ::getaddrinfo(host.c_str(), port.c_str(), &hints, &result);
+    if (ret != 0) {
+        throw std::runtime_error("agent listen on " + listen + ": " + ::gai_strerror(ret));
+    }
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(
+        result, ::freeaddrinfo);
+
+    const int lfd = ::socket(result->ai_family, result->ai_socktype, result->ai_protocol);
+    if (lfd == -1) {
+        throw std::runtime_error(std::string("agent socket: ") + std::strerror(errno));
+    }
+
+    const int on = 1;
+    ::setsockopt(lfd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    if (::bind(lfd, result->ai_addr, result->ai_addrlen) == -1 || ::listen(lfd, 16) == -1) {
+        const std::string err = std::strerror(errno);
+        ::close(lfd);
+        throw std::runtime_error("agent listen on " + listen + ": " + err);
+    }
+    return lfd;
+}
+
+int serveAgent(int lfd) {
+    // 子进程结束后自动回收
+    std::signal(SIGCHLD, SIG_IGN);
+
+    for (;;) {
+        const int fd = ::accept(lfd, nullptr, nullptr);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            throw std::runtime_error(std::string("agent accept: ") + std::strerror(errno));
+        }
+
+        const pid_t pid = ::fork();
+        if (pid == 0) {
+            ::close(lfd);
+            std::signal(SIGCHLD, SIG_DFL);
+
+            const int flags = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flags, sizeof(flags));
+            return fd;
+        }
+        ::close(fd);
+    }
+}
+
+AgentSession::AgentSession(int fd) noexcept : ch_(fd) {}
+
+AgentSession::~AgentSession() {
+    if (!ready_) {
+        try {
+            ch_.write("ERROR agent failed to start the test, see its stderr");
+        } catch (const std::exception&) {
+        }
+    }
+}
+
+std::vector<std::string> AgentSession::args(const std::string& token) {
+    receiveTimeout(ch_.fd(), AGENT_HANDSHAKE_TIMEOUT);
+
+    // 认证失败时不回复任何内容
+    std::string rest;
+    if (command(ch_.read(MAX_AGENT_LINE), rest) != "AUTH" || !sameToken(rest, token)) {
+        ready_ = true;
+        throw std::runtime_error("coordinator failed to authenticate");
+    }
+
+    if (command(ch_.read(MAX_AGENT_LINE), rest) != "RUN") {
+        throw std::runtime_error("expect RUN from coordinator");
+    }
+    if (rest.empty() || rest.size() > 3 ||
+        rest.find_first_not_of("0123456789") != std::string::npos ||
+        std::stoul(rest) > MAX_AGENT_ARGS) {
+        throw std::runtime_error("too many arguments from coordinator");
+    }
+
+    std::vector<std::string> args(std::stoul(rest));
+    for (auto& a : args) {
+        a = ch_.read(MAX_AGENT_LINE);
+    }
+    return args;
+}
+
+void AgentSession::reject(const std::string& why) noexcept {
+    ready_ = true;
+    try {
+        ch_.write("ERROR " + why);
+    } catch (const std::exception&) {
+    }
+}
+
+void AgentSession::start() {
+    ready_ = true;
+    ch_.write("READY");
+
+    // 其它 agent 的准备时间不定, 等待 START 不限时
+    receiveTimeout(ch_.fd(), 0);
+
+    std::string rest;
+    if (command(ch_.read(), rest) != "START") {
+        throw std::runtime_error("expect START from coordinator");
+    }
+
+    const std::chrono::system_clock::time_point at(
+        std::chrono::milliseconds(std::stoull(rest)));
+    std::this_thread::sleep_until(at);
+}
+
+bool AgentSession::interval(std::chrono::milliseconds elapsed,
+                            std::chrono::milliseconds span,
+                            const std::string& snapshot) noexcept {
+    try {
+        ch_.write("INTERVAL " + std::to_string(elapsed.count()) + " " +
+                  std::to_string(span.count()) + " " + snapshot);
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+bool AgentSession::done(std::chrono::milliseconds runtime, const Stats& requests,
+                        const std::string& total,
+                        const std::vector<std::string>& threads,
+                        const std::vector<std::string>& endpoints,
+                        const std::vector<Stats>& phases) noexcept {
+    try {
+        ch_.write("DONE " + std::to_string(runtime.count()) + " " +
+                  encodeHistogram(requests) + " " + total);
+        for (const auto& t : threads) {
+            ch_.write("THREAD " + t);
+        }
+        for (const auto& ep : endpoints) {
+            ch_.write("ENDPOINT " + ep);
+        }
+        for (const auto& st : phases) {
+            ch_.write("PHASE " + encodeHistogram(st));
+        }
+        ch_.write("END");
+    } catch (const std::exception&) {
+        return false;
+    }
+    return true;
+}
+
+Coordinator::Coordinator(const std::vector<std::string>& agents, const std::string& token)
+    : names_(agents), token_(token) {
+    for (const auto& a : agents) {
+        agents_.push_back(std::make_unique<LineChannel>(connectTo(a)));
+    }
+}
+
+std::size_t Coordinator::size() const noexcept {
+    return agents_.size();
+}
+
+void Coordinator::start(const std::vector<std::string>& args,
+                        std::chrono::milliseconds delay) {
+    for (std::size_t i = 0; i < agents_.size(); ++i) {
+        try {
+            agents_[i]->write("AUTH " + token_);
+            agents_[i]->write("RUN " + std::to_string(args.size()));
+            for (const auto& a : args) {
+                agents_[i]->write(a);
+            }
+        } catch (const std::exception& e) {
+            throw agentError(names_[i], e.what());
+        }
+    }
+
+    // 各 agent 的准备时间不同, 全部就绪后才约定开始时间
+    for (std::size_t i = 0; i < agents_.size(); ++i) {
+        std::string line, rest;
+        try {
+            line = agents_[i]->read();
+        } catch (const std::exception& e) {
+            throw agentError(names_[i], e.what());
+        }
+        if (command(line, rest) != "READY") {
+            throw agentError(names_[i], line);
+        }
+    }
+
+    const auto at = std::chrono::duration_cast<std::chrono::milliseconds>(
+        (std::chrono::system_clock::now() + delay).time_since_epoch());
+    for (std::size_t i = 0; i < agents_.size(); ++i) {
+        try {
+            agents_[i]->write("START " + std::to_string(at.count()));
+        } catch (const std::exception& e) {
+            throw agentError(names_[i], e.what());
+        }
+    }
+}
+
+Snapshot Coordinator::interval(std::chrono::milliseconds& elapsed,
+                               std::chrono::milliseconds& span) {
+    Snapshot merged;
+    for (std::size_t i = 0; i < agents_.size(); ++i) {
+        try {
+            std::string rest;
+            const std::string line = agents_[i]->read();
+            if (command(line, rest) != "INTERVAL") {
+                throw std::runtime_error("unexpected " + line.substr(0, 32));
+            }
+
+            std::istringstream is(rest);
+            std::uint64_t e = 0, s = 0;
+            is >> e >> s >> std::ws;
+            elapsed = std::chrono::milliseconds(e);
+            span = std::chrono::milliseconds(s);
+
+            std::string snap;
+            std::getline(is, snap);
+            merged.merge(Snapshot::decode(snap));
+        } catch (const std::exception& e) {
+            throw agentError(names_[i], e.what());
+        }
+    }
+    return merged;
+}
+
+ClusterResult Coordinator::finish() {
+    ClusterResult res;
+    for (std::size_t i = 0; i < agents_.size(); ++i) {
+        try {
+            std::string rest;
+            const std::string line = agents_[i]->read();
+            if (command(line, rest) != "DONE") {
+                throw std::runtime_error("unexpected " + line.substr(0, 32));
+            }
+
+            std::istringstream is(rest);
+            std::uint64_t runtime = 0;
+            std::string requests;
+            is >> runtime >> requests >> std::ws;
+            res.runtime = std::max(res.runtime, std::chrono::milliseconds(runtime));
+
+            auto st = decodeHistogram(requests);
+            if (!st) {
+                throw std::runtime_error("invalid requests histogram");
+            }
+            if (!res.requests) {
+                res.requests = std::move(st);
+            } else {
+                res.requests->merge(*st);
+            }
+
+            std::string snap;
+            std::getline(is, snap);
+            res.total.merge(Snapshot::decode(snap));
+
+            std::size_t ep = 0, phase = 0;
+            for (;;) {
+                const std::string cmd = command(agents_[i]->read(), rest);
+                if (cmd == "THREAD") {
+                    res.threads.push_back(Snapshot::decode(rest));
+                } else if (cmd == "ENDPOINT") {
+                    if (ep == res.endpoints.size()) {
+                        res.endpoints.emplace_back();
+                    }
+                    res.endpoints[ep++].merge(Snapshot::decode(rest));
+                } else if (cmd == "PHASE") {
+                    auto st = decodeHistogram(rest);
+                    if (!st) {
+                        throw std::runtime_error("invalid phase histogram");
+                    }
+                    if (phase == res.phases.size()) {
+                        res.phases.push_back(std::move(st));
+                    } else {
+                        res.phases[phase]->merge(*st);
+                    }
+                    ++phase;
+                } else if (cmd == "END") {
+                    break;
+                } else {
+                    throw std::runtime_error("unexpected " + cmd);
+                }
+            }
+        } catch (const std::exception& e) {
+            throw agentError(names_[i], e.what());
+        }
+    }
+    return res;
+}
+
+}
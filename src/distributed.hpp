@@ -0,0 +1,150 @@
+#ifndef MOROS_DISTRIBUTED_HPP_
+#define MOROS_DISTRIBUTED_HPP_
+
+#include "stats.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+// 分布式模式: coordinator 经 TCP 把同一组命令行参数下发给多个 agent,
+// 约定共同的开始时间, 再在每个 interval 与测试结束时收集各 agent 的
+// 原始计数与直方图, 合并成一份报告.
+//
+// 协议为文本行, 直方图使用 HdrHistogram 压缩编码:
+//   C -> A  AUTH <token>
+//   C -> A  RUN <n>, 随后 n 行参数
+//   A -> C  READY 或 ERROR <msg>
+//   C -> A  START <unix ms>
+//   A -> C  INTERVAL <elapsed ms> <span ms> <snapshot>, 每个 interval 一行
+//   A -> C  DONE <runtime ms> <requests histogram> <snapshot>
+//   A -> C  THREAD <snapshot>, 每个 bencher 一行
+//   A -> C  ENDPOINT <snapshot>, 每个 endpoint 一行
+//   A -> C  PHASE <histogram>, 按 Phase 的顺序每个阶段一行
+//   A -> C  END
+
+namespace moros {
+
+// 可直接相加的一份统计: Metrics 各项计数与 latency 直方图
+struct Snapshot {
+    std::uint64_t counters[static_cast<std::size_t>(Metrics::Kind::MAX)] = {};
+    std::unique_ptr<Stats> latency;
+
+    std::uint64_t operator[](Metrics::Kind k) const noexcept {
+        return counters[static_cast<std::size_t>(k)];
+    }
+
+    // 直方图的可记录范围可以不同
+    void merge(const Snapshot& rhs);
+
+    // 格式错误抛出 std::runtime_error
+    static Snapshot decode(const std::string& s);
+};
+
+std::string encodeSnapshot(const std::uint64_t counters[], const Stats& latency);
+std::string encodeSnapshot(const Metrics& m, const Stats& latency);
+
+// 阻塞 socket 上的按行收发, 对端关闭或出错时抛出 std::runtime_error
+class LineChannel {
+public:
+    explicit LineChannel(int fd) noexcept;
+    ~LineChannel();
+
+    LineChannel(const LineChannel&) = delete;
+    LineChannel& operator=(const LineChannel&) = delete;
+
+    // 超过 limit 字节仍未读到行尾时抛出 std::runtime_error
+    std::string read(std::size_t limit = std::string::npos);
+    void write(const std::string& line);
+
+    int fd() const noexcept {
+        return fd_;
+    }
+
+private:
+    int fd_;
+    std::string buf_;
+};
+
+// 按 "[ADDR:]PORT" 监听, 未给出地址时只监听 127.0.0.1; 返回监听的 fd,
+// 地址无效或监听失败抛出 std::runtime_error
+int listenAgent(const std::string& listen);
+
+// 为 lfd 上的每个 coordinator 连接 fork 一个子进程, 子进程返回连接的 fd,
+// 父进程一直服务下去; accept 失败抛出 std::runtime_error
+int serveAgent(int lfd);
+
+// agent 端的一次测试
+class AgentSession {
+public:
+    explicit AgentSession(int fd) noexcept;
+
+    // 未能就绪就结束时告知 coordinator
+    ~AgentSession();
+
+    // 校验 coordinator 的 token 后返回其下发的命令行参数. token 不符,
+    // 参数过多或过长, 或 coordinator 迟迟不发送时抛出 std::runtime_error
+    std::vector<std::string> args(const std::string& token);
+
+    // 拒绝下发的参数, why 交给 coordinator 报告
+    void reject(const std::string& why) noexcept;
+
+    // 通知就绪并阻塞到约定的开始时间
+    void start();
+
+    // 以下在 coordinator 断开时返回 false
+    bool interval(std::chrono::milliseconds elapsed,
+                  std::chrono::milliseconds span, const std::string& snapshot) noexcept;
+
+    // threads 与 endpoints 为 encodeSnapshot 的结果
+    bool done(std::chrono::milliseconds runtime, const Stats& requests,
+              const std::string& total, const std::vector<std::string>& threads,
+              const std::vector<std::string>& endpoints,
+              const std::vector<Stats>& phases) noexcept;
+
+private:
+    LineChannel ch_;
+    bool ready_ = false;
+};
+
+// 合并后的最终结果
+struct ClusterResult {
+    // 取各 agent 中最长的
+    std::chrono::milliseconds runtime{0};
+    Snapshot total;
+    std::unique_ptr<Stats> requests;
+    // 各 agent 的 bencher 依次排列
+    std::vector<Snapshot> threads;
+    // 按下标合并
+    std::vector<Snapshot> endpoints;
+    std::vector<std::unique_ptr<Stats>> phases;
+};
+
+class Coordinator {
+public:
+    // agents 形如 host:port, token 与各 agent 的相同, 连接失败抛出
+    // std::runtime_error
+    Coordinator(const std::vector<std::string>& agents, const std::string& token);
+
+    std::size_t size() const noexcept;
+
+    // 下发参数, 所有 agent 就绪后约定 delay 之后同时开始,
+    // 任何 agent 出错抛出 std::runtime_error
+    void start(const std::vector<std::string>& args,
+               std::chrono::milliseconds delay);
+
+    // 读取每个 agent 的下一个 interval 并合并
+    Snapshot interval(std::chrono::milliseconds& elapsed,
+                      std::chrono::milliseconds& span);
+
+    ClusterResult finish();
+
+private:
+    std::vector<std::string> names_;
+    std::string token_;
+    std::vector<std::unique_ptr<LineChannel>> agents_;
+};
+
+}
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef MOROS_ESCAPE_HPP_
+#define MOROS_ESCAPE_HPP_
+
+#include <string>
+#include <boost/format.hpp>
+
+namespace moros {
+
+// 带引号的 JSON 字符串, 转义引号, 反斜杠与控制字符
+inline std::string jsonString(const std::string& s) {
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"' || c == '\\') {
+            out.push_back('\\');
+            out.push_back(c);
+        } else if (static_cast<unsigned char>(c) < 0x20) {
+            out += str(boost::format("\\u%04x") % static_cast<int>(c));
+        } else {
+            out.push_back(c);
+        }
+    }
+    out.push_back('"');
+    return out;
+}
+
+// CSV 字段: 含逗号, 引号或换行时加引号, 其中的引号写两次
+inline std::string csvField(const std::string& s) {
+    if (s.find_first_of(",\"\r\n") == std::string::npos) {
+        return s;
+    }
+    std::string out = "\"";
+    for (char c : s) {
+        if (c == '"') {
+            out.push_back('"');
+        }
+        out.push_back(c);
+    }
+    out.push_back('"');
+    return out;
+}
+
+}
+
+#endif
@@ -1,12 +1,14 @@
 #ifndef MOROS_EV_HPP_
 #define MOROS_EV_HPP_
 
+#include "stats.hpp"
 #include <new>
 #include <chrono>
 #include <cassert>
 #include <ctime>
 #include <cstdint>
 #include <vector>
+#include <algorithm>
 #include <functional>
 #include <unordered_map>
 
@@ -77,9 +79,27 @@ private:
 };
 
 
+// event loop 自身的负载, 用于判断客户端是否已成为瓶颈, 耗时单位 us.
+// 与其它统计一样 warmup 期间不记录
+struct LoopStats {
+    LoopStats(std::size_t events, std::uint64_t max_us)
+        : busy(max_us), events(events + 1), lag(max_us) {}
+
+    // 一次 epoll_wait 返回后处理全部事件的耗时
+    Stats busy;
+    // 每次 epoll_wait 返回的事件数
+    Stats events;
+    // timer 实际执行晚于预定到期时刻的时间
+    Stats lag;
+    // busy 的累计, 除以测试时长即 event loop 的利用率
+    std::chrono::nanoseconds busy_total{0};
+};
+
+
 class EventLoop {
 public:
-    EventLoop(std::size_t sz) {
+    // 单次耗时超过 1 分钟的记录无意义, 按越界丢弃
+    EventLoop(std::size_t sz) : stats_(sz, 60 * 1000000) {
         epfd_ = ::epoll_create(1024);
         if (epfd_ == -1) {
             throw std::bad_alloc();
@@ -100,6 +120,11 @@ public:
         return events_.size();
     }
 
+    // 在 event loop 结束后读取
+    const LoopStats& stats() const noexcept {
+        return stats_;
+    }
+
     // 约定:
     // 如果在 evs_ 内存在，则必然已经在 epoll 中注册过
     // 同理，在 close(fd) 时也应保证 evs_ 内不存在 fd 信息
@@ -170,12 +195,22 @@ public:
                 interval - std::chrono::seconds(tv_sec))
                 .count();
 
+        // 首次触发在一个 interval 之后
+        struct timespec first = {
+            .tv_sec = now.tv_sec + tv_sec,
+            .tv_nsec = now.tv_nsec + tv_nsec,
+        };
+        if (first.tv_nsec >= 1000000000) {
+            first.tv_sec += 1;
+            first.tv_nsec -= 1000000000;
+        }
+
         const struct itimerspec ts = {
             .it_interval = {
                 .tv_sec = tv_sec,
                 .tv_nsec = tv_nsec,
             },
-            .it_value = now,
+            .it_value = first,
         };
         
         int fd = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK);
@@ -188,14 +223,40 @@ public:
             return -1;
         }
 
-        return addEvent(fd, Mask::READABLE, [&, fd, cb=std::move(cb)] {
+        // steady_clock 即 CLOCK_MONOTONIC, 用于计算 timer 的调度延迟
+        const auto period =
+            std::chrono::duration_cast<std::chrono::steady_clock::duration>(interval);
+        auto due = std::chrono::steady_clock::time_point(
+            std::chrono::seconds(first.tv_sec) + std::chrono::nanoseconds(first.tv_nsec));
+
+        return addEvent(fd, Mask::READABLE, [&, fd, period, due, cb=std::move(cb)]() mutable {
                     std::uint64_t e;
-                    ::read(fd, &e, sizeof(e));
+                    if (::read(fd, &e, sizeof(e)) == sizeof(e) && e > 0) {
+                        // 错过的周期合并为一次执行, 延迟从最早未处理的到期算起,
+                        // run 之前的到期不算作延迟
+                        if (Metrics::getInstance().enabled()) {
+                            stats_.lag.record(micros(std::chrono::steady_clock::now() -
+                                                     std::max(due, started_)));
+                        }
+                        due += period * e;
+                    }
 
                     cb();
                 }) ? fd : -1;
     }
 
+    // 从本 event loop 中移除 fd 但不关闭, 之后交给其它 event loop
+    void detach(int fd) noexcept {
+        delEvent(fd, Mask::READABLE | Mask::WRITABLE);
+        ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+    }
+
+    void delTimerEvent(int fd) noexcept {
+        delEvent(fd, Mask::READABLE);
+        ::epoll_ctl(epfd_, EPOLL_CTL_DEL, fd, nullptr);
+        ::close(fd);
+    }
+
     template <typename Rep, typename Period>
     void poll(std::chrono::duration<Rep, Period> t) noexcept {
         const int ret = ::epoll_wait(
@@ -205,6 +266,7 @@ public:
             return;
         }
 
+        const auto begin = std::chrono::steady_clock::now();
         for (std::size_t i = 0; i < static_cast<std::size_t>(ret); ++i) {
             auto& ev = events_[i];
 
@@ -226,9 +288,17 @@ public:
                 }
             }
         }
+
+        const auto busy = std::chrono::steady_clock::now() - begin;
+        if (Metrics::getInstance().enabled()) {
+            stats_.events.record(ret);
+            stats_.busy.record(micros(busy));
+            stats_.busy_total += busy;
+        }
     }
 
     void run() noexcept {
+        started_ = std::chrono::steady_clock::now();
         while (!__atomic_load_n(&stop_, __ATOMIC_RELAXED)) {
             poll(std::chrono::milliseconds(1));
         }
@@ -239,12 +309,20 @@ public:
     }
 
 private:
+    static std::uint64_t micros(std::chrono::steady_clock::duration d) noexcept {
+        const auto us = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+        return us > 0 ? us : 0;
+    }
+
     int epfd_;
     std::vector<struct epoll_event> events_;
 
     std::unordered_map<int, Event> evs_;
 
     bool stop_ = false;
+
+    std::chrono::steady_clock::time_point started_;
+    LoopStats stats_;
 };
 
 }
@@ -0,0 +1,148 @@
+#include "h2.hpp"
+#include "hpack.hpp"
+#include <cctype>
+#include <algorithm>
+
+namespace moros {
+namespace h2 {
+
+void writeFrameHeader(std::string& out, Frame type, std::uint8_t flags,
+                      std::uint32_t stream, std::size_t len) {
+    const char hdr[FRAME_HEADER_SIZE] = {
+        static_cast<char>(len >> 16),
+        static_cast<char>(len >> 8),
+        static_cast<char>(len),
+        static_cast<char>(type),
+        static_cast<char>(flags),
+        static_cast<char>((stream >> 24) & 0x7f),
+        static_cast<char>(stream >> 16),
+        static_cast<char>(stream >> 8),
+        static_cast<char>(stream),
+    };
+    out.append(hdr, sizeof(hdr));
+}
+
+void writeFrame(std::string& out, Frame type, std::uint8_t flags,
+                std::uint32_t stream, const char* payload, std::size_t len) {
+    writeFrameHeader(out, type, flags, stream, len);
+    out.append(payload, len);
+}
+
+void writeSetting(std::string& out, Setting id, std::uint32_t v) {
+    const char s[6] = {
+        static_cast<char>(static_cast<std::uint16_t>(id) >> 8),
+        static_cast<char>(id),
+        static_cast<char>(v >> 24),
+        static_cast<char>(v >> 16),
+        static_cast<char>(v >> 8),
+        static_cast<char>(v),
+    };
+    out.append(s, sizeof(s));
+}
+
+void writeWindowUpdate(std::string& out, std::uint32_t stream,
+                       std::uint32_t increment) {
+    writeFrameHeader(out, Frame::WINDOW_UPDATE, 0, stream, 4);
+    const char s[4] = {
+        static_cast<char>((increment >> 24) & 0x7f),
+        static_cast<char>(increment >> 16),
+        static_cast<char>(increment >> 8),
+        static_cast<char>(increment),
+    };
+    out.append(s, sizeof(s));
+}
+
+void writeGoaway(std::string& out, std::uint32_t last_stream, std::uint32_t error) {
+    writeFrameHeader(out, Frame::GOAWAY, 0, 0, 8);
+    const char s[8] = {
+        static_cast<char>((last_stream >> 24) & 0x7f),
+        static_cast<char>(last_stream >> 16),
+        static_cast<char>(last_stream >> 8),
+        static_cast<char>(last_stream),
+        static_cast<char>(error >> 24),
+        static_cast<char>(error >> 16),
+        static_cast<char>(error >> 8),
+        static_cast<char>(error),
+    };
+    out.append(s, sizeof(s));
+}
+
+std::uint32_t readU32(const char* p) noexcept {
+    const auto u = reinterpret_cast<const std::uint8_t*>(p);
+    return (std::uint32_t(u[0]) << 24) | (std::uint32_t(u[1]) << 16) |
+           (std::uint32_t(u[2]) << 8) | std::uint32_t(u[3]);
+}
+
+FrameHeader readFrameHeader(const char* p) noexcept {
+    const auto u = reinterpret_cast<const std::uint8_t*>(p);
+
+    FrameHeader hdr;
+    hdr.length = (std::uint32_t(u[0]) << 16) | (std::uint32_t(u[1]) << 8) | u[2];
+    hdr.type = static_cast<Frame>(u[3]);
+    hdr.flags = u[4];
+    hdr.stream = readU32(p + 5) & 0x7fffffff;
+    return hdr;
+}
+
+bool encodeRequest(const std::string& req, const char* scheme,
+                   std::string& block, std::string& body) {
+    const std::size_t head_end = req.find("\r\n\r\n");
+    if (head_end == std::string::npos) {
+        return false;
+    }
+
+    std::size_t eol = req.find("\r\n");
+    const std::size_t sp1 = req.find(' ');
+    const std::size_t sp2 = req.find(' ', sp1 + 1);
+    if (sp1 == std::string::npos || sp2 == std::string::npos || sp2 > eol) {
+        return false;
+    }
+
+    const std::string method = req.substr(0, sp1),
+                      path = req.substr(sp1 + 1, sp2 - sp1 - 1);
+
+    std::string authority;
+    std::vector<std::pair<std::string, std::string>> headers;
+    while (eol < head_end) {
+        const std::size_t begin = eol + 2;
+        eol = req.find("\r\n", begin);
+
+        const std::size_t colon = req.find(':', begin);
+        if (colon == std::string::npos || colon > eol) {
+            return false;
+        }
+
+        std::string name = req.substr(begin, colon - begin);
+        std::transform(name.begin(), name.end(), name.begin(), ::tolower);
+
+        std::size_t vbegin = colon + 1;
+        while (vbegin < eol && req[vbegin] == ' ') {
+            ++vbegin;
+        }
+        std::string value = req.substr(vbegin, eol - vbegin);
+
+        // connection-specific header 在 HTTP/2 中是非法的
+        if (name == "host") {
+            authority = std::move(value);
+        } else if (name != "connection" && name != "keep-alive" &&
+                   name != "proxy-connection" && name != "transfer-encoding" &&
+                   name != "upgrade") {
+            headers.emplace_back(std::move(name), std::move(value));
+        }
+    }
+
+    block.clear();
+    hpack::encodeHeader(block, ":method", method);
+    hpack::encodeHeader(block, ":scheme", scheme);
+    hpack::encodeHeader(block, ":authority", authority);
+    hpack::encodeHeader(block, ":path", path);
+    for (const auto& h : headers) {
+        hpack::encodeHeader(block, h.first, h.second);
+    }
+
+    body = req.substr(head_end + 4);
+    return true;
+}
+
+}
+}
@@ -0,0 +1,905 @@
+#ifndef MOROS_H2_HPP_
+#define MOROS_H2_HPP_
+
+#include "connection.hpp"
+#include "hpack.hpp"
+#include <limits>
+#include <vector>
+#include <cstdlib>
+
+namespace moros {
+namespace h2 {
+
+constexpr char PREFACE[] = "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+constexpr std::size_t FRAME_HEADER_SIZE = 9;
+constexpr std::size_t DEFAULT_FRAME_SIZE = 16384;
+constexpr std::size_t MAX_FRAME_SIZE = 16777215;
+constexpr std::uint32_t DEFAULT_WINDOW_SIZE = 65535;
+constexpr std::uint32_t MAX_WINDOW_SIZE = 0x7fffffff;
+constexpr std::uint32_t MAX_STREAM_ID = 0x7fffffff;
+
+enum class Frame : std::uint8_t {
+    DATA = 0x0,
+    HEADERS = 0x1,
+    PRIORITY = 0x2,
+    RST_STREAM = 0x3,
+    SETTINGS = 0x4,
+    PUSH_PROMISE = 0x5,
+    PING = 0x6,
+    GOAWAY = 0x7,
+    WINDOW_UPDATE = 0x8,
+    CONTINUATION = 0x9,
+};
+
+enum class Setting : std::uint16_t {
+    HEADER_TABLE_SIZE = 0x1,
+    ENABLE_PUSH = 0x2,
+    MAX_CONCURRENT_STREAMS = 0x3,
+    INITIAL_WINDOW_SIZE = 0x4,
+    MAX_FRAME_SIZE = 0x5,
+    MAX_HEADER_LIST_SIZE = 0x6,
+};
+
+constexpr std::uint8_t FLAG_END_STREAM = 0x1;
+constexpr std::uint8_t FLAG_ACK = 0x1;
+constexpr std::uint8_t FLAG_END_HEADERS = 0x4;
+constexpr std::uint8_t FLAG_PADDED = 0x8;
+constexpr std::uint8_t FLAG_PRIORITY = 0x20;
+
+// GOAWAY 与 RST_STREAM 的错误码
+constexpr std::uint32_t PROTOCOL_ERROR = 0x1;
+constexpr std::uint32_t FRAME_SIZE_ERROR = 0x6;
+
+struct FrameHeader {
+    std::uint32_t length;
+    Frame type;
+    std::uint8_t flags;
+    std::uint32_t stream;
+};
+
+void writeFrameHeader(std::string& out, Frame type, std::uint8_t flags,
+                      std::uint32_t stream, std::size_t len);
+
+void writeFrame(std::string& out, Frame type, std::uint8_t flags,
+                std::uint32_t stream, const char* payload, std::size_t len);
+
+void writeSetting(std::string& out, Setting id, std::uint32_t v);
+
+void writeWindowUpdate(std::string& out, std::uint32_t stream,
+                       std::uint32_t increment);
+
+void writeGoaway(std::string& out, std::uint32_t last_stream, std::uint32_t error);
+
+std::uint32_t readU32(const char* p) noexcept;
+
+FrameHeader readFrameHeader(const char* p) noexcept;
+
+// 将 HTTP/1.1 格式的请求转换成 HPACK header block 与 body
+bool encodeRequest(const std::string& req, const char* scheme,
+                   std::string& block, std::string& body);
+
+}
+
+
+// 单条连接上复用多个 stream, 每个 stream 独立计算 latency
+template <typename Transport, typename Hooks>
+class H2Connection
+    : public std::enable_shared_from_this<H2Connection<Transport, Hooks>> {
+public:
+    H2Connection(EventLoop& ev_loop, Bencher& b, const std::string& host,
+                 const SslContext* ssl_ctx, Plugin& plugin);
+
+    void connect();
+    void reconnect();
+
+    // 连接失败, 归还名额并在退避后重连
+    void failConnect();
+
+    void connected();
+
+    void request();
+    void response();
+
+private:
+    struct Stream {
+        std::uint32_t id;
+        std::size_t ep;
+        unsigned status;
+        std::chrono::steady_clock::time_point start;
+        // 收到响应 HEADERS 的时刻, 未收到时为默认值
+        std::chrono::steady_clock::time_point first_byte;
+        std::string headers;
+        std::string body;
+        // 收到的 header block 与 DATA 的字节数
+        std::uint32_t bytes;
+    };
+
+    enum class Result {
+        OK,
+        CLOSE,
+        ERROR,
+    };
+
+    void reset();
+    // TLS 握手由可读与可写事件共同推进, 完成时返回 true
+    bool handshaken();
+    // 握手失败或对端不同意 h2, 按建立连接失败计并退避后重连
+    void abandon();
+    void start();
+    void open();
+    void flush();
+    // 连接错误, 尽量发出带 error_ 的 GOAWAY 后再关闭
+    void goaway();
+    // 以 code 作为连接错误
+    Result fail(std::uint32_t code) noexcept;
+
+    Result process();
+    Result onFrame(const h2::FrameHeader& hdr, const char* payload);
+    Result onHeaders();
+    Result complete(std::uint32_t id);
+
+    // --trace 或 --slowest: 记录刚在 now 完成的 stream
+    void trace(const Stream& s, std::chrono::steady_clock::time_point now);
+
+    // 不再打开新的 stream, 已有的完成后换一条新连接
+    bool exhausted() const noexcept;
+
+    Stream* find(std::uint32_t id) noexcept;
+    void erase(std::uint32_t id) noexcept;
+
+    EventLoop& ev_loop_;
+    Bencher& bencher_;
+
+    int fd_ = -1;
+    Transport transport_;
+
+    // 已占用建立连接的名额, 尚未确认建立成功
+    bool connecting_ = false;
+    unsigned failures_ = 0;
+
+    std::string host_;
+
+    // 各 endpoint 的请求预先编码为 header block 与 body
+    struct Encoded {
+        std::string block;
+        std::string body;
+    };
+    std::vector<Encoded> encoded_;
+    TemplateState tpl_;
+    std::string rendered_;
+    std::string scratch_;
+    std::string plugin_req_;
+    Encoded generated_;
+    std::size_t next_ep_ = 0;
+    bool picked_ = false;
+    // 对端 GOAWAY 时未处理的 stream 的 endpoint, 在新连接上优先重新发出
+    std::vector<std::size_t> retry_;
+    bool use_generated_ = false;
+
+    std::string out_;
+    std::size_t written_ = 0;
+    std::string in_;
+
+    char buf_[h2::DEFAULT_FRAME_SIZE];
+
+    hpack::Decoder decoder_;
+    std::string header_block_;
+    std::uint32_t header_stream_ = 0;
+    bool header_end_stream_ = false;
+    std::uint32_t error_;
+
+    std::vector<Stream> streams_;
+    std::size_t max_streams_;
+    std::size_t peer_max_streams_;
+    std::uint32_t next_id_;
+    std::int64_t send_window_;
+    std::int64_t peer_initial_window_;
+    std::size_t peer_frame_size_;
+    std::uint64_t recv_consumed_;
+    bool started_;
+    // --conn-churn 选中了本连接
+    bool draining_;
+
+    std::chrono::steady_clock::time_point connect_start_;
+    std::chrono::steady_clock::time_point handshake_start_;
+    // 最近一次读到数据的时刻, 作为其中各帧的到达时间
+    std::chrono::steady_clock::time_point read_at_;
+    bool handshaking_ = false;
+    // 建立连接与 TLS 握手的耗时, 计入 stream 1 的记录, us
+    std::uint32_t connect_us_ = 0;
+
+    Hooks hooks_;
+};
+
+template <typename Transport, typename Hooks>
+H2Connection<Transport, Hooks>::H2Connection(EventLoop& ev_loop, Bencher& b,
+                                             const std::string& host,
+                                             const SslContext* ssl_ctx,
+                                             Plugin& plugin)
+    : ev_loop_(ev_loop),
+      bencher_(b),
+      transport_(ssl_ctx),
+      host_(host),
+      tpl_(b.templateState()),
+      max_streams_(std::max<std::size_t>(b.config().streams, 1)),
+      hooks_(b, plugin) {
+    for (const auto& ep : b.endpoints()) {
+        encoded_.emplace_back();
+        h2::encodeRequest(ep.req, Transport::scheme(), encoded_.back().block,
+                          encoded_.back().body);
+    }
+    streams_.reserve(max_streams_);
+    reset();
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::reset() {
+    in_.clear();
+    out_.clear();
+    written_ = 0;
+    decoder_ = hpack::Decoder();
+    header_block_.clear();
+    header_stream_ = 0;
+    header_end_stream_ = false;
+    error_ = h2::PROTOCOL_ERROR;
+    streams_.clear();
+    peer_max_streams_ = std::numeric_limits<std::size_t>::max();
+    next_id_ = 1;
+    send_window_ = h2::DEFAULT_WINDOW_SIZE;
+    peer_initial_window_ = h2::DEFAULT_WINDOW_SIZE;
+    peer_frame_size_ = h2::DEFAULT_FRAME_SIZE;
+    recv_consumed_ = 0;
+    started_ = false;
+    draining_ = false;
+    handshaking_ = false;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::reconnect() {
+    // 延长生命周期，delEvent 会删除 Connection 的拷贝
+    auto self = this->shared_from_this();
+
+    ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+
+    transport_.close();
+    ::close(fd_);
+    // connect 可能排队等待名额, 在此之前 fd 号可能已被其它连接复用
+    fd_ = -1;
+    written_ = 0;
+    connect();
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::connect() {
+    auto self = this->shared_from_this();
+
+    // 建立中的连接已达上限时排队, 有名额时再调用 connect
+    if (!bencher_.beginConnect([self] { self->connect(); })) {
+        return;
+    }
+    connecting_ = true;
+
+    connect_start_ = std::chrono::steady_clock::now();
+    const int fd = dial(bencher_.addr(), bencher_.socketOptions());
+    if (fd == -1) {
+        failConnect();
+        return;
+    }
+
+    if (!ev_loop_.addEvent(fd, Mask::WRITABLE, [self] { self->connected(); }) ||
+        !ev_loop_.addEvent(fd, Mask::READABLE, [self] { self->response(); })) {
+        ev_loop_.delEvent(fd, Mask::READABLE | Mask::WRITABLE);
+        ::close(fd);
+        failConnect();
+        return;
+    }
+
+    fd_ = fd;
+    reset();
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::failConnect() {
+    Metrics::getInstance().count(Metrics::Kind::ECONNECT);
+
+    connecting_ = false;
+    bencher_.endConnect();
+
+    auto self = this->shared_from_this();
+    bencher_.retryConnect(++failures_, [self] { self->connect(); });
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::connected() {
+    const auto now = std::chrono::steady_clock::now();
+    auto self = this->shared_from_this();
+
+    if (!established(fd_)) {
+        ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+        ::close(fd_);
+        fd_ = -1;
+        failConnect();
+        return;
+    }
+
+    connecting_ = false;
+    bencher_.endConnect();
+    bencher_.phase(Phase::CONNECT, now - connect_start_);
+    connect_us_ = traceMicros(now - connect_start_);
+
+    if (!ev_loop_.addEvent(fd_, Mask::WRITABLE, [self] { self->request(); })) {
+        return;
+    }
+
+    if (transport_.handshake(fd_, host_)) {
+        request();
+    } else {
+        handshaking_ = true;
+        handshake_start_ = now;
+    }
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::request() {
+    if (handshaking_ && !handshaken()) {
+        return;
+    }
+
+    if (!started_) {
+        // 对端没有经 ALPN 同意 h2 时不发出任何 h2 数据
+        if (!transport_.alpnAccepted("h2")) {
+            bencher_.refuseH2();
+            abandon();
+            return;
+        }
+        failures_ = 0;
+        start();
+    }
+    flush();
+}
+
+template <typename Transport, typename Hooks>
+bool H2Connection<Transport, Hooks>::handshaken() {
+    if (!transport_.finishHandshake()) {
+        if (errno != EAGAIN) {
+            abandon();
+        }
+        return false;
+    }
+
+    handshaking_ = false;
+    const auto now = std::chrono::steady_clock::now();
+    bencher_.phase(Phase::TLS, now - handshake_start_);
+    connect_us_ += traceMicros(now - handshake_start_);
+    return true;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::abandon() {
+    Metrics::getInstance().count(Metrics::Kind::ECONNECT);
+
+    auto self = this->shared_from_this();
+    ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+    transport_.close();
+    ::close(fd_);
+    fd_ = -1;
+    handshaking_ = false;
+
+    bencher_.retryConnect(++failures_, [self] { self->connect(); });
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::start() {
+    started_ = true;
+
+    std::string preface(h2::PREFACE, sizeof(h2::PREFACE) - 1);
+    h2::writeFrameHeader(preface, h2::Frame::SETTINGS, 0, 0, 12);
+    h2::writeSetting(preface, h2::Setting::ENABLE_PUSH, 0);
+    h2::writeSetting(preface, h2::Setting::INITIAL_WINDOW_SIZE, h2::MAX_WINDOW_SIZE);
+    h2::writeWindowUpdate(preface, 0, h2::MAX_WINDOW_SIZE - h2::DEFAULT_WINDOW_SIZE);
+
+    // 对端的 SETTINGS 可能先于可写事件到达, 此时 out_ 中已有 ACK
+    out_.insert(0, preface);
+
+    open();
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::open() {
+    if (!started_) {
+        return;
+    }
+
+    while (streams_.size() < std::min(max_streams_, peer_max_streams_) && !exhausted()) {
+        // 因流控未能发出的请求保留到下次, 以免改变各 endpoint 的比例
+        if (!picked_) {
+            picked_ = true;
+            if (retry_.empty()) {
+                next_ep_ = bencher_.pick();
+            } else {
+                next_ep_ = retry_.back();
+                retry_.pop_back();
+            }
+
+            // 模板或插件生成的请求需要逐个编码
+            const Endpoint& ep = bencher_.endpoints()[next_ep_];
+            const std::string* req = &ep.req;
+            if (ep.dynamic()) {
+                ep.render(rendered_, scratch_, tpl_);
+                req = &rendered_;
+            }
+            if (Hooks::enabled && hooks_.wantRequest()) {
+                if (plugin_req_.empty()) {
+                    plugin_req_ = *req;
+                }
+                hooks_.request(plugin_req_);
+                req = &plugin_req_;
+            }
+
+            use_generated_ = req != &ep.req;
+            if (use_generated_) {
+                h2::encodeRequest(*req, Transport::scheme(), generated_.block,
+                                  generated_.body);
+            }
+        }
+        const std::size_t ep = next_ep_;
+        const Encoded& e = use_generated_ ? generated_ : encoded_[ep];
+        const std::string& block = e.block;
+        const std::string& body = e.body;
+
+        // 请求 body 不拆分到多个窗口, 等待对端 WINDOW_UPDATE
+        const std::int64_t len = body.size();
+        if (len > send_window_ || len > peer_initial_window_) {
+            break;
+        }
+        picked_ = false;
+
+        const std::uint32_t id = next_id_;
+        next_id_ += 2;
+
+        std::size_t off = 0;
+        do {
+            const std::size_t n = std::min(block.size() - off, peer_frame_size_);
+            const bool last = off + n == block.size();
+            const std::uint8_t flags =
+                (last ? h2::FLAG_END_HEADERS : 0) |
+                (off == 0 && body.empty() ? h2::FLAG_END_STREAM : 0);
+
+            h2::writeFrame(out_, off == 0 ? h2::Frame::HEADERS : h2::Frame::CONTINUATION,
+                           flags, id, block.data() + off, n);
+            off += n;
+        } while (off < block.size());
+
+        for (off = 0; off < body.size();) {
+            const std::size_t n = std::min(body.size() - off, peer_frame_size_);
+            const bool last = off + n == body.size();
+            h2::writeFrame(out_, h2::Frame::DATA, last ? h2::FLAG_END_STREAM : 0,
+                           id, body.data() + off, n);
+            off += n;
+        }
+        send_window_ -= len;
+
+        streams_.push_back(Stream{id, ep, 0, std::chrono::steady_clock::now(), {}, {}, {}, 0});
+    }
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::flush() {
+    while (written_ < out_.size()) {
+        const ssize_t n =
+            transport_.write(fd_, out_.data() + written_, out_.size() - written_);
+        if (n >= 0) {
+            written_ += static_cast<std::size_t>(n);
+        } else if (errno == EAGAIN) {
+            return;
+        } else {
+            Metrics::getInstance().count(Metrics::Kind::EWRITE);
+            reconnect();
+            return;
+        }
+    }
+    out_.clear();
+    written_ = 0;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::goaway() {
+    // 未写完的帧之后追加, 只尝试一次, 随后即关闭连接.
+    // 客户端不处理对端发起的 stream, last stream 为 0
+    h2::writeGoaway(out_, 0, error_);
+    transport_.write(fd_, out_.data() + written_, out_.size() - written_);
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::fail(std::uint32_t code) noexcept -> Result {
+    error_ = code;
+    return Result::ERROR;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::response() {
+    // 连接失败的 EPOLLERR 由 read callback 先收到
+    if (connecting_) {
+        connected();
+        // 失败或首次写入出错后已在重连, 此时的 fd 不再是本次事件的 fd
+        if (fd_ == -1 || connecting_) {
+            return;
+        }
+    }
+
+    // 握手完成并确认 ALPN 之前不读取 h2 数据
+    if (handshaking_) {
+        request();
+        if (fd_ == -1 || connecting_ || handshaking_) {
+            return;
+        }
+    }
+
+    ssize_t n = 0;
+    while ((n = transport_.read(fd_, buf_, sizeof(buf_))) > 0) {
+        Metrics::getInstance().count(Metrics::Kind::BYTES, n);
+        read_at_ = std::chrono::steady_clock::now();
+
+        in_.append(buf_, n);
+        const Result r = process();
+        if (r != Result::OK) {
+            if (r == Result::ERROR) {
+                Metrics::getInstance().count(Metrics::Kind::EREAD);
+                goaway();
+            }
+            reconnect();
+            return;
+        }
+    }
+
+    if (n == 0) {
+        if (!streams_.empty()) {
+            Metrics::getInstance().count(Metrics::Kind::EREAD);
+        }
+        reconnect();
+        return;
+    } else if (errno != EAGAIN) {
+        Metrics::getInstance().count(Metrics::Kind::EREAD);
+        reconnect();
+        return;
+    }
+
+    if (bencher_.socketOptions().quickack) {
+        quickAck(fd_);
+    }
+    if (started_) {
+        flush();
+    }
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::process() -> Result {
+    std::size_t off = 0;
+    while (in_.size() - off >= h2::FRAME_HEADER_SIZE) {
+        const h2::FrameHeader hdr = h2::readFrameHeader(in_.data() + off);
+        if (hdr.length > h2::DEFAULT_FRAME_SIZE) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+        if (in_.size() - off - h2::FRAME_HEADER_SIZE < hdr.length) {
+            break;
+        }
+
+        const Result r = onFrame(hdr, in_.data() + off + h2::FRAME_HEADER_SIZE);
+        if (r != Result::OK) {
+            return r;
+        }
+        off += h2::FRAME_HEADER_SIZE + hdr.length;
+    }
+    in_.erase(0, off);
+
+    return Result::OK;
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::onFrame(const h2::FrameHeader& hdr,
+                                             const char* payload) -> Result {
+    // header block 必须由连续的 CONTINUATION 完成
+    if (header_stream_ != 0 && hdr.type != h2::Frame::CONTINUATION) {
+        return Result::ERROR;
+    }
+
+    std::size_t len = hdr.length;
+    if ((hdr.type == h2::Frame::DATA || hdr.type == h2::Frame::HEADERS) &&
+        (hdr.flags & h2::FLAG_PADDED)) {
+        if (len == 0 || static_cast<std::uint8_t>(payload[0]) >= len) {
+            return Result::ERROR;
+        }
+        len -= 1 + static_cast<std::uint8_t>(payload[0]);
+        ++payload;
+    }
+
+    switch (hdr.type) {
+    case h2::Frame::DATA: {
+        if (hdr.stream == 0) {
+            return Result::ERROR;
+        }
+
+        recv_consumed_ += hdr.length;
+        if (recv_consumed_ >= h2::MAX_WINDOW_SIZE / 2) {
+            h2::writeWindowUpdate(out_, 0, recv_consumed_);
+            recv_consumed_ = 0;
+        }
+
+        Stream* s = find(hdr.stream);
+        if (s) {
+            s->bytes += hdr.length;
+        }
+        if (s && hooks_.wantResponseBody()) {
+            s->body.append(payload, len);
+        }
+        if (s && (hdr.flags & h2::FLAG_END_STREAM)) {
+            return complete(hdr.stream);
+        }
+        return Result::OK;
+    }
+
+    case h2::Frame::HEADERS:
+        if (hdr.stream == 0) {
+            return Result::ERROR;
+        }
+        if (hdr.flags & h2::FLAG_PRIORITY) {
+            if (len < 5) {
+                return Result::ERROR;
+            }
+            payload += 5;
+            len -= 5;
+        }
+
+        header_block_.assign(payload, len);
+        header_stream_ = hdr.stream;
+        header_end_stream_ = hdr.flags & h2::FLAG_END_STREAM;
+        return (hdr.flags & h2::FLAG_END_HEADERS) ? onHeaders() : Result::OK;
+
+    case h2::Frame::CONTINUATION:
+        if (hdr.stream == 0 || hdr.stream != header_stream_) {
+            return Result::ERROR;
+        }
+
+        header_block_.append(payload, len);
+        return (hdr.flags & h2::FLAG_END_HEADERS) ? onHeaders() : Result::OK;
+
+    case h2::Frame::RST_STREAM:
+        if (len != 4) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+        if (hdr.stream == 0) {
+            return Result::ERROR;
+        }
+        if (Stream* s = find(hdr.stream)) {
+            bencher_.fail(s->ep, Metrics::Kind::EREAD);
+            erase(hdr.stream);
+            open();
+        }
+        return Result::OK;
+
+    case h2::Frame::SETTINGS:
+        if (hdr.flags & h2::FLAG_ACK) {
+            return Result::OK;
+        }
+        if (hdr.stream != 0) {
+            return Result::ERROR;
+        }
+        if (len % 6 != 0) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+
+        for (std::size_t i = 0; i < len; i += 6) {
+            const auto id = static_cast<h2::Setting>(
+                (static_cast<std::uint8_t>(payload[i]) << 8) |
+                static_cast<std::uint8_t>(payload[i + 1]));
+            const std::uint32_t v = h2::readU32(payload + i + 2);
+
+            switch (id) {
+            case h2::Setting::MAX_CONCURRENT_STREAMS:
+                peer_max_streams_ = v;
+                break;
+            case h2::Setting::INITIAL_WINDOW_SIZE:
+                if (v > h2::MAX_WINDOW_SIZE) {
+                    return Result::ERROR;
+                }
+                peer_initial_window_ = v;
+                break;
+            case h2::Setting::MAX_FRAME_SIZE:
+                // RFC 7540 6.5.2, 为 0 时 open() 无法拆分 header block
+                if (v < h2::DEFAULT_FRAME_SIZE || v > h2::MAX_FRAME_SIZE) {
+                    return Result::ERROR;
+                }
+                peer_frame_size_ = v;
+                break;
+            default:
+                break;
+            }
+        }
+
+        h2::writeFrameHeader(out_, h2::Frame::SETTINGS, h2::FLAG_ACK, 0, 0);
+        open();
+        return Result::OK;
+
+    case h2::Frame::PING:
+        if (len != 8) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+        if (!(hdr.flags & h2::FLAG_ACK)) {
+            h2::writeFrame(out_, h2::Frame::PING, h2::FLAG_ACK, 0, payload, len);
+        }
+        return Result::OK;
+
+    case h2::Frame::GOAWAY: {
+        if (hdr.stream != 0) {
+            return Result::ERROR;
+        }
+        if (len < 8) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+
+        // 对端仍会完成 last 及之前的 stream, 之后的未被处理, 可以安全地重发.
+        // 不再打开新的 stream, 剩余的完成后换一条新连接
+        const std::uint32_t last = h2::readU32(payload) & 0x7fffffff;
+        for (auto it = streams_.begin(); it != streams_.end();) {
+            if (it->id > last) {
+                retry_.push_back(it->ep);
+                it = streams_.erase(it);
+            } else {
+                ++it;
+            }
+        }
+        draining_ = true;
+        return streams_.empty() ? Result::CLOSE : Result::OK;
+    }
+
+    case h2::Frame::WINDOW_UPDATE:
+        if (len != 4) {
+            return fail(h2::FRAME_SIZE_ERROR);
+        }
+        if (hdr.stream == 0) {
+            send_window_ += h2::readU32(payload) & 0x7fffffff;
+            open();
+        }
+        return Result::OK;
+
+    case h2::Frame::PUSH_PROMISE:
+        // SETTINGS_ENABLE_PUSH = 0
+        return Result::ERROR;
+
+    default:
+        return Result::OK;
+    }
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::onHeaders() -> Result {
+    const std::uint32_t id = header_stream_;
+    header_stream_ = 0;
+
+    Stream* s = find(id);
+
+    // 即便 stream 已不存在也要解码以保持动态表同步
+    const bool ok = decoder_.decode(
+        header_block_.data(), header_block_.size(),
+        [&](const std::string& name, const std::string& value) {
+            if (!s) {
+                return;
+            }
+
+            if (name == ":status") {
+                s->status = std::strtoul(value.c_str(), nullptr, 10);
+            } else if (hooks_.wantResponseHeaders()) {
+                if (!s->headers.empty()) {
+                    s->headers.push_back('\x01');
+                }
+                s->headers.append(name);
+                s->headers.push_back(':');
+                s->headers.append(value);
+            }
+        });
+    if (!ok) {
+        return Result::ERROR;
+    }
+
+    if (s) {
+        s->bytes += header_block_.size();
+    }
+
+    // 只统计第一个 HEADERS, 之后的 trailer 不算
+    if (s && s->first_byte == std::chrono::steady_clock::time_point()) {
+        s->first_byte = read_at_;
+        bencher_.phase(Phase::TTFB, read_at_ - s->start);
+        if (s->id == 1) {
+            bencher_.phase(Phase::ACCEPT, read_at_ - s->start);
+        }
+    }
+
+    if (s && header_end_stream_) {
+        return complete(id);
+    }
+    return Result::OK;
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::complete(std::uint32_t id) -> Result {
+    Stream* s = find(id);
+
+    const auto now = std::chrono::steady_clock::now();
+    const auto elapsed =
+        std::chrono::duration_cast<std::chrono::milliseconds>(now - s->start);
+    bencher_.complete(s->ep, s->status, elapsed.count());
+    if (s->first_byte != std::chrono::steady_clock::time_point()) {
+        bencher_.phase(Phase::TRANSFER, now - s->first_byte);
+    }
+    if (bencher_.tracing()) {
+        trace(*s, now);
+    }
+
+    if (Hooks::enabled) {
+        hooks_.response(s->status, std::move(s->headers), std::move(s->body));
+    }
+
+    erase(id);
+    if (!draining_ && bencher_.churn()) {
+        draining_ = true;
+    }
+    open();
+
+    if (streams_.empty() && exhausted()) {
+        return Result::CLOSE;
+    }
+    return Result::OK;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::trace(const Stream& s,
+                                           std::chrono::steady_clock::time_point now) {
+    const auto first_byte =
+        s.first_byte == std::chrono::steady_clock::time_point() ? now : s.first_byte;
+
+    TraceRecord r = {};
+    r.start = std::chrono::duration_cast<std::chrono::microseconds>(
+                  s.start.time_since_epoch()).count();
+    // seq 每次递增 stride, 余数即初始值
+    r.conn = static_cast<std::uint32_t>(tpl_.seq % tpl_.stride);
+    r.bytes = s.bytes;
+    r.connect = s.id == 1 ? connect_us_ : 0;
+    r.ttfb = traceMicros(first_byte - s.start);
+    r.transfer = traceMicros(now - first_byte);
+    r.endpoint = static_cast<std::uint16_t>(s.ep);
+    r.status = static_cast<std::uint16_t>(s.status);
+    // 模板与插件生成的请求已编码, 只给出 endpoint 的请求
+    bencher_.trace(r, bencher_.endpoints()[s.ep].req);
+}
+
+template <typename Transport, typename Hooks>
+bool H2Connection<Transport, Hooks>::exhausted() const noexcept {
+    // stream id 从 1 起每次加 2
+    const std::size_t limit = bencher_.config().requests_per_conn;
+    return next_id_ > h2::MAX_STREAM_ID || draining_ || (limit && next_id_ / 2 >= limit);
+}
+
+template <typename Transport, typename Hooks>
+auto H2Connection<Transport, Hooks>::find(std::uint32_t id) noexcept -> Stream* {
+    for (auto& s : streams_) {
+        if (s.id == id) {
+            return &s;
+        }
+    }
+    return nullptr;
+}
+
+template <typename Transport, typename Hooks>
+void H2Connection<Transport, Hooks>::erase(std::uint32_t id) noexcept {
+    for (auto& s : streams_) {
+        if (s.id == id) {
+            std::swap(s, streams_.back());
+            streams_.pop_back();
+            return;
+        }
+    }
+}
+
+}
+
+#endif
@@ -0,0 +1,217 @@
+#include "histlog.hpp"
+#include <ctime>
+#include <cstring>
+#include <stdexcept>
+#include <boost/format.hpp>
+#include <openssl/evp.h>
+#include <zlib.h>
+
+namespace moros {
+
+namespace {
+
+constexpr std::uint32_t ENCODING_COOKIE = 0x1c849303 | 0x10;
+constexpr std::uint32_t COMPRESSION_COOKIE = 0x1c849304 | 0x10;
+constexpr std::size_t ENCODING_HEADER_SIZE = 40;
+
+void putBE(std::string& out, std::uint64_t v, std::size_t bytes) {
+    for (std::size_t i = bytes; i-- > 0;) {
+        out.push_back(static_cast<char>(v >> (8 * i)));
+    }
+}
+
+std::uint64_t getBE(const std::string& in, std::size_t off, std::size_t bytes) {
+    std::uint64_t v = 0;
+    for (std::size_t i = 0; i < bytes; ++i) {
+        v = (v << 8) | static_cast<std::uint8_t>(in[off + i]);
+    }
+    return v;
+}
+
+// ZigZag LEB128, 最多 9 字节, 第 9 字节承载完整的 8 位
+void putVarint(std::string& out, std::int64_t n) {
+    std::uint64_t v = (static_cast<std::uint64_t>(n) << 1) ^ static_cast<std::uint64_t>(n >> 63);
+    for (int i = 0; i < 8; ++i) {
+        if ((v >> 7) == 0) {
+            out.push_back(static_cast<char>(v));
+            return;
+        }
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+bool getVarint(const std::string& in, std::size_t& off, std::int64_t& n) {
+    std::uint64_t v = 0;
+    for (int i = 0; i < 9; ++i) {
+        if (off >= in.size()) {
+            return false;
+        }
+        const std::uint8_t b = in[off++];
+        if (i == 8) {
+            v |= std::uint64_t(b) << 56;
+            break;
+        }
+        v |= std::uint64_t(b & 0x7f) << (7 * i);
+        if (!(b & 0x80)) {
+            break;
+        }
+    }
+    n = static_cast<std::int64_t>(v >> 1) ^ -static_cast<std::int64_t>(v & 1);
+    return true;
+}
+
+}
+
+std::string encodeHistogram(const Stats& st) {
+    // 连续的空桶编码为负数表示的长度
+    const auto& xs = st.counts();
+    const std::size_t limit = st.count() ? Stats::countsIndex(st.max()) + 1 : 0;
+
+    std::string payload;
+    for (std::size_t i = 0; i < limit;) {
+        if (xs[i]) {
+            putVarint(payload, xs[i++]);
+            continue;
+        }
+
+        std::int64_t zeros = 0;
+        while (i < limit && xs[i] == 0) {
+            ++zeros;
+            ++i;
+        }
+        putVarint(payload, -zeros);
+    }
+
+    double ratio = 1.0;
+    std::uint64_t ratio_bits;
+    std::memcpy(&ratio_bits, &ratio, sizeof(ratio));
+
+    std::string raw;
+    putBE(raw, ENCODING_COOKIE, 4);
+    putBE(raw, payload.size(), 4);
+    putBE(raw, 0, 4); // normalizing index offset
+    putBE(raw, Stats::SIGNIFICANT_FIGURES, 4);
+    putBE(raw, 1, 8); // lowest trackable value
+    putBE(raw, st.highest(), 8);
+    putBE(raw, ratio_bits, 8);
+    raw.append(payload);
+
+    uLongf zlen = ::compressBound(raw.size());
+    std::string compressed(8 + zlen, '\0');
+    ::compress(reinterpret_cast<Bytef*>(&compressed[8]), &zlen,
+               reinterpret_cast<const Bytef*>(raw.data()), raw.size());
+    compressed.resize(8 + zlen);
+
+    std::string hdr;
+    putBE(hdr, COMPRESSION_COOKIE, 4);
+    putBE(hdr, zlen, 4);
+    compressed.replace(0, 8, hdr);
+
+    std::string out(4 * ((compressed.size() + 2) / 3) + 1, '\0');
+    const int n = ::EVP_EncodeBlock(reinterpret_cast<unsigned char*>(&out[0]),
+                                    reinterpret_cast<const unsigned char*>(compressed.data()),
+                                    compressed.size());
+    out.resize(n);
+    return out;
+}
+
+std::unique_ptr<Stats> decodeHistogram(const std::string& s) {
+    if (s.empty() || s.size() % 4) {
+        return nullptr;
+    }
+
+    std::string compressed(s.size() / 4 * 3, '\0');
+    const int n = ::EVP_DecodeBlock(reinterpret_cast<unsigned char*>(&compressed[0]),
+                                    reinterpret_cast<const unsigned char*>(s.data()),
+                                    s.size());
+    if (n < 8) {
+        return nullptr;
+    }
+    // EVP_DecodeBlock 把 padding 也算作输出
+    compressed.resize(n - (s[s.size() - 1] == '=') - (s[s.size() - 2] == '='));
+
+    if (getBE(compressed, 0, 4) != COMPRESSION_COOKIE ||
+        getBE(compressed, 4, 4) != compressed.size() - 8) {
+        return nullptr;
+    }
+
+    // 解压后大小未知, 不够时加倍重试
+    std::string raw(4 * compressed.size() + ENCODING_HEADER_SIZE, '\0');
+    for (;;) {
+        uLongf len = raw.size();
+        const int ret = ::uncompress(reinterpret_cast<Bytef*>(&raw[0]), &len,
+                                     reinterpret_cast<const Bytef*>(&compressed[8]),
+                                     compressed.size() - 8);
+        if (ret == Z_OK) {
+            raw.resize(len);
+            break;
+        } else if (ret != Z_BUF_ERROR) {
+            return nullptr;
+        }
+        raw.resize(raw.size() * 2);
+    }
+
+    if (raw.size() < ENCODING_HEADER_SIZE ||
+        getBE(raw, 0, 4) != ENCODING_COOKIE ||
+        getBE(raw, 4, 4) != raw.size() - ENCODING_HEADER_SIZE ||
+        getBE(raw, 8, 4) != 0 ||
+        getBE(raw, 12, 4) != Stats::SIGNIFICANT_FIGURES ||
+        getBE(raw, 16, 8) != 1) {
+        return nullptr;
+    }
+
+    const std::uint64_t highest = getBE(raw, 24, 8);
+    if (highest == 0 || highest >= INT64_MAX) {
+        return nullptr;
+    }
+
+    auto st = std::make_unique<Stats>(highest + 1);
+    std::size_t off = ENCODING_HEADER_SIZE, idx = 0;
+    while (off < raw.size()) {
+        std::int64_t v;
+        if (!getVarint(raw, off, v)) {
+            return nullptr;
+        }
+
+        if (v < 0) {
+            idx += -v;
+        } else if (!st->add(idx++, v)) {
+            return nullptr;
+        }
+    }
+    return st;
+}
+
+HistogramLog::HistogramLog(const std::string& path) : os_(path) {
+    if (!os_) {
+        throw std::runtime_error("open " + path + " failed");
+    }
+}
+
+void HistogramLog::start(std::chrono::system_clock::time_point t) {
+    const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+        t.time_since_epoch());
+    const std::time_t tt = std::chrono::system_clock::to_time_t(t);
+
+    char date[64];
+    std::strftime(date, sizeof(date), "%a %b %d %H:%M:%S %Z %Y", std::localtime(&tt));
+
+    os_ << "#[Histogram log format version 1.3]\n"
+        << boost::format("#[StartTime: %.3f (seconds since epoch), %s]\n") %
+               (ms.count() / 1000.0) % date
+        << "\"StartTimestamp\",\"Interval_Length\",\"Interval_Max\","
+           "\"Interval_Compressed_Histogram\"\n"
+        << std::flush;
+}
+
+void HistogramLog::append(std::chrono::milliseconds begin,
+                          std::chrono::milliseconds len, const Stats& st) {
+    os_ << boost::format("%.3f,%.3f,%.3f,") % (begin.count() / 1000.0) %
+               (len.count() / 1000.0) % st.max()
+        << encodeHistogram(st) << '\n'
+        << std::flush;
+}
+
+}
@@ -0,0 +1,36 @@
+#ifndef MOROS_HISTLOG_HPP_
+#define MOROS_HISTLOG_HPP_
+
+#include "stats.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+#include <fstream>
+
+namespace moros {
+
+// HdrHistogram V2 压缩编码 (zlib + base64), 可直接交给各语言的
+// HdrHistogram 解码, 跨机器, 跨次运行合并
+std::string encodeHistogram(const Stats& st);
+
+// 只接受 lowest 为 1, 3 位有效数字的布局, 格式错误返回 nullptr
+std::unique_ptr<Stats> decodeHistogram(const std::string& s);
+
+// HdrHistogram log (format version 1.3), 每行一个 interval 的直方图
+class HistogramLog {
+public:
+    explicit HistogramLog(const std::string& path);
+
+    void start(std::chrono::system_clock::time_point t);
+
+    // begin 为 interval 相对 start 的偏移
+    void append(std::chrono::milliseconds begin, std::chrono::milliseconds len,
+                const Stats& st);
+
+private:
+    std::ofstream os_;
+};
+
+}
+
+#endif
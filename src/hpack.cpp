@@ -0,0 +1,397 @@
+#include "hpack.hpp"
+#include <vector>
+
+namespace moros {
+namespace hpack {
+
+namespace {
+
+struct Entry {
+    const char* name;
+    const char* value;
+};
+
+// RFC 7541 Appendix A
+const Entry static_table[] = {
+    {":authority", ""},
+    {":method", "GET"},
+    {":method", "POST"},
+    {":path", "/"},
+    {":path", "/index.html"},
+    {":scheme", "http"},
+    {":scheme", "https"},
+    {":status", "200"},
+    {":status", "204"},
+    {":status", "206"},
+    {":status", "304"},
+    {":status", "400"},
+    {":status", "404"},
+    {":status", "500"},
+    {"accept-charset", ""},
+    {"accept-encoding", "gzip, deflate"},
+    {"accept-language", ""},
+    {"accept-ranges", ""},
+    {"accept", ""},
+    {"access-control-allow-origin", ""},
+    {"age", ""},
+    {"allow", ""},
+    {"authorization", ""},
+    {"cache-control", ""},
+    {"content-disposition", ""},
+    {"content-encoding", ""},
+    {"content-language", ""},
+    {"content-length", ""},
+    {"content-location", ""},
+    {"content-range", ""},
+    {"content-type", ""},
+    {"cookie", ""},
+    {"date", ""},
+    {"etag", ""},
+    {"expect", ""},
+    {"expires", ""},
+    {"from", ""},
+    {"host", ""},
+    {"if-match", ""},
+    {"if-modified-since", ""},
+    {"if-none-match", ""},
+    {"if-range", ""},
+    {"if-unmodified-since", ""},
+    {"last-modified", ""},
+    {"link", ""},
+    {"location", ""},
+    {"max-forwards", ""},
+    {"proxy-authenticate", ""},
+    {"proxy-authorization", ""},
+    {"range", ""},
+    {"referer", ""},
+    {"refresh", ""},
+    {"retry-after", ""},
+    {"server", ""},
+    {"set-cookie", ""},
+    {"strict-transport-security", ""},
+    {"transfer-encoding", ""},
+    {"user-agent", ""},
+    {"vary", ""},
+    {"via", ""},
+    {"www-authenticate", ""},
+};
+
+constexpr std::size_t STATIC_SIZE = sizeof(static_table) / sizeof(static_table[0]);
+
+// RFC 7541 Appendix B, 下标即符号, 256 为 EOS
+const struct {
+    std::uint32_t code;
+    std::uint8_t bits;
+} huffman_codes[] = {
+    {0x1ff8, 13}, {0x7fffd8, 23}, {0xfffffe2, 28}, {0xfffffe3, 28},
+    {0xfffffe4, 28}, {0xfffffe5, 28}, {0xfffffe6, 28}, {0xfffffe7, 28},
+    {0xfffffe8, 28}, {0xffffea, 24}, {0x3ffffffc, 30}, {0xfffffe9, 28},
+    {0xfffffea, 28}, {0x3ffffffd, 30}, {0xfffffeb, 28}, {0xfffffec, 28},
+    {0xfffffed, 28}, {0xfffffee, 28}, {0xfffffef, 28}, {0xffffff0, 28},
+    {0xffffff1, 28}, {0xffffff2, 28}, {0x3ffffffe, 30}, {0xffffff3, 28},
+    {0xffffff4, 28}, {0xffffff5, 28}, {0xffffff6, 28}, {0xffffff7, 28},
+    {0xffffff8, 28}, {0xffffff9, 28}, {0xffffffa, 28}, {0xffffffb, 28},
+    {0x14, 6}, {0x3f8, 10}, {0x3f9, 10}, {0xffa, 12},
+    {0x1ff9, 13}, {0x15, 6}, {0xf8, 8}, {0x7fa, 11},
+    {0x3fa, 10}, {0x3fb, 10}, {0xf9, 8}, {0x7fb, 11},
+    {0xfa, 8}, {0x16, 6}, {0x17, 6}, {0x18, 6},
+    {0x0, 5}, {0x1, 5}, {0x2, 5}, {0x19, 6},
+    {0x1a, 6}, {0x1b, 6}, {0x1c, 6}, {0x1d, 6},
+    {0x1e, 6}, {0x1f, 6}, {0x5c, 7}, {0xfb, 8},
+    {0x7ffc, 15}, {0x20, 6}, {0xffb, 12}, {0x3fc, 10},
+    {0x1ffa, 13}, {0x21, 6}, {0x5d, 7}, {0x5e, 7},
+    {0x5f, 7}, {0x60, 7}, {0x61, 7}, {0x62, 7},
+    {0x63, 7}, {0x64, 7}, {0x65, 7}, {0x66, 7},
+    {0x67, 7}, {0x68, 7}, {0x69, 7}, {0x6a, 7},
+    {0x6b, 7}, {0x6c, 7}, {0x6d, 7}, {0x6e, 7},
+    {0x6f, 7}, {0x70, 7}, {0x71, 7}, {0x72, 7},
+    {0xfc, 8}, {0x73, 7}, {0xfd, 8}, {0x1ffb, 13},
+    {0x7fff0, 19}, {0x1ffc, 13}, {0x3ffc, 14}, {0x22, 6},
+    {0x7ffd, 15}, {0x3, 5}, {0x23, 6}, {0x4, 5},
+    {0x24, 6}, {0x5, 5}, {0x25, 6}, {0x26, 6},
+    {0x27, 6}, {0x6, 5}, {0x74, 7}, {0x75, 7},
+    {0x28, 6}, {0x29, 6}, {0x2a, 6}, {0x7, 5},
+    {0x2b, 6}, {0x76, 7}, {0x2c, 6}, {0x8, 5},
+    {0x9, 5}, {0x2d, 6}, {0x77, 7}, {0x78, 7},
+    {0x79, 7}, {0x7a, 7}, {0x7b, 7}, {0x7ffe, 15},
+    {0x7fc, 11}, {0x3ffd, 14}, {0x1ffd, 13}, {0xffffffc, 28},
+    {0xfffe6, 20}, {0x3fffd2, 22}, {0xfffe7, 20}, {0xfffe8, 20},
+    {0x3fffd3, 22}, {0x3fffd4, 22}, {0x3fffd5, 22}, {0x7fffd9, 23},
+    {0x3fffd6, 22}, {0x7fffda, 23}, {0x7fffdb, 23}, {0x7fffdc, 23},
+    {0x7fffdd, 23}, {0x7fffde, 23}, {0xffffeb, 24}, {0x7fffdf, 23},
+    {0xffffec, 24}, {0xffffed, 24}, {0x3fffd7, 22}, {0x7fffe0, 23},
+    {0xffffee, 24}, {0x7fffe1, 23}, {0x7fffe2, 23}, {0x7fffe3, 23},
+    {0x7fffe4, 23}, {0x1fffdc, 21}, {0x3fffd8, 22}, {0x7fffe5, 23},
+    {0x3fffd9, 22}, {0x7fffe6, 23}, {0x7fffe7, 23}, {0xffffef, 24},
+    {0x3fffda, 22}, {0x1fffdd, 21}, {0xfffe9, 20}, {0x3fffdb, 22},
+    {0x3fffdc, 22}, {0x7fffe8, 23}, {0x7fffe9, 23}, {0x1fffde, 21},
+    {0x7fffea, 23}, {0x3fffdd, 22}, {0x3fffde, 22}, {0xfffff0, 24},
+    {0x1fffdf, 21}, {0x3fffdf, 22}, {0x7fffeb, 23}, {0x7fffec, 23},
+    {0x1fffe0, 21}, {0x1fffe1, 21}, {0x3fffe0, 22}, {0x1fffe2, 21},
+    {0x7fffed, 23}, {0x3fffe1, 22}, {0x7fffee, 23}, {0x7fffef, 23},
+    {0xfffea, 20}, {0x3fffe2, 22}, {0x3fffe3, 22}, {0x3fffe4, 22},
+    {0x7ffff0, 23}, {0x3fffe5, 22}, {0x3fffe6, 22}, {0x7ffff1, 23},
+    {0x3ffffe0, 26}, {0x3ffffe1, 26}, {0xfffeb, 20}, {0x7fff1, 19},
+    {0x3fffe7, 22}, {0x7ffff2, 23}, {0x3fffe8, 22}, {0x1ffffec, 25},
+    {0x3ffffe2, 26}, {0x3ffffe3, 26}, {0x3ffffe4, 26}, {0x7ffffde, 27},
+    {0x7ffffdf, 27}, {0x3ffffe5, 26}, {0xfffff1, 24}, {0x1ffffed, 25},
+    {0x7fff2, 19}, {0x1fffe3, 21}, {0x3ffffe6, 26}, {0x7ffffe0, 27},
+    {0x7ffffe1, 27}, {0x3ffffe7, 26}, {0x7ffffe2, 27}, {0xfffff2, 24},
+    {0x1fffe4, 21}, {0x1fffe5, 21}, {0x3ffffe8, 26}, {0x3ffffe9, 26},
+    {0xffffffd, 28}, {0x7ffffe3, 27}, {0x7ffffe4, 27}, {0x7ffffe5, 27},
+    {0xfffec, 20}, {0xfffff3, 24}, {0xfffed, 20}, {0x1fffe6, 21},
+    {0x3fffe9, 22}, {0x1fffe7, 21}, {0x1fffe8, 21}, {0x7ffff3, 23},
+    {0x3fffea, 22}, {0x3fffeb, 22}, {0x1ffffee, 25}, {0x1ffffef, 25},
+    {0xfffff4, 24}, {0xfffff5, 24}, {0x3ffffea, 26}, {0x7ffff4, 23},
+    {0x3ffffeb, 26}, {0x7ffffe6, 27}, {0x3ffffec, 26}, {0x3ffffed, 26},
+    {0x7ffffe7, 27}, {0x7ffffe8, 27}, {0x7ffffe9, 27}, {0x7ffffea, 27},
+    {0x7ffffeb, 27}, {0xffffffe, 28}, {0x7ffffec, 27}, {0x7ffffed, 27},
+    {0x7ffffee, 27}, {0x7ffffef, 27}, {0x7fffff0, 27}, {0x3ffffee, 26},
+    {0x3fffffff, 30},
+};
+
+static_assert(sizeof(huffman_codes) / sizeof(huffman_codes[0]) == 257, "");
+
+// 解码用的二叉树, 叶子节点的 sym 有效
+struct Node {
+    std::int16_t child[2] = {-1, -1};
+    std::int16_t sym = -1;
+};
+
+const std::vector<Node>& huffmanTree() {
+    static const std::vector<Node> tree = [] {
+        std::vector<Node> t(1);
+        for (std::size_t sym = 0; sym < 257; ++sym) {
+            std::size_t cur = 0;
+            for (int i = huffman_codes[sym].bits - 1; i >= 0; --i) {
+                const int bit = (huffman_codes[sym].code >> i) & 1;
+                if (t[cur].child[bit] == -1) {
+                    t[cur].child[bit] = static_cast<std::int16_t>(t.size());
+                    t.emplace_back();
+                }
+                cur = t[cur].child[bit];
+            }
+            t[cur].sym = static_cast<std::int16_t>(sym);
+        }
+        return t;
+    }();
+    return tree;
+}
+
+bool decodeInteger(const std::uint8_t*& p, const std::uint8_t* end,
+                   std::size_t prefix, std::uint64_t& v) noexcept {
+    if (p == end) {
+        return false;
+    }
+
+    const std::uint8_t mask = (1u << prefix) - 1;
+    v = *p++ & mask;
+    if (v < mask) {
+        return true;
+    }
+
+    for (std::size_t shift = 0; p != end && shift < 56; shift += 7) {
+        const std::uint8_t b = *p++;
+        v += static_cast<std::uint64_t>(b & 0x7f) << shift;
+        if (!(b & 0x80)) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool decodeString(const std::uint8_t*& p, const std::uint8_t* end,
+                  std::string& out) {
+    if (p == end) {
+        return false;
+    }
+
+    const bool huffman = *p & 0x80;
+    std::uint64_t len = 0;
+    if (!decodeInteger(p, end, 7, len) ||
+        len > static_cast<std::uint64_t>(end - p)) {
+        return false;
+    }
+
+    const char* s = reinterpret_cast<const char*>(p);
+    p += len;
+
+    out.clear();
+    if (huffman) {
+        return huffmanDecode(s, len, out);
+    }
+    out.assign(s, len);
+    return true;
+}
+
+}
+
+void encodeInteger(std::string& out, std::uint8_t first, std::size_t prefix,
+                   std::uint64_t v) {
+    const std::uint64_t mask = (1u << prefix) - 1;
+    if (v < mask) {
+        out.push_back(static_cast<char>(first | v));
+        return;
+    }
+
+    out.push_back(static_cast<char>(first | mask));
+    v -= mask;
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+void encodeHeader(std::string& out, const std::string& name,
+                  const std::string& value) {
+    std::size_t name_idx = 0;
+    for (std::size_t i = 0; i < STATIC_SIZE; ++i) {
+        if (name == static_table[i].name) {
+            if (value == static_table[i].value) {
+                // indexed header field
+                encodeInteger(out, 0x80, 7, i + 1);
+                return;
+            }
+            if (name_idx == 0) {
+                name_idx = i + 1;
+            }
+        }
+    }
+
+    // literal header field without indexing
+    encodeInteger(out, 0x00, 4, name_idx);
+    if (name_idx == 0) {
+        encodeInteger(out, 0x00, 7, name.size());
+        out.append(name);
+    }
+    encodeInteger(out, 0x00, 7, value.size());
+    out.append(value);
+}
+
+bool huffmanDecode(const char* s, std::size_t len, std::string& out) {
+    const auto& tree = huffmanTree();
+
+    std::size_t cur = 0, depth = 0;
+    bool ones = true;
+    for (std::size_t i = 0; i < len; ++i) {
+        const std::uint8_t c = s[i];
+        for (int j = 7; j >= 0; --j) {
+            const int bit = (c >> j) & 1;
+            const std::int16_t next = tree[cur].child[bit];
+            if (next == -1) {
+                return false;
+            }
+
+            cur = next;
+            ++depth;
+            ones = ones && bit;
+            if (tree[cur].sym != -1) {
+                if (tree[cur].sym == 256) {
+                    return false;
+                }
+                out.push_back(static_cast<char>(tree[cur].sym));
+                cur = 0;
+                depth = 0;
+                ones = true;
+            }
+        }
+    }
+
+    // 末尾的 padding 必须是不足 8 位的 EOS 前缀
+    return depth < 8 && ones;
+}
+
+Decoder::Decoder(std::size_t max_size) noexcept
+    : size_(0), max_size_(max_size), limit_(max_size) {}
+
+bool Decoder::decode(const char* s, std::size_t len,
+                     const std::function<void(const std::string&,
+                                              const std::string&)>& fn) {
+    auto p = reinterpret_cast<const std::uint8_t*>(s);
+    const auto end = p + len;
+
+    std::string name, value;
+    while (p != end) {
+        const std::uint8_t b = *p;
+        std::uint64_t idx = 0;
+
+        if (b & 0x80) {
+            // indexed header field
+            if (!decodeInteger(p, end, 7, idx) || !lookup(idx, name, value)) {
+                return false;
+            }
+        } else if ((b & 0xe0) == 0x20) {
+            // dynamic table size update
+            if (!decodeInteger(p, end, 5, idx) || idx > limit_) {
+                return false;
+            }
+            max_size_ = idx;
+            evict();
+            continue;
+        } else {
+            // literal header field, 0x40 表示加入动态表
+            const bool indexing = (b & 0xc0) == 0x40;
+            if (!decodeInteger(p, end, indexing ? 6 : 4, idx)) {
+                return false;
+            }
+
+            if (idx == 0) {
+                if (!decodeString(p, end, name)) {
+                    return false;
+                }
+            } else if (!lookup(idx, name, value)) {
+                return false;
+            }
+
+            if (!decodeString(p, end, value)) {
+                return false;
+            }
+
+            if (indexing) {
+                insert(name, value);
+            }
+        }
+
+        fn(name, value);
+    }
+
+    return true;
+}
+
+bool Decoder::lookup(std::uint64_t idx, std::string& name,
+                     std::string& value) const {
+    if (idx == 0) {
+        return false;
+    }
+
+    if (idx <= STATIC_SIZE) {
+        name = static_table[idx - 1].name;
+        value = static_table[idx - 1].value;
+        return true;
+    }
+
+    idx -= STATIC_SIZE + 1;
+    if (idx >= table_.size()) {
+        return false;
+    }
+    name = table_[idx].first;
+    value = table_[idx].second;
+    return true;
+}
+
+void Decoder::insert(std::string name, std::string value) {
+    size_ += name.size() + value.size() + 32;
+    table_.emplace_front(std::move(name), std::move(value));
+    evict();
+}
+
+void Decoder::evict() noexcept {
+    while (size_ > max_size_ && !table_.empty()) {
+        size_ -= table_.back().first.size() + table_.back().second.size() + 32;
+        table_.pop_back();
+    }
+}
+
+}
+}
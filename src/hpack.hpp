@@ -0,0 +1,46 @@
+#ifndef MOROS_HPACK_HPP_
+#define MOROS_HPACK_HPP_
+
+#include <deque>
+#include <string>
+#include <cstdint>
+#include <utility>
+#include <functional>
+
+namespace moros {
+namespace hpack {
+
+// 编码只使用静态表与 literal without indexing, 不修改对端的动态表,
+// 因此同一个 header block 可以在所有 stream 上复用
+void encodeInteger(std::string& out, std::uint8_t first, std::size_t prefix,
+                   std::uint64_t v);
+
+void encodeHeader(std::string& out, const std::string& name,
+                  const std::string& value);
+
+bool huffmanDecode(const char* s, std::size_t len, std::string& out);
+
+class Decoder {
+public:
+    explicit Decoder(std::size_t max_size = 4096) noexcept;
+
+    // 返回 false 表示 COMPRESSION_ERROR, 连接应当关闭
+    bool decode(const char* s, std::size_t len,
+                const std::function<void(const std::string&,
+                                         const std::string&)>& fn);
+
+private:
+    bool lookup(std::uint64_t idx, std::string& name, std::string& value) const;
+    void insert(std::string name, std::string value);
+    void evict() noexcept;
+
+    std::deque<std::pair<std::string, std::string>> table_;
+    std::size_t size_;
+    std::size_t max_size_;
+    std::size_t limit_;
+};
+
+}
+}
+
+#endif
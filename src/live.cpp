@@ -0,0 +1,192 @@
+#include "live.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <thread>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace moros {
+
+namespace {
+
+constexpr std::size_t KINDS = static_cast<std::size_t>(Metrics::Kind::MAX);
+
+enum Header : std::size_t {
+    MAGIC,
+    VERSION,
+    SEQ,
+    PID,
+    STATE,
+    START,   // unix 时间, ms
+    ELAPSED, // ms
+    KINDS_N, // 计数的个数
+    BUCKETS, // 直方图桶数
+    HIGHEST, // 直方图可记录的最大值
+    URL = 16,
+    URL_N = 64, // 以 0 结尾, 过长时截断
+    HEADER_N = URL + URL_N,
+};
+
+// 全部内容在一次读取中被改写的次数上限, 超过后放弃这一次
+constexpr int READ_RETRIES = 100;
+
+std::string errmsg(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+}
+
+LiveStats::LiveStats(const std::string& path, const std::string& url,
+                     const Stats& latency)
+    : latency_(latency),
+      size_((HEADER_N + KINDS + latency.counts().size()) * sizeof(std::uint64_t)) {
+    ::unlink(path.c_str());
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+    if (fd == -1) {
+        throw std::runtime_error(errmsg("create", path));
+    }
+    if (::ftruncate(fd, size_) == -1) {
+        const std::string msg = errmsg("truncate", path);
+        ::close(fd);
+        throw std::runtime_error(msg);
+    }
+    void* p = ::mmap(nullptr, size_, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error(errmsg("mmap", path));
+    }
+    base_ = static_cast<std::uint64_t*>(p);
+
+    // 读者以 MAGIC 判断文件已就绪, 最后写入
+    base_[VERSION] = LIVE_VERSION;
+    base_[PID] = static_cast<std::uint64_t>(::getpid());
+    base_[START] = std::chrono::duration_cast<std::chrono::milliseconds>(
+                       std::chrono::system_clock::now().time_since_epoch())
+                       .count();
+    base_[KINDS_N] = KINDS;
+    base_[BUCKETS] = latency.counts().size();
+    base_[HIGHEST] = latency.highest();
+    std::strncpy(reinterpret_cast<char*>(base_ + URL), url.c_str(),
+                 URL_N * sizeof(std::uint64_t) - 1);
+    __atomic_store_n(&base_[MAGIC], LIVE_MAGIC, __ATOMIC_RELEASE);
+}
+
+LiveStats::~LiveStats() {
+    ::munmap(base_, size_);
+}
+
+void LiveStats::publish(LiveState state, std::chrono::milliseconds elapsed) noexcept {
+    const std::uint64_t seq = base_[SEQ];
+    __atomic_store_n(&base_[SEQ], seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    __atomic_store_n(&base_[STATE], static_cast<std::uint64_t>(state), __ATOMIC_RELAXED);
+    __atomic_store_n(&base_[ELAPSED], elapsed.count(), __ATOMIC_RELAXED);
+
+    std::uint64_t* p = base_ + HEADER_N;
+    for (std::size_t i = 0; i < KINDS; ++i) {
+        __atomic_store_n(p++, Metrics::getInstance()[static_cast<Metrics::Kind>(i)],
+                         __ATOMIC_RELAXED);
+    }
+    // bencher 线程以原子操作更新各桶, 逐个读取不会读到撕裂的值
+    for (const auto& x : latency_.counts()) {
+        __atomic_store_n(p++, __atomic_load_n(&x, __ATOMIC_RELAXED), __ATOMIC_RELAXED);
+    }
+
+    __atomic_store_n(&base_[SEQ], seq + 2, __ATOMIC_RELEASE);
+}
+
+LiveReader::LiveReader(const std::string& path) : path_(path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error(errmsg("open", path));
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        const std::string msg = errmsg("stat", path);
+        ::close(fd);
+        throw std::runtime_error(msg);
+    }
+    ino_ = st.st_ino;
+    size_ = st.st_size;
+    if (size_ < HEADER_N * sizeof(std::uint64_t)) {
+        ::close(fd);
+        throw std::runtime_error(path + " is not a moros stats file");
+    }
+
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error(errmsg("mmap", path));
+    }
+    base_ = static_cast<const std::uint64_t*>(p);
+
+    const std::size_t n = HEADER_N + KINDS + base_[BUCKETS];
+    if (__atomic_load_n(&base_[MAGIC], __ATOMIC_ACQUIRE) != LIVE_MAGIC ||
+        base_[VERSION] != LIVE_VERSION || base_[KINDS_N] != KINDS ||
+        n * sizeof(std::uint64_t) > size_ ||
+        Stats(base_[HIGHEST] + 1).counts().size() != base_[BUCKETS]) {
+        ::munmap(const_cast<std::uint64_t*>(base_), size_);
+        throw std::runtime_error(path + " is not a moros stats file of version " +
+                                 std::to_string(LIVE_VERSION));
+    }
+}
+
+LiveReader::~LiveReader() {
+    ::munmap(const_cast<std::uint64_t*>(base_), size_);
+}
+
+bool LiveReader::read(LiveSnapshot& out) const {
+    const std::size_t buckets = base_[BUCKETS];
+    std::vector<std::uint64_t> xs(buckets);
+
+    for (int i = 0; i < READ_RETRIES; ++i) {
+        const std::uint64_t seq = __atomic_load_n(&base_[SEQ], __ATOMIC_ACQUIRE);
+        if (seq & 1) {
+            std::this_thread::yield();
+            continue;
+        }
+
+        const LiveState state =
+            static_cast<LiveState>(__atomic_load_n(&base_[STATE], __ATOMIC_RELAXED));
+        const std::uint64_t elapsed = __atomic_load_n(&base_[ELAPSED], __ATOMIC_RELAXED);
+        const std::uint64_t* p = base_ + HEADER_N;
+        for (std::size_t k = 0; k < KINDS; ++k) {
+            out.counters[k] = __atomic_load_n(p++, __ATOMIC_RELAXED);
+        }
+        for (auto& x : xs) {
+            x = __atomic_load_n(p++, __ATOMIC_RELAXED);
+        }
+
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        if (__atomic_load_n(&base_[SEQ], __ATOMIC_RELAXED) != seq) {
+            continue;
+        }
+
+        out.pid = base_[PID];
+        out.state = state;
+        out.start = std::chrono::milliseconds(base_[START]);
+        out.elapsed = std::chrono::milliseconds(elapsed);
+        const char* url = reinterpret_cast<const char*>(base_ + URL);
+        out.url.assign(url, ::strnlen(url, URL_N * sizeof(std::uint64_t)));
+        out.latency = std::make_unique<Stats>(base_[HIGHEST] + 1);
+        for (std::size_t j = 0; j < buckets; ++j) {
+            out.latency->add(j, xs[j]);
+        }
+        return true;
+    }
+    return false;
+}
+
+bool LiveReader::stale() const noexcept {
+    struct stat st;
+    return ::stat(path_.c_str(), &st) == -1 || st.st_ino != ino_;
+}
+
+}
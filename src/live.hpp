@@ -0,0 +1,86 @@
+#ifndef MOROS_LIVE_HPP_
+#define MOROS_LIVE_HPP_
+
+#include "stats.hpp"
+#include <chrono>
+#include <memory>
+#include <string>
+
+// --stats-file: 主线程定期把全局计数与 latency 直方图的累计值写入一个
+// mmap 的文件, moros-top 等外部程序只读映射后轮询. bencher 线程不参与,
+// 写入方也不等待读者.
+//
+// 文件由 std::uint64_t 组成: 固定的头部, 之后依次为各计数与直方图各桶.
+// 头部中的 seq 为 seqlock, 写入期间为奇数, 读者前后两次读到相同的偶数
+// 才采用读到的内容. 格式变化时增加 LIVE_VERSION
+
+namespace moros {
+
+constexpr std::uint64_t LIVE_MAGIC = 0x31564c534f524f4dULL; // "MOROSLV1"
+constexpr std::uint64_t LIVE_VERSION = 1;
+
+enum class LiveState : std::uint64_t {
+    WARMUP,
+    RUNNING,
+    DONE,
+};
+
+class LiveStats {
+public:
+    // 删除已有的 path 后重新创建, 仍映射着旧文件的读者不受影响.
+    // latency 须比 LiveStats 活得久, 失败抛出 std::runtime_error
+    LiveStats(const std::string& path, const std::string& url, const Stats& latency);
+    ~LiveStats();
+
+    LiveStats(const LiveStats&) = delete;
+    LiveStats& operator=(const LiveStats&) = delete;
+
+    // 只能由一个线程调用, 与 bencher 线程的 record 并发也安全
+    void publish(LiveState state, std::chrono::milliseconds elapsed) noexcept;
+
+private:
+    const Stats& latency_;
+    std::size_t size_;
+    std::uint64_t* base_;
+};
+
+// 读者取得的一份快照, 计数与直方图均为自测试 (或 warmup) 开始的累计值
+struct LiveSnapshot {
+    std::uint64_t pid = 0;
+    LiveState state = LiveState::WARMUP;
+    // 开始时的 unix 时间与至今的时长
+    std::chrono::milliseconds start{0}, elapsed{0};
+    std::string url;
+    std::uint64_t counters[static_cast<std::size_t>(Metrics::Kind::MAX)] = {};
+    std::unique_ptr<Stats> latency;
+
+    std::uint64_t operator[](Metrics::Kind k) const noexcept {
+        return counters[static_cast<std::size_t>(k)];
+    }
+};
+
+class LiveReader {
+public:
+    // 文件不存在, 不是 --stats-file 或版本不符时抛出 std::runtime_error
+    explicit LiveReader(const std::string& path);
+    ~LiveReader();
+
+    LiveReader(const LiveReader&) = delete;
+    LiveReader& operator=(const LiveReader&) = delete;
+
+    // 写入方持续更新以致始终读不到一致的内容时返回 false
+    bool read(LiveSnapshot& out) const;
+
+    // path 已被新的测试重新创建, 应重新打开
+    bool stale() const noexcept;
+
+private:
+    std::string path_;
+    std::uint64_t ino_;
+    std::size_t size_;
+    const std::uint64_t* base_;
+};
+
+}
+
+#endif
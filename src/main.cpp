@@ -7,19 +7,39 @@
 #include "http_parser.h"
 #include "stats.hpp"
 #include "numfmt.hpp"
+#include "report.hpp"
+#include "histlog.hpp"
+#include "scenario.hpp"
+#include "distributed.hpp"
+#include "server.hpp"
+#include "url.hpp"
+#include "shm.hpp"
+#include "live.hpp"
+#include "search.hpp"
+#include "delay.hpp"
+#include "replay.hpp"
+#include "balance.hpp"
+#include "trace.hpp"
+#include "sockopt.hpp"
 #include <csignal>
+#include <cstdlib>
+#include <cstring>
 #include <memory>
+#include <algorithm>
 #include <iostream>
 #include <iomanip>
+#include <sstream>
 #include <chrono>
 #include <thread>
 #include <list>
-#include <boost/format.hpp>
+#include <random>
 #include <boost/program_options.hpp>
 
 #include <sys/types.h>
 #include <sys/socket.h>
 #include <netdb.h>
+#include <sys/wait.h>
+#include <unistd.h>
 
 
 namespace po = boost::program_options;
@@ -28,18 +48,277 @@ std::unique_ptr<moros::Stats> requests, latency;
 
 static moros::Config cfg;
 static moros::SslContext ssl_ctx;
+static std::vector<moros::Endpoint> endpoints;
 static std::list<moros::Bencher> benchers;
+static std::unique_ptr<moros::AgentSession> agent;
+static std::unique_ptr<moros::Server> server;
 
-int main(int argc, char* argv[]) {
+// --processes: 父子进程共享的结果区, 父进程中各 worker 的 pid, 以及
+// 本进程的 worker 序号, 父进程为 -1
+static std::unique_ptr<moros::SharedResults> shared;
+static std::vector<pid_t> workers;
+static int worker = -1;
+
+// 收到 SIGINT 后不再开始新的 --search 步骤
+static volatile std::sig_atomic_t interrupted = 0;
+
+static void printBanner(std::size_t agents) {
+    std::cerr << "Running " << moros::numfmt(cfg.duration) << " test @ "
+              << cfg.url << '\n' << "  ";
+    if (agents) {
+        std::cerr << agents << " agent(s), ";
+    }
+    if (cfg.processes > 1) {
+        std::cerr << cfg.processes << " process(es), ";
+    }
+    std::cerr << cfg.threads << " thread(s) and " << cfg.connections
+              << " connection(s) each";
+    if (cfg.protocol != moros::Protocol::HTTP1) {
+        std::cerr << ", " << cfg.streams << " stream(s) per connection";
+    }
+    if (!cfg.think.empty()) {
+        std::cerr << ", think " << cfg.think;
+    } else if (!cfg.arrival.empty()) {
+        std::cerr << ", arrival " << cfg.arrival;
+    } else if (!cfg.replay.empty()) {
+        std::cerr << ", replaying " << cfg.replay << " at " << cfg.replay_speed << "x";
+    }
+    if (std::any_of(endpoints.begin(), endpoints.end(),
+                    [](const moros::Endpoint& ep) { return ep.dynamic(); })) {
+        std::cerr << ", seed " << cfg.seed;
+    }
+    std::cerr << std::endl;
+}
+
+static void printSummary(const moros::Summary& summary) {
+    switch (cfg.output) {
+    case moros::Output::TEXT:
+        moros::reportText(std::cerr, summary);
+        break;
+    case moros::Output::JSON:
+        moros::reportJson(std::cout, summary);
+        moros::reportSaturation(std::cerr, summary);
+        break;
+    case moros::Output::CSV:
+        moros::reportCsv(std::cout, summary);
+        moros::reportSaturation(std::cerr, summary);
+        break;
+    }
+}
+
+static void summarize(const moros::ClusterResult& res, moros::HistogramLog* histogram_log);
+
+// coordinator: 本机不施压, 由各 agent 同时开始并汇总它们的结果
+static void coordinate(const std::vector<std::string>& agents,
+                       const std::vector<std::string>& args, const std::string& token,
+                       moros::HistogramLog* histogram_log) {
+    moros::Coordinator coord(agents, token);
+
+    // 留出时间让 START 送达所有 agent
+    const auto delay = std::chrono::milliseconds(500);
+    coord.start(args, delay);
+
+    if (cfg.warmup.count()) {
+        std::cerr << "Warming up for " << moros::numfmt(cfg.warmup) << " @ "
+                  << cfg.url << std::endl;
+    }
+    if (histogram_log) {
+        histogram_log->start(std::chrono::system_clock::now() + delay + cfg.warmup);
+    }
+    printBanner(coord.size());
+
+    if (cfg.interval.count()) {
+        moros::IntervalReport interval(benchers, cfg.timeout.count() * 1000,
+                                       histogram_log);
+        interval.header(std::cerr);
+
+        for (auto t = cfg.interval; t <= cfg.duration; t += cfg.interval) {
+            std::chrono::milliseconds elapsed, span;
+            const moros::Snapshot snap = coord.interval(elapsed, span);
+            interval.merge(snap.counters, *snap.latency);
+            interval.print(std::cerr, elapsed, span);
+        }
+    }
+
+    const moros::ClusterResult res = coord.finish();
+    if (res.endpoints.size() != endpoints.size()) {
+        throw std::runtime_error("agents disagree on the endpoints");
+    }
+    summarize(res, histogram_log);
+}
+
+// fork cfg.processes 个 worker, 结果经新建的 shared 交给父进程. 父进程中
+// 返回 true; worker 中记下序号后返回 false, 由调用者继续以 cfg 施压.
+// fork 失败时结束已有的 worker 并抛出 std::runtime_error
+static bool spawnWorkers() {
+    shared = std::make_unique<moros::SharedResults>(cfg.processes, cfg.threads,
+                                                    endpoints.size(), cfg.timeout);
+
+    std::cout.flush();
+    std::cerr.flush();
+    // 信号处理中会遍历, 不能重新分配
+    workers.clear();
+    workers.reserve(cfg.processes);
+    for (std::size_t w = 0; w < cfg.processes; ++w) {
+        const pid_t pid = ::fork();
+        if (pid == -1) {
+            const std::string msg = std::string("fork: ") + std::strerror(errno);
+            for (pid_t p : workers) {
+                ::kill(p, SIGKILL);
+                ::waitpid(p, nullptr, 0);
+            }
+            workers.clear();
+            throw std::runtime_error(msg);
+        }
+        if (pid == 0) {
+            worker = static_cast<int>(w);
+            workers.clear();
+            cfg.histogram_log.clear();
+            return false;
+        }
+        workers.push_back(pid);
+    }
+    return true;
+}
+
+// 等待尚未回收的 worker 退出, 提示没有留下结果的
+static void reapWorkers(const std::vector<bool>& exited) {
+    for (std::size_t w = 0; w < workers.size(); ++w) {
+        if (w >= exited.size() || !exited[w]) {
+            ::waitpid(workers[w], nullptr, 0);
+        }
+        if (!shared->done(w)) {
+            std::cerr << "Warning: worker process " << w << " exited without results"
+                      << std::endl;
+        }
+    }
+}
+
+// --processes: 父进程不施压, 按 interval 汇总各 worker 写在共享内存中的
+// 结果, 全部退出后合并
+static void supervise(const std::vector<pid_t>& pids, moros::HistogramLog* histogram_log) {
+    if (cfg.warmup.count()) {
+        std::cerr << "Warming up for " << moros::numfmt(cfg.warmup) << " @ "
+                  << cfg.url << std::endl;
+    }
+    if (histogram_log) {
+        histogram_log->start(std::chrono::system_clock::now() + cfg.warmup);
+    }
+    printBanner(0);
+
+    // 提前退出的 worker 不再等待, 例如插件调用了 exit
+    std::vector<bool> exited(pids.size());
+    const auto reap = [&] {
+        for (std::size_t w = 0; w < pids.size(); ++w) {
+            if (!exited[w] && ::waitpid(pids[w], nullptr, WNOHANG) == pids[w]) {
+                exited[w] = true;
+            }
+        }
+    };
+
+    if (cfg.interval.count()) {
+        moros::IntervalReport interval(benchers, cfg.timeout.count() * 1000,
+                                       histogram_log);
+        interval.header(std::cerr);
+
+        std::uint64_t k = 0;
+        for (auto t = cfg.interval; t <= cfg.duration; t += cfg.interval) {
+            ++k;
+            moros::Snapshot snap;
+            std::vector<bool> merged(pids.size());
+            for (;;) {
+                bool all = true;
+                for (std::size_t w = 0; w < pids.size(); ++w) {
+                    if (!merged[w]) {
+                        merged[w] = shared->interval(w, k, snap) || shared->done(w) ||
+                                    exited[w];
+                    }
+                    all = all && merged[w];
+                }
+                if (all) {
+                    break;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(1));
+                reap();
+            }
+
+            if (!snap.latency) {
+                snap.latency = std::make_unique<moros::Stats>(cfg.timeout.count() * 1000);
+            }
+            interval.merge(snap.counters, *snap.latency);
+            interval.print(std::cerr, t, cfg.interval);
+        }
+    }
+
+    reapWorkers(exited);
+    summarize(shared->collect(), histogram_log);
+}
+
+// 汇总结果并入本机的统计, 之后与单机模式共用输出
+static void summarize(const moros::ClusterResult& res, moros::HistogramLog* histogram_log) {
+    for (std::size_t i = 0; i < static_cast<std::size_t>(moros::Metrics::Kind::MAX); ++i) {
+        const auto k = static_cast<moros::Metrics::Kind>(i);
+        moros::Metrics::getInstance().count(k, res.total[k]);
+        for (std::size_t j = 0; j < endpoints.size(); ++j) {
+            endpoints[j].metrics->count(k, res.endpoints[j][k]);
+        }
+    }
+    latency->merge(*res.total.latency);
+    requests->merge(*res.requests);
+    for (std::size_t j = 0; j < endpoints.size(); ++j) {
+        endpoints[j].latency->merge(*res.endpoints[j].latency);
+    }
+
+    std::vector<moros::Stats> phases(static_cast<std::size_t>(moros::Phase::MAX),
+                                     moros::Stats(cfg.timeout.count() * 1000000));
+    for (std::size_t p = 0; p < std::min(phases.size(), res.phases.size()); ++p) {
+        phases[p].merge(*res.phases[p]);
+    }
+
+    if (histogram_log && !cfg.interval.count()) {
+        histogram_log->append(std::chrono::milliseconds(0), res.runtime, *latency);
+    }
+
+    std::vector<moros::ThreadSummary> threads;
+    for (const auto& t : res.threads) {
+        threads.push_back({t[moros::Metrics::Kind::COMPLETES], t.latency.get(),
+                           nullptr, nullptr, nullptr});
+    }
+    const moros::Summary summary = {cfg, res.runtime, *latency, *requests,
+                                    std::move(threads), endpoints, phases};
+    printSummary(summary);
+
+    if (server) {
+        moros::reportCalibration(std::cerr, summary);
+    }
+}
+
+static int run(int argc, char* argv[]) {
     std::signal(SIGINT, [](int sig) {
         (void)sig;
 
         for (auto& b : benchers) {
             b.stop();
         }
+        for (pid_t pid : workers) {
+            ::kill(pid, SIGINT);
+        }
+        interrupted = 1;
+        // --serve; --calibrate 时服务随测试结束, 多进程时随 worker 结束
+        if (server && benchers.empty() && !shared) {
+            server->stop();
+        }
     });
     std::signal(SIGPIPE, SIG_IGN);
 
+    // agent 会以下发的参数再次进入
+    cfg = moros::Config();
+
+    std::string protocol, output, percentiles, agents, search_slo, agent_listen, agent_token;
+    std::uint16_t serve_port = 0;
+    std::size_t search_max = 0;
+    moros::ServerConfig server_cfg;
+
     po::options_description desc("Allowed options");
     desc.add_options()
         ("help,h", "Produce help message")
@@ -47,11 +326,48 @@ int main(int argc, char* argv[]) {
         ("url,u", po::value<std::string>(&cfg.url), "HTTP url")
         ("plugin,p", po::value<std::string>(&cfg.plugin), "Load plugin")
         ("header,H", po::value<std::vector<std::string>>(&cfg.headers), "HTTP header")
+        ("scenario,S", po::value<std::string>(&cfg.scenario), "Send weighted requests described in this file instead of GET url")
         ("threads,t", po::value<std::size_t>(&cfg.threads)->default_value(1), "The number of HTTP benchers")
         ("connections,c", po::value<std::size_t>(&cfg.connections)->default_value(10), "The number of HTTP connections per bencher")
+        ("processes", po::value<std::size_t>(&cfg.processes)->default_value(1), "Fork this many worker processes, each running its own benchers and plugin")
         ("duration,d", po::value<std::chrono::seconds>(&cfg.duration)->default_value(std::chrono::seconds(10)), "Duration of bench")
         ("timeout,T", po::value<std::chrono::seconds>(&cfg.timeout)->default_value(std::chrono::seconds(2)), "Mark HTTP Request timeouted if HTTP Response is not received within this amount of time")
+        ("warmup,w", po::value<std::chrono::seconds>(&cfg.warmup)->default_value(std::chrono::seconds(0)), "Run load for this long before the test and discard its statistics")
+        ("ramp-up,r", po::value<std::chrono::seconds>(&cfg.ramp_up)->default_value(std::chrono::seconds(0)), "Open connections gradually over this period")
+        ("connect-concurrency", po::value<std::size_t>(&cfg.connect_concurrency)->default_value(256), "The maximum number of connects in flight per bencher, 0 for no limit")
+        ("requests-per-conn", po::value<std::size_t>(&cfg.requests_per_conn)->default_value(0), "Close and reopen a connection after this many requests, 0 for no limit")
+        ("conn-churn", po::value<double>(&cfg.conn_churn)->default_value(0), "Close and reopen this many connections per second in total, each after its current response")
+        ("think", po::value<std::string>(&cfg.think), "Wait this long after each response before the connection sends its next request, in ms: fixed:D, uniform:MIN,MAX, exp:MEAN or file:PATH")
+        ("arrival", po::value<std::string>(&cfg.arrival), "Schedule each connection's requests with inter-arrival times of this distribution (open loop), latency counted from the scheduled time; same format as --think")
+        ("replay", po::value<std::string>(&cfg.replay), "Replay the requests of this access log (common/combined log format, or tab separated time, method, uri and headers) with their original inter-arrival times")
+        ("replay-speed", po::value<double>(&cfg.replay_speed)->default_value(1), "Replay the access log this many times faster")
+        ("interval,i", po::value<std::chrono::seconds>(&cfg.interval)->default_value(std::chrono::seconds(0)), "Print throughput, errors and latency of every interval of this length")
         ("latency,l", "Print latency distribution")
+        ("protocol,P", po::value<std::string>(&protocol)->default_value("http/1.1"), "Protocol: http/1.1, h2 (TLS with ALPN) or h2c (cleartext with prior knowledge)")
+        ("streams,s", po::value<std::size_t>(&cfg.streams)->default_value(10), "The number of concurrent streams per HTTP/2 connection")
+        ("seed", po::value<std::uint64_t>(&cfg.seed), "Seed of request templates and endpoint picking, random by default")
+        ("output,o", po::value<std::string>(&output)->default_value("text"), "Result format: text, json or csv (json and csv go to stdout)")
+        ("percentiles", po::value<std::string>(&percentiles)->default_value("50,75,90,99,99.9,99.99"), "Comma separated latency percentiles to report")
+        ("histogram-log", po::value<std::string>(&cfg.histogram_log), "Write latency histograms to this file in HdrHistogram log format")
+        ("stats-file", po::value<std::string>(&cfg.stats_file), "Publish live counters and latency histograms to this file for moros-top")
+        ("trace", po::value<std::string>(&cfg.trace), "Record every request's timings in a ring buffer per bencher and write them to this binary file at the end, for moros-trace")
+        ("trace-size", po::value<std::size_t>(&cfg.trace_size)->default_value(65536), "The number of most recent requests each bencher keeps for --trace")
+        ("slowest", po::value<std::size_t>(&cfg.slowest)->default_value(0), "Print the N slowest requests with their connection, start time and phase timings")
+        ("rebalance", "Move idle connections from lagging benchers to faster ones of the same process, keeping the total number of connections")
+        ("sockopt", po::value<std::string>(&cfg.sockopt), "Comma separated socket options of the connections: fastopen, quickack, linger-rst, sndbuf=BYTES, rcvbuf=BYTES, congestion=NAME")
+        ("timestamping", "Also measure the wire latency of HTTP/1.1 requests with kernel socket timestamps")
+        ("perf-counters", "Count cycles, instructions, cache misses, context switches and syscalls of each bencher thread with perf_event_open and report them per request")
+        ("max-lag", po::value<std::chrono::milliseconds>(&cfg.max_lag)->default_value(std::chrono::milliseconds(10)), "Warn that the client is saturated when the p99 timer lag of a bencher's event loop exceeds this many milliseconds")
+        ("agent", po::value<std::string>(&agent_listen), "Run as an agent listening on [ADDR:]PORT, 127.0.0.1 unless ADDR is given, each coordinator connection runs one test")
+        ("agents", po::value<std::string>(&agents), "Comma separated host:port of agents to run the test on, merging their results")
+        ("agent-token", po::value<std::string>(&agent_token), "Shared secret the coordinator presents to its agents, $MOROS_AGENT_TOKEN by default")
+        ("serve", po::value<std::uint16_t>(&serve_port), "Run the built-in HTTP/1.1 server on this port with --threads threads instead of benchmarking")
+        ("calibrate", "Benchmark the built-in server over loopback to measure the max Req/Sec and latency floor of moros on this machine")
+        ("serve-size", po::value<std::size_t>(&server_cfg.response_size)->default_value(0), "Body size in bytes of the built-in server's responses")
+        ("serve-delay", po::value<std::string>(&server_cfg.delay), "Delay of the built-in server's responses in ms: fixed:D, uniform:MIN,MAX, exp:MEAN or file:PATH")
+        ("serve-keep-alive", po::value<std::size_t>(&server_cfg.keep_alive)->default_value(0), "Requests the built-in server answers per connection before closing it, 0 for no limit")
+        ("search", po::value<std::string>(&search_slo), "Search for the largest -c meeting this SLO, e.g. p99<50ms,errors<0.1%, running one -d step per -c")
+        ("search-max", po::value<std::size_t>(&search_max)->default_value(1000), "The largest -c tried by --search")
         ;
 
     po::positional_options_description pd;
@@ -71,7 +387,162 @@ int main(int argc, char* argv[]) {
         return 0;
     }
 
+    // 下发的参数不能让 agent 加载代码, 在本机任意写文件或对外提供服务
+    if (agent) {
+        for (const char* opt : {"plugin", "trace", "stats-file", "histogram-log", "serve",
+                                "serve-size", "serve-delay", "serve-keep-alive", "calibrate",
+                                "agent", "agents", "agent-token"}) {
+            if (vm.count(opt) && !vm[opt].defaulted()) {
+                const std::string why =
+                    std::string("--") + opt + " is not accepted from a coordinator";
+                std::cerr << why << '\n';
+                agent->reject(why);
+                return -1;
+            }
+        }
+    }
+
+    if (agent_token.empty()) {
+        if (const char* token = std::getenv("MOROS_AGENT_TOKEN")) {
+            agent_token = token;
+        }
+    }
+    if ((vm.count("agent") || !agents.empty()) && agent_token.empty()) {
+        std::cerr << "--agent and --agents need a shared --agent-token or MOROS_AGENT_TOKEN"
+                  << '\n';
+        return -1;
+    }
+
+    // 每个 coordinator 连接在 fork 出的子进程中按下发的参数运行一次测试
+    if (vm.count("agent")) {
+        std::signal(SIGINT, SIG_DFL);
+        try {
+            agent = std::make_unique<moros::AgentSession>(
+                moros::serveAgent(moros::listenAgent(agent_listen)));
+
+            std::vector<std::string> args = agent->args(agent_token);
+            args.insert(args.begin(), argv[0]);
+            std::vector<char*> av;
+            for (auto& a : args) {
+                av.push_back(&a[0]);
+            }
+            return run(static_cast<int>(av.size()), av.data());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
+
+    if (vm.count("serve")) {
+        server_cfg.port = serve_port;
+        server_cfg.threads = cfg.threads;
+        try {
+            server = std::make_unique<moros::Server>(server_cfg);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+
+        std::cerr << "Serving HTTP/1.1 on port " << server->port() << " with "
+                  << cfg.threads << " thread(s)" << std::endl;
+        server->start();
+        server->wait();
+        std::cerr << server->served() << " requests served" << std::endl;
+        return 0;
+    }
+
+    // 服务与 bencher 在同一进程中, 经 loopback 施压
+    if (vm.count("calibrate")) {
+        if (vm.count("url") || !agents.empty() || agent || protocol != "http/1.1") {
+            std::cerr << "--calibrate benchmarks the built-in server over http/1.1, "
+                         "without url or agents" << '\n';
+            return -1;
+        }
+
+        server_cfg.loopback = true;
+        server_cfg.threads = cfg.threads;
+        try {
+            server = std::make_unique<moros::Server>(server_cfg);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+        server->start();
+        cfg.url = "http://127.0.0.1:" + std::to_string(server->port()) + "/";
+    }
+
+    // 这些只对本机有意义, agent 也不会接受
+    if (!agents.empty() && (!cfg.plugin.empty() || !cfg.trace.empty() || !cfg.stats_file.empty())) {
+        std::cerr << "--plugin, --trace and --stats-file cannot be combined with agents" << '\n';
+        return -1;
+    }
+
+    if (cfg.processes == 0 || (cfg.processes > 1 && (agent || !agents.empty()))) {
+        std::cerr << "--processes must be at least 1, and cannot be combined with "
+                     "agents" << '\n';
+        return -1;
+    }
+
+    // 每步只输出一行结果, 不需要 interval
+    std::unique_ptr<moros::Slo> slo;
+    if (!search_slo.empty()) {
+        if (agent || !agents.empty() || !cfg.histogram_log.empty()) {
+            std::cerr << "--search cannot be combined with agents or --histogram-log" << '\n';
+            return -1;
+        }
+        try {
+            slo = std::make_unique<moros::Slo>(search_slo);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+        cfg.interval = std::chrono::seconds(0);
+    }
+
+    // 最慢的请求只在本进程的报告中列出, 各步的 worker 会覆盖同一个 trace
+    if (cfg.trace_size == 0 || cfg.trace_size > (std::size_t(1) << 26)) {
+        std::cerr << "Invalid --trace-size: " << cfg.trace_size << '\n';
+        return -1;
+    }
+    if ((cfg.slowest && (cfg.processes > 1 || !agents.empty())) ||
+        (slo && (cfg.slowest || !cfg.trace.empty()))) {
+        std::cerr << "--slowest works in a single process without agents, and neither it "
+                     "nor --trace works with --search" << '\n';
+        return -1;
+    }
+
     cfg.display_latency = vm.count("latency");
+    cfg.timestamping = vm.count("timestamping");
+    cfg.perf_counters = vm.count("perf-counters");
+    cfg.rebalance = vm.count("rebalance");
+
+    if (!vm.count("seed")) {
+        cfg.seed = (std::uint64_t(std::random_device()()) << 32) | std::random_device()();
+    }
+
+    if (output == "text") {
+        cfg.output = moros::Output::TEXT;
+    } else if (output == "json") {
+        cfg.output = moros::Output::JSON;
+    } else if (output == "csv") {
+        cfg.output = moros::Output::CSV;
+    } else {
+        std::cerr << "Invalid output format: " << output << '\n';
+        return -1;
+    }
+
+    {
+        std::istringstream is(percentiles);
+        for (std::string p; std::getline(is, p, ',');) {
+            char* end = nullptr;
+            const double v = std::strtod(p.c_str(), &end);
+            if (p.empty() || *end != '\0' || v <= 0 || v > 100) {
+                std::cerr << "Invalid percentile: " << p << '\n';
+                return -1;
+            }
+            cfg.percentiles.push_back(v);
+        }
+    }
 
 
     // Max QPS = 1M
@@ -80,63 +551,228 @@ int main(int argc, char* argv[]) {
     latency = std::make_unique<moros::Stats>(cfg.timeout.count() * 1000);
 
 
+    // http+unix:///path/to.sock:/uri 经 Unix socket 连接, 其余部分按
+    // schema://localhost/uri 处理
+    moros::UnixUrl unix_url;
+    const bool using_unix = moros::parseUnixUrl(cfg.url, unix_url);
+    if (using_unix && cfg.timestamping) {
+        std::cerr << "--timestamping needs a TCP target" << '\n';
+        return -1;
+    }
+    const std::string target =
+        using_unix ? unix_url.schema + "://localhost" + unix_url.uri : cfg.url;
+
     struct http_parser_url parts = {};
-    if (http_parser_parse_url(cfg.url.c_str(), cfg.url.size(), false, &parts) == 0) {
+    if (http_parser_parse_url(target.c_str(), target.size(), false, &parts) == 0) {
         if (!(parts.field_set & ((1 << UF_SCHEMA) | (1 << UF_HOST)))) {
             std::cerr << "Invalid url: " << cfg.url << '\n';
             return -1;
         }
     }
 
-    const std::string schema = cfg.url.substr(parts.field_data[UF_SCHEMA].off,
+    const std::string schema = target.substr(parts.field_data[UF_SCHEMA].off,
                                               parts.field_data[UF_SCHEMA].len),
-                      host = cfg.url.substr(parts.field_data[UF_HOST].off,
+                      host = target.substr(parts.field_data[UF_HOST].off,
                                             parts.field_data[UF_HOST].len),
                       port = (parts.field_set & (1 << UF_PORT))
-                                 ? cfg.url.substr(parts.field_data[UF_PORT].off,
+                                 ? target.substr(parts.field_data[UF_PORT].off,
                                                   parts.field_data[UF_PORT].len)
                                  : "",
                       service = !port.empty() ? port : schema,
                       path = (parts.field_set & (1 << UF_PATH))
-                                 ? cfg.url.substr(parts.field_data[UF_PATH].off,
+                                 ? target.substr(parts.field_data[UF_PATH].off,
                                                   parts.field_data[UF_PATH].len)
                                  : "/",
                       query_string =
                           (parts.field_set & (1 << UF_QUERY))
-                              ? cfg.url.substr(parts.field_data[UF_QUERY].off,
+                              ? target.substr(parts.field_data[UF_QUERY].off,
                                                parts.field_data[UF_QUERY].len)
                               : "";
 
-    const std::string http_req = ({
-        const auto iter = std::find_if(
-            cfg.headers.begin(), cfg.headers.end(), [](const std::string& s) {
-                return (s.size() <= 5)
-                           ? false
-                           : ::strncasecmp(s.c_str(), "Host", 4) == 0;
-            });
-
-        const std::string uri =
-            path + (query_string.empty() ? "" : "?") + query_string;
-
-        std::string req;
-        if (iter == cfg.headers.end()) {
-            req = str(boost::format("GET %1% HTTP/1.1\r\n"
-                                    "Host: %2%\r\n") %
-                      uri % host);
+    const std::string uri =
+        path + (query_string.empty() ? "" : "?") + query_string;
+
+    // 未指定 scenario 时只有一个 GET url 的 endpoint
+    try {
+        if (cfg.scenario.empty()) {
+            endpoints.emplace_back(uri, 1, moros::buildHead("GET", uri, host, cfg.headers),
+                                   "", cfg.timeout.count() * 1000);
         } else {
-            req = str(boost::format("GET %1% HTTP/1.1\r\n") % uri);
+            endpoints = moros::loadScenario(cfg.scenario, host, cfg.headers,
+                                            cfg.timeout.count() * 1000);
         }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+
+    const bool using_https = ::strncasecmp(schema.c_str(), "https", 5) == 0;
 
-        for (const auto& header : cfg.headers) {
-            req.append(header);
-            req.append("\r\n");
+    if (protocol == "http/1.1") {
+        cfg.protocol = moros::Protocol::HTTP1;
+    } else if (protocol == "h2" && using_https) {
+        cfg.protocol = moros::Protocol::H2;
+        ssl_ctx.alpn({"h2"});
+    } else if (protocol == "h2c" && !using_https) {
+        cfg.protocol = moros::Protocol::H2C;
+    } else {
+        std::cerr << "Invalid protocol " << protocol << " for " << cfg.url << '\n';
+        return -1;
+    }
+
+    if (!(cfg.conn_churn >= 0)) {
+        std::cerr << "Invalid --conn-churn: " << cfg.conn_churn << '\n';
+        return -1;
+    }
+
+    // 内核不支持的选项在开始前报告, 而不是让每次连接都失败
+    try {
+        moros::probeSocketOptions(using_unix ? AF_UNIX : AF_INET,
+                                  moros::parseSocketOptions(cfg.sockopt));
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+
+    // 按计划发出请求只用于 HTTP/1.1, 每个连接同时只有一个请求
+    if (!cfg.think.empty() || !cfg.arrival.empty()) {
+        if (cfg.protocol != moros::Protocol::HTTP1 ||
+            (!cfg.think.empty() && !cfg.arrival.empty())) {
+            std::cerr << "Only one of --think and --arrival can be used, over http/1.1" << '\n';
+            return -1;
         }
-        req.append("\r\n");
+        try {
+            const moros::DelayDistribution think(cfg.think), arrival(cfg.arrival);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
 
-        req;
-    });
+    // 日志取代 url 与 scenario 的请求, url 只给出目标; 各 agent 会重复
+    // 重放整个日志, 因此不能与 agents 一起使用
+    if (!cfg.replay.empty()) {
+        if (cfg.protocol != moros::Protocol::HTTP1 || !agents.empty() || agent || slo ||
+            !cfg.scenario.empty() || !cfg.think.empty() || !cfg.arrival.empty()) {
+            std::cerr << "--replay works over http/1.1, without agents, --search, "
+                         "--scenario, --think or --arrival" << '\n';
+            return -1;
+        }
+        if (!(cfg.replay_speed > 0)) {
+            std::cerr << "Invalid --replay-speed: " << cfg.replay_speed << '\n';
+            return -1;
+        }
+        try {
+            moros::AccessLog log(cfg.replay);
+            moros::ReplayEntry e;
+            if (!log.next(e)) {
+                std::cerr << "No request to replay in " << cfg.replay << '\n';
+                return -1;
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
 
-    const bool using_https = ::strncasecmp(schema.c_str(), "https", 5) == 0;
+    // 只能移交没有 TLS 与 HTTP/2 会话状态的连接; 重放的日志按 bencher 分配
+    if (cfg.rebalance &&
+        (cfg.protocol != moros::Protocol::HTTP1 || using_https || !cfg.replay.empty())) {
+        std::cerr << "--rebalance works over cleartext http/1.1, without --replay" << '\n';
+        return -1;
+    }
+
+    // --search: 每一步 fork 新的 worker 以该步的 -c 施压, 父进程只检查 SLO
+    if (slo) {
+        moros::LoadSearch search(*slo, cfg.connections, search_max);
+        std::cerr << "Running " << moros::numfmt(cfg.duration) << " steps @ " << cfg.url
+                  << std::endl;
+        search.header(std::cout);
+
+        try {
+            std::size_t c = 0;
+            while (!interrupted && search.next(c)) {
+                cfg.connections = c;
+                if (!spawnWorkers()) {
+                    break;
+                }
+                reapWorkers({});
+
+                const moros::ClusterResult res = shared->collect();
+                search.record(moros::measure(c, res.runtime, res.total.counters,
+                                             *res.total.latency),
+                              *res.total.latency);
+                search.print(std::cout, search.steps().back());
+            }
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+
+        if (worker < 0) {
+            search.summary(std::cout);
+            if (server) {
+                server->stop();
+                server->wait();
+            }
+            return 0;
+        }
+    } else if (cfg.processes > 1) {
+        // fork 出的 worker 各自加载插件与建立 bencher, 结果只经共享内存交给父进程
+        try {
+            spawnWorkers();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
+
+    std::unique_ptr<moros::HistogramLog> histogram_log;
+    if (!cfg.histogram_log.empty()) {
+        histogram_log = std::make_unique<moros::HistogramLog>(cfg.histogram_log);
+    }
+
+    if (worker < 0 && !workers.empty()) {
+        supervise(workers, histogram_log.get());
+        if (server) {
+            server->stop();
+            server->wait();
+        }
+        return 0;
+    }
+
+    if (!agents.empty()) {
+        // 其余参数原样下发, 各 agent 自行解析 url 与 scenario. histogram log
+        // 由 coordinator 写, token 不必随参数再发一遍
+        std::vector<std::string> list, args;
+        std::istringstream is(agents);
+        for (std::string a; std::getline(is, a, ',');) {
+            list.push_back(a);
+        }
+        for (int i = 1; i < argc; ++i) {
+            const std::string a = argv[i];
+            bool local = false;
+            for (const std::string opt : {"--agents", "--agent-token", "--histogram-log"}) {
+                if (a == opt) {
+                    local = true;
+                    ++i;
+                } else if (a.compare(0, opt.size() + 1, opt + "=") == 0) {
+                    local = true;
+                }
+            }
+            if (!local) {
+                args.push_back(a);
+            }
+        }
+
+        try {
+            coordinate(list, args, agent_token, histogram_log.get());
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+        return 0;
+    }
 
     auto plugin =
         moros::Plugin(schema, host, port, service, query_string, cfg.headers);
@@ -157,18 +793,102 @@ int main(int argc, char* argv[]) {
     };
 
     struct addrinfo* result = nullptr;
-    int ret = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
-    if (ret != 0) {
-        std::cerr << "resolve " << host << " failed: " << ::gai_strerror(ret) << '\n';
-        return -2;
+    struct sockaddr_un sun;
+    struct addrinfo unix_addr;
+    if (using_unix) {
+        if (!moros::unixAddr(unix_url.path, sun, unix_addr)) {
+            std::cerr << "Unix socket path too long: " << unix_url.path << '\n';
+            return -1;
+        }
+    } else {
+        int ret = ::getaddrinfo(host.c_str(), service.c_str(), &hints, &result);
+        if (ret != 0) {
+            std::cerr << "resolve " << host << " failed: " << ::gai_strerror(ret) << '\n';
+            return -2;
+        }
     }
 
     std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(
         result, ::freeaddrinfo);
 
-    for (std::size_t i = 0; i < cfg.threads; ++i) {
-        benchers.emplace_back(*rptr, cfg.connections, host, http_req,
-                              using_https ? &ssl_ctx : nullptr, plugin);
+    try {
+        for (std::size_t i = 0; i < cfg.threads; ++i) {
+            // 各 worker 的 bencher 编号连续, 种子与模板序号互不重叠
+            const std::size_t id = worker < 0 ? i : worker * cfg.threads + i;
+            benchers.emplace_back(cfg, id, using_unix ? unix_addr : *rptr, host, endpoints,
+                                  using_https ? &ssl_ctx : nullptr, plugin);
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+
+    // 与其他 agent 同时开始
+    if (agent) {
+        try {
+            agent->start();
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
+
+    // 多进程时每个 worker 写各自的文件, 由 moros-top 合并
+    std::unique_ptr<moros::LiveStats> live;
+    if (!cfg.stats_file.empty()) {
+        const std::string path =
+            worker < 0 ? cfg.stats_file : cfg.stats_file + "." + std::to_string(worker);
+        try {
+            live = std::make_unique<moros::LiveStats>(path, cfg.url, *latency);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+            return -1;
+        }
+    }
+
+    // 主线程等待期间每 100ms 发布一次, bencher 线程不参与
+    auto live_state = moros::LiveState::WARMUP;
+    auto live_start = std::chrono::steady_clock::now();
+    // --rebalance: 主线程每秒比较一次各 bencher
+    std::unique_ptr<moros::Balancer> balancer;
+    if (cfg.rebalance && benchers.size() > 1) {
+        balancer = std::make_unique<moros::Balancer>();
+    }
+    auto balance_at = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    const auto balance = [&] {
+        std::vector<moros::BencherLoad> loads;
+        for (const auto& b : benchers) {
+            loads.push_back(b.load());
+        }
+        moros::Migration m;
+        if (balancer->decide(loads, m)) {
+            std::next(benchers.begin(), m.from)->migrate(*std::next(benchers.begin(), m.to),
+                                                         m.count);
+        }
+    };
+    const auto wait = [&](std::chrono::steady_clock::time_point until) {
+        if (live || balancer) {
+            for (auto now = std::chrono::steady_clock::now(); now < until;
+                 now = std::chrono::steady_clock::now()) {
+                std::this_thread::sleep_until(
+                    std::min(until, now + std::chrono::milliseconds(100)));
+                if (live) {
+                    live->publish(live_state,
+                                  std::chrono::duration_cast<std::chrono::milliseconds>(
+                                      std::chrono::steady_clock::now() - live_start));
+                }
+                if (balancer && std::chrono::steady_clock::now() >= balance_at) {
+                    balance();
+                    balance_at += std::chrono::seconds(1);
+                }
+            }
+        }
+        std::this_thread::sleep_until(until);
+    };
+
+    // warmup 期间照常施压, 但不记录任何统计
+    if (cfg.warmup.count()) {
+        moros::Metrics::getInstance().enable(false);
     }
 
     std::vector<std::thread> thread_group;
@@ -179,15 +899,74 @@ int main(int argc, char* argv[]) {
         });
     });
 
+    if (cfg.warmup.count()) {
+        if (worker < 0) {
+            std::cerr << "Warming up for " << moros::numfmt(cfg.warmup) << " @ "
+                      << cfg.url << std::endl;
+        }
+        wait(std::chrono::steady_clock::now() + cfg.warmup);
+
+        requests->reset();
+        latency->reset();
+        for (auto& ep : endpoints) {
+            ep.latency->reset();
+            ep.metrics->reset();
+        }
+        moros::Metrics::getInstance().reset();
+        moros::Metrics::getInstance().enable(true);
+    }
+
     const auto bench_start = std::chrono::steady_clock::now();
+    const auto bench_wall = std::chrono::system_clock::now();
+    if (live) {
+        live_state = moros::LiveState::RUNNING;
+        live_start = bench_start;
+        live->publish(live_state, std::chrono::milliseconds(0));
+    }
+    if (histogram_log) {
+        histogram_log->start(std::chrono::system_clock::now());
+    }
+
+    // 计数器在 bencher 线程中打开, 此时尚未打开的从打开时算起
+    std::vector<moros::PerfSample> perf;
+    for (const auto& b : benchers) {
+        perf.push_back(b.perf().read());
+    }
 
     // benchmark result title
-    std::cerr << "Running " << moros::numfmt(cfg.duration) << " test @ "
-              << cfg.url << '\n'
-              << "  " << cfg.threads << " thread(s) and " << cfg.connections
-              << " connection(s) each" << std::endl;
+    if (worker < 0) {
+        printBanner(0);
+    }
+
+    if (cfg.interval.count()) {
+        moros::IntervalReport interval(benchers, cfg.timeout.count() * 1000,
+                                       histogram_log.get());
+        if (!agent && worker < 0) {
+            interval.header(std::cerr);
+        }
+
+        bool connected = true;
+        std::uint64_t k = 0;
+        for (auto t = cfg.interval; t <= cfg.duration; t += cfg.interval) {
+            wait(bench_start + t);
+            ++k;
+            if (worker >= 0) {
+                interval.collect(cfg.interval);
+                shared->publishInterval(worker, k, interval.delta(), interval.latency());
+                interval.clear();
+            } else if (!agent) {
+                interval.report(std::cerr, t, cfg.interval);
+            } else if (connected) {
+                interval.collect(cfg.interval);
+                connected = agent->interval(
+                    t, cfg.interval,
+                    moros::encodeSnapshot(interval.delta(), interval.latency()));
+                interval.clear();
+            }
+        }
+    }
+    wait(bench_start + cfg.duration);
 
-    std::this_thread::sleep_for(cfg.duration);
     for (auto& b : benchers) {
         b.stop();
     }
@@ -200,72 +979,146 @@ int main(int argc, char* argv[]) {
 
     const auto runtime = std::chrono::duration_cast<std::chrono::milliseconds>(
         std::chrono::steady_clock::now() - bench_start);
+    if (live) {
+        live->publish(moros::LiveState::DONE, runtime);
+    }
 
-    // benchmark result
-    std::cerr << "  Thread Stats   Avg      Stdev      Max   +/- Stdev\n";
-    const auto print_stats = [](std::string name, const moros::Stats& st, auto fn) {
-        const double mean = st.mean();
-        const double stdev = st.stdev(mean);
-        const double max = st.max();
-        const double p = st.inStdevPercent(mean, stdev, 1);
-
-        std::cerr << "    " << name
-                  << std::setw(9) << moros::numfmt(fn(mean))
-                  << std::setw(11) << moros::numfmt(fn(stdev))
-                  << std::setw(9) << moros::numfmt(fn(max))
-                  << std::setw(12) << p << "%\n";
-    };
-    print_stats("Latency", *latency, [](auto x) {
-        return std::chrono::milliseconds(static_cast<std::uint64_t>(x));
-    });
-    print_stats("Req/Sec", *requests, [](auto x) { return x; });
-
-    if (cfg.display_latency) {
-        std::cerr << "  Latency Distribution\n";
-        for (double p : {0.55, 0.75, 0.95, 0.99}) {
-            const std::chrono::milliseconds ms(latency->derank(p));
-            std::cerr << std::setw(7) << 100 * p << "%\t" << moros::numfmt(ms) << '\n';
-        }
-    }
-
-    // total requests and bytes
-    std::cerr << "  "
-              << moros::Metrics::getInstance()[moros::Metrics::Kind::COMPLETES]
-              << " requests in " << moros::numfmt(runtime) << ", "
-              << moros::numfmt(
-                     moros::Metrics::getInstance()[moros::Metrics::Kind::BYTES])
-              << "B read" << std::endl;
-
-    // socket errors
-    if (moros::Metrics::getInstance()[moros::Metrics::Kind::ECONNECT] ||
-        moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD] ||
-        moros::Metrics::getInstance()[moros::Metrics::Kind::EWRITE] ||
-        moros::Metrics::getInstance()[moros::Metrics::Kind::ETIMEOUT]) {
-        std::cerr << "  Socket errors:"
-                  << " connect " << moros::Metrics::getInstance()[moros::Metrics::Kind::ECONNECT]
-                  << ", read " << moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD]
-                  << ", write " << moros::Metrics::getInstance()[moros::Metrics::Kind::EWRITE]
-                  << ", timeout " << moros::Metrics::getInstance()[moros::Metrics::Kind::ETIMEOUT]
-                  << std::endl;
+    if (balancer && balancer->moved() && worker < 0 && !agent) {
+        std::cerr << "Rebalanced " << balancer->moved() << " connections, now";
+        for (const auto& b : benchers) {
+            std::cerr << ' ' << b.load().connections;
+        }
+        std::cerr << " per bencher" << '\n';
     }
 
-    // http status code errors
-    if (moros::Metrics::getInstance()[moros::Metrics::Kind::ESTATUS]) {
-        std::cerr << "  Non-2xx or 3xx responses: "
-                  << moros::Metrics::getInstance()[moros::Metrics::Kind::ESTATUS]
-                  << std::endl;
+    // 这些连接只计入 connect 错误, 在此说明原因
+    if (std::any_of(benchers.begin(), benchers.end(),
+                    [](const moros::Bencher& b) { return b.h2Refused(); })) {
+        std::cerr << "Error: server did not negotiate h2 via ALPN, those connections count as connect errors"
+                  << '\n';
+    }
+
+    // 未按 interval 输出时整个测试作为 log 中的一个 interval
+    if (histogram_log && !cfg.interval.count()) {
+        histogram_log->append(std::chrono::milliseconds(0), runtime, *latency);
+    }
+
+    // 各 bencher 的记录按发出时间合并, 多进程时每个 worker 写各自的文件
+    if (!cfg.trace.empty()) {
+        moros::TraceFile t;
+        t.start = std::chrono::duration_cast<std::chrono::microseconds>(
+                      bench_start.time_since_epoch()).count();
+        t.wall = std::chrono::duration_cast<std::chrono::microseconds>(
+                     bench_wall.time_since_epoch()).count();
+        for (const auto& ep : endpoints) {
+            t.endpoints.push_back(ep.name);
+        }
+        for (const auto& b : benchers) {
+            const std::size_t kept = t.records.size();
+            b.traceRing()->snapshot(t.records);
+            t.dropped += b.traceRing()->pushed() - (t.records.size() - kept);
+        }
+        std::sort(t.records.begin(), t.records.end(),
+                  [](const moros::TraceRecord& lhs, const moros::TraceRecord& rhs) {
+                      return lhs.start < rhs.start;
+                  });
+
+        const std::string path =
+            worker < 0 ? cfg.trace : cfg.trace + "." + std::to_string(worker);
+        try {
+            moros::writeTrace(path, t);
+        } catch (const std::exception& e) {
+            std::cerr << e.what() << '\n';
+        }
+    }
+
+    // 各阶段的耗时只在 bencher 内记录, 结束后合并
+    std::vector<moros::Stats> phases(static_cast<std::size_t>(moros::Phase::MAX),
+                                     moros::Stats(cfg.timeout.count() * 1000000));
+    for (const auto& b : benchers) {
+        for (std::size_t p = 0; p < phases.size(); ++p) {
+            phases[p].merge(b.phase(static_cast<moros::Phase>(p)));
+        }
+    }
+
+    std::size_t i = 0, counted = 0;
+    for (const auto& b : benchers) {
+        perf[i] = b.perf().read() - perf[i];
+        counted += perf[i++].mask != 0;
+    }
+    if (cfg.perf_counters && !counted && !benchers.empty()) {
+        std::cerr << "Warning: perf counters unavailable: "
+                  << std::strerror(benchers.front().perf().error()) << std::endl;
+    }
+
+    std::vector<moros::ThreadSummary> summaries;
+    i = 0;
+    for (const auto& b : benchers) {
+        summaries.push_back({b.completes(), &b.latency(), &b.loop(), &b.hooks(),
+                             cfg.perf_counters ? &perf[i] : nullptr});
+        ++i;
+    }
+    const moros::Summary summary = {cfg, runtime, *latency, *requests,
+                                    std::move(summaries), endpoints, phases};
+
+    if (agent) {
+        // 客户端饱和与否只有 agent 自己知道
+        moros::reportSaturation(std::cerr, summary);
+
+        std::vector<std::string> threads, eps;
+        for (const auto& b : benchers) {
+            std::uint64_t counters[static_cast<std::size_t>(moros::Metrics::Kind::MAX)] = {};
+            counters[static_cast<std::size_t>(moros::Metrics::Kind::COMPLETES)] = b.completes();
+            threads.push_back(moros::encodeSnapshot(counters, b.latency()));
+        }
+        for (const auto& ep : endpoints) {
+            eps.push_back(moros::encodeSnapshot(*ep.metrics, *ep.latency));
+        }
+
+        const std::string total =
+            moros::encodeSnapshot(moros::Metrics::getInstance(), *latency);
+        return agent->done(runtime, *requests, total, threads, eps, phases) ? 0 : -1;
+    }
+
+    if (worker >= 0) {
+        moros::reportSaturation(std::cerr, summary);
+        shared->publishDone(worker, runtime, moros::Metrics::getInstance(), *latency,
+                            *requests, benchers, endpoints, phases);
+
+        // 不运行析构: 父进程的服务线程与 bencher 状态在子进程中都无效
+        std::cout.flush();
+        std::cerr.flush();
+        std::fflush(nullptr);
+        ::_exit(0);
     }
 
-    // request per sec
-    std::cerr << "Requests/sec: "
-              << moros::Metrics::getInstance()[moros::Metrics::Kind::COMPLETES] *
-                     1000.0 / runtime.count()
-              << '\n'
-              << "Transfer/sec: "
-              << moros::numfmt(
-                     moros::Metrics::getInstance()[moros::Metrics::Kind::BYTES] *
-                     1000.0 / runtime.count())
-              << "B" << std::endl;
+    // benchmark result
+    printSummary(summary);
+
+    if (cfg.slowest) {
+        moros::SlowestRequests slowest(cfg.slowest);
+        for (const auto& b : benchers) {
+            slowest.merge(b.slowest());
+        }
+        std::vector<std::string> names;
+        for (const auto& ep : endpoints) {
+            names.push_back(ep.name);
+        }
+        moros::reportSlowest(std::cerr, slowest.sorted(),
+                             std::chrono::duration_cast<std::chrono::microseconds>(
+                                 bench_start.time_since_epoch()).count(),
+                             names);
+    }
+
+    if (server) {
+        moros::reportCalibration(std::cerr, summary);
+        server->stop();
+        server->wait();
+    }
 
     return 0;
 }
+
+int main(int argc, char* argv[]) {
+    return run(argc, argv);
+}
@@ -8,11 +8,11 @@
 
 namespace moros {
 
-std::string numfmt(std::chrono::hours h) {
+inline std::string numfmt(std::chrono::hours h) {
     return str(boost::format("%1%h") % h.count());
 }
 
-std::string numfmt(std::chrono::minutes m) {
+inline std::string numfmt(std::chrono::minutes m) {
     const auto hours = std::chrono::duration_cast<std::chrono::hours>(m);
     m -= hours;
 
@@ -24,7 +24,7 @@ std::string numfmt(std::chrono::minutes m) {
     return str(boost::format("%1%m") % m.count());
 }
 
-std::string numfmt(std::chrono::seconds s) {
+inline std::string numfmt(std::chrono::seconds s) {
     const auto mins = std::chrono::duration_cast<std::chrono::minutes>(s);
     s -= mins;
 
@@ -36,7 +36,7 @@ std::string numfmt(std::chrono::seconds s) {
     return str(boost::format("%1%s") % s.count());
 }
 
-std::string numfmt(std::chrono::milliseconds ms) {
+inline std::string numfmt(std::chrono::milliseconds ms) {
     const auto sec = std::chrono::duration_cast<std::chrono::seconds>(ms);
     ms -= sec;
 
@@ -48,7 +48,7 @@ std::string numfmt(std::chrono::milliseconds ms) {
     return str(boost::format("%1%ms") % ms.count());
 }
 
-std::string numfmt(std::chrono::microseconds us) {
+inline std::string numfmt(std::chrono::microseconds us) {
     const auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(us);
     us -= ms;
 
@@ -60,7 +60,7 @@ std::string numfmt(std::chrono::microseconds us) {
     return str(boost::format("%1%us") % us.count());
 }
 
-std::string numfmt(double n) {
+inline std::string numfmt(double n) {
     static const char* units[] = {
         "", "K", "M", "G", "T", "P", "E", "Z", "Y"
     };
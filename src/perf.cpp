@@ -0,0 +1,156 @@
+#include "perf.hpp"
+#include <cerrno>
+#include <string>
+#include <fstream>
+
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+namespace moros {
+
+namespace {
+
+constexpr std::size_t NEVENTS = static_cast<std::size_t>(PerfEvent::MAX);
+
+const char* const NAMES[] = {"cycles", "instructions", "cache-misses",
+                             "context-switches", "syscalls"};
+static_assert(sizeof(NAMES) / sizeof(NAMES[0]) == NEVENTS, "");
+
+// tracefs 可能挂载在两个位置之一, 都不可读时返回 0
+std::uint64_t tracepointId(const char* event) noexcept {
+    for (const char* root : {"/sys/kernel/tracing", "/sys/kernel/debug/tracing"}) {
+        std::ifstream in(std::string(root) + "/events/" + event + "/id");
+        std::uint64_t id = 0;
+        if (in >> id) {
+            return id;
+        }
+    }
+    return 0;
+}
+
+// 先连同内核态一起计数, perf_event_paranoid 不允许时退回只计用户态
+int perfOpen(std::uint32_t type, std::uint64_t config, int group) noexcept {
+    struct perf_event_attr attr = {};
+    attr.size = sizeof(attr);
+    attr.type = type;
+    attr.config = config;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                       PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+    int fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+    if (fd == -1 && (errno == EACCES || errno == EPERM)) {
+        attr.exclude_kernel = 1;
+        fd = ::syscall(SYS_perf_event_open, &attr, 0, -1, group, PERF_FLAG_FD_CLOEXEC);
+    }
+    return fd;
+}
+
+}
+
+const char* perfEventName(PerfEvent e) noexcept {
+    return NAMES[static_cast<std::size_t>(e)];
+}
+
+PerfSample& PerfSample::operator+=(const PerfSample& rhs) noexcept {
+    for (std::size_t i = 0; i < NEVENTS; ++i) {
+        counts[i] += rhs.counts[i];
+    }
+    mask |= rhs.mask;
+    return *this;
+}
+
+PerfSample PerfSample::operator-(const PerfSample& rhs) const noexcept {
+    PerfSample d = *this;
+    for (std::size_t i = 0; i < NEVENTS; ++i) {
+        if (rhs.has(static_cast<PerfEvent>(i))) {
+            d.counts[i] -= rhs.counts[i];
+        }
+    }
+    return d;
+}
+
+PerfCounters::~PerfCounters() {
+    for (int fd : fds_) {
+        if (fd != -1) {
+            ::close(fd);
+        }
+    }
+}
+
+std::size_t PerfCounters::open() noexcept {
+    const struct {
+        std::uint32_t type;
+        std::uint64_t config;
+    } events[NEVENTS] = {
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS},
+        {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES},
+        {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES},
+        {PERF_TYPE_TRACEPOINT, tracepointId("raw_syscalls/sys_enter")},
+    };
+
+    // 第一个打开的计数器作为 group leader, 整组同时调度, 一次 read 取得全部
+    int leader = -1;
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < NEVENTS; ++i) {
+        if (events[i].type == PERF_TYPE_TRACEPOINT && events[i].config == 0) {
+            continue;
+        }
+
+        const int fd = perfOpen(events[i].type, events[i].config, leader);
+        if (fd == -1) {
+            if (leader == -1) {
+                error_ = errno;
+            }
+            continue;
+        }
+
+        if (leader == -1) {
+            leader = fd;
+        }
+        fds_[i] = fd;
+        index_[i] = n++;
+    }
+
+    if (n) {
+        error_ = 0;
+    } else if (!error_) {
+        error_ = ENOENT;
+    }
+    leader_.store(leader, std::memory_order_release);
+    return n;
+}
+
+int PerfCounters::error() const noexcept {
+    return error_;
+}
+
+PerfSample PerfCounters::read() const noexcept {
+    PerfSample s;
+    const int leader = leader_.load(std::memory_order_acquire);
+    if (leader == -1) {
+        return s;
+    }
+
+    // nr, time_enabled, time_running, 之后每个计数器一个值
+    std::uint64_t buf[3 + NEVENTS];
+    if (::read(leader, buf, sizeof(buf)) < static_cast<ssize_t>(3 * sizeof(buf[0]))) {
+        return s;
+    }
+
+    const std::uint64_t nr = buf[0], enabled = buf[1], running = buf[2];
+    const double scale = running && running < enabled
+                             ? static_cast<double>(enabled) / running
+                             : 1.0;
+    for (std::size_t i = 0; i < NEVENTS; ++i) {
+        if (fds_[i] != -1 && index_[i] < nr) {
+            s.counts[i] = static_cast<std::uint64_t>(buf[3 + index_[i]] * scale);
+            s.mask |= 1u << i;
+        }
+    }
+    return s;
+}
+
+}
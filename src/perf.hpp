@@ -0,0 +1,75 @@
+#ifndef MOROS_PERF_HPP_
+#define MOROS_PERF_HPP_
+
+#include <atomic>
+#include <cstdint>
+#include <cstddef>
+
+// 单个线程的 perf_event_open 计数器组, 用于衡量客户端自身每个请求的开销.
+// 虚拟机, 容器或 perf_event_paranoid 的限制下部分甚至全部计数器可能打不开,
+// 此时对应的值不可用而不是报错
+
+namespace moros {
+
+enum class PerfEvent {
+    CYCLES,
+    INSTRUCTIONS,
+    CACHE_MISSES,
+    CONTEXT_SWITCHES,
+    // raw_syscalls:sys_enter tracepoint, 需要可读的 tracefs
+    SYSCALLS,
+    MAX,
+};
+
+const char* perfEventName(PerfEvent e) noexcept;
+
+// 某一时刻各计数器的累计值, 两次采样之差即其间的增量
+struct PerfSample {
+    std::uint64_t counts[static_cast<std::size_t>(PerfEvent::MAX)] = {};
+    // 以 PerfEvent 为位序的可用计数器
+    unsigned mask = 0;
+
+    bool has(PerfEvent e) const noexcept {
+        return mask & (1u << static_cast<unsigned>(e));
+    }
+
+    std::uint64_t operator[](PerfEvent e) const noexcept {
+        return counts[static_cast<std::size_t>(e)];
+    }
+
+    // 多个线程的增量相加
+    PerfSample& operator+=(const PerfSample& rhs) noexcept;
+
+    // rhs 中不可用的计数器视为 0, 例如计数器打开之前的采样
+    PerfSample operator-(const PerfSample& rhs) const noexcept;
+};
+
+class PerfCounters {
+public:
+    PerfCounters() noexcept = default;
+    ~PerfCounters();
+
+    PerfCounters(const PerfCounters&) = delete;
+    PerfCounters& operator=(const PerfCounters&) = delete;
+
+    // 在被统计的线程中调用, 返回打开的计数器个数
+    std::size_t open() noexcept;
+
+    // 一个计数器都没有打开时的 errno
+    int error() const noexcept;
+
+    // 任何线程均可调用, open 之前返回空的采样. 计数器因复用而未能全程
+    // 运行时按运行时间的比例放大
+    PerfSample read() const noexcept;
+
+private:
+    int fds_[static_cast<std::size_t>(PerfEvent::MAX)] = {-1, -1, -1, -1, -1};
+    // 在 group read 结果中的位置
+    std::size_t index_[static_cast<std::size_t>(PerfEvent::MAX)] = {};
+    std::atomic_int leader_{-1};
+    int error_ = 0;
+};
+
+}
+
+#endif
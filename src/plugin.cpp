@@ -43,6 +43,18 @@ void Plugin::load(std::string so) {
     so_ = std::unique_ptr<void, int (*)(void*)>(handle, ::dlclose);
 }
 
+bool Plugin::loaded() const noexcept {
+    return so_ != nullptr;
+}
+
+bool Plugin::wantRequest() const noexcept {
+    return request_ != nullptr;
+}
+
+bool Plugin::wantResponse() const noexcept {
+    return response_ != nullptr;
+}
+
 bool Plugin::wantResponseHeaders() const noexcept {
     return want_response_headers_;
 }
@@ -16,6 +16,10 @@ public:
 
     void load(std::string so);
 
+    bool loaded() const noexcept;
+
+    bool wantRequest() const noexcept;
+    bool wantResponse() const noexcept;
     bool wantResponseHeaders() const noexcept;
     bool wantResponseBody() const noexcept;
 
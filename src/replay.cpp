@@ -0,0 +1,261 @@
+#include "replay.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <stdexcept>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace moros {
+
+namespace {
+
+std::string errmsg(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+// 1970-01-01 起的天数, Howard Hinnant 的 days_from_civil
+std::int64_t daysFromCivil(std::int64_t y, unsigned m, unsigned d) noexcept {
+    y -= m <= 2;
+    const std::int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+}
+
+bool digits(const char*& p, const char* end, std::size_t n, int& v) noexcept {
+    if (static_cast<std::size_t>(end - p) < n) {
+        return false;
+    }
+    v = 0;
+    for (std::size_t i = 0; i < n; ++i, ++p) {
+        if (*p < '0' || *p > '9') {
+            return false;
+        }
+        v = v * 10 + (*p - '0');
+    }
+    return true;
+}
+
+bool expect(const char*& p, const char* end, char c) noexcept {
+    if (p == end || *p != c) {
+        return false;
+    }
+    ++p;
+    return true;
+}
+
+// "10/Oct/2000:13:55:36 -0700" 转为 unix us
+bool parseClfTime(const char* p, const char* end, std::int64_t& us) noexcept {
+    static const char* const MONTHS[] = {"Jan", "Feb", "Mar", "Apr", "May", "Jun",
+                                         "Jul", "Aug", "Sep", "Oct", "Nov", "Dec"};
+    int day, year, hh, mm, ss, tz_h, tz_m;
+    if (!digits(p, end, 2, day) || !expect(p, end, '/') || end - p < 4) {
+        return false;
+    }
+    const auto month = std::find_if(std::begin(MONTHS), std::end(MONTHS),
+                                     [&](const char* m) { return std::strncmp(p, m, 3) == 0; });
+    if (month == std::end(MONTHS)) {
+        return false;
+    }
+    p += 3;
+    if (!expect(p, end, '/') || !digits(p, end, 4, year) || !expect(p, end, ':') ||
+        !digits(p, end, 2, hh) || !expect(p, end, ':') || !digits(p, end, 2, mm) ||
+        !expect(p, end, ':') || !digits(p, end, 2, ss) || !expect(p, end, ' ') ||
+        p == end || (*p != '+' && *p != '-')) {
+        return false;
+    }
+    const int sign = *p++ == '-' ? -1 : 1;
+    if (!digits(p, end, 2, tz_h) || !digits(p, end, 2, tz_m) || p != end) {
+        return false;
+    }
+
+    const std::int64_t days =
+        daysFromCivil(year, static_cast<unsigned>(month - std::begin(MONTHS) + 1), day);
+    const std::int64_t secs =
+        days * 86400 + hh * 3600 + mm * 60 + ss - sign * (tz_h * 3600 + tz_m * 60);
+    us = secs * 1000000;
+    return true;
+}
+
+// 从 p 处的引号开始, 返回引号内的内容, p 移到结束引号之后.
+// Apache 以 \" 转义引号, nginx 以 \x22, 均原样保留
+bool quoted(const char*& p, const char* end, std::string& out) {
+    while (p != end && *p == ' ') {
+        ++p;
+    }
+    if (!expect(p, end, '"')) {
+        return false;
+    }
+    const char* begin = p;
+    for (; p != end && *p != '"'; ++p) {
+        if (*p == '\\' && p + 1 != end) {
+            ++p;
+        }
+    }
+    if (p == end) {
+        return false;
+    }
+    out.assign(begin, p++);
+    return true;
+}
+
+// 不能带空白与控制字符, 否则会破坏请求行
+bool token(const std::string& s) noexcept {
+    return !s.empty() && std::none_of(s.begin(), s.end(), [](char c) {
+        return static_cast<unsigned char>(c) <= ' ' || c == 0x7f;
+    });
+}
+
+bool printable(const std::string& s) noexcept {
+    return std::none_of(s.begin(), s.end(), [](char c) {
+        return (static_cast<unsigned char>(c) < ' ' && c != '\t') || c == 0x7f;
+    });
+}
+
+}
+
+AccessLog::AccessLog(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd == -1) {
+        throw std::runtime_error(errmsg("open", path));
+    }
+
+    struct stat st;
+    if (::fstat(fd, &st) == -1) {
+        const std::string msg = errmsg("stat", path);
+        ::close(fd);
+        throw std::runtime_error(msg);
+    }
+    size_ = st.st_size;
+    if (size_ == 0) {
+        ::close(fd);
+        throw std::runtime_error(path + " is empty");
+    }
+
+    void* p = ::mmap(nullptr, size_, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error(errmsg("mmap", path));
+    }
+    // 只顺序读一遍, 让内核积极预读并及早回收读过的页
+    ::madvise(p, size_, MADV_SEQUENTIAL);
+    base_ = static_cast<const char*>(p);
+}
+
+AccessLog::~AccessLog() {
+    ::munmap(const_cast<char*>(base_), size_);
+}
+
+bool AccessLog::next(ReplayEntry& e) {
+    while (pos_ < size_) {
+        const char* line = base_ + pos_;
+        const char* nl = static_cast<const char*>(std::memchr(line, '\n', size_ - pos_));
+        const char* end = nl ? nl : base_ + size_;
+        pos_ = end - base_ + 1;
+
+        if (end != line && end[-1] == '\r') {
+            --end;
+        }
+        if (end == line) {
+            continue;
+        }
+        if (parse(line, end, e)) {
+            return true;
+        }
+        ++skipped_;
+    }
+    return false;
+}
+
+bool AccessLog::parse(const char* p, const char* end, ReplayEntry& e) {
+    std::int64_t us = 0;
+    e.headers.clear();
+
+    const char* tab = std::find(p, end, '\t');
+    if (tab != end) {
+        // 时间 \t METHOD \t URI [\t header]...
+        const std::string ts(p, tab);
+        char* tend = nullptr;
+        const double secs = std::strtod(ts.c_str(), &tend);
+        if (ts.empty() || *tend != '\0' || !(secs >= 0)) {
+            return false;
+        }
+        us = std::llround(secs * 1e6);
+
+        std::vector<std::string> fields;
+        for (const char* f = tab + 1;;) {
+            const char* t = std::find(f, end, '\t');
+            fields.emplace_back(f, t);
+            if (t == end) {
+                break;
+            }
+            f = t + 1;
+        }
+        if (fields.size() < 2) {
+            return false;
+        }
+        e.method = std::move(fields[0]);
+        e.uri = std::move(fields[1]);
+        for (std::size_t i = 2; i < fields.size(); ++i) {
+            if (fields[i].find(':') == std::string::npos || !printable(fields[i])) {
+                return false;
+            }
+            e.headers.push_back(std::move(fields[i]));
+        }
+    } else {
+        // host ident user [time] "request" status bytes ["referer" "user-agent"]
+        const char* lb = std::find(p, end, '[');
+        const char* rb = std::find(lb, end, ']');
+        if (rb == end || !parseClfTime(lb + 1, rb, us)) {
+            return false;
+        }
+
+        p = rb + 1;
+        std::string request;
+        if (!quoted(p, end, request)) {
+            return false;
+        }
+        const std::size_t sp1 = request.find(' ');
+        const std::size_t sp2 = request.find(' ', sp1 + 1);
+        if (sp1 == std::string::npos) {
+            return false;
+        }
+        e.method = request.substr(0, sp1);
+        e.uri = request.substr(sp1 + 1, sp2 == std::string::npos ? sp2 : sp2 - sp1 - 1);
+
+        // combined 格式, 状态码与长度之后是 Referer 与 User-Agent
+        const char* q = std::find(p, end, '"');
+        std::string referer, agent;
+        if (q != end && quoted(q, end, referer) && quoted(q, end, agent)) {
+            if (referer != "-" && printable(referer)) {
+                e.headers.push_back("Referer: " + referer);
+            }
+            if (agent != "-" && printable(agent)) {
+                e.headers.push_back("User-Agent: " + agent);
+            }
+        }
+    }
+
+    if (!token(e.method) || !token(e.uri) ||
+        !std::all_of(e.method.begin(), e.method.end(), [](char c) {
+            return (c >= 'A' && c <= 'Z') || c == '-' || c == '_';
+        })) {
+        return false;
+    }
+
+    if (!started_) {
+        started_ = true;
+        start_ = us;
+    }
+    e.offset = std::chrono::microseconds(std::max<std::int64_t>(us - start_, 0));
+    return true;
+}
+
+}
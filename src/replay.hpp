@@ -0,0 +1,59 @@
+#ifndef MOROS_REPLAY_HPP_
+#define MOROS_REPLAY_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// --replay: 按访问日志中记录的时间间隔重放其中的请求
+
+namespace moros {
+
+struct ReplayEntry {
+    // 距日志第一条的时间
+    std::chrono::microseconds offset;
+    std::string method;
+    std::string uri;
+    // "Name: value" 形式
+    std::vector<std::string> headers;
+};
+
+// mmap 访问日志, 逐行解析, 不整体载入内存. 支持两种格式:
+//   nginx 与 Apache 的 common 及 combined 格式, Referer 与 User-Agent
+//   作为 header 发送;
+//   制表符分隔的 "unix 时间 (秒, 可带小数)\tMETHOD\tURI[\tName: value]...".
+// 时间应大致递增, 早于第一条的记录 offset 为 0
+class AccessLog {
+public:
+    // 无法打开或为空时抛出 std::runtime_error
+    explicit AccessLog(const std::string& path);
+    ~AccessLog();
+
+    AccessLog(const AccessLog&) = delete;
+    AccessLog& operator=(const AccessLog&) = delete;
+
+    // 读取下一条可解析的记录, 到结尾时返回 false. 无法解析的行被跳过
+    bool next(ReplayEntry& e);
+
+    // 已跳过的行数, 空行不计
+    std::size_t skipped() const noexcept {
+        return skipped_;
+    }
+
+private:
+    bool parse(const char* p, const char* end, ReplayEntry& e);
+
+    const char* base_ = nullptr;
+    std::size_t size_ = 0;
+    std::size_t pos_ = 0;
+
+    // 第一条记录的时间, unix us
+    bool started_ = false;
+    std::int64_t start_ = 0;
+    std::size_t skipped_ = 0;
+};
+
+}
+
+#endif
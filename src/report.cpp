@@ -0,0 +1,589 @@
+#include "report.hpp"
+#include "numfmt.hpp"
+#include "escape.hpp"
+#include <thread>
+#include <iomanip>
+#include <algorithm>
+#include <boost/format.hpp>
+#include <boost/io/ios_state.hpp>
+
+namespace moros {
+
+IntervalReport::IntervalReport(std::list<Bencher>& benchers,
+                               std::size_t max_latency, HistogramLog* log)
+    : benchers_(benchers), log_(log), latency_(max_latency),
+      perf_(!benchers.empty() && benchers.front().config().perf_counters) {
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Metrics::Kind::MAX); ++i) {
+        last_[i] = Metrics::getInstance()[static_cast<Metrics::Kind>(i)];
+    }
+    if (perf_) {
+        for (const auto& b : benchers_) {
+            perf_last_.push_back(b.perf().read());
+        }
+    }
+}
+
+void IntervalReport::header(std::ostream& os) const {
+    os << "  Time      Req/Sec   Transfer/Sec   Errors   Non-2xx"
+          "    p50      p90      p99      Max";
+    if (perf_) {
+        os << "   Cyc/Req   Ins/Req   Sys/Req";
+    }
+    os << '\n';
+}
+
+void IntervalReport::report(std::ostream& os, std::chrono::milliseconds elapsed,
+                            std::chrono::milliseconds span) {
+    collect(span);
+    print(os, elapsed, span);
+}
+
+void IntervalReport::collect(std::chrono::milliseconds span) {
+    // 各 bencher 的 interval timer 与 reporter 并非严格对齐,
+    // 最多等待 1/10 个 interval 让落后的 bencher 发布
+    const auto deadline = std::chrono::steady_clock::now() + span / 10;
+    std::vector<bool> done(benchers_.size(), false);
+    for (;;) {
+        std::size_t i = 0, pending = 0;
+        for (auto& b : benchers_) {
+            if (!done[i]) {
+                done[i] = b.collect(latency_);
+                pending += !done[i];
+            }
+            ++i;
+        }
+
+        if (pending == 0 || std::chrono::steady_clock::now() >= deadline) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Metrics::Kind::MAX); ++i) {
+        const std::uint64_t cur = Metrics::getInstance()[static_cast<Metrics::Kind>(i)];
+        delta_[i] += cur - last_[i];
+        last_[i] = cur;
+    }
+
+    if (perf_) {
+        std::size_t i = 0;
+        for (const auto& b : benchers_) {
+            const PerfSample cur = b.perf().read();
+            perf_delta_ += cur - perf_last_[i];
+            perf_last_[i++] = cur;
+        }
+    }
+}
+
+void IntervalReport::merge(const std::uint64_t delta[], const Stats& latency) {
+    for (std::size_t i = 0; i < static_cast<std::size_t>(Metrics::Kind::MAX); ++i) {
+        delta_[i] += delta[i];
+    }
+    latency_.merge(latency);
+}
+
+void IntervalReport::print(std::ostream& os, std::chrono::milliseconds elapsed,
+                           std::chrono::milliseconds span) {
+    const auto get = [&](Metrics::Kind k) {
+        return delta_[static_cast<std::size_t>(k)];
+    };
+    const double secs = span.count() / 1000.0;
+    const std::uint64_t errors =
+        get(Metrics::Kind::ECONNECT) + get(Metrics::Kind::EREAD) +
+        get(Metrics::Kind::EWRITE) + get(Metrics::Kind::ETIMEOUT);
+
+    const auto ms = [](std::uint64_t x) {
+        return numfmt(std::chrono::milliseconds(x));
+    };
+
+    os << "  " << std::left << std::setw(8)
+       << numfmt(std::chrono::duration_cast<std::chrono::seconds>(elapsed))
+       << std::right
+       << std::setw(9) << numfmt(get(Metrics::Kind::COMPLETES) / secs)
+       << std::setw(14) << numfmt(get(Metrics::Kind::BYTES) / secs) + "B"
+       << std::setw(9) << errors
+       << std::setw(10) << get(Metrics::Kind::ESTATUS)
+       << std::setw(7) << ms(latency_.derank(0.50))
+       << std::setw(9) << ms(latency_.derank(0.90))
+       << std::setw(9) << ms(latency_.derank(0.99))
+       << std::setw(9) << ms(latency_.max());
+    if (perf_) {
+        const std::uint64_t completes = get(Metrics::Kind::COMPLETES);
+        for (PerfEvent e : {PerfEvent::CYCLES, PerfEvent::INSTRUCTIONS, PerfEvent::SYSCALLS}) {
+            os << std::setw(10)
+               << (perf_delta_.has(e) && completes
+                       ? numfmt(static_cast<double>(perf_delta_[e]) / completes)
+                       : "-");
+        }
+    }
+    os << std::endl;
+
+    if (log_) {
+        log_->append(elapsed - span, span, latency_);
+    }
+    clear();
+}
+
+void IntervalReport::clear() noexcept {
+    for (auto& d : delta_) {
+        d = 0;
+    }
+    latency_.reset();
+    perf_delta_ = PerfSample();
+}
+
+namespace {
+
+std::uint64_t metric(Metrics::Kind k) {
+    return Metrics::getInstance()[k];
+}
+
+const char* const PHASE_NAMES[] = {"connect", "tls", "ttfb", "transfer",
+                                   "wire", "overhead", "schedule", "accept"};
+static_assert(sizeof(PHASE_NAMES) / sizeof(PHASE_NAMES[0]) ==
+                  static_cast<std::size_t>(Phase::MAX),
+              "");
+
+// 阶段等耗时跨度大, 用紧凑的单一单位以免撑破列宽
+std::string compactUs(double x) {
+    if (x < 1000) {
+        return str(boost::format("%.0fus") % x);
+    } else if (x < 1000000) {
+        return str(boost::format("%.2fms") % (x / 1000));
+    }
+    return str(boost::format("%.2fs") % (x / 1000000));
+}
+
+// 以 timer 延迟的 p99 判断, 此时 event loop 已来不及及时处理就绪的事件
+bool saturated(const Config& cfg, const LoopStats& loop) {
+    const auto max_lag = std::chrono::duration_cast<std::chrono::microseconds>(cfg.max_lag);
+    return loop.lag.count() &&
+           loop.lag.derank(0.99) > static_cast<std::uint64_t>(max_lag.count());
+}
+
+// event loop 处理事件的时间占测试时长的比例
+double utilization(const LoopStats& loop, std::chrono::milliseconds runtime) {
+    return runtime.count() ? loop.busy_total.count() / 1e6 / runtime.count() : 0;
+}
+
+const char* const PERF_LABELS[] = {"Cycles/req", "Instructions/req",
+                                   "Cache-misses/req", "Context-switches/req",
+                                   "Syscalls/req"};
+static_assert(sizeof(PERF_LABELS) / sizeof(PERF_LABELS[0]) ==
+                  static_cast<std::size_t>(PerfEvent::MAX),
+              "");
+
+// 各 bencher 的计数器之和, 未开启 --perf-counters 时返回 false
+bool perfTotal(const Summary& sum, PerfSample& total, std::uint64_t& completes) {
+    bool enabled = false;
+    for (const auto& t : sum.threads) {
+        if (t.perf) {
+            total += *t.perf;
+            completes += t.completes;
+            enabled = true;
+        }
+    }
+    return enabled;
+}
+
+bool anySaturated(const Summary& sum) {
+    return std::any_of(sum.threads.begin(), sum.threads.end(),
+                       [&](const ThreadSummary& t) {
+                           return t.loop && saturated(sum.cfg, *t.loop);
+                       });
+}
+
+std::string percentileName(double p) {
+    return str(boost::format("%g") % p);
+}
+
+void jsonLatency(std::ostream& os, const Config& cfg, const Stats& st,
+                 const char* indent) {
+    const double mean = st.mean();
+
+    os << "{\n"
+       << indent << "  \"mean\": " << mean << ",\n"
+       << indent << "  \"stdev\": " << st.stdev(mean) << ",\n"
+       << indent << "  \"max\": " << st.max() << ",\n"
+       << indent << "  \"percentiles\": {";
+    for (std::size_t i = 0; i < cfg.percentiles.size(); ++i) {
+        os << (i ? ", " : "") << '"' << percentileName(cfg.percentiles[i])
+           << "\": " << st.derank(cfg.percentiles[i] / 100);
+    }
+    os << "},\n"
+       << indent << "  \"histogram\": \"" << encodeHistogram(st) << "\"\n"
+       << indent << "}";
+}
+
+}
+
+void reportText(std::ostream& os, const Summary& sum) {
+    os << "  Thread Stats   Avg      Stdev      Max   +/- Stdev\n";
+    const auto print_stats = [&](std::string name, const Stats& st, auto fn) {
+        const double mean = st.mean();
+        const double stdev = st.stdev(mean);
+        const double max = st.max();
+        const double p = st.inStdevPercent(mean, stdev, 1);
+
+        os << "    " << name
+           << std::setw(9) << numfmt(fn(mean))
+           << std::setw(11) << numfmt(fn(stdev))
+           << std::setw(9) << numfmt(fn(max))
+           << std::setw(12) << p << "%\n";
+    };
+    print_stats("Latency", sum.latency, [](auto x) {
+        return std::chrono::milliseconds(static_cast<std::uint64_t>(x));
+    });
+    print_stats("Req/Sec", sum.requests, [](auto x) { return x; });
+
+    if (sum.cfg.display_latency) {
+        os << "  Latency Distribution\n";
+        for (double p : sum.cfg.percentiles) {
+            const std::chrono::milliseconds ms(sum.latency.derank(p / 100));
+            os << std::setw(7) << p << "%\t" << numfmt(ms) << '\n';
+        }
+
+        // 没有样本的阶段不输出, 例如明文连接的 tls
+        os << "  Phase             Count      Avg      p50      p99      Max\n";
+        const auto us = compactUs;
+        for (std::size_t i = 0; i < sum.phases.size(); ++i) {
+            const Stats& st = sum.phases[i];
+            if (st.count() == 0) {
+                continue;
+            }
+            os << "    " << std::left << std::setw(10) << PHASE_NAMES[i]
+               << std::right << std::setw(11) << st.count()
+               << std::setw(9) << us(st.mean())
+               << std::setw(9) << us(st.derank(0.50))
+               << std::setw(9) << us(st.derank(0.99))
+               << std::setw(9) << us(st.max()) << '\n';
+        }
+
+        // 分布式模式下各 bencher 在 agent 上运行, 没有 event loop 的统计
+        if (!sum.threads.empty() && sum.threads[0].loop) {
+            os << "  Event Loop     Busy   Events   Iter p99    Lag p99    Lag Max   Hook p99\n";
+            std::size_t i = 0;
+            for (const auto& t : sum.threads) {
+                const LoopStats& loop = *t.loop;
+                os << "    " << std::left << std::setw(10)
+                   << "thread-" + std::to_string(i++) << std::right
+                   << std::setw(7)
+                   << str(boost::format("%.0f%%") % (100 * utilization(loop, sum.runtime)))
+                   << std::setw(9) << str(boost::format("%.1f") % loop.events.mean())
+                   << std::setw(11) << us(loop.busy.derank(0.99))
+                   << std::setw(11) << us(loop.lag.derank(0.99))
+                   << std::setw(11) << us(loop.lag.max())
+                   << std::setw(11)
+                   << (t.hooks->count() ? us(t.hooks->derank(0.99)) : "-") << '\n';
+            }
+        }
+    }
+
+    if (sum.endpoints.size() > 1) {
+        os << "  Endpoint                Requests   Errors  Non-2xx      Avg      p50      p99      Max\n";
+        for (const auto& ep : sum.endpoints) {
+            const Metrics& m = *ep.metrics;
+            const Stats& st = *ep.latency;
+            const auto ms = [](double x) {
+                return numfmt(std::chrono::milliseconds(static_cast<std::uint64_t>(x)));
+            };
+
+            os << "    " << std::left << std::setw(20) << ep.name.substr(0, 19)
+               << std::right << std::setw(10) << m[Metrics::Kind::COMPLETES]
+               << std::setw(9)
+               << m[Metrics::Kind::EREAD] + m[Metrics::Kind::EWRITE] +
+                      m[Metrics::Kind::ETIMEOUT]
+               << std::setw(9) << m[Metrics::Kind::ESTATUS]
+               << std::setw(9) << ms(st.mean())
+               << std::setw(9) << ms(st.derank(0.50))
+               << std::setw(9) << ms(st.derank(0.99))
+               << std::setw(9) << ms(st.max()) << '\n';
+        }
+    }
+
+    // total requests and bytes
+    os << "  " << metric(Metrics::Kind::COMPLETES) << " requests in "
+       << numfmt(sum.runtime) << ", " << numfmt(metric(Metrics::Kind::BYTES))
+       << "B read" << std::endl;
+
+    // socket errors
+    if (metric(Metrics::Kind::ECONNECT) || metric(Metrics::Kind::EREAD) ||
+        metric(Metrics::Kind::EWRITE) || metric(Metrics::Kind::ETIMEOUT)) {
+        os << "  Socket errors:"
+           << " connect " << metric(Metrics::Kind::ECONNECT)
+           << ", read " << metric(Metrics::Kind::EREAD)
+           << ", write " << metric(Metrics::Kind::EWRITE)
+           << ", timeout " << metric(Metrics::Kind::ETIMEOUT) << std::endl;
+    }
+
+    // http status code errors
+    if (metric(Metrics::Kind::ESTATUS)) {
+        os << "  Non-2xx or 3xx responses: " << metric(Metrics::Kind::ESTATUS)
+           << std::endl;
+    }
+
+    // request per sec
+    os << "Requests/sec: "
+       << metric(Metrics::Kind::COMPLETES) * 1000.0 / sum.runtime.count() << '\n'
+       << "Transfer/sec: "
+       << numfmt(metric(Metrics::Kind::BYTES) * 1000.0 / sum.runtime.count())
+       << "B" << std::endl;
+
+    // 包括开始时建立的连接
+    if (sum.cfg.requests_per_conn || sum.cfg.conn_churn > 0) {
+        os << "Connects/sec: "
+           << sum.phases[static_cast<std::size_t>(Phase::CONNECT)].count() * 1000.0 /
+                  sum.runtime.count()
+           << std::endl;
+    }
+
+    // 客户端自身每个请求的开销, 打不开的计数器为 n/a
+    PerfSample perf;
+    std::uint64_t completes = 0;
+    if (perfTotal(sum, perf, completes)) {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(PerfEvent::MAX); ++i) {
+            const auto e = static_cast<PerfEvent>(i);
+            os << PERF_LABELS[i] << ": ";
+            if (perf.has(e) && completes) {
+                os << str(boost::format("%.2f") % (static_cast<double>(perf[e]) / completes));
+            } else {
+                os << "n/a";
+            }
+            os << '\n';
+        }
+        os << std::flush;
+    }
+
+    reportSaturation(os, sum);
+}
+
+void reportSaturation(std::ostream& os, const Summary& sum) {
+    std::size_t i = 0;
+    for (const auto& t : sum.threads) {
+        const std::size_t id = i++;
+        if (!t.loop || !saturated(sum.cfg, *t.loop)) {
+            continue;
+        }
+        os << "Warning: client saturated, thread-" << id << " event loop lag p99 "
+           << compactUs(t.loop->lag.derank(0.99)) << " > " << numfmt(sum.cfg.max_lag)
+           << ", busy "
+           << str(boost::format("%.0f%%") % (100 * utilization(*t.loop, sum.runtime)))
+           << '\n';
+    }
+
+    if (anySaturated(sum)) {
+        os << "  Latency includes time spent queued inside moros, "
+              "add threads or lower connections" << std::endl;
+    }
+}
+
+void reportCalibration(std::ostream& os, const Summary& sum) {
+    boost::io::ios_all_saver guard(os);
+
+    // 内置服务几乎不做事, 首字节时间即请求在 moros 与内核中往返的开销
+    const Stats& ttfb = sum.phases[static_cast<std::size_t>(Phase::TTFB)];
+    os << "Calibration against the built-in server:\n"
+       << "  Max Req/Sec:   " << std::fixed << std::setprecision(2)
+       << metric(Metrics::Kind::COMPLETES) * 1000.0 / sum.runtime.count() << '\n'
+       << "  Latency floor: min " << compactUs(ttfb.derank(0))
+       << ", p50 " << compactUs(ttfb.derank(0.50))
+       << ", p99 " << compactUs(ttfb.derank(0.99)) << " (time to first byte)"
+       << std::endl;
+}
+
+void reportJson(std::ostream& os, const Summary& sum) {
+    boost::io::ios_all_saver guard(os);
+    os << std::fixed << std::setprecision(3);
+
+    const double secs = sum.runtime.count() / 1000.0;
+    const double rmean = sum.requests.mean();
+
+    os << "{\n"
+       << "  \"url\": " << jsonString(sum.cfg.url) << ",\n"
+       << "  \"threads\": " << sum.cfg.threads << ",\n"
+       << "  \"connections\": " << sum.cfg.connections << ",\n"
+       << "  \"seed\": " << sum.cfg.seed << ",\n"
+       << "  \"runtime_ms\": " << sum.runtime.count() << ",\n"
+       << "  \"requests\": " << metric(Metrics::Kind::COMPLETES) << ",\n"
+       << "  \"bytes\": " << metric(Metrics::Kind::BYTES) << ",\n"
+       << "  \"requests_per_sec\": " << metric(Metrics::Kind::COMPLETES) / secs << ",\n"
+       << "  \"bytes_per_sec\": " << metric(Metrics::Kind::BYTES) / secs << ",\n"
+       << "  \"errors\": {"
+       << "\"connect\": " << metric(Metrics::Kind::ECONNECT)
+       << ", \"read\": " << metric(Metrics::Kind::EREAD)
+       << ", \"write\": " << metric(Metrics::Kind::EWRITE)
+       << ", \"timeout\": " << metric(Metrics::Kind::ETIMEOUT)
+       << ", \"status\": " << metric(Metrics::Kind::ESTATUS) << "},\n"
+       << "  \"client_saturated\": " << (anySaturated(sum) ? "true" : "false") << ",\n";
+
+    // 各计数器除以 n, 不可用的计数器或 n 为 0 时为 null
+    const auto perf_json = [&](const PerfSample& s, std::uint64_t n) {
+        for (std::size_t i = 0; i < static_cast<std::size_t>(PerfEvent::MAX); ++i) {
+            const auto e = static_cast<PerfEvent>(i);
+            os << (i ? ", " : "") << '"' << perfEventName(e) << "\": ";
+            if (s.has(e) && n) {
+                os << static_cast<double>(s[e]) / n;
+            } else {
+                os << "null";
+            }
+        }
+    };
+
+    PerfSample perf;
+    std::uint64_t completes = 0;
+    if (perfTotal(sum, perf, completes)) {
+        os << "  \"perf_per_request\": {";
+        perf_json(perf, completes);
+        os << "},\n";
+    }
+
+    os
+       << "  \"thread_requests_per_sec\": {"
+       << "\"mean\": " << rmean
+       << ", \"stdev\": " << sum.requests.stdev(rmean)
+       << ", \"max\": " << sum.requests.max() << "},\n"
+       << "  \"latency\": ";
+    jsonLatency(os, sum.cfg, sum.latency, "  ");
+    os << ",\n"
+       << "  \"per_thread\": [";
+
+    std::size_t i = 0;
+    for (const auto& t : sum.threads) {
+        os << (i++ ? "," : "") << "\n"
+           << "    {\n"
+           << "      \"requests\": " << t.completes << ",\n"
+           << "      \"requests_per_sec\": " << t.completes / secs << ",\n"
+           << "      \"latency\": ";
+        jsonLatency(os, sum.cfg, *t.latency, "      ");
+        if (t.loop) {
+            const LoopStats& loop = *t.loop;
+            os << ",\n"
+               << "      \"loop\": {\n"
+               << "        \"saturated\": " << (saturated(sum.cfg, loop) ? "true" : "false") << ",\n"
+               << "        \"utilization\": " << utilization(loop, sum.runtime) << ",\n"
+               << "        \"events_per_wait\": " << loop.events.mean() << ",\n"
+               << "        \"iteration_us\": ";
+            jsonLatency(os, sum.cfg, loop.busy, "        ");
+            os << ",\n"
+               << "        \"lag_us\": ";
+            jsonLatency(os, sum.cfg, loop.lag, "        ");
+            os << ",\n"
+               << "        \"hook_us\": ";
+            jsonLatency(os, sum.cfg, *t.hooks, "        ");
+            os << "\n      }";
+        }
+        if (t.perf) {
+            os << ",\n"
+               << "      \"perf\": {";
+            perf_json(*t.perf, 1);
+            os << "}";
+        }
+        os << "\n    }";
+    }
+    os << "\n  ],\n"
+       << "  \"phases_us\": {";
+
+    for (std::size_t p = 0; p < sum.phases.size(); ++p) {
+        os << (p ? "," : "") << "\n"
+           << "    \"" << PHASE_NAMES[p] << "\": {\n"
+           << "      \"count\": " << sum.phases[p].count() << ",\n"
+           << "      \"latency\": ";
+        jsonLatency(os, sum.cfg, sum.phases[p], "      ");
+        os << "\n    }";
+    }
+    os << "\n  },\n"
+       << "  \"endpoints\": [";
+
+    i = 0;
+    for (const auto& ep : sum.endpoints) {
+        const Metrics& m = *ep.metrics;
+        os << (i++ ? "," : "") << "\n"
+           << "    {\n"
+           << "      \"name\": " << jsonString(ep.name) << ",\n"
+           << "      \"weight\": " << ep.weight << ",\n"
+           << "      \"requests\": " << m[Metrics::Kind::COMPLETES] << ",\n"
+           << "      \"errors\": {"
+           << "\"read\": " << m[Metrics::Kind::EREAD]
+           << ", \"write\": " << m[Metrics::Kind::EWRITE]
+           << ", \"timeout\": " << m[Metrics::Kind::ETIMEOUT]
+           << ", \"status\": " << m[Metrics::Kind::ESTATUS] << "},\n"
+           << "      \"latency\": ";
+        jsonLatency(os, sum.cfg, *ep.latency, "      ");
+        os << "\n    }";
+    }
+    os << "\n  ]\n"
+       << "}" << std::endl;
+}
+
+void reportCsv(std::ostream& os, const Summary& sum) {
+    boost::io::ios_all_saver guard(os);
+    os << std::fixed << std::setprecision(3);
+
+    const double secs = sum.runtime.count() / 1000.0;
+
+    os << "scope,runtime_ms,requests,bytes,requests_per_sec,bytes_per_sec,"
+          "connect_errors,read_errors,write_errors,timeouts,non2xx,"
+          "latency_mean,latency_stdev,latency_max";
+    for (double p : sum.cfg.percentiles) {
+        os << ",p" << percentileName(p);
+    }
+    os << '\n';
+
+    const auto latency = [&](const Stats& st) {
+        const double mean = st.mean();
+        os << ',' << mean << ',' << st.stdev(mean) << ',' << st.max();
+        for (double p : sum.cfg.percentiles) {
+            os << ',' << st.derank(p / 100);
+        }
+        os << '\n';
+    };
+
+    os << "total," << sum.runtime.count() << ','
+       << metric(Metrics::Kind::COMPLETES) << ',' << metric(Metrics::Kind::BYTES) << ','
+       << metric(Metrics::Kind::COMPLETES) / secs << ','
+       << metric(Metrics::Kind::BYTES) / secs << ','
+       << metric(Metrics::Kind::ECONNECT) << ',' << metric(Metrics::Kind::EREAD) << ','
+       << metric(Metrics::Kind::EWRITE) << ',' << metric(Metrics::Kind::ETIMEOUT) << ','
+       << metric(Metrics::Kind::ESTATUS);
+    latency(sum.latency);
+
+    // 错误与字节数只有全局计数
+    std::size_t i = 0;
+    for (const auto& t : sum.threads) {
+        os << "thread-" << i++ << ',' << sum.runtime.count() << ','
+           << t.completes << ",," << t.completes / secs << ",,,,,,";
+        latency(*t.latency);
+    }
+
+    // endpoint 没有连接错误与字节数
+    for (const auto& ep : sum.endpoints) {
+        const Metrics& m = *ep.metrics;
+
+        os << csvField("endpoint:" + ep.name) << ',' << sum.runtime.count() << ','
+           << m[Metrics::Kind::COMPLETES] << ",," << m[Metrics::Kind::COMPLETES] / secs
+           << ",,," << m[Metrics::Kind::EREAD] << ',' << m[Metrics::Kind::EWRITE] << ','
+           << m[Metrics::Kind::ETIMEOUT] << ',' << m[Metrics::Kind::ESTATUS];
+        latency(*ep.latency);
+    }
+
+    // 阶段只有样本数与耗时, 单位 us
+    for (std::size_t p = 0; p < sum.phases.size(); ++p) {
+        os << "phase:" << PHASE_NAMES[p] << ',' << sum.runtime.count() << ','
+           << sum.phases[p].count() << ",,,,,,,,";
+        latency(sum.phases[p]);
+    }
+
+    // 各 bencher 的 event loop 的 timer 延迟, 单位 us
+    i = 0;
+    for (const auto& t : sum.threads) {
+        const std::size_t id = i++;
+        if (t.loop) {
+            os << "lag:thread-" << id << ',' << sum.runtime.count() << ','
+               << t.loop->lag.count() << ",,,,,,,,";
+            latency(t.loop->lag);
+        }
+    }
+    os << std::flush;
+}
+
+}
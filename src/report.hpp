@@ -0,0 +1,104 @@
+#ifndef MOROS_REPORT_HPP_
+#define MOROS_REPORT_HPP_
+
+#include "perf.hpp"
+#include "stats.hpp"
+#include "config.hpp"
+#include "bencher.hpp"
+#include "histlog.hpp"
+#include "scenario.hpp"
+#include <list>
+#include <chrono>
+#include <ostream>
+
+namespace moros {
+
+// 每个 interval 输出一行: 吞吐, 错误数与该 interval 的 latency 分位数,
+// 开启 --perf-counters 时还有每个请求的 cycles, instructions 与 syscalls
+class IntervalReport {
+public:
+    // log 非空时同时把每个 interval 的直方图写入 HdrHistogram log
+    IntervalReport(std::list<Bencher>& benchers, std::size_t max_latency,
+                   HistogramLog* log = nullptr);
+
+    void header(std::ostream& os) const;
+
+    // elapsed 为测试开始至今的时间, span 为本 interval 的长度,
+    // 等价于 collect 之后 print
+    void report(std::ostream& os, std::chrono::milliseconds elapsed,
+                std::chrono::milliseconds span);
+
+    // 收集各 bencher 本 interval 的计数增量与直方图
+    void collect(std::chrono::milliseconds span);
+
+    // 分布式模式下并入一个 agent 的 interval
+    void merge(const std::uint64_t delta[], const Stats& latency);
+
+    // 输出已收集的 interval 后清空
+    void print(std::ostream& os, std::chrono::milliseconds elapsed,
+               std::chrono::milliseconds span);
+
+    void clear() noexcept;
+
+    const std::uint64_t* delta() const noexcept {
+        return delta_;
+    }
+
+    const Stats& latency() const noexcept {
+        return latency_;
+    }
+
+private:
+    std::list<Bencher>& benchers_;
+    HistogramLog* log_;
+
+    Stats latency_;
+    std::uint64_t last_[static_cast<std::size_t>(Metrics::Kind::MAX)] = {};
+    std::uint64_t delta_[static_cast<std::size_t>(Metrics::Kind::MAX)] = {};
+
+    // 分布式模式下 coordinator 没有 bencher, 也就没有计数器
+    bool perf_;
+    std::vector<PerfSample> perf_last_;
+    PerfSample perf_delta_;
+};
+
+// 单个 bencher 的结果, 分布式模式下来自各个 agent, 此时没有 loop, hooks
+// 与 perf. perf 为测试期间的增量, 未开启 --perf-counters 时为空
+struct ThreadSummary {
+    std::uint64_t completes;
+    const Stats* latency;
+    const LoopStats* loop;
+    const Stats* hooks;
+    const PerfSample* perf;
+};
+
+// 测试结束后的汇总结果, 各种输出格式共用
+struct Summary {
+    const Config& cfg;
+    std::chrono::milliseconds runtime;
+    const Stats& latency;
+    const Stats& requests;
+    std::vector<ThreadSummary> threads;
+    const std::vector<Endpoint>& endpoints;
+    // 以 Phase 为下标, 单位 us
+    const std::vector<Stats>& phases;
+};
+
+void reportText(std::ostream& os, const Summary& sum);
+
+// 以下两种格式面向机器读取, latency 单位均为 ms, 各阶段耗时单位为 us
+void reportJson(std::ostream& os, const Summary& sum);
+
+// 首行为表头, 其后一行汇总, 每个 bencher 与 endpoint 各一行
+void reportCsv(std::ostream& os, const Summary& sum);
+
+// event loop 滞后超过 cfg.max_lag 的 bencher 各输出一行警告, 都未超过时
+// 不输出. reportText 已包含, 其它格式另行输出到 stderr
+void reportSaturation(std::ostream& os, const Summary& sum);
+
+// --calibrate: 对内置服务测得的吞吐上限与最低延迟, 即 moros 在本机的上限
+void reportCalibration(std::ostream& os, const Summary& sum);
+
+}
+
+#endif
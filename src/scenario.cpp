@@ -0,0 +1,211 @@
+#include "scenario.hpp"
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <strings.h>
+
+namespace moros {
+
+namespace {
+
+bool hasHeader(const std::string& head, const char* name) {
+    const std::size_t len = std::strlen(name);
+    for (std::size_t eol = head.find("\r\n"); eol != std::string::npos;
+         eol = head.find("\r\n", eol + 2)) {
+        if (::strncasecmp(head.c_str() + eol + 2, name, len) == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+std::string trim(const std::string& s) {
+    const std::size_t b = s.find_first_not_of(" \t\r");
+    if (b == std::string::npos) {
+        return "";
+    }
+    return s.substr(b, s.find_last_not_of(" \t\r") - b + 1);
+}
+
+}
+
+Endpoint::Endpoint(std::string name, std::uint32_t weight,
+                   const std::string& head, const std::string& body,
+                   std::size_t max_latency)
+    : name(std::move(name)),
+      weight(weight),
+      latency(std::make_unique<Stats>(max_latency)),
+      metrics(std::make_unique<Metrics>()),
+      head_(head),
+      body_(body),
+      length_(!body.empty() && !hasHeader(head, "Content-Length:")),
+      dynamic_(head_.dynamic() || body_.dynamic()) {
+    if (!dynamic_) {
+        std::string scratch;
+        TemplateState st(0, 0, 0);
+        render(req, scratch, st);
+    }
+}
+
+bool Endpoint::dynamic() const noexcept {
+    return dynamic_;
+}
+
+void Endpoint::render(std::string& out, std::string& scratch,
+                      TemplateState& st) const {
+    out.clear();
+    head_.render(out, st);
+
+    if (length_) {
+        scratch.clear();
+        body_.render(scratch, st);
+
+        out.append("Content-Length: ");
+        appendNumber(out, scratch.size());
+        out.append("\r\n\r\n");
+        out.append(scratch);
+    } else {
+        out.append("\r\n");
+        body_.render(out, st);
+    }
+
+    st.seq += st.stride;
+}
+
+std::string buildHead(const std::string& method, const std::string& uri,
+                      const std::string& host,
+                      const std::vector<std::string>& headers) {
+    const bool has_host = std::any_of(
+        headers.begin(), headers.end(), [](const std::string& s) {
+            return ::strncasecmp(s.c_str(), "Host:", 5) == 0;
+        });
+
+    std::string head = method + " " + uri + " HTTP/1.1\r\n";
+    if (!has_host) {
+        head += "Host: " + host + "\r\n";
+    }
+    for (const auto& header : headers) {
+        head.append(header);
+        head.append("\r\n");
+    }
+
+    return head;
+}
+
+std::vector<Endpoint> loadScenario(const std::string& path,
+                                   const std::string& host,
+                                   const std::vector<std::string>& headers,
+                                   std::size_t max_latency) {
+    std::ifstream is(path);
+    if (!is) {
+        throw std::runtime_error("open " + path + " failed");
+    }
+
+    struct Section {
+        std::string name;
+        std::uint32_t weight = 1;
+        std::string method, uri, body;
+        std::vector<std::string> headers;
+    };
+    std::vector<Section> sections;
+
+    std::size_t lineno = 0;
+    const auto fail = [&](const std::string& what) {
+        throw std::runtime_error(path + ":" + std::to_string(lineno) + ": " + what);
+    };
+
+    for (std::string line; std::getline(is, line);) {
+        ++lineno;
+        line = trim(line);
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        if (line.front() == '[') {
+            if (line.back() != ']' || line.size() < 3) {
+                fail("invalid section");
+            }
+            sections.emplace_back();
+            sections.back().name = line.substr(1, line.size() - 2);
+            sections.back().headers = headers;
+            continue;
+        }
+
+        const std::size_t eq = line.find('=');
+        if (eq == std::string::npos) {
+            fail("expect key = value");
+        }
+        if (sections.empty()) {
+            fail("key outside of section");
+        }
+
+        const std::string key = trim(line.substr(0, eq)),
+                          value = trim(line.substr(eq + 1));
+        Section& s = sections.back();
+        if (key == "weight") {
+            char* end = nullptr;
+            const unsigned long w = std::strtoul(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || w > UINT32_MAX) {
+                fail("invalid weight " + value);
+            }
+            s.weight = w;
+        } else if (key == "request") {
+            const std::size_t sp = value.find(' ');
+            if (sp == std::string::npos) {
+                fail("expect METHOD URI");
+            }
+            s.method = value.substr(0, sp);
+            s.uri = trim(value.substr(sp + 1));
+        } else if (key == "header") {
+            s.headers.push_back(value);
+        } else if (key == "body") {
+            s.body = value;
+        } else {
+            fail("unknown key " + key);
+        }
+    }
+
+    std::vector<Endpoint> endpoints;
+    std::uint64_t total = 0;
+    for (const auto& s : sections) {
+        if (s.method.empty()) {
+            throw std::runtime_error(path + ": [" + s.name + "] has no request");
+        }
+        total += s.weight;
+        try {
+            endpoints.emplace_back(s.name, s.weight,
+                                   buildHead(s.method, s.uri, host, s.headers),
+                                   s.body, max_latency);
+        } catch (const std::runtime_error& e) {
+            throw std::runtime_error(path + ": [" + s.name + "] " + e.what());
+        }
+    }
+    if (total == 0) {
+        throw std::runtime_error(path + ": no endpoint with positive weight");
+    }
+
+    return endpoints;
+}
+
+Picker::Picker(const std::vector<Endpoint>& endpoints, std::uint64_t seed) noexcept
+    : rng_(seed) {
+    std::uint64_t total = 0;
+    for (const auto& ep : endpoints) {
+        total += ep.weight;
+        cumulative_.push_back(total);
+    }
+}
+
+std::size_t Picker::pick() noexcept {
+    if (cumulative_.size() <= 1) {
+        return 0;
+    }
+
+    const std::uint64_t r = rng_.next() % cumulative_.back();
+
+    return std::upper_bound(cumulative_.begin(), cumulative_.end(), r) -
+           cumulative_.begin();
+}
+
+}
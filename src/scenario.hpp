@@ -0,0 +1,73 @@
+#ifndef MOROS_SCENARIO_HPP_
+#define MOROS_SCENARIO_HPP_
+
+#include "stats.hpp"
+#include "template.hpp"
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace moros {
+
+// 一类按权重发送的请求, 统计由各 bencher 线程并发更新
+struct Endpoint {
+    // head 为请求行与 header (各以 CRLF 结尾), 二者都可以包含模板占位符;
+    // body 非空且 head 中没有 Content-Length 时自动补上
+    Endpoint(std::string name, std::uint32_t weight, const std::string& head,
+             const std::string& body, std::size_t max_latency);
+
+    // 不含占位符时可直接发送 req
+    bool dynamic() const noexcept;
+
+    // 渲染一个请求到 out, scratch 暂存 body; 容量足够后不再分配内存
+    void render(std::string& out, std::string& scratch, TemplateState& st) const;
+
+    std::string name;
+    std::uint32_t weight;
+    std::string req;
+
+    std::unique_ptr<Stats> latency;
+    std::unique_ptr<Metrics> metrics;
+
+private:
+    Template head_;
+    Template body_;
+    bool length_;
+    bool dynamic_;
+};
+
+// 请求行与 header, headers 中没有 Host 时补上
+std::string buildHead(const std::string& method, const std::string& uri,
+                      const std::string& host,
+                      const std::vector<std::string>& headers);
+
+// 解析 scenario 文件, 格式错误时抛出 std::runtime_error
+//
+//   [name]
+//   weight = 70
+//   request = GET /path
+//   header = Accept: */*        (可重复)
+//   body = ...
+//
+// 全局的 -H header 附加在每个 endpoint 的 header 之前
+std::vector<Endpoint> loadScenario(const std::string& path,
+                                   const std::string& host,
+                                   const std::vector<std::string>& headers,
+                                   std::size_t max_latency);
+
+// 每个 bencher 一个, 按权重挑选 endpoint 的下标
+class Picker {
+public:
+    Picker(const std::vector<Endpoint>& endpoints, std::uint64_t seed) noexcept;
+
+    std::size_t pick() noexcept;
+
+private:
+    std::vector<std::uint64_t> cumulative_;
+    Xorshift rng_;
+};
+
+}
+
+#endif
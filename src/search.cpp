@@ -0,0 +1,207 @@
+#include "search.hpp"
+#include "numfmt.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <sstream>
+#include <stdexcept>
+#include <boost/format.hpp>
+
+namespace moros {
+
+namespace {
+
+// "50ms", "1.5s" 转为 ms
+double parseDuration(const std::string& s) {
+    char* end = nullptr;
+    const double v = std::strtod(s.c_str(), &end);
+    const std::string unit = end;
+    if (end == s.c_str() || v < 0) {
+        throw std::invalid_argument("Invalid duration in SLO: " + s);
+    }
+    if (unit == "ms") {
+        return v;
+    } else if (unit == "s") {
+        return v * 1000;
+    }
+    throw std::invalid_argument("Invalid duration in SLO: " + s);
+}
+
+// latency 以 ms 为单位记录, 只有平均值带小数
+std::string ms(double x) {
+    return str(boost::format(x == std::floor(x) ? "%.0fms" : "%.2fms") % x);
+}
+
+std::string percent(double x) {
+    return str(boost::format("%.2f%%") % (x * 100));
+}
+
+}
+
+StepResult measure(std::size_t connections, std::chrono::milliseconds runtime,
+                   const std::uint64_t counters[], const Stats& latency) {
+    const auto get = [&](Metrics::Kind k) {
+        return counters[static_cast<std::size_t>(k)];
+    };
+    const std::uint64_t failed = get(Metrics::Kind::ECONNECT) + get(Metrics::Kind::EREAD) +
+                                 get(Metrics::Kind::EWRITE) + get(Metrics::Kind::ETIMEOUT);
+    const std::uint64_t total = get(Metrics::Kind::COMPLETES) + failed;
+
+    StepResult r = {};
+    r.connections = connections;
+    r.rps = runtime.count() ? 1000.0 * get(Metrics::Kind::COMPLETES) / runtime.count() : 0;
+    r.mean = latency.count() ? latency.mean() : 0;
+    r.p50 = latency.derank(0.50);
+    r.p99 = latency.derank(0.99);
+    // 什么都没有完成也不能算通过
+    r.errors = total ? static_cast<double>(failed + get(Metrics::Kind::ESTATUS)) / total : 1;
+    return r;
+}
+
+Slo::Slo(const std::string& spec) : spec_(spec) {
+    std::istringstream is(spec);
+    for (std::string term; std::getline(is, term, ',');) {
+        const std::size_t lt = term.find('<');
+        if (lt == std::string::npos) {
+            throw std::invalid_argument("Invalid SLO term: " + term);
+        }
+        const std::string lhs = term.substr(0, lt), rhs = term.substr(lt + 1);
+
+        if (lhs == "errors") {
+            char* end = nullptr;
+            const double v = std::strtod(rhs.c_str(), &end);
+            if (end == rhs.c_str() || std::string(end) != "%" || v < 0 || v > 100) {
+                throw std::invalid_argument("Invalid error rate in SLO: " + rhs);
+            }
+            errors_ = v / 100;
+        } else if (lhs.size() > 1 && lhs[0] == 'p') {
+            char* end = nullptr;
+            const double p = std::strtod(lhs.c_str() + 1, &end);
+            if (*end != '\0' || p <= 0 || p > 100) {
+                throw std::invalid_argument("Invalid percentile in SLO: " + lhs);
+            }
+            percentiles_.push_back({p, parseDuration(rhs)});
+        } else {
+            throw std::invalid_argument("Invalid SLO term: " + term);
+        }
+    }
+
+    if (percentiles_.empty() && errors_ >= 1) {
+        throw std::invalid_argument("Empty SLO: " + spec);
+    }
+}
+
+void Slo::check(StepResult& r, const Stats& latency) const {
+    r.pass = true;
+    r.violation.clear();
+
+    if (r.errors >= errors_ || r.rps == 0) {
+        r.pass = false;
+        r.violation = "errors " + percent(r.errors);
+        return;
+    }
+    for (const auto& p : percentiles_) {
+        const double v = latency.derank(p.p / 100);
+        if (v >= p.ms) {
+            r.pass = false;
+            r.violation = str(boost::format("p%g %s") % p.p % ms(v));
+            return;
+        }
+    }
+}
+
+LoadSearch::LoadSearch(const Slo& slo, std::size_t start, std::size_t max)
+    : slo_(slo), start_(std::max<std::size_t>(start, 1)),
+      max_(std::max(max, std::max<std::size_t>(start, 1))) {}
+
+bool LoadSearch::next(std::size_t& connections) const {
+    if (steps_.empty()) {
+        connections = start_;
+        return true;
+    }
+
+    // 倍增阶段
+    if (!fail_) {
+        if (pass_ >= max_) {
+            return false;
+        }
+        connections = std::min(pass_ * 2, max_);
+        return true;
+    }
+
+    // 二分阶段, 区间在 5% 以内即停止
+    if (fail_ - pass_ <= std::max<std::size_t>(1, pass_ / 20)) {
+        return false;
+    }
+    connections = pass_ + (fail_ - pass_) / 2;
+    return true;
+}
+
+void LoadSearch::record(StepResult r, const Stats& latency) {
+    slo_.check(r, latency);
+    if (r.pass) {
+        pass_ = std::max(pass_, r.connections);
+    } else {
+        fail_ = fail_ ? std::min(fail_, r.connections) : r.connections;
+    }
+    steps_.push_back(std::move(r));
+}
+
+const StepResult* LoadSearch::best() const noexcept {
+    const StepResult* best = nullptr;
+    for (const auto& r : steps_) {
+        if (r.pass && (!best || r.connections > best->connections)) {
+            best = &r;
+        }
+    }
+    return best;
+}
+
+const StepResult* LoadSearch::knee() const noexcept {
+    const StepResult* knee = nullptr;
+    const auto power = [](const StepResult& r) {
+        return r.rps / std::max(r.mean, 1.0);
+    };
+    for (const auto& r : steps_) {
+        if (r.pass && (!knee || power(r) > power(*knee))) {
+            knee = &r;
+        }
+    }
+    return knee;
+}
+
+void LoadSearch::header(std::ostream& os) const {
+    os << "Searching -c from " << start_ << " up to " << max_ << " for " << slo_.spec()
+       << '\n'
+       << "  Conns     Req/Sec      Mean       p50       p99    Errors   SLO" << '\n';
+}
+
+void LoadSearch::print(std::ostream& os, const StepResult& r) const {
+    os << "  " << std::left << std::setw(7) << r.connections << std::right
+       << std::setw(10) << numfmt(r.rps)
+       << std::setw(10) << ms(r.mean)
+       << std::setw(10) << ms(r.p50)
+       << std::setw(10) << ms(r.p99)
+       << std::setw(10) << percent(r.errors)
+       << "   " << (r.pass ? "ok" : "fail (" + r.violation + ")") << std::endl;
+}
+
+void LoadSearch::summary(std::ostream& os) const {
+    const StepResult* b = best();
+    if (!b) {
+        os << "No step met the SLO" << '\n';
+        return;
+    }
+    os << "Max sustainable: -c " << b->connections << ", " << numfmt(b->rps)
+       << " Req/Sec, p99 " << ms(b->p99) << '\n';
+
+    const StepResult* k = knee();
+    os << "Knee: -c " << k->connections << ", " << numfmt(k->rps) << " Req/Sec, mean "
+       << ms(k->mean) << '\n';
+    if (b->connections >= max_) {
+        os << "The SLO still held at --search-max, the capacity may be higher" << '\n';
+    }
+}
+
+}
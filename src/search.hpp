@@ -0,0 +1,96 @@
+#ifndef MOROS_SEARCH_HPP_
+#define MOROS_SEARCH_HPP_
+
+#include "stats.hpp"
+#include <chrono>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// --search: 以不同的 -c 依次运行若干步, 每步结束后检查 SLO, 先倍增再二分,
+// 找出满足 SLO 的最大并发, 同时给出 latency 曲线的拐点
+
+namespace moros {
+
+// 一步的结果, latency 均为 ms
+struct StepResult {
+    std::size_t connections;
+    double rps;
+    double mean, p50, p99;
+    // 出错或非 2xx 的请求占全部请求的比例
+    double errors;
+
+    bool pass;
+    // 未满足的第一个条件, 例如 "p99 62ms"
+    std::string violation;
+};
+
+// counters 为整步的 Metrics 计数, latency 为整步的直方图
+StepResult measure(std::size_t connections, std::chrono::milliseconds runtime,
+                   const std::uint64_t counters[], const Stats& latency);
+
+// 形如 "p99<50ms,p50<10ms,errors<0.1%", 各条件同时满足才算通过.
+// 时长可以用 ms 或 s
+class Slo {
+public:
+    // 格式错误抛出 std::invalid_argument
+    explicit Slo(const std::string& spec);
+
+    // latency 为该步的直方图, 填写 r.pass 与 r.violation
+    void check(StepResult& r, const Stats& latency) const;
+
+    const std::string& spec() const noexcept {
+        return spec_;
+    }
+
+private:
+    struct Percentile {
+        double p;  // (0, 100]
+        double ms; // 上限
+    };
+
+    std::string spec_;
+    std::vector<Percentile> percentiles_;
+    double errors_ = 1; // 上限, 比例
+};
+
+class LoadSearch {
+public:
+    // 从 start 开始倍增直到违反 SLO 或到达 max, 之后在最后一次通过与
+    // 第一次违反之间二分, 区间缩小到 5% 以内为止
+    LoadSearch(const Slo& slo, std::size_t start, std::size_t max);
+
+    // 下一步的连接数, 已收敛时返回 false
+    bool next(std::size_t& connections) const;
+
+    // 检查 r 并记录
+    void record(StepResult r, const Stats& latency);
+
+    const std::vector<StepResult>& steps() const noexcept {
+        return steps_;
+    }
+
+    // 满足 SLO 的连接数最大的一步, 没有时为 nullptr
+    const StepResult* best() const noexcept;
+
+    // 拐点: 满足 SLO 的各步中 Req/Sec 与平均 latency 之比 (Kleinrock
+    // 的 power) 最大的, 再增加并发主要只是增加排队. latency 以 ms 记录,
+    // 平均值不足 1ms 时按 1ms 计
+    const StepResult* knee() const noexcept;
+
+    void header(std::ostream& os) const;
+    void print(std::ostream& os, const StepResult& r) const;
+    void summary(std::ostream& os) const;
+
+private:
+    const Slo& slo_;
+    const std::size_t start_, max_;
+
+    // 通过的最大连接数与违反的最小连接数, 0 表示还没有
+    std::size_t pass_ = 0, fail_ = 0;
+    std::vector<StepResult> steps_;
+};
+
+}
+
+#endif
@@ -0,0 +1,481 @@
+#include "server.hpp"
+#include "ev.hpp"
+#include "http_parser.h"
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstring>
+#include <cstdlib>
+#include <deque>
+#include <functional>
+#include <queue>
+#include <atomic>
+#include <stdexcept>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
+
+namespace moros {
+
+class Server::Worker {
+public:
+    // lfd 不为 -1 时使用这个已在监听的 fd
+    Worker(const ServerConfig& cfg, std::uint16_t port, int lfd = -1);
+    ~Worker();
+
+    std::uint16_t port() const noexcept {
+        return port_;
+    }
+
+    int listener() const noexcept {
+        return lfd_;
+    }
+
+    void run() noexcept {
+        ev_loop_.run();
+    }
+
+    void stop() noexcept {
+        ev_loop_.stop();
+    }
+
+    std::uint64_t served() const noexcept {
+        return served_.load(std::memory_order_relaxed);
+    }
+
+private:
+    class Conn;
+
+    using Clock = std::chrono::steady_clock;
+
+    void accept() noexcept;
+
+    // 延迟的响应到期时再写出
+    void schedule(Clock::time_point due, std::weak_ptr<Conn> c);
+    void expire() noexcept;
+    void arm() noexcept;
+
+    const bool unix_;
+    const std::size_t keep_alive_;
+    const DelayDistribution delay_;
+    std::mt19937_64 rng_;
+
+    // 保持连接与关闭连接两种响应, 启动时构造一次
+    std::string response_, closing_;
+
+    EventLoop ev_loop_;
+    int lfd_ = -1, tfd_ = -1;
+    std::uint16_t port_;
+
+    struct Timed {
+        Clock::time_point due;
+        std::weak_ptr<Conn> conn;
+
+        bool operator>(const Timed& rhs) const noexcept {
+            return due > rhs.due;
+        }
+    };
+    std::priority_queue<Timed, std::vector<Timed>, std::greater<Timed>> timers_;
+
+    std::atomic_uint64_t served_{0};
+
+    static http_parser_settings settings_;
+};
+
+// 一个客户端连接. 响应按请求顺序写出, 前一个响应未到期时后面的也等待
+class Server::Worker::Conn : public std::enable_shared_from_this<Conn> {
+public:
+    Conn(Worker& w, int fd) noexcept : w_(w), fd_(fd) {
+        http_parser_init(&parser_, HTTP_REQUEST);
+        parser_.data = this;
+    }
+
+    ~Conn() {
+        if (fd_ != -1) {
+            ::close(fd_);
+        }
+    }
+
+    void read() noexcept {
+        if (fd_ == -1) {
+            return;
+        }
+
+        // close 会删除 event loop 中的拷贝
+        auto self = shared_from_this();
+
+        char buf[16384];
+        for (;;) {
+            const ssize_t n = ::read(fd_, buf, sizeof(buf));
+            if (n > 0) {
+                // 决定关闭之后的请求不再处理
+                if (!last_) {
+                    if (http_parser_execute(&parser_, &settings_, buf, n) !=
+                            static_cast<std::size_t>(n) && !last_) {
+                        close();
+                        return;
+                    }
+                }
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else if (n == -1 && errno == EAGAIN) {
+                break;
+            } else {
+                close();
+                return;
+            }
+        }
+
+        flush();
+    }
+
+    // 写出已到期的响应, 需要关闭时在写完后关闭
+    void flush() noexcept {
+        if (fd_ == -1) {
+            return;
+        }
+
+        if (!pending_.empty()) {
+            const auto now = Clock::now();
+            while (!pending_.empty() && !closing_ && pending_.front().due <= now) {
+                closing_ = pending_.front().close;
+                out_ += closing_ ? w_.closing_ : w_.response_;
+                pending_.pop_front();
+                w_.served_.fetch_add(1, std::memory_order_relaxed);
+            }
+        }
+
+        while (written_ < out_.size()) {
+            const ssize_t n = ::write(fd_, out_.data() + written_, out_.size() - written_);
+            if (n > 0) {
+                written_ += n;
+            } else if (n == -1 && errno == EINTR) {
+                continue;
+            } else if (n == -1 && errno == EAGAIN) {
+                return;
+            } else {
+                close();
+                return;
+            }
+        }
+        out_.clear();
+        written_ = 0;
+
+        if (closing_) {
+            close();
+        }
+    }
+
+    static int onMessageComplete(http_parser* parser) {
+        auto c = static_cast<Conn*>(parser->data);
+        Worker& w = c->w_;
+
+        ++c->requests_;
+        const bool close = !http_should_keep_alive(parser) ||
+                           (w.keep_alive_ && c->requests_ >= w.keep_alive_);
+
+        // 没有延迟时立即到期, 免去取时间
+        Clock::time_point due;
+        if (!w.delay_.none()) {
+            due = Clock::now() + w.delay_(w.rng_);
+            w.schedule(due, c->shared_from_this());
+        }
+        c->pending_.push_back({due, close});
+
+        // 返回非 0 使 http_parser 停止解析剩余的数据
+        c->last_ = close;
+        return close;
+    }
+
+private:
+    void close() noexcept {
+        auto self = shared_from_this();
+        w_.ev_loop_.delEvent(fd_, Mask::READABLE | Mask::WRITABLE);
+        ::close(fd_);
+        fd_ = -1;
+    }
+
+    Worker& w_;
+    int fd_;
+    http_parser parser_;
+
+    struct Pending {
+        Clock::time_point due;
+        bool close;
+    };
+    std::deque<Pending> pending_;
+    std::size_t requests_ = 0;
+    bool last_ = false;
+    bool closing_ = false;
+
+    std::string out_;
+    std::size_t written_ = 0;
+};
+
+http_parser_settings Server::Worker::settings_ = [] {
+    http_parser_settings s;
+    http_parser_settings_init(&s);
+    s.on_message_complete = &Conn::onMessageComplete;
+    return s;
+}();
+
+namespace {
+
+std::string response(std::size_t size, bool close) {
+    std::string r = "HTTP/1.1 200 OK\r\n"
+                    "Content-Length: " + std::to_string(size) + "\r\n";
+    if (close) {
+        r += "Connection: close\r\n";
+    }
+    r += "\r\n";
+    r.append(size, 'x');
+    return r;
+}
+
+// 各线程以 SO_REUSEPORT 监听同一端口, 由内核分发连接
+int listenOn(bool loopback, std::uint16_t port) {
+    const int fd = ::socket(loopback ? AF_INET : AF_INET6,
+                            SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    const int on = 1, off = 0;
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    ::setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &on, sizeof(on));
+
+    int ret;
+    if (loopback) {
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        addr.sin_port = htons(port);
+        ret = ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    } else {
+        ::setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+
+        struct sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        ret = ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    }
+
+    if (ret == -1 || ::listen(fd, 1024) == -1) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error("listen on port " + std::to_string(port) + ": " +
+                                 std::strerror(err));
+    }
+
+    // 接受 --sockopt fastopen 的 SYN 数据, 还需 net.ipv4.tcp_fastopen 开启服务端
+    const int qlen = 1024;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_FASTOPEN, &qlen, sizeof(qlen));
+    return fd;
+}
+
+// Unix socket 不支持 SO_REUSEPORT, 各线程共用一个监听 fd
+int listenUnix(const std::string& path) {
+    struct sockaddr_un addr = {};
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Unix socket path too long: " + path);
+    }
+    addr.sun_family = AF_UNIX;
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+
+    // 上次运行遗留的 socket 文件
+    struct stat st;
+    if (::stat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        ::unlink(path.c_str());
+    }
+
+    if (::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == -1 ||
+        ::listen(fd, 1024) == -1) {
+        const int err = errno;
+        ::close(fd);
+        throw std::runtime_error("listen on " + path + ": " + std::strerror(err));
+    }
+    return fd;
+}
+
+}
+
+Server::Worker::Worker(const ServerConfig& cfg, std::uint16_t port, int lfd)
+    : unix_(!cfg.unix_path.empty()),
+      keep_alive_(cfg.keep_alive),
+      delay_(cfg.delay),
+      rng_(std::random_device()()),
+      response_(response(cfg.response_size, false)),
+      closing_(response(cfg.response_size, true)),
+      ev_loop_(1024) {
+    if (lfd != -1) {
+        lfd_ = lfd;
+    } else if (unix_) {
+        lfd_ = listenUnix(cfg.unix_path);
+    } else {
+        lfd_ = listenOn(cfg.loopback, port);
+    }
+
+    port_ = 0;
+    if (!unix_) {
+        struct sockaddr_storage addr;
+        socklen_t len = sizeof(addr);
+        ::getsockname(lfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.ss_family == AF_INET
+                          ? reinterpret_cast<struct sockaddr_in*>(&addr)->sin_port
+                          : reinterpret_cast<struct sockaddr_in6*>(&addr)->sin6_port);
+    }
+
+    tfd_ = ::timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (tfd_ == -1 ||
+        !ev_loop_.addEvent(lfd_, Mask::READABLE, [this] { accept(); }) ||
+        !ev_loop_.addEvent(tfd_, Mask::READABLE, [this] { expire(); })) {
+        const int err = errno;
+        ::close(lfd_);
+        if (tfd_ != -1) {
+            ::close(tfd_);
+        }
+        throw std::runtime_error(std::string("server event loop: ") + std::strerror(err));
+    }
+}
+
+Server::Worker::~Worker() {
+    ::close(lfd_);
+    ::close(tfd_);
+}
+
+void Server::Worker::accept() noexcept {
+    for (;;) {
+        const int fd = ::accept4(lfd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == -1) {
+            if (errno == EINTR || errno == ECONNABORTED) {
+                continue;
+            }
+            return;
+        }
+
+        if (!unix_) {
+            const int on = 1;
+            ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+        }
+
+        auto c = std::make_shared<Conn>(*this, fd);
+        if (!ev_loop_.addEvent(fd, Mask::READABLE, [c] { c->read(); }) ||
+            !ev_loop_.addEvent(fd, Mask::WRITABLE, [c] { c->flush(); })) {
+            ev_loop_.delEvent(fd, Mask::READABLE | Mask::WRITABLE);
+        }
+    }
+}
+
+void Server::Worker::schedule(Clock::time_point due, std::weak_ptr<Conn> c) {
+    const bool earliest = timers_.empty() || due < timers_.top().due;
+    timers_.push({due, std::move(c)});
+    if (earliest) {
+        arm();
+    }
+}
+
+void Server::Worker::expire() noexcept {
+    std::uint64_t e;
+    (void)::read(tfd_, &e, sizeof(e));
+
+    const auto now = Clock::now();
+    while (!timers_.empty() && timers_.top().due <= now) {
+        // 连接可能已经关闭
+        if (auto c = timers_.top().conn.lock()) {
+            timers_.pop();
+            c->flush();
+        } else {
+            timers_.pop();
+        }
+    }
+    arm();
+}
+
+void Server::Worker::arm() noexcept {
+    // 全 0 即解除; steady_clock 即 CLOCK_MONOTONIC
+    struct itimerspec ts = {};
+    if (!timers_.empty()) {
+        const auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                            timers_.top().due.time_since_epoch())
+                            .count();
+        ts.it_value.tv_sec = ns / 1000000000;
+        ts.it_value.tv_nsec = ns % 1000000000;
+        if (ts.it_value.tv_sec == 0 && ts.it_value.tv_nsec == 0) {
+            ts.it_value.tv_nsec = 1;
+        }
+    }
+    ::timerfd_settime(tfd_, TFD_TIMER_ABSTIME, &ts, nullptr);
+}
+
+
+Server::Server(const ServerConfig& cfg) : unix_path_(cfg.unix_path) {
+    for (std::size_t i = 0; i < std::max<std::size_t>(cfg.threads, 1); ++i) {
+        if (i && !unix_path_.empty()) {
+            const int lfd = ::fcntl(workers_.front()->listener(), F_DUPFD_CLOEXEC, 0);
+            if (lfd == -1) {
+                throw std::runtime_error(std::string("dup: ") + std::strerror(errno));
+            }
+            workers_.push_back(std::make_unique<Worker>(cfg, 0, lfd));
+        } else {
+            workers_.push_back(std::make_unique<Worker>(cfg, i ? port_ : cfg.port));
+        }
+        port_ = workers_.front()->port();
+    }
+}
+
+Server::~Server() {
+    stop();
+    wait();
+    if (!unix_path_.empty()) {
+        ::unlink(unix_path_.c_str());
+    }
+}
+
+std::uint16_t Server::port() const noexcept {
+    return port_;
+}
+
+void Server::start() {
+    for (auto& w : workers_) {
+        Worker* p = w.get();
+        threads_.emplace_back([p] { p->run(); });
+    }
+}
+
+void Server::stop() noexcept {
+    for (auto& w : workers_) {
+        w->stop();
+    }
+}
+
+void Server::wait() {
+    for (auto& t : threads_) {
+        if (t.joinable()) {
+            t.join();
+        }
+    }
+}
+
+std::uint64_t Server::served() const noexcept {
+    std::uint64_t n = 0;
+    for (auto& w : workers_) {
+        n += w->served();
+    }
+    return n;
+}
+
+}
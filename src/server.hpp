@@ -0,0 +1,70 @@
+#ifndef MOROS_SERVER_HPP_
+#define MOROS_SERVER_HPP_
+
+#include "delay.hpp"
+#include <chrono>
+#include <memory>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+#include <cstdint>
+
+// 内置的 HTTP/1.1 服务: 基于 EventLoop, 每个线程一个 SO_REUSEPORT 监听,
+// 回复固定大小的响应. 用于在没有外部服务时测出 moros 自身的上限, 以及
+// 作为测试的对端
+
+namespace moros {
+
+struct ServerConfig {
+    std::uint16_t port = 0;
+    // 只监听 127.0.0.1, 否则监听 IPv6 双栈的所有地址
+    bool loopback = false;
+    // 不为空时改为监听这个 Unix socket, 忽略 port 与 loopback
+    std::string unix_path;
+    std::size_t threads = 1;
+    // 响应 body 的字节数
+    std::size_t response_size = 0;
+    std::string delay;
+    // 每个连接最多回复的请求数, 之后以 Connection: close 关闭, 0 为不限
+    std::size_t keep_alive = 0;
+};
+
+class Server {
+public:
+    // 监听失败或延迟分布格式错误时抛出异常
+    explicit Server(const ServerConfig& cfg);
+
+    ~Server();
+
+    Server(const Server&) = delete;
+    Server& operator=(const Server&) = delete;
+
+    // 实际监听的端口, cfg.port 为 0 时由内核分配, Unix socket 为 0
+    std::uint16_t port() const noexcept;
+
+    // 各线程开始服务, 立即返回
+    void start();
+
+    // 可在信号处理函数中调用
+    void stop() noexcept;
+
+    // 等待各线程结束
+    void wait();
+
+    // 已回复的请求数
+    std::uint64_t served() const noexcept;
+
+private:
+    class Worker;
+
+    std::uint16_t port_ = 0;
+    // 析构时删除
+    std::string unix_path_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::vector<std::thread> threads_;
+};
+
+}
+
+#endif
@@ -0,0 +1,227 @@
+#include "shm.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+
+#include <sys/mman.h>
+
+namespace moros {
+
+namespace {
+
+constexpr std::size_t KINDS = static_cast<std::size_t>(Metrics::Kind::MAX);
+constexpr std::size_t PHASES = static_cast<std::size_t>(Phase::MAX);
+
+// 与 main 中 Req/Sec 直方图的范围一致
+constexpr std::uint64_t REQUESTS_SZ = 1000000;
+
+// slot 开头的字段, 其后依次为 2 个 interval, total, requests, 各 bencher,
+// 各 endpoint 与各阶段
+enum Header : std::size_t {
+    STATE,
+    GENERATION,
+    RUNTIME,
+    // 两个 interval 缓冲各自保存的 interval, 写入期间为 0
+    BUFFER,
+    HEADER_N = BUFFER + 2,
+};
+
+constexpr std::uint64_t RUNNING = 0, DONE = 1;
+
+std::size_t buckets(std::uint64_t sz) {
+    return Stats(sz).counts().size();
+}
+
+}
+
+SharedResults::SharedResults(std::size_t workers, std::size_t threads,
+                             std::size_t endpoints, std::chrono::seconds timeout)
+    : workers_(workers),
+      threads_(threads),
+      endpoints_(endpoints),
+      latency_sz_(timeout.count() * 1000),
+      phase_sz_(timeout.count() * 1000000),
+      latency_n_(buckets(latency_sz_)),
+      requests_n_(buckets(REQUESTS_SZ)),
+      phase_n_(buckets(phase_sz_)),
+      snapshot_n_(KINDS + latency_n_),
+      slot_n_(HEADER_N + (3 + threads + endpoints) * snapshot_n_ + requests_n_ +
+              PHASES * phase_n_) {
+    // 匿名映射的页面初始为 0, 即各 slot 处于 RUNNING 且尚无 interval
+    void* p = ::mmap(nullptr, workers_ * slot_n_ * sizeof(std::uint64_t),
+                     PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) {
+        throw std::runtime_error(std::string("mmap shared results: ") + std::strerror(errno));
+    }
+    base_ = static_cast<std::uint64_t*>(p);
+}
+
+SharedResults::~SharedResults() {
+    ::munmap(base_, workers_ * slot_n_ * sizeof(std::uint64_t));
+}
+
+std::size_t SharedResults::size() const noexcept {
+    return workers_;
+}
+
+std::uint64_t* SharedResults::slot(std::size_t w) const noexcept {
+    return base_ + w * slot_n_;
+}
+
+void SharedResults::store(std::uint64_t* dst, const std::uint64_t counters[],
+                          const Stats& latency) const noexcept {
+    std::copy(counters, counters + KINDS, dst);
+    store(dst + KINDS, latency_n_, latency);
+}
+
+void SharedResults::store(std::uint64_t* dst, std::size_t n,
+                          const Stats& st) const noexcept {
+    const auto& xs = st.counts();
+    const std::size_t m = std::min(n, xs.size());
+    std::copy(xs.begin(), xs.begin() + m, dst);
+    std::fill(dst + m, dst + n, 0);
+}
+
+Snapshot SharedResults::load(const std::uint64_t* src) const {
+    Snapshot snap;
+    std::copy(src, src + KINDS, snap.counters);
+    snap.latency = load(src + KINDS, latency_n_, latency_sz_);
+    return snap;
+}
+
+std::unique_ptr<Stats> SharedResults::load(const std::uint64_t* src, std::size_t n,
+                                           std::uint64_t sz) const {
+    auto st = std::make_unique<Stats>(sz);
+    for (std::size_t i = 0; i < n; ++i) {
+        if (src[i]) {
+            st->add(i, src[i]);
+        }
+    }
+    return st;
+}
+
+void SharedResults::publishInterval(std::size_t w, std::uint64_t k,
+                                    const std::uint64_t counters[],
+                                    const Stats& latency) noexcept {
+    std::uint64_t* s = slot(w);
+    std::uint64_t* gen = &s[BUFFER + (k & 1)];
+    __atomic_store_n(gen, 0, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+    store(s + HEADER_N + (k & 1) * snapshot_n_, counters, latency);
+    __atomic_store_n(gen, k, __ATOMIC_RELEASE);
+    __atomic_store_n(&s[GENERATION], k, __ATOMIC_RELEASE);
+}
+
+bool SharedResults::interval(std::size_t w, std::uint64_t k, Snapshot& out) const {
+    const std::uint64_t* s = slot(w);
+    if (__atomic_load_n(&s[GENERATION], __ATOMIC_ACQUIRE) < k) {
+        return false;
+    }
+
+    // 读取前后缓冲都保存着第 k 个 interval 才合并, 否则已被 k + 2 覆盖
+    const std::uint64_t* gen = &s[BUFFER + (k & 1)];
+    if (__atomic_load_n(gen, __ATOMIC_ACQUIRE) != k) {
+        return true;
+    }
+    Snapshot snap = load(s + HEADER_N + (k & 1) * snapshot_n_);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (__atomic_load_n(gen, __ATOMIC_RELAXED) == k) {
+        out.merge(snap);
+    }
+    return true;
+}
+
+void SharedResults::publishDone(std::size_t w, std::chrono::milliseconds runtime,
+                                const Metrics& total, const Stats& latency,
+                                const Stats& requests,
+                                const std::list<Bencher>& benchers,
+                                const std::vector<Endpoint>& endpoints,
+                                const std::vector<Stats>& phases) noexcept {
+    std::uint64_t* s = slot(w);
+    s[RUNTIME] = runtime.count();
+
+    std::uint64_t counters[KINDS];
+    for (std::size_t i = 0; i < KINDS; ++i) {
+        counters[i] = total[static_cast<Metrics::Kind>(i)];
+    }
+
+    std::uint64_t* p = s + HEADER_N + 2 * snapshot_n_;
+    store(p, counters, latency);
+    p += snapshot_n_;
+    store(p, requests_n_, requests);
+    p += requests_n_;
+
+    auto b = benchers.begin();
+    for (std::size_t i = 0; i < threads_; ++i, p += snapshot_n_) {
+        std::fill(counters, counters + KINDS, 0);
+        counters[static_cast<std::size_t>(Metrics::Kind::COMPLETES)] = b->completes();
+        store(p, counters, b->latency());
+        ++b;
+    }
+
+    for (std::size_t i = 0; i < endpoints_; ++i, p += snapshot_n_) {
+        const Metrics& m = *endpoints[i].metrics;
+        for (std::size_t j = 0; j < KINDS; ++j) {
+            counters[j] = m[static_cast<Metrics::Kind>(j)];
+        }
+        store(p, counters, *endpoints[i].latency);
+    }
+
+    for (std::size_t i = 0; i < PHASES; ++i, p += phase_n_) {
+        store(p, phase_n_, phases[i]);
+    }
+
+    __atomic_store_n(&s[STATE], DONE, __ATOMIC_RELEASE);
+}
+
+bool SharedResults::done(std::size_t w) const noexcept {
+    return __atomic_load_n(&slot(w)[STATE], __ATOMIC_ACQUIRE) == DONE;
+}
+
+ClusterResult SharedResults::collect() const {
+    ClusterResult res;
+    res.requests = std::make_unique<Stats>(REQUESTS_SZ);
+    res.endpoints.resize(endpoints_);
+    for (std::size_t i = 0; i < PHASES; ++i) {
+        res.phases.push_back(std::make_unique<Stats>(phase_sz_));
+    }
+
+    for (std::size_t w = 0; w < workers_; ++w) {
+        if (!done(w)) {
+            continue;
+        }
+
+        const std::uint64_t* s = slot(w);
+        res.runtime = std::max(res.runtime, std::chrono::milliseconds(s[RUNTIME]));
+
+        const std::uint64_t* p = s + HEADER_N + 2 * snapshot_n_;
+        res.total.merge(load(p));
+        p += snapshot_n_;
+        res.requests->merge(*load(p, requests_n_, REQUESTS_SZ));
+        p += requests_n_;
+
+        for (std::size_t i = 0; i < threads_; ++i, p += snapshot_n_) {
+            res.threads.push_back(load(p));
+        }
+        for (std::size_t i = 0; i < endpoints_; ++i, p += snapshot_n_) {
+            res.endpoints[i].merge(load(p));
+        }
+        for (std::size_t i = 0; i < PHASES; ++i, p += phase_n_) {
+            res.phases[i]->merge(*load(p, phase_n_, phase_sz_));
+        }
+    }
+
+    // 没有 worker 完成时也要有直方图
+    if (!res.total.latency) {
+        res.total.latency = std::make_unique<Stats>(latency_sz_);
+    }
+    for (auto& ep : res.endpoints) {
+        if (!ep.latency) {
+            ep.latency = std::make_unique<Stats>(latency_sz_);
+        }
+    }
+    return res;
+}
+
+}
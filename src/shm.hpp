@@ -0,0 +1,77 @@
+#ifndef MOROS_SHM_HPP_
+#define MOROS_SHM_HPP_
+
+#include "stats.hpp"
+#include "bencher.hpp"
+#include "distributed.hpp"
+#include <chrono>
+#include <list>
+#include <vector>
+
+// --processes: fork 前映射一块匿名共享内存, 每个 worker 进程一个 slot.
+// worker 在每个 interval 与测试结束时把计数与直方图各桶的计数直接写入
+// 自己的 slot, 父进程读取后按分布式模式的方式合并, 进程之间不共享任何
+// 会被并发写入的数据.
+//
+// slot 的布局只由 worker 数, 每个 worker 的 bencher 数, endpoint 数与
+// --timeout 决定, 父子进程以相同的参数算出一致的偏移
+
+namespace moros {
+
+class SharedResults {
+public:
+    // 映射失败抛出 std::runtime_error
+    SharedResults(std::size_t workers, std::size_t threads,
+                  std::size_t endpoints, std::chrono::seconds timeout);
+    ~SharedResults();
+
+    SharedResults(const SharedResults&) = delete;
+    SharedResults& operator=(const SharedResults&) = delete;
+
+    std::size_t size() const noexcept;
+
+    // worker: 发布第 k 个 interval (从 1 起) 的增量
+    void publishInterval(std::size_t w, std::uint64_t k,
+                         const std::uint64_t counters[], const Stats& latency) noexcept;
+
+    // 父进程: worker w 已发布第 k 个 interval 时合并入 out 并返回 true.
+    // 两个缓冲交替使用, 父进程落后两个以上 interval 时第 k 个已被覆盖,
+    // 此时不合并而同样返回 true
+    bool interval(std::size_t w, std::uint64_t k, Snapshot& out) const;
+
+    // worker: 测试结束后的全部结果, 之后 done(w) 为 true
+    void publishDone(std::size_t w, std::chrono::milliseconds runtime,
+                     const Metrics& total, const Stats& latency, const Stats& requests,
+                     const std::list<Bencher>& benchers,
+                     const std::vector<Endpoint>& endpoints,
+                     const std::vector<Stats>& phases) noexcept;
+
+    bool done(std::size_t w) const noexcept;
+
+    // 父进程: 合并所有已完成的 worker, 各 worker 的 bencher 依次排列
+    ClusterResult collect() const;
+
+private:
+    std::uint64_t* slot(std::size_t w) const noexcept;
+
+    void store(std::uint64_t* dst, const std::uint64_t counters[],
+               const Stats& latency) const noexcept;
+    void store(std::uint64_t* dst, std::size_t n, const Stats& st) const noexcept;
+
+    Snapshot load(const std::uint64_t* src) const;
+    std::unique_ptr<Stats> load(const std::uint64_t* src, std::size_t n,
+                                std::uint64_t sz) const;
+
+    const std::size_t workers_, threads_, endpoints_;
+    const std::uint64_t latency_sz_, phase_sz_;
+
+    // 以下均以 std::uint64_t 为单位
+    std::size_t latency_n_, requests_n_, phase_n_;
+    std::size_t snapshot_n_, slot_n_;
+
+    std::uint64_t* base_;
+};
+
+}
+
+#endif
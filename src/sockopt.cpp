@@ -0,0 +1,103 @@
+#include "sockopt.hpp"
+#include <cerrno>
+#include <climits>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <stdexcept>
+
+#include <unistd.h>
+
+namespace moros {
+
+SocketOptions parseSocketOptions(const std::string& spec) {
+    SocketOptions opts;
+    const auto invalid = [&](const std::string& s) {
+        return std::invalid_argument("Invalid socket option: " + s);
+    };
+
+    std::istringstream is(spec);
+    for (std::string opt; std::getline(is, opt, ',');) {
+        const std::size_t eq = opt.find('=');
+        const std::string name = opt.substr(0, eq);
+        const std::string value = eq == std::string::npos ? "" : opt.substr(eq + 1);
+
+        const auto bytes = [&] {
+            char* end = nullptr;
+            const long v = std::strtol(value.c_str(), &end, 10);
+            if (value.empty() || *end != '\0' || v <= 0 || v > INT_MAX) {
+                throw invalid(opt);
+            }
+            return static_cast<int>(v);
+        };
+
+        if (opt == "fastopen") {
+            opts.fastopen = true;
+        } else if (opt == "quickack") {
+            opts.quickack = true;
+        } else if (opt == "linger-rst") {
+            opts.linger_rst = true;
+        } else if (name == "sndbuf" && eq != std::string::npos) {
+            opts.sndbuf = bytes();
+        } else if (name == "rcvbuf" && eq != std::string::npos) {
+            opts.rcvbuf = bytes();
+        } else if (name == "congestion" && !value.empty()) {
+            opts.congestion = value;
+        } else {
+            throw invalid(opt);
+        }
+    }
+    return opts;
+}
+
+bool applySocketOptions(int fd, int family, const SocketOptions& opts,
+                        const char** failed) noexcept {
+    const auto set = [&](int level, int name, const void* v, socklen_t len,
+                         const char* what) {
+        if (::setsockopt(fd, level, name, v, len) == -1) {
+            if (failed) {
+                *failed = what;
+            }
+            return false;
+        }
+        return true;
+    };
+    const int on = 1;
+
+    // 缓冲区大小须在 connect 前设置, 才能影响握手时通告的窗口
+    if ((opts.sndbuf &&
+         !set(SOL_SOCKET, SO_SNDBUF, &opts.sndbuf, sizeof(opts.sndbuf), "sndbuf")) ||
+        (opts.rcvbuf &&
+         !set(SOL_SOCKET, SO_RCVBUF, &opts.rcvbuf, sizeof(opts.rcvbuf), "rcvbuf"))) {
+        return false;
+    }
+    if (family == AF_UNIX) {
+        return true;
+    }
+
+    const struct linger rst = {1, 0};
+    return (!opts.linger_rst || set(SOL_SOCKET, SO_LINGER, &rst, sizeof(rst), "linger-rst")) &&
+           (!opts.fastopen ||
+            set(IPPROTO_TCP, TCP_FASTOPEN_CONNECT, &on, sizeof(on), "fastopen")) &&
+           (!opts.quickack || set(IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on), "quickack")) &&
+           (opts.congestion.empty() ||
+            set(IPPROTO_TCP, TCP_CONGESTION, opts.congestion.data(),
+                opts.congestion.size(), "congestion"));
+}
+
+void probeSocketOptions(int family, const SocketOptions& opts) {
+    const int fd = ::socket(family, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd == -1) {
+        throw std::runtime_error(std::string("socket: ") + std::strerror(errno));
+    }
+    const char* failed = "";
+    if (!applySocketOptions(fd, family, opts, &failed)) {
+        const std::string msg =
+            std::string("Socket option ") + failed + ": " + std::strerror(errno);
+        ::close(fd);
+        throw std::runtime_error(msg);
+    }
+    ::close(fd);
+}
+
+}
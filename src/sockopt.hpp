@@ -0,0 +1,49 @@
+#ifndef MOROS_SOCKOPT_HPP_
+#define MOROS_SOCKOPT_HPP_
+
+#include <string>
+
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+// --sockopt: 客户端连接在 connect 之前设置的 socket 选项
+
+namespace moros {
+
+// 以逗号分隔, 例如 "fastopen,linger-rst,sndbuf=65536,congestion=bbr":
+//   fastopen        TCP_FASTOPEN_CONNECT, 第一次写入随 SYN 发出
+//   quickack        TCP_QUICKACK, 内核会自行清除, 每次读完后重新设置
+//   linger-rst      SO_LINGER 为 0, close 时发送 RST, 不留下 TIME_WAIT
+//   sndbuf=BYTES    SO_SNDBUF
+//   rcvbuf=BYTES    SO_RCVBUF
+//   congestion=NAME TCP_CONGESTION
+// TCP_NODELAY 总是开启. Unix socket 只使用 sndbuf 与 rcvbuf
+struct SocketOptions {
+    bool fastopen = false;
+    bool quickack = false;
+    bool linger_rst = false;
+    int sndbuf = 0;
+    int rcvbuf = 0;
+    std::string congestion;
+};
+
+// 格式错误抛出 std::invalid_argument
+SocketOptions parseSocketOptions(const std::string& spec);
+
+// 在 connect 之前设置. 返回 false 时 errno 为第一个失败的选项的错误,
+// failed 不为空时指向其名字
+bool applySocketOptions(int fd, int family, const SocketOptions& opts,
+                        const char** failed = nullptr) noexcept;
+
+// 以 family 的 socket 试设一次, 内核不支持的选项抛出 std::runtime_error
+void probeSocketOptions(int family, const SocketOptions& opts);
+
+inline void quickAck(int fd) noexcept {
+    const int on = 1;
+    ::setsockopt(fd, IPPROTO_TCP, TCP_QUICKACK, &on, sizeof(on));
+}
+
+}
+
+#endif
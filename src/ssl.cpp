@@ -29,6 +29,20 @@ SSL_CTX* SslContext::data() const noexcept {
     return ssl_ctx_.get();
 }
 
+void SslContext::alpn(const std::vector<std::string>& protos) {
+    std::string wire;
+    for (const auto& p : protos) {
+        wire.push_back(static_cast<char>(p.size()));
+        wire.append(p);
+    }
+
+    if (SSL_CTX_set_alpn_protos(ssl_ctx_.get(),
+                                reinterpret_cast<const unsigned char*>(wire.data()),
+                                wire.size()) != 0) {
+        throw std::runtime_error("ssl alpn setup failed");
+    }
+}
+
 Ssl::Ssl(const SslContext& ssl_ctx)
     : ssl_(SSL_new(ssl_ctx.data()), SSL_free), enabled_(true) {}
 
@@ -57,6 +71,14 @@ int Ssl::connect() noexcept {
     return r;
 }
 
+std::string Ssl::alpn() const {
+    const unsigned char* proto = nullptr;
+    unsigned int len = 0;
+    SSL_get0_alpn_selected(ssl_.get(), &proto, &len);
+
+    return std::string(reinterpret_cast<const char*>(proto), len);
+}
+
 int Ssl::close() noexcept {
     SSL_clear(ssl_.get());
     return 0;
@@ -2,6 +2,8 @@
 #define MOROS_SSL_HPP_
 
 #include <memory>
+#include <string>
+#include <vector>
 #include <openssl/ossl_typ.h>
 
 namespace moros {
@@ -12,6 +14,9 @@ public:
 
     SSL_CTX* data() const noexcept;
 
+    // 设置 ALPN 候选协议, 如 {"h2"}
+    void alpn(const std::vector<std::string>& protos);
+
 private:
     std::unique_ptr<SSL_CTX, void (*)(SSL_CTX*)> ssl_ctx_;
 };
@@ -37,6 +42,9 @@ public:
 
     int connect() noexcept;
 
+    // 握手完成后协商出的 ALPN 协议, 未协商时为空
+    std::string alpn() const;
+
     int close() noexcept;
 
     int read(char buf[], std::size_t len) noexcept;
@@ -6,16 +6,67 @@
 
 namespace moros {
 
+namespace {
+
+// 3 位有效数字需要 2 * 10^3 个子桶, 取整到 2^11
+constexpr int SUB_BUCKET_COUNT_MAGNITUDE = 11;
+constexpr int SUB_BUCKET_HALF_COUNT_MAGNITUDE = SUB_BUCKET_COUNT_MAGNITUDE - 1;
+constexpr std::uint64_t SUB_BUCKET_COUNT = 1ull << SUB_BUCKET_COUNT_MAGNITUDE;
+constexpr std::uint64_t SUB_BUCKET_HALF_COUNT = SUB_BUCKET_COUNT / 2;
+constexpr std::uint64_t SUB_BUCKET_MASK = SUB_BUCKET_COUNT - 1;
+
+std::size_t bucketsNeeded(std::uint64_t highest) noexcept {
+    std::uint64_t smallest_untrackable = SUB_BUCKET_COUNT;
+    std::size_t buckets = 1;
+    while (smallest_untrackable <= highest) {
+        if (smallest_untrackable > INT64_MAX / 2) {
+            return buckets + 1;
+        }
+        smallest_untrackable <<= 1;
+        ++buckets;
+    }
+    return buckets;
+}
+
+}
+
 Stats::Stats(std::size_t sz) noexcept
-    : count_(0), min_(UINT64_MAX), max_(0), xs_(sz, 0) {}
+    : count_(0),
+      min_(UINT64_MAX),
+      max_(0),
+      highest_(sz ? sz - 1 : 0),
+      xs_((bucketsNeeded(highest_) + 1) * SUB_BUCKET_HALF_COUNT, 0) {}
+
+std::size_t Stats::countsIndex(std::uint64_t n) noexcept {
+    const int bucket = 64 - __builtin_clzll(n | SUB_BUCKET_MASK) -
+                       (SUB_BUCKET_HALF_COUNT_MAGNITUDE + 1);
+    const std::uint64_t sub = n >> bucket;
+    return ((bucket + 1) << SUB_BUCKET_HALF_COUNT_MAGNITUDE) +
+           (sub - SUB_BUCKET_HALF_COUNT);
+}
+
+std::uint64_t Stats::valueAt(std::size_t idx) noexcept {
+    int bucket = static_cast<int>(idx >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    std::uint64_t sub = (idx & (SUB_BUCKET_HALF_COUNT - 1)) + SUB_BUCKET_HALF_COUNT;
+    if (bucket < 0) {
+        sub -= SUB_BUCKET_HALF_COUNT;
+        bucket = 0;
+    }
+    return sub << bucket;
+}
+
+std::uint64_t Stats::rangeAt(std::size_t idx) noexcept {
+    const int bucket = static_cast<int>(idx >> SUB_BUCKET_HALF_COUNT_MAGNITUDE) - 1;
+    return 1ull << std::max(bucket, 0);
+}
 
 bool Stats::record(std::uint64_t n) noexcept {
-    if (n >= xs_.size()) {
+    if (n > highest_) {
         return false;
     }
 
     __atomic_add_fetch(&count_, 1, __ATOMIC_RELAXED);
-    __atomic_add_fetch(&xs_[n], 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&xs_[countsIndex(n)], 1, __ATOMIC_RELAXED);
 
     std::uint64_t min = __atomic_load_n(&min_, __ATOMIC_RELAXED),
                   max = __atomic_load_n(&max_, __ATOMIC_RELAXED);
@@ -31,6 +82,57 @@ bool Stats::record(std::uint64_t n) noexcept {
     return true;
 }
 
+void Stats::reset() noexcept {
+    __atomic_store_n(&count_, 0, __ATOMIC_RELAXED);
+    __atomic_store_n(&min_, UINT64_MAX, __ATOMIC_RELAXED);
+    __atomic_store_n(&max_, 0, __ATOMIC_RELAXED);
+    for (auto& x : xs_) {
+        __atomic_store_n(&x, 0, __ATOMIC_RELAXED);
+    }
+}
+
+void Stats::merge(const Stats& rhs) noexcept {
+    if (rhs.count_ == 0) {
+        return;
+    }
+
+    // 布局只取决于有效数字, 不同 highest 的直方图可按下标直接相加
+    const std::size_t n = std::min(xs_.size(), rhs.xs_.size());
+    for (std::size_t i = countsIndex(rhs.min_); i <= countsIndex(rhs.max_) && i < n; ++i) {
+        __atomic_add_fetch(&xs_[i], rhs.xs_[i], __ATOMIC_RELAXED);
+    }
+    __atomic_add_fetch(&count_, rhs.count_, __ATOMIC_RELAXED);
+    min_ = std::min(min_, rhs.min_);
+    max_ = std::max(max_, std::min(rhs.max_, highest_));
+}
+
+bool Stats::add(std::size_t idx, std::uint64_t n) noexcept {
+    if (idx >= xs_.size()) {
+        return false;
+    }
+    if (n == 0) {
+        return true;
+    }
+
+    xs_[idx] += n;
+    count_ += n;
+    min_ = std::min(min_, valueAt(idx));
+    max_ = std::max(max_, std::min(valueAt(idx) + rangeAt(idx) - 1, highest_));
+    return true;
+}
+
+std::uint64_t Stats::count() const noexcept {
+    return count_;
+}
+
+std::uint64_t Stats::highest() const noexcept {
+    return highest_;
+}
+
+const std::vector<std::uint64_t>& Stats::counts() const noexcept {
+    return xs_;
+}
+
 double Stats::max() const noexcept {
     return max_;
 }
@@ -40,11 +142,14 @@ double Stats::mean() const noexcept {
         return 0.0;
     }
 
-    std::uint64_t sum = 0;
-    for (std::uint64_t i = min_; i <= max_; ++i) {
-        sum += xs_[i] * i;
+    // 非精确的桶以区间中点代表其中所有样本
+    double sum = 0;
+    for (std::size_t i = countsIndex(min_); i <= countsIndex(max_); ++i) {
+        if (xs_[i]) {
+            sum += 1.0 * xs_[i] * (valueAt(i) + rangeAt(i) / 2);
+        }
     }
-    return 1.0 * sum / count_;
+    return sum / count_;
 }
 
 double Stats::stdev(double m) const noexcept {
@@ -53,33 +158,41 @@ double Stats::stdev(double m) const noexcept {
     }
 
     double sum = 0;
-    for (std::uint64_t i = min_; i <= max_; ++i) {
+    for (std::size_t i = countsIndex(min_); i <= countsIndex(max_); ++i) {
         if (xs_[i]) {
-            sum += std::pow(i - m, 2) * xs_[i];
+            sum += std::pow(valueAt(i) + rangeAt(i) / 2 - m, 2) * xs_[i];
         }
     }
     return std::sqrt(sum / (count_ - 1));
 }
 
 double Stats::inStdevPercent(double m, double sev, std::size_t n) const noexcept {
+    if (count_ == 0) {
+        return 0.0;
+    }
+
     const std::uint64_t lo = std::max(0.0 + min_, std::ceil(m - n * sev)),
                         hi = std::min(0.0 + max_, std::ceil(m + n * sev));
 
     std::uint64_t sum = 0;
-    for (std::uint64_t i = lo; i <= hi; ++i) {
+    for (std::size_t i = countsIndex(lo); i <= countsIndex(hi); ++i) {
         sum += xs_[i];
     }
     return 100.0 * sum / count_;
 }
 
 std::uint64_t Stats::derank(double p) const noexcept {
+    if (count_ == 0) {
+        return 0;
+    }
+
     const std::uint64_t rank = std::ceil(p * count_);
 
     std::uint64_t total = 0;
-    for (std::uint64_t i = min_; i <= max_; ++i) {
+    for (std::size_t i = countsIndex(min_); i <= countsIndex(max_); ++i) {
         total += xs_[i];
         if (total >= rank) {
-            return i;
+            return std::min(valueAt(i) + rangeAt(i) - 1, max_);
         }
     }
     return 0;
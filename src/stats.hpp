@@ -33,8 +33,26 @@ public:
         return ins;
     }
 
+    // warmup 期间关闭, 此时的计数全部丢弃. 直方图由记录者自行检查 enabled,
+    // 重新打开前清零的直方图对之后读到 true 的线程可见
+    void enable(bool on) noexcept {
+        enabled_.store(on, std::memory_order_release);
+    }
+
+    bool enabled() const noexcept {
+        return enabled_.load(std::memory_order_acquire);
+    }
+
     void count(Kind k, std::size_t c = 1) noexcept {
-        cnt_[static_cast<std::size_t>(k)] += c;
+        if (enabled()) {
+            cnt_[static_cast<std::size_t>(k)] += c;
+        }
+    }
+
+    void reset() noexcept {
+        for (auto& c : cnt_) {
+            c = 0;
+        }
     }
 
     std::uint64_t get(Kind k) const noexcept {
@@ -48,15 +66,46 @@ public:
 private:
     // avoid false sharing
     alignas(64) std::atomic_uint64_t cnt_[static_cast<std::size_t>(Kind::MAX)] = {};
+
+    std::atomic_bool enabled_{true};
 };
 
 
+// 一个请求所经历的阶段, 耗时以 us 记录. CONNECT 与 TLS 每个连接一次,
+// TTFB 从开始发送请求到收到第一个响应字节, TRANSFER 从第一个字节到响应结束.
+// WIRE 为内核时间戳测得的 TTFB, OVERHEAD 为同一请求两者之差, 即 moros
+// 自身的排队与调度延迟, 只在开启 --timestamping 时记录. SCHEDULE 为
+// --arrival 与 --replay 下请求实际发出晚于计划的时间. ACCEPT 为每个连接
+// 第一个请求的 TTFB, 包含在服务端 accept 队列中等待的时间
+enum class Phase {
+    CONNECT,
+    TLS,
+    TTFB,
+    TRANSFER,
+    WIRE,
+    OVERHEAD,
+    SCHEDULE,
+    ACCEPT,
+    MAX,
+};
+
+// HdrHistogram 兼容的对数-线性布局: lowest 为 1, 保留 3 位有效数字,
+// 小于 2048 的值精确记录, 之后每翻一倍桶宽也翻一倍
 class Stats {
 public:
+    static constexpr int SIGNIFICANT_FIGURES = 3;
+
+    // 可记录 [0, sz) 内的值
     Stats(std::size_t sz) noexcept;
 
     bool record(std::uint64_t n) noexcept;
 
+    // 调用时不能有并发的 record, 例如 warmup 期间各 bencher 不记录时
+    void reset() noexcept;
+
+    // 同上, rhs 不能有并发的 record
+    void merge(const Stats& rhs) noexcept;
+
     double max() const noexcept;
 
     double mean() const noexcept;
@@ -67,9 +116,27 @@ public:
 
     std::uint64_t derank(double p) const noexcept;
 
+    std::uint64_t count() const noexcept;
+
+    // 可记录的最大值
+    std::uint64_t highest() const noexcept;
+
+    // 以下供编解码直接访问各个桶
+    const std::vector<std::uint64_t>& counts() const noexcept;
+
+    // 向第 idx 个桶加入 n 个样本, idx 越界返回 false
+    bool add(std::size_t idx, std::uint64_t n) noexcept;
+
+    static std::size_t countsIndex(std::uint64_t n) noexcept;
+
+    // 第 idx 个桶所代表区间的下界与宽度
+    static std::uint64_t valueAt(std::size_t idx) noexcept;
+    static std::uint64_t rangeAt(std::size_t idx) noexcept;
+
 private:
     std::size_t count_;
     std::uint64_t min_, max_;
+    std::uint64_t highest_;
     std::vector<std::uint64_t> xs_;
 };
 
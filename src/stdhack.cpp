@@ -19,6 +19,19 @@ ostream& operator<<(ostream& os, seconds sec) {
     return os << sec.count() << "s";
 }
 
+void validate(boost::any& v, const std::vector<std::string>& xs,
+              std::chrono::milliseconds*, long) {
+    po::validators::check_first_occurrence(v);
+
+    const auto& s = po::validators::get_single_string(xs);
+
+    v = std::chrono::milliseconds(std::stoull(s));
+}
+
+ostream& operator<<(ostream& os, milliseconds ms) {
+    return os << ms.count() << "ms";
+}
+
 }
 
 
@@ -16,6 +16,12 @@ void validate(boost::any& v, const std::vector<std::string>& xs, seconds*,
 
 ostream& operator<<(ostream& os, seconds sec);
 
+// 同上, 用于毫秒级的选项
+void validate(boost::any& v, const std::vector<std::string>& xs,
+              milliseconds*, long);
+
+ostream& operator<<(ostream& os, milliseconds ms);
+
 }
 }
 
@@ -0,0 +1,180 @@
+#include "template.hpp"
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+
+namespace moros {
+
+Xorshift::Xorshift(std::uint64_t seed) noexcept
+    : state_(seed ? seed : 0x9e3779b97f4a7c15ull) {}
+
+std::uint64_t Xorshift::next() noexcept {
+    state_ ^= state_ >> 12;
+    state_ ^= state_ << 25;
+    state_ ^= state_ >> 27;
+    return state_ * 0x2545f4914f6cdd1dull;
+}
+
+TemplateState::TemplateState(std::uint64_t seed, std::uint64_t seq,
+                             std::uint64_t stride) noexcept
+    : rng(seed), seq(seq), stride(stride) {}
+
+std::uint64_t deriveSeed(std::uint64_t seed, std::uint64_t id) noexcept {
+    // splitmix64
+    std::uint64_t z = seed + (id + 1) * 0x9e3779b97f4a7c15ull;
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+void appendNumber(std::string& out, std::uint64_t n) {
+    char buf[20];
+    std::size_t i = sizeof(buf);
+    do {
+        buf[--i] = static_cast<char>('0' + n % 10);
+        n /= 10;
+    } while (n);
+    out.append(buf + i, sizeof(buf) - i);
+}
+
+namespace {
+
+void appendHex(std::string& out, std::uint64_t v, int digits) {
+    static const char hex[] = "0123456789abcdef";
+    for (int i = digits - 1; i >= 0; --i) {
+        out.push_back(hex[(v >> (4 * i)) & 0xf]);
+    }
+}
+
+}
+
+Template::Template(const std::string& src) {
+    const auto literal = [&](std::size_t begin, std::size_t end) {
+        if (begin == end) {
+            return;
+        }
+        segs_.push_back(Segment{Kind::TEXT, text_.size(), end - begin});
+        text_.append(src, begin, end - begin);
+    };
+
+    std::size_t pos = 0;
+    for (;;) {
+        const std::size_t open = src.find("{{", pos);
+        if (open == std::string::npos) {
+            literal(pos, src.size());
+            break;
+        }
+        literal(pos, open);
+
+        const std::size_t close = src.find("}}", open + 2);
+        if (close == std::string::npos) {
+            throw std::runtime_error("unterminated placeholder in " + src);
+        }
+
+        const std::string ph = src.substr(open + 2, close - open - 2);
+        const std::size_t colon = ph.find(':');
+        const std::string name = ph.substr(0, colon),
+                          arg = colon == std::string::npos ? "" : ph.substr(colon + 1);
+
+        if (name == "seq" && arg.empty()) {
+            segs_.push_back(Segment{Kind::SEQ, 0, 0});
+        } else if (name == "uuid" && arg.empty()) {
+            segs_.push_back(Segment{Kind::UUID, 0, 0});
+        } else if (name == "rand") {
+            const std::size_t dots = arg.find("..");
+            char* end1 = nullptr;
+            char* end2 = nullptr;
+            const std::string lo_s = arg.substr(0, dots),
+                              hi_s = dots == std::string::npos ? "" : arg.substr(dots + 2);
+            const std::uint64_t lo = std::strtoull(lo_s.c_str(), &end1, 10),
+                                hi = std::strtoull(hi_s.c_str(), &end2, 10);
+            if (lo_s.empty() || hi_s.empty() || *end1 != '\0' || *end2 != '\0' ||
+                lo > hi) {
+                throw std::runtime_error("invalid placeholder {{" + ph + "}}");
+            }
+            segs_.push_back(Segment{Kind::RAND, lo, hi});
+        } else if (name == "pick" && !arg.empty()) {
+            std::ifstream is(arg);
+            if (!is) {
+                throw std::runtime_error("open " + arg + " failed");
+            }
+
+            std::vector<std::string> lines;
+            for (std::string line; std::getline(is, line);) {
+                if (!line.empty() && line.back() == '\r') {
+                    line.pop_back();
+                }
+                if (!line.empty()) {
+                    lines.push_back(std::move(line));
+                }
+            }
+            if (lines.empty()) {
+                throw std::runtime_error(arg + " is empty");
+            }
+
+            segs_.push_back(Segment{Kind::PICK, picks_.size(), 0});
+            picks_.push_back(std::move(lines));
+        } else {
+            throw std::runtime_error("unknown placeholder {{" + ph + "}}");
+        }
+
+        pos = close + 2;
+    }
+}
+
+bool Template::dynamic() const noexcept {
+    for (const auto& seg : segs_) {
+        if (seg.kind != Kind::TEXT) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool Template::empty() const noexcept {
+    return segs_.empty();
+}
+
+void Template::render(std::string& out, TemplateState& st) const {
+    for (const auto& seg : segs_) {
+        switch (seg.kind) {
+        case Kind::TEXT:
+            out.append(text_, seg.a, seg.b);
+            break;
+
+        case Kind::SEQ:
+            appendNumber(out, st.seq);
+            break;
+
+        case Kind::RAND: {
+            const std::uint64_t span = seg.b - seg.a + 1;
+            appendNumber(out, seg.a + (span ? st.rng.next() % span : st.rng.next()));
+            break;
+        }
+
+        case Kind::UUID: {
+            // version 4, variant 10xx
+            const std::uint64_t hi = (st.rng.next() & ~0xf000ull) | 0x4000ull,
+                                lo = (st.rng.next() & ~(3ull << 62)) | (2ull << 62);
+            appendHex(out, hi >> 32, 8);
+            out.push_back('-');
+            appendHex(out, hi >> 16, 4);
+            out.push_back('-');
+            appendHex(out, hi, 4);
+            out.push_back('-');
+            appendHex(out, lo >> 48, 4);
+            out.push_back('-');
+            appendHex(out, lo, 12);
+            break;
+        }
+
+        case Kind::PICK: {
+            const auto& lines = picks_[seg.a];
+            out.append(lines[st.rng.next() % lines.size()]);
+            break;
+        }
+        }
+    }
+}
+
+}
@@ -0,0 +1,79 @@
+#ifndef MOROS_TEMPLATE_HPP_
+#define MOROS_TEMPLATE_HPP_
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace moros {
+
+// xorshift64*, 每个线程或连接各持有一个
+class Xorshift {
+public:
+    explicit Xorshift(std::uint64_t seed) noexcept;
+
+    std::uint64_t next() noexcept;
+
+private:
+    std::uint64_t state_;
+};
+
+// 每条连接一份, 相同 seed 下渲染结果可复现
+struct TemplateState {
+    TemplateState(std::uint64_t seed, std::uint64_t seq,
+                  std::uint64_t stride) noexcept;
+
+    Xorshift rng;
+
+    // {{seq}} 的当前值, 每个请求后递增 stride, 各连接的序列互不重叠
+    std::uint64_t seq;
+    std::uint64_t stride;
+};
+
+// 由 seed 与编号导出互不相关的子 seed
+std::uint64_t deriveSeed(std::uint64_t seed, std::uint64_t id) noexcept;
+
+void appendNumber(std::string& out, std::uint64_t n);
+
+// 请求模板, 支持的占位符:
+//   {{seq}}            连接内递增的序号, 全局唯一
+//   {{rand:LO..HI}}    [LO, HI] 内的均匀随机数
+//   {{uuid}}           随机的 UUID v4
+//   {{pick:FILE}}      随机选取 FILE 中的一行
+// 启动时编译为片段列表, 渲染时只向 out 追加
+class Template {
+public:
+    Template() = default;
+
+    // 语法错误或 FILE 无法读取时抛出 std::runtime_error
+    explicit Template(const std::string& src);
+
+    bool dynamic() const noexcept;
+
+    bool empty() const noexcept;
+
+    void render(std::string& out, TemplateState& st) const;
+
+private:
+    enum class Kind {
+        TEXT,
+        SEQ,
+        RAND,
+        UUID,
+        PICK,
+    };
+
+    struct Segment {
+        Kind kind;
+        // TEXT: text_ 中的区间; RAND: [lo, hi]; PICK: picks_ 的下标
+        std::uint64_t a, b;
+    };
+
+    std::string text_;
+    std::vector<Segment> segs_;
+    std::vector<std::vector<std::string>> picks_;
+};
+
+}
+
+#endif
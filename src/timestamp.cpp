@@ -0,0 +1,92 @@
+#include "timestamp.hpp"
+#include <cstring>
+
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <linux/net_tstamp.h>
+#include <linux/errqueue.h>
+
+namespace moros {
+
+namespace {
+
+std::int64_t nanos(const struct timespec& ts) noexcept {
+    return std::int64_t(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+// 从 msg 的 control message 中取出时间戳, 没有时返回 false
+bool parseStamp(struct msghdr& msg, WireStamp& st) noexcept {
+    for (struct cmsghdr* c = CMSG_FIRSTHDR(&msg); c; c = CMSG_NXTHDR(&msg, c)) {
+        if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPING) {
+            struct scm_timestamping ts;
+            std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+            st.sw = nanos(ts.ts[0]);
+            st.hw = nanos(ts.ts[2]);
+            return true;
+        }
+    }
+    return false;
+}
+
+}
+
+bool enableTimestamping(int fd) noexcept {
+    const int flags = SOF_TIMESTAMPING_TX_SOFTWARE | SOF_TIMESTAMPING_RX_SOFTWARE |
+                      SOF_TIMESTAMPING_SOFTWARE | SOF_TIMESTAMPING_TX_HARDWARE |
+                      SOF_TIMESTAMPING_RX_HARDWARE | SOF_TIMESTAMPING_RAW_HARDWARE |
+                      SOF_TIMESTAMPING_OPT_TSONLY;
+    return ::setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPING, &flags, sizeof(flags)) == 0;
+}
+
+ssize_t recvStamped(int fd, char buf[], std::size_t len, WireStamp& rx) noexcept {
+    struct iovec iov = {buf, len};
+    char ctrl[CMSG_SPACE(sizeof(struct scm_timestamping))];
+
+    struct msghdr msg = {};
+    msg.msg_iov = &iov;
+    msg.msg_iovlen = 1;
+    msg.msg_control = ctrl;
+    msg.msg_controllen = sizeof(ctrl);
+
+    const ssize_t n = ::recvmsg(fd, &msg, 0);
+    if (n > 0) {
+        parseStamp(msg, rx);
+    }
+    return n;
+}
+
+void drainTxStamps(int fd, WireStamp& tx) noexcept {
+    // OPT_TSONLY: 错误队列中只有时间戳与 sock_extended_err, 不回送数据
+    char ctrl[CMSG_SPACE(sizeof(struct scm_timestamping)) +
+              CMSG_SPACE(sizeof(struct sock_extended_err) + 64)];
+    for (;;) {
+        struct msghdr msg = {};
+        msg.msg_control = ctrl;
+        msg.msg_controllen = sizeof(ctrl);
+
+        if (::recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) < 0) {
+            return;
+        }
+        parseStamp(msg, tx);
+    }
+}
+
+bool wireTime(const WireStamp& tx, const WireStamp& rx,
+              std::chrono::nanoseconds& d) noexcept {
+    std::int64_t delta;
+    if (tx.hw && rx.hw) {
+        delta = rx.hw - tx.hw;
+    } else if (tx.sw && rx.sw) {
+        delta = rx.sw - tx.sw;
+    } else {
+        return false;
+    }
+
+    if (delta < 0) {
+        return false;
+    }
+    d = std::chrono::nanoseconds(delta);
+    return true;
+}
+
+}
@@ -0,0 +1,33 @@
+#ifndef MOROS_TIMESTAMP_HPP_
+#define MOROS_TIMESTAMP_HPP_
+
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+#include <sys/types.h>
+
+namespace moros {
+
+// SO_TIMESTAMPING 给出的收发时刻 (ns). 软件时间戳由内核打在协议栈与驱动
+// 之间, 硬件时间戳只在网卡已开启 timestamping 时才有, 没有时为 0
+struct WireStamp {
+    std::int64_t sw = 0;
+    std::int64_t hw = 0;
+};
+
+// 请求收发两个方向的软件与硬件时间戳, 失败返回 false
+bool enableTimestamping(int fd) noexcept;
+
+// 与 read 相同, 同时取得本次读到的数据被内核接收的时刻
+ssize_t recvStamped(int fd, char buf[], std::size_t len, WireStamp& rx) noexcept;
+
+// 取空错误队列中的发送时间戳, tx 保留最后一个
+void drainTxStamps(int fd, WireStamp& tx) noexcept;
+
+// rx - tx, 两端都有硬件时间戳时优先使用, 任一端缺失返回 false
+bool wireTime(const WireStamp& tx, const WireStamp& rx,
+              std::chrono::nanoseconds& d) noexcept;
+
+}
+
+#endif
@@ -0,0 +1,166 @@
+// moros-top: 轮询一个或多个 --stats-file, 按刷新间隔输出吞吐, 错误与
+// latency 分位数. 只读映射文件, 不与 moros 进程有任何交互
+#include "live.hpp"
+#include "numfmt.hpp"
+#include <iostream>
+#include <iomanip>
+#include <thread>
+#include <vector>
+#include <boost/program_options.hpp>
+
+namespace {
+
+using Kind = moros::Metrics::Kind;
+
+struct Source {
+    std::string path;
+    std::unique_ptr<moros::LiveReader> reader;
+    // 上次读到的快照与计算增量的基准, 基准的 latency 为空时从 0 算起
+    moros::LiveSnapshot last, base;
+    bool seen = false;
+};
+
+// 本轮各文件合并后的增量
+struct Delta {
+    double requests = 0, bytes = 0;
+    std::uint64_t errors = 0, status = 0;
+    std::unique_ptr<moros::Stats> latency;
+    std::chrono::milliseconds elapsed{0};
+    bool running = false, warmup = false, done = true;
+};
+
+void poll(Source& src, Delta& d) {
+    if (src.reader && src.reader->stale()) {
+        src.reader.reset();
+    }
+    if (!src.reader) {
+        try {
+            src.reader = std::make_unique<moros::LiveReader>(src.path);
+        } catch (const std::exception&) {
+            // 测试尚未开始, 或文件还未就绪
+            d.done = false;
+            return;
+        }
+        src.seen = false;
+    }
+
+    moros::LiveSnapshot cur;
+    if (!src.reader->read(cur)) {
+        d.done = false;
+        return;
+    }
+
+    // 首次读到时输出自开始以来的平均; warmup 结束时 moros 清零了全部统计
+    if (!src.seen || (src.last.state == moros::LiveState::WARMUP &&
+                      cur.state != moros::LiveState::WARMUP)) {
+        src.base = moros::LiveSnapshot();
+    } else {
+        src.base = std::move(src.last);
+    }
+    src.seen = true;
+
+    const double secs = (cur.elapsed - src.base.elapsed).count() / 1000.0;
+    const auto get = [&](Kind k) { return cur[k] - src.base[k]; };
+    if (secs > 0) {
+        d.requests += get(Kind::COMPLETES) / secs;
+        d.bytes += get(Kind::BYTES) / secs;
+    }
+    d.errors += get(Kind::ECONNECT) + get(Kind::EREAD) + get(Kind::EWRITE) +
+                get(Kind::ETIMEOUT);
+    d.status += get(Kind::ESTATUS);
+
+    if (!d.latency) {
+        d.latency = std::make_unique<moros::Stats>(cur.latency->highest() + 1);
+    }
+    const auto& xs = cur.latency->counts();
+    for (std::size_t i = 0; i < xs.size(); ++i) {
+        const std::uint64_t prev = src.base.latency ? src.base.latency->counts()[i] : 0;
+        if (xs[i] > prev) {
+            d.latency->add(i, xs[i] - prev);
+        }
+    }
+
+    d.elapsed = std::max(d.elapsed, cur.elapsed);
+    d.running = d.running || cur.state == moros::LiveState::RUNNING;
+    d.warmup = d.warmup || cur.state == moros::LiveState::WARMUP;
+    d.done = d.done && cur.state == moros::LiveState::DONE;
+    src.last = std::move(cur);
+}
+
+void print(std::ostream& os, const Delta& d) {
+    const auto ms = [](std::uint64_t x) {
+        return moros::numfmt(std::chrono::milliseconds(x));
+    };
+
+    os << "  " << std::left << std::setw(8)
+       << moros::numfmt(std::chrono::duration_cast<std::chrono::seconds>(d.elapsed))
+       << std::setw(8) << (d.running ? "running" : d.warmup ? "warmup" : "done")
+       << std::right
+       << std::setw(9) << moros::numfmt(d.requests)
+       << std::setw(14) << moros::numfmt(d.bytes) + "B"
+       << std::setw(9) << d.errors
+       << std::setw(10) << d.status
+       << std::setw(7) << ms(d.latency->derank(0.50))
+       << std::setw(9) << ms(d.latency->derank(0.90))
+       << std::setw(9) << ms(d.latency->derank(0.99))
+       << std::setw(9) << ms(d.latency->max()) << std::endl;
+}
+
+}
+
+int main(int argc, char* argv[]) {
+    namespace po = boost::program_options;
+
+    std::chrono::milliseconds::rep interval = 1000;
+    std::size_t count = 0;
+    std::vector<std::string> files;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("interval,i", po::value<std::chrono::milliseconds::rep>(&interval)->default_value(1000), "Refresh every this many milliseconds")
+        ("count,n", po::value<std::size_t>(&count)->default_value(0), "Exit after this many lines, 0 to run until every test is done")
+        ("file", po::value<std::vector<std::string>>(&files), "Files written by moros --stats-file, merged into one line");
+
+    po::positional_options_description pos;
+    pos.add("file", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+    if (vm.count("help") || files.empty() || interval <= 0) {
+        std::cerr << "Usage: " << argv[0] << " [options] <file>..." << '\n'
+                  << desc << '\n';
+        return vm.count("help") ? 0 : -1;
+    }
+
+    std::vector<Source> sources(files.size());
+    for (std::size_t i = 0; i < files.size(); ++i) {
+        sources[i].path = files[i];
+    }
+
+    std::cout << "  Time    State     Req/Sec   Transfer/Sec   Errors   Non-2xx"
+                 "    p50      p90      p99      Max" << std::endl;
+
+    for (std::size_t n = 0; count == 0 || n < count;) {
+        Delta d;
+        for (auto& src : sources) {
+            poll(src, d);
+        }
+        // 还没有任何文件可读时不输出
+        if (d.latency) {
+            print(std::cout, d);
+            ++n;
+        }
+        if (d.done) {
+            break;
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(interval));
+    }
+    return 0;
+}
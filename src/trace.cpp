@@ -0,0 +1,274 @@
+#include "trace.hpp"
+#include "numfmt.hpp"
+#include "escape.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <stdexcept>
+
+namespace moros {
+
+namespace {
+
+struct Header {
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t record_size;
+    std::uint64_t start;
+    std::int64_t wall;
+    std::uint64_t records;
+    std::uint64_t dropped;
+    // 其后 endpoint 名称的总字节数
+    std::uint64_t names;
+};
+
+constexpr char MAGIC[8] = {'M', 'O', 'R', 'O', 'S', 'T', 'R', 'C'};
+constexpr std::uint32_t VERSION = 1;
+
+std::string errmsg(const std::string& what, const std::string& path) {
+    return what + " " + path + ": " + std::strerror(errno);
+}
+
+bool slower(const SlowRequest& lhs, const SlowRequest& rhs) noexcept {
+    return lhs.record.latency() > rhs.record.latency();
+}
+
+const std::string& endpointName(const TraceFile& t, std::uint16_t ep) {
+    static const std::string unknown = "?";
+    return ep < t.endpoints.size() ? t.endpoints[ep] : unknown;
+}
+
+// 相对测试开始的 us, 开始前发出的请求为负
+std::int64_t since(std::uint64_t us, std::uint64_t start) noexcept {
+    return static_cast<std::int64_t>(us - start);
+}
+
+std::string us(std::uint64_t x) {
+    return x < 1000 ? str(boost::format("%1%us") % x)
+                    : str(boost::format("%.2fms") % (x / 1000.0));
+}
+
+}
+
+std::uint32_t traceMicros(std::chrono::steady_clock::duration d) noexcept {
+    const auto n = std::chrono::duration_cast<std::chrono::microseconds>(d).count();
+    if (n <= 0) {
+        return 0;
+    }
+    return static_cast<std::uint32_t>(
+        std::min<std::chrono::microseconds::rep>(n, UINT32_MAX));
+}
+
+TraceRing::TraceRing(std::size_t capacity) {
+    std::size_t n = 1;
+    while (n < capacity) {
+        n <<= 1;
+    }
+    buf_.resize(n);
+    mask_ = n - 1;
+}
+
+void TraceRing::snapshot(std::vector<TraceRecord>& out) const {
+    const std::uint64_t head = head_.load(std::memory_order_acquire);
+    const std::uint64_t from = head > buf_.size() ? head - buf_.size() : 0;
+    const std::size_t base = out.size();
+    for (std::uint64_t i = from; i < head; ++i) {
+        out.push_back(buf_[i & mask_]);
+    }
+
+    // 复制期间写入者绕回覆盖的部分不可信
+    std::atomic_thread_fence(std::memory_order_acquire);
+    const std::uint64_t now = head_.load(std::memory_order_relaxed);
+    if (now > from + buf_.size()) {
+        const std::uint64_t lost = std::min(now - buf_.size() - from, head - from);
+        out.erase(out.begin() + base, out.begin() + base + lost);
+    }
+}
+
+SlowestRequests::SlowestRequests(std::size_t n) : n_(n) {
+    heap_.reserve(n);
+}
+
+void SlowestRequests::add(const TraceRecord& r, const std::string& request) {
+    if (!qualifies(r.latency())) {
+        return;
+    }
+    if (heap_.size() == n_) {
+        std::pop_heap(heap_.begin(), heap_.end(), slower);
+        heap_.pop_back();
+    }
+    heap_.push_back({r, request.substr(0, request.find("\r\n"))});
+    std::push_heap(heap_.begin(), heap_.end(), slower);
+}
+
+void SlowestRequests::merge(const SlowestRequests& other) {
+    for (const auto& s : other.heap_) {
+        add(s.record, s.request);
+    }
+}
+
+std::vector<SlowRequest> SlowestRequests::sorted() const {
+    std::vector<SlowRequest> out = heap_;
+    std::sort(out.begin(), out.end(), slower);
+    return out;
+}
+
+void writeTrace(const std::string& path, const TraceFile& t) {
+    std::string names;
+    for (const auto& ep : t.endpoints) {
+        names += ep;
+        names.push_back('\n');
+    }
+
+    Header h = {};
+    std::memcpy(h.magic, MAGIC, sizeof(MAGIC));
+    h.version = VERSION;
+    h.record_size = sizeof(TraceRecord);
+    h.start = t.start;
+    h.wall = t.wall;
+    h.records = t.records.size();
+    h.dropped = t.dropped;
+    h.names = names.size();
+
+    std::ofstream os(path, std::ios::binary | std::ios::trunc);
+    if (!os) {
+        throw std::runtime_error(errmsg("create", path));
+    }
+    os.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    os.write(names.data(), names.size());
+    os.write(reinterpret_cast<const char*>(t.records.data()),
+             t.records.size() * sizeof(TraceRecord));
+    if (!os.flush()) {
+        throw std::runtime_error(errmsg("write", path));
+    }
+}
+
+TraceFile readTrace(const std::string& path) {
+    std::ifstream is(path, std::ios::binary);
+    if (!is) {
+        throw std::runtime_error(errmsg("open", path));
+    }
+
+    Header h;
+    if (!is.read(reinterpret_cast<char*>(&h), sizeof(h)) ||
+        std::memcmp(h.magic, MAGIC, sizeof(MAGIC)) != 0) {
+        throw std::runtime_error(path + " is not a moros trace");
+    }
+    if (h.version != VERSION || h.record_size != sizeof(TraceRecord)) {
+        throw std::runtime_error(path + " has an unsupported trace version");
+    }
+
+    TraceFile t;
+    t.start = h.start;
+    t.wall = h.wall;
+    t.dropped = h.dropped;
+
+    std::string names(h.names, '\0');
+    t.records.resize(h.records);
+    if (!is.read(&names[0], names.size()) ||
+        !is.read(reinterpret_cast<char*>(t.records.data()),
+                 t.records.size() * sizeof(TraceRecord))) {
+        throw std::runtime_error(path + " is truncated");
+    }
+    for (std::size_t pos = 0, nl; (nl = names.find('\n', pos)) != std::string::npos;
+         pos = nl + 1) {
+        t.endpoints.push_back(names.substr(pos, nl - pos));
+    }
+    return t;
+}
+
+void traceCsv(std::ostream& os, const TraceFile& t) {
+    os << "start_us,thread,conn,endpoint,status,bytes,connect_us,wait_us,ttfb_us,"
+          "transfer_us,latency_us\n";
+    for (const auto& r : t.records) {
+        os << since(r.start, t.start) << ',' << r.thread << ',' << r.conn << ','
+           << csvField(endpointName(t, r.endpoint)) << ',' << r.status << ',' << r.bytes
+           << ',' << r.connect << ',' << r.wait << ',' << r.ttfb << ',' << r.transfer
+           << ',' << r.latency() << '\n';
+    }
+}
+
+void traceChrome(std::ostream& os, const TraceFile& t) {
+    os << "{\"displayTimeUnit\":\"ms\",\"otherData\":{\"start_unix_us\":" << t.wall
+       << ",\"dropped\":" << t.dropped << "},\"traceEvents\":[";
+
+    bool first = true;
+    const auto event = [&](const char* name, const std::string& label, const TraceRecord& r,
+                           std::int64_t ts, std::uint64_t dur,
+                           const std::function<void()>& args) {
+        os << (first ? "\n" : ",\n") << "{\"name\":" << (label.empty() ? jsonString(name) : label)
+           << ",\"cat\":\"" << name << "\",\"ph\":\"X\",\"pid\":" << r.thread
+           << ",\"tid\":" << r.conn << ",\"ts\":" << ts << ",\"dur\":" << dur;
+        if (args) {
+            os << ",\"args\":{";
+            args();
+            os << '}';
+        }
+        os << '}';
+        first = false;
+    };
+
+    std::vector<std::uint16_t> threads;
+    for (const auto& r : t.records) {
+        threads.push_back(r.thread);
+
+        const std::int64_t start = since(r.start, t.start);
+        if (r.connect) {
+            event("connect", "", r, start - r.connect, r.connect, nullptr);
+        }
+        // 请求包含等待, 之下依次是各阶段
+        event("request", jsonString(endpointName(t, r.endpoint)), r, start - r.wait,
+              r.latency(), [&] {
+                  os << "\"status\":" << r.status << ",\"bytes\":" << r.bytes;
+              });
+        if (r.wait) {
+            event("wait", "", r, start - r.wait, r.wait, nullptr);
+        }
+        event("ttfb", "", r, start, r.ttfb, nullptr);
+        event("transfer", "", r, start + r.ttfb, r.transfer, nullptr);
+    }
+
+    std::sort(threads.begin(), threads.end());
+    threads.erase(std::unique(threads.begin(), threads.end()), threads.end());
+    for (auto thread : threads) {
+        os << (first ? "\n" : ",\n") << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":"
+           << thread << ",\"args\":{\"name\":\"bencher " << thread << "\"}}";
+        first = false;
+    }
+    os << "\n]}\n";
+}
+
+void reportSlowest(std::ostream& os, const std::vector<SlowRequest>& slowest,
+                   std::uint64_t start, const std::vector<std::string>& endpoints) {
+    if (slowest.empty()) {
+        return;
+    }
+
+    os << "  Slowest Requests" << '\n'
+       << "     Latency        At  Thread    Conn  Status    Bytes   Connect      Wait"
+          "      TTFB  Transfer  Request"
+       << '\n';
+    for (const auto& s : slowest) {
+        const TraceRecord& r = s.record;
+        const std::int64_t at = since(r.start, start);
+        os << std::right << std::setw(12) << us(r.latency())
+           << std::setw(10) << str(boost::format("%.3fs") % (at / 1e6))
+           << std::setw(8) << r.thread
+           << std::setw(8) << r.conn
+           << std::setw(8) << r.status
+           << std::setw(9) << numfmt(static_cast<double>(r.bytes))
+           << std::setw(10) << us(r.connect)
+           << std::setw(10) << us(r.wait)
+           << std::setw(10) << us(r.ttfb)
+           << std::setw(10) << us(r.transfer)
+           << "  " << (r.endpoint < endpoints.size() && endpoints.size() > 1
+                           ? "[" + endpoints[r.endpoint] + "] "
+                           : "")
+           << s.request << '\n';
+    }
+}
+
+}
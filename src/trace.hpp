@@ -0,0 +1,137 @@
+#ifndef MOROS_TRACE_HPP_
+#define MOROS_TRACE_HPP_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <vector>
+
+// --trace 与 --slowest: bencher 线程为每个完成的请求写一条定长记录,
+// 最近的若干条留在环形缓冲中, 结束时写入二进制文件; 另外保留最慢的
+// 若干个请求及其请求行. 由 moros-trace 转换为 Chrome trace 或 CSV
+
+namespace moros {
+
+// 一个完成的请求, 时长均为 us
+struct TraceRecord {
+    // 请求发出的时刻, 自 steady_clock 的起点起
+    std::uint64_t start;
+    // 全局的连接编号, 与 {{seq}} 的初始值相同
+    std::uint32_t conn;
+    // 响应的字节数. HTTP/1.1 含 header, HTTP/2 为 header block 与 DATA
+    std::uint32_t bytes;
+    // 连接上的第一个请求记下建立连接与 TLS 握手的耗时, 之后为 0
+    std::uint32_t connect;
+    // 开环时从计划时间到实际发出的等待
+    std::uint32_t wait;
+    std::uint32_t ttfb;
+    std::uint32_t transfer;
+    std::uint16_t endpoint;
+    std::uint16_t status;
+    std::uint16_t thread;
+    std::uint16_t reserved;
+
+    // 与 latency 统计的口径相同, 开环时含等待
+    std::uint64_t latency() const noexcept {
+        return std::uint64_t(wait) + ttfb + transfer;
+    }
+};
+static_assert(sizeof(TraceRecord) == 40, "TraceRecord is written to the trace file as is");
+
+// 超过 uint32 的时长按上限记录
+std::uint32_t traceMicros(std::chrono::steady_clock::duration d) noexcept;
+
+// 单写者的环形缓冲, 写满后覆盖最旧的记录. 写入只有一次复制与一次
+// release store. 其它线程可随时读取, 读取期间可能已被覆盖的记录丢弃
+class TraceRing {
+public:
+    // capacity 向上取整为 2 的幂
+    explicit TraceRing(std::size_t capacity);
+
+    // bencher 线程
+    void push(const TraceRecord& r) noexcept {
+        const std::uint64_t head = head_.load(std::memory_order_relaxed);
+        buf_[head & mask_] = r;
+        head_.store(head + 1, std::memory_order_release);
+    }
+
+    // 把仍保留的记录由旧到新追加到 out
+    void snapshot(std::vector<TraceRecord>& out) const;
+
+    // 写入过的总数, 超出容量的部分已被覆盖
+    std::uint64_t pushed() const noexcept {
+        return head_.load(std::memory_order_acquire);
+    }
+
+    std::size_t capacity() const noexcept {
+        return buf_.size();
+    }
+
+private:
+    std::vector<TraceRecord> buf_;
+    std::size_t mask_;
+    std::atomic<std::uint64_t> head_{0};
+};
+
+struct SlowRequest {
+    TraceRecord record;
+    // 请求的第一行
+    std::string request;
+};
+
+// latency 最大的 n 个请求, 小顶堆. 多数请求只与堆顶比较一次
+class SlowestRequests {
+public:
+    explicit SlowestRequests(std::size_t n);
+
+    // 能否进入前 n 个, 能时才需要取出请求行
+    bool qualifies(std::uint64_t latency) const noexcept {
+        return heap_.size() < n_ ||
+               (n_ && latency > heap_.front().record.latency());
+    }
+
+    // request 为完整的请求, 只保留第一行
+    void add(const TraceRecord& r, const std::string& request);
+
+    void merge(const SlowestRequests& other);
+
+    // 由慢到快
+    std::vector<SlowRequest> sorted() const;
+
+private:
+    std::size_t n_;
+    std::vector<SlowRequest> heap_;
+};
+
+// 二进制 trace 文件的内容. 文件依次是定长的 header, 以 '\n' 结尾的各
+// endpoint 名称, 按 start 排序的记录, 字节序与写入的机器相同
+struct TraceFile {
+    // 测试开始时的 steady_clock 时刻与 unix 时间, us
+    std::uint64_t start = 0;
+    std::int64_t wall = 0;
+    std::vector<std::string> endpoints;
+    std::vector<TraceRecord> records;
+    // 已被覆盖而未能写入的记录数
+    std::uint64_t dropped = 0;
+};
+
+// 失败时抛出 std::runtime_error
+void writeTrace(const std::string& path, const TraceFile& t);
+TraceFile readTrace(const std::string& path);
+
+// 每个请求一行, 时间相对测试开始
+void traceCsv(std::ostream& os, const TraceFile& t);
+
+// Chrome trace event 格式的 JSON, 可由 chrome://tracing 或 Perfetto 打开.
+// 每个 bencher 为一个进程, 每个连接为一个线程, 请求之下嵌套各阶段
+void traceChrome(std::ostream& os, const TraceFile& t);
+
+// 报告中最慢请求的表格, start 为测试开始的 steady_clock 时刻, us
+void reportSlowest(std::ostream& os, const std::vector<SlowRequest>& slowest,
+                   std::uint64_t start, const std::vector<std::string>& endpoints);
+
+}
+
+#endif
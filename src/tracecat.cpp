@@ -0,0 +1,71 @@
+// moros-trace: 把 --trace 写出的二进制文件转换为 CSV 或 Chrome trace.
+// 多个文件 (例如各 worker 的) 合并输出, 时间以最早开始的为起点
+#include "trace.hpp"
+#include <algorithm>
+#include <iostream>
+#include <vector>
+#include <boost/program_options.hpp>
+
+int main(int argc, char* argv[]) {
+    namespace po = boost::program_options;
+
+    std::string format;
+    std::vector<std::string> files;
+
+    po::options_description desc("Options");
+    desc.add_options()
+        ("help,h", "Print this help message")
+        ("format,f", po::value<std::string>(&format)->default_value("chrome"), "Output format: chrome (trace event JSON for chrome://tracing or Perfetto) or csv")
+        ("file", po::value<std::vector<std::string>>(&files), "Files written by moros --trace, merged into one output");
+
+    po::positional_options_description pos;
+    pos.add("file", -1);
+
+    po::variables_map vm;
+    try {
+        po::store(po::command_line_parser(argc, argv).options(desc).positional(pos).run(), vm);
+        po::notify(vm);
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+    if (vm.count("help") || files.empty() || (format != "chrome" && format != "csv")) {
+        std::cerr << "Usage: " << argv[0] << " [options] <file>..." << '\n'
+                  << desc << '\n';
+        return vm.count("help") ? 0 : -1;
+    }
+
+    moros::TraceFile merged;
+    try {
+        for (std::size_t i = 0; i < files.size(); ++i) {
+            moros::TraceFile t = moros::readTrace(files[i]);
+            if (i == 0 || t.start < merged.start) {
+                merged.start = t.start;
+                merged.wall = t.wall;
+            }
+            if (merged.endpoints.empty()) {
+                merged.endpoints = std::move(t.endpoints);
+            }
+            merged.dropped += t.dropped;
+            merged.records.insert(merged.records.end(), t.records.begin(), t.records.end());
+        }
+    } catch (const std::exception& e) {
+        std::cerr << e.what() << '\n';
+        return -1;
+    }
+    std::stable_sort(merged.records.begin(), merged.records.end(),
+                     [](const moros::TraceRecord& lhs, const moros::TraceRecord& rhs) {
+                         return lhs.start < rhs.start;
+                     });
+
+    if (merged.dropped) {
+        std::cerr << merged.dropped << " earlier requests were overwritten, raise "
+                  << "--trace-size to keep them" << '\n';
+    }
+    if (format == "csv") {
+        moros::traceCsv(std::cout, merged);
+    } else {
+        moros::traceChrome(std::cout, merged);
+    }
+    return 0;
+}
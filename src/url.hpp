@@ -0,0 +1,68 @@
+#ifndef MOROS_URL_HPP_
+#define MOROS_URL_HPP_
+
+#include <string>
+#include <cstring>
+#include <strings.h>
+
+#include <netdb.h>
+#include <sys/un.h>
+#include <sys/socket.h>
+
+namespace moros {
+
+// 经 Unix socket 连接的目标:
+//   http+unix:///path/to.sock:/uri
+//   https+unix:///path/to.sock:/uri
+// 省略 :/uri 时为 /
+struct UnixUrl {
+    std::string schema; // http 或 https
+    std::string path;   // socket 文件
+    std::string uri;    // path 与 query
+};
+
+// 不是 +unix 形式的 url 返回 false
+inline bool parseUnixUrl(const std::string& url, UnixUrl& out) {
+    const std::size_t sep = url.find("+unix://");
+    if (sep == std::string::npos) {
+        return false;
+    }
+
+    const std::string schema = url.substr(0, sep);
+    if (::strcasecmp(schema.c_str(), "http") != 0 &&
+        ::strcasecmp(schema.c_str(), "https") != 0) {
+        return false;
+    }
+
+    const std::string rest = url.substr(sep + std::strlen("+unix://"));
+    const std::size_t colon = rest.find(':');
+    out.schema = schema;
+    out.path = rest.substr(0, colon);
+    out.uri = colon == std::string::npos ? "/" : rest.substr(colon + 1);
+
+    return !out.path.empty() && out.uri.compare(0, 1, "/") == 0;
+}
+
+// 构造可交给 Bencher 的地址, sun 须比返回值活得久.
+// 路径超出 sun_path 时返回 false
+inline bool unixAddr(const std::string& path, struct sockaddr_un& sun,
+                     struct addrinfo& addr) noexcept {
+    if (path.size() >= sizeof(sun.sun_path)) {
+        return false;
+    }
+
+    sun = {};
+    sun.sun_family = AF_UNIX;
+    std::memcpy(sun.sun_path, path.c_str(), path.size() + 1);
+
+    addr = {};
+    addr.ai_family = AF_UNIX;
+    addr.ai_socktype = SOCK_STREAM;
+    addr.ai_addr = reinterpret_cast<struct sockaddr*>(&sun);
+    addr.ai_addrlen = sizeof(sun);
+    return true;
+}
+
+}
+
+#endif
@@ -0,0 +1,74 @@
+#define BOOST_TEST_MODULE BALANCE
+#include "balance.hpp"
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+// 在上一次的基础上推进一个周期: 每个连接完成 rate 个请求, 100 次 tick
+// 平均晚 lag us
+void advance(std::vector<moros::BencherLoad>& loads, const std::vector<double>& rate,
+             const std::vector<std::uint64_t>& lag) {
+    for (std::size_t i = 0; i < loads.size(); ++i) {
+        loads[i].completes += static_cast<std::uint64_t>(rate[i] * loads[i].connections);
+        loads[i].ticks += 100;
+        loads[i].lag_us += lag[i] * 100;
+    }
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(moves_from_lagging_bencher) {
+    moros::Balancer balancer;
+    std::vector<moros::BencherLoad> loads(3, {0, 40, 0, 0});
+    moros::Migration m;
+
+    // 第一次只记下状态
+    BOOST_TEST(!balancer.decide(loads, m));
+
+    // bencher 1 每个连接的吞吐只有一半, timer 平均晚 5ms
+    advance(loads, {100, 50, 90}, {100, 5000, 200});
+    BOOST_REQUIRE(balancer.decide(loads, m));
+    BOOST_TEST(m.from == 1u);
+    BOOST_TEST(m.to == 0u);
+    // 差距的一半是 10 个, 不超过 1/4
+    BOOST_TEST(m.count == 10u);
+    BOOST_TEST(balancer.moved() == 10u);
+
+    // 迁移后的一个周期不比较
+    loads[1].connections -= 10;
+    loads[0].connections += 10;
+    advance(loads, {100, 50, 90}, {100, 5000, 200});
+    BOOST_TEST(!balancer.decide(loads, m));
+
+    advance(loads, {100, 50, 90}, {100, 5000, 200});
+    BOOST_REQUIRE(balancer.decide(loads, m));
+    BOOST_TEST(m.from == 1u);
+    BOOST_TEST(m.count == 7u);
+}
+
+BOOST_AUTO_TEST_CASE(balanced_or_not_lagging) {
+    moros::Balancer balancer;
+    std::vector<moros::BencherLoad> loads(2, {0, 10, 0, 0});
+    moros::Migration m;
+    balancer.decide(loads, m);
+
+    // 差距在阈值以内
+    advance(loads, {100, 85}, {100, 5000});
+    BOOST_TEST(!balancer.decide(loads, m));
+
+    // 吞吐低但 event loop 不忙, 慢在服务端, 迁移没有帮助
+    advance(loads, {100, 20}, {100, 150});
+    BOOST_TEST(!balancer.decide(loads, m));
+    advance(loads, {100, 20}, {1000, 1500});
+    BOOST_TEST(!balancer.decide(loads, m));
+
+    // 只剩一个连接时不再移出
+    loads[1].connections = 1;
+    advance(loads, {100, 20}, {100, 5000});
+    BOOST_TEST(!balancer.decide(loads, m));
+    BOOST_TEST(balancer.moved() == 0u);
+
+    // 数量变化时重新开始
+    std::vector<moros::BencherLoad> one(1, {0, 10, 0, 0});
+    BOOST_TEST(!balancer.decide(one, m));
+}
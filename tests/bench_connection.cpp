@@ -0,0 +1,207 @@
+// 对比 Connection 的编译期特化与旧的虚函数 + 运行时插件判断的单请求开销,
+// 以及加载插件后解析器回调与插件 hook 的开销
+#include "connection.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <benchmark/benchmark.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+std::unique_ptr<moros::Stats> requests = std::make_unique<moros::Stats>(1000000);
+std::unique_ptr<moros::Stats> latency = std::make_unique<moros::Stats>(2000);
+
+namespace {
+
+const char response[] = "HTTP/1.1 200 OK\r\n"
+                        "Content-Length: 13\r\n"
+                        "Connection: keep-alive\r\n"
+                        "\r\n"
+                        "Hello, world!";
+
+// 内存中的 transport: 写入即丢弃, 每个请求读到一份固定响应
+class MemTransport {
+public:
+    explicit MemTransport(const moros::SslContext*) noexcept {}
+
+    bool handshake(int, const std::string&) noexcept {
+        return true;
+    }
+
+    int read(int, char buf[], std::size_t len) noexcept {
+        if (!pending_) {
+            errno = EAGAIN;
+            return -1;
+        }
+        pending_ = false;
+
+        const std::size_t n = std::min(len, sizeof(response) - 1);
+        std::memcpy(buf, response, n);
+        return n;
+    }
+
+    int write(int, const char buf[], std::size_t len) noexcept {
+        benchmark::DoNotOptimize(buf);
+        pending_ = true;
+        return len;
+    }
+
+    void timestamping(int) noexcept {}
+
+    bool wire(std::chrono::nanoseconds&) noexcept {
+        return false;
+    }
+
+    int close() noexcept {
+        return 0;
+    }
+
+private:
+    bool pending_ = false;
+};
+
+// 模拟旧实现: 经由虚函数收发
+class Stream {
+public:
+    virtual ~Stream() = default;
+
+    virtual int read(int fd, char buf[], std::size_t len) noexcept = 0;
+    virtual int write(int fd, const char buf[], std::size_t len) noexcept = 0;
+};
+
+class MemStream : public Stream {
+public:
+    int read(int fd, char buf[], std::size_t len) noexcept override {
+        return mem_.read(fd, buf, len);
+    }
+
+    int write(int fd, const char buf[], std::size_t len) noexcept override {
+        return mem_.write(fd, buf, len);
+    }
+
+private:
+    MemTransport mem_{nullptr};
+};
+
+class VirtualMemTransport {
+public:
+    explicit VirtualMemTransport(const moros::SslContext*)
+        : stream_(std::make_unique<MemStream>()) {}
+
+    bool handshake(int, const std::string&) noexcept {
+        return true;
+    }
+
+    int read(int fd, char buf[], std::size_t len) noexcept {
+        return stream_->read(fd, buf, len);
+    }
+
+    int write(int fd, const char buf[], std::size_t len) noexcept {
+        return stream_->write(fd, buf, len);
+    }
+
+    void timestamping(int) noexcept {}
+
+    bool wire(std::chrono::nanoseconds&) noexcept {
+        return false;
+    }
+
+    int close() noexcept {
+        return 0;
+    }
+
+private:
+    std::unique_ptr<Stream> stream_;
+};
+
+std::uint64_t cycles() noexcept {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+double fastest(const std::vector<double>& v) {
+    return *std::min_element(v.begin(), v.end());
+}
+
+template <typename Transport, typename Hooks>
+void BM_Request(benchmark::State& state) {
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "localhost", "", "http", "", {});
+    moros::Config cfg = {};
+    struct addrinfo addr = {};
+    moros::Bencher bencher(cfg, 0, addr, "localhost", endpoints, nullptr, plugin);
+    moros::EventLoop ev_loop(1);
+
+    auto c = std::make_shared<moros::Connection<Transport, Hooks>>(
+        ev_loop, bencher, "localhost", nullptr, plugin);
+
+    const std::uint64_t begin = cycles();
+    for (auto _ : state) {
+        c->request();
+        c->response();
+    }
+    const std::uint64_t end = cycles();
+
+    state.counters["cycles/req"] = benchmark::Counter(
+        static_cast<double>(end - begin) / state.iterations());
+}
+
+#ifdef MOROS_BENCH_PLUGIN
+// 加载了需要 body 的插件: 解析器的 body 回调与 Plugin::response 都在路径上
+void BM_RequestWithPlugin(benchmark::State& state) {
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "localhost", "", "http", "", {});
+    plugin.load(MOROS_BENCH_PLUGIN);
+    moros::Config cfg = {};
+    struct addrinfo addr = {};
+    moros::Bencher bencher(cfg, 0, addr, "localhost", endpoints, nullptr, plugin);
+    moros::EventLoop ev_loop(1);
+
+    auto c = std::make_shared<moros::Connection<MemTransport, moros::PluginHooks>>(
+        ev_loop, bencher, "localhost", nullptr, plugin);
+
+    for (auto _ : state) {
+        c->request();
+        c->response();
+    }
+}
+
+// 单独的 Plugin::response: 拆分 header 并调用插件
+void BM_PluginResponse(benchmark::State& state) {
+    moros::Plugin plugin("http", "localhost", "", "http", "", {});
+    plugin.load(MOROS_BENCH_PLUGIN);
+
+    // Connection 收集的格式: name:value, 以 \x01 分隔
+    const std::string headers = "Content-Length:13\x01" "Connection:keep-alive";
+    const std::string body = "Hello, world!";
+    for (auto _ : state) {
+        plugin.response(200, headers, body);
+    }
+}
+#endif
+
+}
+
+// 各变体之间只差几个 ns, 均值与中位数易被同机的其它负载淹没,
+// 多次重复取最小值比较
+BENCHMARK_TEMPLATE(BM_Request, MemTransport, moros::NoHooks)
+    ->ComputeStatistics("min", fastest);
+BENCHMARK_TEMPLATE(BM_Request, MemTransport, moros::PluginHooks)
+    ->ComputeStatistics("min", fastest);
+BENCHMARK_TEMPLATE(BM_Request, VirtualMemTransport, moros::PluginHooks)
+    ->ComputeStatistics("min", fastest);
+#ifdef MOROS_BENCH_PLUGIN
+BENCHMARK(BM_RequestWithPlugin);
+BENCHMARK(BM_PluginResponse);
+#endif
+
+BENCHMARK_MAIN();
@@ -0,0 +1,50 @@
+// EventLoop 的分发开销: 每次 poll 有 N 个 fd 就绪
+#include "ev.hpp"
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <sys/eventfd.h>
+
+namespace {
+
+void BM_EventLoopDispatch(benchmark::State& state) {
+    const std::size_t n = state.range(0);
+    moros::EventLoop ev_loop(n);
+
+    // 每个回调取走计数后立即再次写入, 下一次 poll 时仍然就绪
+    std::vector<int> fds;
+    for (std::size_t i = 0; i < n; ++i) {
+        const int fd = ::eventfd(1, EFD_NONBLOCK);
+        fds.push_back(fd);
+        ev_loop.addEvent(fd, moros::Mask::READABLE, [fd] {
+            std::uint64_t v;
+            (void)::read(fd, &v, sizeof(v));
+            v = 1;
+            (void)::write(fd, &v, sizeof(v));
+        });
+    }
+
+    for (auto _ : state) {
+        ev_loop.poll(std::chrono::milliseconds(0));
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+
+    for (int fd : fds) {
+        ev_loop.delEvent(fd, moros::Mask::READABLE);
+        ::close(fd);
+    }
+}
+
+void BM_EventLoopIdle(benchmark::State& state) {
+    moros::EventLoop ev_loop(1);
+
+    for (auto _ : state) {
+        ev_loop.poll(std::chrono::milliseconds(0));
+    }
+}
+
+}
+
+BENCHMARK(BM_EventLoopDispatch)->Arg(1)->Arg(16)->Arg(256);
+// 没有就绪事件时只有一次 epoll_wait
+BENCHMARK(BM_EventLoopIdle);
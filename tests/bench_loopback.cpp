@@ -0,0 +1,78 @@
+// 端到端: 一个 bencher 经 localhost TCP 对进程内的内置服务施压, 报告 Req/Sec.
+// 服务与 bencher 共享 CPU, 数值只用于同一台机器上不同版本之间的比较
+#include "bencher.hpp"
+#include "server.hpp"
+#include <thread>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+void BM_Loopback(benchmark::State& state) {
+    // 内置服务, 回复 13 字节的 body
+    moros::ServerConfig scfg;
+    scfg.loopback = true;
+    scfg.response_size = 13;
+    moros::Server server(scfg);
+    server.start();
+
+    struct sockaddr_in sin = {};
+    sin.sin_family = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port = htons(server.port());
+
+    struct addrinfo addr = {};
+    addr.ai_family = AF_INET;
+    addr.ai_socktype = SOCK_STREAM;
+    addr.ai_addr = reinterpret_cast<struct sockaddr*>(&sin);
+    addr.ai_addrlen = sizeof(sin);
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+    moros::Config cfg = {};
+    cfg.threads = 1;
+    cfg.connections = state.range(0);
+    cfg.timeout = std::chrono::seconds(2);
+    cfg.protocol = moros::Protocol::HTTP1;
+
+    moros::Plugin plugin("http", "localhost", "", "http", "", {});
+    moros::Bencher bencher(cfg, 0, addr, "localhost", endpoints, nullptr, plugin);
+    std::thread t([&] { bencher.run(); });
+
+    // 每次迭代等待一批请求完成, 长时间没有进展视为失败
+    const std::uint64_t batch = 1000;
+    const auto& m = moros::Metrics::getInstance();
+    std::uint64_t done = m[moros::Metrics::Kind::COMPLETES];
+    for (auto _ : state) {
+        const std::uint64_t target = done + batch;
+        auto progress = std::chrono::steady_clock::now();
+        while (done < target) {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+
+            const std::uint64_t cur = m[moros::Metrics::Kind::COMPLETES];
+            if (cur != done) {
+                done = cur;
+                progress = std::chrono::steady_clock::now();
+            } else if (std::chrono::steady_clock::now() - progress > std::chrono::seconds(5)) {
+                break;
+            }
+        }
+        if (done < target) {
+            state.SkipWithError("no response from the loopback server");
+            break;
+        }
+    }
+
+    bencher.stop();
+    t.join();
+    state.SetItemsProcessed(state.iterations() * batch);
+}
+
+}
+
+BENCHMARK(BM_Loopback)->Arg(1)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
@@ -0,0 +1,59 @@
+// Stats 的记录与读取: record 在每个请求完成时被调用 4 次
+#include "stats.hpp"
+#include <random>
+#include <vector>
+#include <benchmark/benchmark.h>
+
+namespace {
+
+// 固定 seed 的 latency 样本, 大部分落在精确记录区间, 少数落在长尾
+std::vector<std::uint64_t> samples(std::uint64_t max) {
+    std::mt19937_64 rng(42);
+    std::lognormal_distribution<double> dist(3, 1.5);
+
+    std::vector<std::uint64_t> xs(4096);
+    for (auto& x : xs) {
+        x = std::min<std::uint64_t>(dist(rng), max - 1);
+    }
+    return xs;
+}
+
+void BM_StatsRecord(benchmark::State& state) {
+    static moros::Stats st(2000000);
+    const auto xs = samples(st.highest());
+
+    std::size_t i = 0;
+    for (auto _ : state) {
+        st.record(xs[i++ & (xs.size() - 1)]);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_StatsMerge(benchmark::State& state) {
+    moros::Stats from(2000000), to(2000000);
+    for (auto x : samples(from.highest())) {
+        from.record(x);
+    }
+
+    for (auto _ : state) {
+        to.merge(from);
+    }
+}
+
+void BM_StatsDerank(benchmark::State& state) {
+    moros::Stats st(2000000);
+    for (auto x : samples(st.highest())) {
+        st.record(x);
+    }
+
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(st.derank(0.99));
+    }
+}
+
+}
+
+// 多个 bencher 线程同时记录到全局的 latency 直方图
+BENCHMARK(BM_StatsRecord)->Threads(1)->Threads(4);
+BENCHMARK(BM_StatsMerge);
+BENCHMARK(BM_StatsDerank);
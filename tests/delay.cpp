@@ -0,0 +1,59 @@
+#define BOOST_TEST_MODULE DELAY
+#include "delay.hpp"
+#include <fstream>
+#include <set>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+BOOST_AUTO_TEST_CASE(delay_spec) {
+    std::mt19937_64 rng(1);
+
+    BOOST_CHECK(moros::DelayDistribution().none());
+    BOOST_CHECK_EQUAL(moros::DelayDistribution("fixed:1.5")(rng).count(), 1500);
+
+    const moros::DelayDistribution uniform("uniform:1,2");
+    for (int i = 0; i < 100; ++i) {
+        const auto d = uniform(rng).count();
+        BOOST_CHECK(d >= 1000 && d <= 2000);
+    }
+
+    const moros::DelayDistribution exp("exp:2");
+    double sum = 0;
+    for (int i = 0; i < 10000; ++i) {
+        sum += exp(rng).count();
+    }
+    BOOST_CHECK_CLOSE(sum / 10000, 2000, 5);
+
+    for (const char* bad : {"fixed", "fixed:", "fixed:-1", "fixed:1,2", "uniform:2,1",
+                            "exp:0", "normal:1", "fixed:1ms"}) {
+        BOOST_CHECK_THROW(moros::DelayDistribution{bad}, std::invalid_argument);
+    }
+}
+
+// 经验分布只会取到文件中的样本
+BOOST_AUTO_TEST_CASE(file_samples) {
+    const std::string path = "/tmp/moros-delay-" + std::to_string(::getpid());
+    std::ofstream(path) << "# think time\n1\n\n  2.5 \n10\n";
+
+    std::mt19937_64 rng(1);
+    const moros::DelayDistribution samples("file:" + path);
+    BOOST_CHECK(!samples.none());
+
+    std::set<long> seen;
+    for (int i = 0; i < 1000; ++i) {
+        seen.insert(samples(rng).count());
+    }
+    BOOST_CHECK((seen == std::set<long>{1000, 2500, 10000}));
+
+    // 拷贝共享样本
+    const moros::DelayDistribution copy = samples;
+    BOOST_CHECK_EQUAL(seen.count(copy(rng).count()), 1u);
+
+    std::ofstream(path) << "1\n-2\n";
+    BOOST_CHECK_THROW(moros::DelayDistribution("file:" + path), std::invalid_argument);
+    std::ofstream(path) << "# empty\n";
+    BOOST_CHECK_THROW(moros::DelayDistribution("file:" + path), std::invalid_argument);
+    ::unlink(path.c_str());
+    BOOST_CHECK_THROW(moros::DelayDistribution("file:" + path), std::invalid_argument);
+}
@@ -0,0 +1,230 @@
+#define BOOST_TEST_MODULE DISTRIBUTED
+#include "distributed.hpp"
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+using Kind = moros::Metrics::Kind;
+
+// 替身 agent: 在 localhost 上接受一个 coordinator, 第 id 个 agent 每个请求
+// 的 latency 均为 id + 1 ms
+class FakeAgent {
+public:
+    FakeAgent(std::size_t id, std::size_t intervals) : id_(id) {
+        lfd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(lfd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        ::listen(lfd_, 1);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(lfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        thread_ = std::thread([this, intervals] { serve(intervals); });
+    }
+
+    ~FakeAgent() {
+        thread_.join();
+        ::close(lfd_);
+    }
+
+    std::string address() const {
+        return "127.0.0.1:" + std::to_string(port_);
+    }
+
+    const std::vector<std::string>& args() const noexcept {
+        return args_;
+    }
+
+private:
+    void serve(std::size_t intervals) {
+        moros::AgentSession session(::accept(lfd_, nullptr, nullptr));
+        args_ = session.args("secret");
+        session.start();
+
+        std::uint64_t counters[static_cast<std::size_t>(Kind::MAX)] = {};
+        moros::Stats total(2000);
+        for (std::size_t i = 1; i <= intervals; ++i) {
+            moros::Stats st(2000);
+            std::uint64_t delta[static_cast<std::size_t>(Kind::MAX)] = {};
+            delta[static_cast<std::size_t>(Kind::COMPLETES)] = 10;
+            delta[static_cast<std::size_t>(Kind::EREAD)] = id_;
+            for (int n = 0; n < 10; ++n) {
+                st.record(id_ + 1);
+            }
+            session.interval(std::chrono::milliseconds(1000 * i),
+                             std::chrono::milliseconds(1000),
+                             moros::encodeSnapshot(delta, st));
+
+            for (std::size_t k = 0; k < static_cast<std::size_t>(Kind::MAX); ++k) {
+                counters[k] += delta[k];
+            }
+            total.merge(st);
+        }
+
+        moros::Stats requests(1000000);
+        requests.record(10);
+
+        // 一个 bencher 与一个 endpoint, 结果与汇总相同
+        std::vector<moros::Stats> phases(static_cast<std::size_t>(moros::Phase::MAX),
+                                         moros::Stats(2000000));
+        phases[static_cast<std::size_t>(moros::Phase::CONNECT)].record(100 * (id_ + 1));
+
+        const std::string snap = moros::encodeSnapshot(counters, total);
+        session.done(std::chrono::milliseconds(1000 * intervals + id_), requests,
+                     snap, {snap}, {snap}, phases);
+    }
+
+    const std::size_t id_;
+    int lfd_;
+    std::uint16_t port_;
+    std::thread thread_;
+    std::vector<std::string> args_;
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_roundtrip) {
+    moros::Metrics m;
+    m.count(Kind::COMPLETES, 3);
+    m.count(Kind::BYTES, 300);
+
+    moros::Stats st(2000);
+    st.record(7);
+    st.record(1500);
+
+    auto snap = moros::Snapshot::decode(moros::encodeSnapshot(m, st));
+    BOOST_CHECK_EQUAL(snap[Kind::COMPLETES], 3u);
+    BOOST_CHECK_EQUAL(snap[Kind::BYTES], 300u);
+    BOOST_REQUIRE(snap.latency);
+    BOOST_CHECK_EQUAL(snap.latency->count(), 2u);
+    BOOST_CHECK_EQUAL(snap.latency->max(), 1500);
+
+    snap.merge(moros::Snapshot::decode(moros::encodeSnapshot(m, st)));
+    BOOST_CHECK_EQUAL(snap[Kind::COMPLETES], 6u);
+    BOOST_CHECK_EQUAL(snap.latency->count(), 4u);
+
+    BOOST_CHECK_THROW(moros::Snapshot::decode("1 2 3"), std::runtime_error);
+    BOOST_CHECK_THROW(moros::Snapshot::decode("1 2 3 4 5 6 7 HISTFAAAA"), std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(coordinate_localhost_agents) {
+    const std::size_t nagents = 3, intervals = 2;
+
+    std::vector<std::unique_ptr<FakeAgent>> agents;
+    std::vector<std::string> addrs;
+    for (std::size_t i = 0; i < nagents; ++i) {
+        agents.push_back(std::make_unique<FakeAgent>(i, intervals));
+        addrs.push_back(agents.back()->address());
+    }
+
+    moros::Coordinator coord(addrs, "secret");
+    BOOST_CHECK_EQUAL(coord.size(), nagents);
+
+    const std::vector<std::string> args = {"http://127.0.0.1/", "-d", "2", "-i", "1"};
+    const auto begin = std::chrono::steady_clock::now();
+    coord.start(args, std::chrono::milliseconds(100));
+
+    for (std::size_t i = 1; i <= intervals; ++i) {
+        std::chrono::milliseconds elapsed, span;
+        const auto snap = coord.interval(elapsed, span);
+        BOOST_CHECK_EQUAL(elapsed.count(), 1000 * i);
+        BOOST_CHECK_EQUAL(span.count(), 1000);
+        BOOST_CHECK_EQUAL(snap[Kind::COMPLETES], 10 * nagents);
+        BOOST_CHECK_EQUAL(snap[Kind::EREAD], 0u + 1 + 2);
+        BOOST_CHECK_EQUAL(snap.latency->count(), 10 * nagents);
+        BOOST_CHECK_EQUAL(snap.latency->max(), nagents);
+    }
+
+    // 约定的开始时间之前 agent 不会发送任何 interval
+    BOOST_CHECK(std::chrono::steady_clock::now() - begin >= std::chrono::milliseconds(100));
+
+    const auto res = coord.finish();
+    BOOST_CHECK_EQUAL(res.runtime.count(), 1000 * intervals + nagents - 1);
+    BOOST_CHECK_EQUAL(res.total[Kind::COMPLETES], 10 * nagents * intervals);
+    BOOST_CHECK_EQUAL(res.total.latency->count(), 10 * nagents * intervals);
+    BOOST_CHECK_EQUAL(res.total.latency->derank(0.5), 2u);
+    BOOST_REQUIRE(res.requests);
+    BOOST_CHECK_EQUAL(res.requests->count(), nagents);
+    BOOST_CHECK_EQUAL(res.threads.size(), nagents);
+    BOOST_REQUIRE_EQUAL(res.endpoints.size(), 1u);
+    BOOST_CHECK_EQUAL(res.endpoints[0][Kind::COMPLETES], 10 * nagents * intervals);
+    BOOST_REQUIRE_EQUAL(res.phases.size(), static_cast<std::size_t>(moros::Phase::MAX));
+    BOOST_CHECK_EQUAL(res.phases[static_cast<std::size_t>(moros::Phase::CONNECT)]->count(), nagents);
+    BOOST_CHECK_EQUAL(res.phases[static_cast<std::size_t>(moros::Phase::CONNECT)]->max(), 100 * nagents);
+    BOOST_CHECK_EQUAL(res.phases[static_cast<std::size_t>(moros::Phase::TLS)]->count(), 0u);
+
+    for (const auto& a : agents) {
+        BOOST_CHECK(a->args() == args);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(unreachable_agent) {
+    BOOST_CHECK_THROW(moros::Coordinator({"127.0.0.1"}, "secret"), std::runtime_error);
+    BOOST_CHECK_THROW(moros::Coordinator({"127.0.0.1:1"}, "secret"), std::runtime_error);
+}
+
+// 未给出地址时只在 loopback 上监听
+BOOST_AUTO_TEST_CASE(agent_listen_address) {
+    for (const char* listen : {"0", "127.0.0.1:0", "[::1]:0"}) {
+        int lfd = -1;
+        try {
+            lfd = moros::listenAgent(listen);
+        } catch (const std::runtime_error&) {
+            // 没有 IPv6 的环境
+            BOOST_CHECK_EQUAL(std::string(listen), "[::1]:0");
+            continue;
+        }
+
+        struct sockaddr_storage addr = {};
+        socklen_t len = sizeof(addr);
+        BOOST_REQUIRE_EQUAL(::getsockname(lfd, reinterpret_cast<struct sockaddr*>(&addr), &len), 0);
+        if (addr.ss_family == AF_INET) {
+            const auto in = reinterpret_cast<const struct sockaddr_in*>(&addr);
+            BOOST_CHECK_EQUAL(ntohl(in->sin_addr.s_addr), INADDR_LOOPBACK);
+        } else {
+            const auto in6 = reinterpret_cast<const struct sockaddr_in6*>(&addr);
+            BOOST_CHECK(IN6_IS_ADDR_LOOPBACK(&in6->sin6_addr));
+        }
+        ::close(lfd);
+    }
+
+    for (const char* bad : {"", "x", "99999", "127.0.0.1:", ":9000", "127.0.0.1:9x"}) {
+        BOOST_CHECK_THROW(moros::listenAgent(bad), std::runtime_error);
+    }
+}
+
+// agent 在运行任何参数之前校验 token, 并限制参数的个数与长度
+BOOST_AUTO_TEST_CASE(agent_rejects_peer) {
+    const auto session = [](const std::vector<std::string>& lines) {
+        int sv[2];
+        BOOST_REQUIRE_EQUAL(::socketpair(AF_UNIX, SOCK_STREAM, 0, sv), 0);
+        moros::LineChannel coord(sv[0]);
+        for (const auto& l : lines) {
+            coord.write(l);
+        }
+        moros::AgentSession agent(sv[1]);
+        return agent.args("secret");
+    };
+
+    const auto args = session({"AUTH secret", "RUN 2", "http://127.0.0.1/", "-d"});
+    BOOST_CHECK(args == std::vector<std::string>({"http://127.0.0.1/", "-d"}));
+
+    BOOST_CHECK_THROW(session({"RUN 1", "-d"}), std::runtime_error);
+    BOOST_CHECK_THROW(session({"AUTH secreT", "RUN 1", "-d"}), std::runtime_error);
+    BOOST_CHECK_THROW(session({"AUTH ", "RUN 1", "-d"}), std::runtime_error);
+    BOOST_CHECK_THROW(session({"AUTH secret", "RUN 100000"}), std::runtime_error);
+    BOOST_CHECK_THROW(session({"AUTH secret", "RUN -1"}), std::runtime_error);
+    BOOST_CHECK_THROW(session({"AUTH secret", "RUN 1", std::string(5000, 'x')}),
+                      std::runtime_error);
+}
@@ -0,0 +1,16 @@
+#define BOOST_TEST_MODULE ESCAPE
+#include "escape.hpp"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(json_string) {
+    BOOST_CHECK_EQUAL(moros::jsonString("GET /"), "\"GET /\"");
+    BOOST_CHECK_EQUAL(moros::jsonString("a\"b\\c"), "\"a\\\"b\\\\c\"");
+    BOOST_CHECK_EQUAL(moros::jsonString("a\nb"), "\"a\\u000ab\"");
+}
+
+BOOST_AUTO_TEST_CASE(csv_field) {
+    BOOST_CHECK_EQUAL(moros::csvField("endpoint:GET /"), "endpoint:GET /");
+    BOOST_CHECK_EQUAL(moros::csvField("a,b"), "\"a,b\"");
+    BOOST_CHECK_EQUAL(moros::csvField("say \"hi\""), "\"say \"\"hi\"\"\"");
+    BOOST_CHECK_EQUAL(moros::csvField("a\r\nb"), "\"a\r\nb\"");
+}
@@ -0,0 +1,93 @@
+#define BOOST_TEST_MODULE EV
+#include "ev.hpp"
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+
+// 非阻塞的 pipe, 写入一个字节即令读端就绪
+struct Pipe {
+    Pipe() {
+        ::pipe2(fds, O_NONBLOCK);
+    }
+
+    ~Pipe() {
+        ::close(fds[0]);
+        ::close(fds[1]);
+    }
+
+    void kick() {
+        ::write(fds[1], "x", 1);
+    }
+
+    void drain() {
+        char c;
+        while (::read(fds[0], &c, 1) == 1) {
+        }
+    }
+
+    int fds[2];
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(events_per_wait) {
+    moros::EventLoop loop(8);
+
+    Pipe ps[3];
+    std::size_t calls = 0;
+    for (auto& p : ps) {
+        BOOST_REQUIRE(loop.addEvent(p.fds[0], moros::Mask::READABLE, [&] {
+            p.drain();
+            ++calls;
+        }));
+        p.kick();
+    }
+
+    loop.poll(std::chrono::milliseconds(100));
+    BOOST_CHECK_EQUAL(calls, 3u);
+
+    const auto& st = loop.stats();
+    BOOST_CHECK_EQUAL(st.events.count(), 1u);
+    BOOST_CHECK_EQUAL(st.events.max(), 3);
+    BOOST_CHECK_EQUAL(st.busy.count(), 1u);
+
+    // 超时返回不计入
+    loop.poll(std::chrono::milliseconds(1));
+    BOOST_CHECK_EQUAL(st.events.count(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(timer_lag) {
+    moros::EventLoop loop(8);
+
+    std::size_t ticks = 0;
+    const int tfd = loop.addTimerEvent(std::chrono::milliseconds(5), [&] { ++ticks; });
+    BOOST_REQUIRE_NE(tfd, -1);
+
+    // 一个耗时 30ms 的回调拖住 event loop, timer 只能迟到
+    Pipe p;
+    BOOST_REQUIRE(loop.addEvent(p.fds[0], moros::Mask::READABLE, [&] {
+        p.drain();
+        std::this_thread::sleep_for(std::chrono::milliseconds(30));
+    }));
+    p.kick();
+
+    const auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(1);
+    while (ticks < 3 && std::chrono::steady_clock::now() < deadline) {
+        loop.poll(std::chrono::milliseconds(10));
+    }
+    BOOST_REQUIRE_GE(ticks, 3u);
+
+    const auto& st = loop.stats();
+    BOOST_CHECK_EQUAL(st.lag.count(), ticks);
+    BOOST_CHECK_GE(st.lag.max(), 20000);
+    // 拖住期间错过的周期合并为一次, 之后恢复准时
+    BOOST_CHECK_LT(st.lag.derank(0.5), 5000u);
+    BOOST_CHECK_GE(st.busy.max(), 30000);
+    BOOST_CHECK_GE(st.busy_total.count(), 30000000);
+
+    loop.delTimerEvent(tfd);
+}
@@ -0,0 +1,672 @@
+#define BOOST_TEST_MODULE H2
+#include "h2.hpp"
+#include "hpack.hpp"
+#include "bencher.hpp"
+#include <algorithm>
+#include <csignal>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <boost/test/unit_test.hpp>
+
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <openssl/ssl.h>
+#include <openssl/x509.h>
+
+std::unique_ptr<moros::Stats> requests = std::make_unique<moros::Stats>(1000000);
+std::unique_ptr<moros::Stats> latency = std::make_unique<moros::Stats>(2000);
+
+namespace {
+
+std::string unhex(const std::string& s) {
+    std::string out;
+    for (std::size_t i = 0; i + 1 < s.size(); i += 2) {
+        out.push_back(static_cast<char>(std::stoi(s.substr(i, 2), nullptr, 16)));
+    }
+    return out;
+}
+
+std::vector<std::pair<std::string, std::string>> decode(moros::hpack::Decoder& d,
+                                                        const std::string& block) {
+    std::vector<std::pair<std::string, std::string>> hs;
+    BOOST_REQUIRE(d.decode(block.data(), block.size(),
+                           [&](const std::string& n, const std::string& v) {
+                               hs.emplace_back(n, v);
+                           }));
+    return hs;
+}
+
+// h2c 替身服务端: 凑齐 batch 个并发 stream 后才一起响应,
+// 客户端若不复用连接就会一直等待. frame_size 不为负时在 SETTINGS 中宣告,
+// greeting 中的帧紧随 SETTINGS 发出. goaway 为 true 时凑齐 batch 个 stream
+// 后先发出 GOAWAY, 只响应前一半的 stream 后关闭连接
+class H2cServer {
+public:
+    explicit H2cServer(std::size_t batch, std::int64_t frame_size = -1,
+                       std::string greeting = "", bool goaway = false)
+        : batch_(batch),
+          frame_size_(frame_size),
+          greeting_(std::move(greeting)),
+          goaway_after_(goaway) {
+        lfd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(lfd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        ::listen(lfd_, 16);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(lfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~H2cServer() {
+        stop_ = true;
+        ::shutdown(lfd_, SHUT_RDWR);
+        thread_.join();
+        ::close(lfd_);
+    }
+
+    std::string port() const {
+        return std::to_string(port_);
+    }
+
+    std::size_t maxConcurrent() const noexcept {
+        return max_concurrent_;
+    }
+
+    // 最近收到的 GOAWAY 的错误码, 未收到时为 -1
+    std::int64_t goaway() const noexcept {
+        return goaway_;
+    }
+
+    // 收到与响应的 stream 数
+    std::size_t requested() const noexcept {
+        return requested_;
+    }
+
+    std::size_t answered() const noexcept {
+        return answered_;
+    }
+
+private:
+    void serve() {
+        while (!stop_) {
+            const int fd = ::accept(lfd_, nullptr, nullptr);
+            if (fd == -1) {
+                return;
+            }
+
+            struct timeval tv = {0, 100000};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            handle(fd);
+            ::close(fd);
+        }
+    }
+
+    void handle(int fd) {
+        std::string in, out;
+        if (frame_size_ >= 0) {
+            moros::h2::writeFrameHeader(out, moros::h2::Frame::SETTINGS, 0, 0, 6);
+            moros::h2::writeSetting(out, moros::h2::Setting::MAX_FRAME_SIZE,
+                                    static_cast<std::uint32_t>(frame_size_));
+        } else {
+            moros::h2::writeFrameHeader(out, moros::h2::Frame::SETTINGS, 0, 0, 0);
+        }
+        out.append(greeting_);
+        ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+
+        std::vector<std::uint32_t> pending;
+        bool preface = false;
+        bool closing = false, shut = false;
+        char buf[4096];
+        while (!stop_) {
+            const ssize_t n = ::recv(fd, buf, sizeof(buf), 0);
+            if (n == 0) {
+                return;
+            } else if (n < 0) {
+                continue;
+            }
+            in.append(buf, n);
+
+            if (!preface) {
+                if (in.size() < sizeof(moros::h2::PREFACE) - 1) {
+                    continue;
+                }
+                if (in.compare(0, sizeof(moros::h2::PREFACE) - 1,
+                               moros::h2::PREFACE) != 0) {
+                    return;
+                }
+                in.erase(0, sizeof(moros::h2::PREFACE) - 1);
+                preface = true;
+            }
+
+            out.clear();
+            while (in.size() >= moros::h2::FRAME_HEADER_SIZE) {
+                const auto hdr = moros::h2::readFrameHeader(in.data());
+                if (in.size() < moros::h2::FRAME_HEADER_SIZE + hdr.length) {
+                    break;
+                }
+
+                if (hdr.type == moros::h2::Frame::SETTINGS &&
+                    !(hdr.flags & moros::h2::FLAG_ACK)) {
+                    moros::h2::writeFrameHeader(out, moros::h2::Frame::SETTINGS,
+                                                moros::h2::FLAG_ACK, 0, 0);
+                } else if (hdr.type == moros::h2::Frame::HEADERS &&
+                           (hdr.flags & moros::h2::FLAG_END_STREAM)) {
+                    pending.push_back(hdr.stream);
+                    ++requested_;
+                } else if (hdr.type == moros::h2::Frame::GOAWAY && hdr.length >= 8) {
+                    goaway_ = moros::h2::readU32(in.data() + moros::h2::FRAME_HEADER_SIZE + 4);
+                }
+                in.erase(0, moros::h2::FRAME_HEADER_SIZE + hdr.length);
+            }
+
+            max_concurrent_ = std::max(max_concurrent_.load(), pending.size());
+            if (pending.size() >= batch_ && !closing) {
+                std::size_t answer = pending.size();
+                if (goaway_after_) {
+                    answer /= 2;
+                    moros::h2::writeGoaway(out, pending[answer - 1], 0);
+                    closing = true;
+                }
+
+                // 0x88: indexed ":status: 200"
+                const char status = '\x88';
+                for (std::size_t i = 0; i < answer; ++i) {
+                    moros::h2::writeFrame(out, moros::h2::Frame::HEADERS,
+                                          moros::h2::FLAG_END_HEADERS, pending[i], &status, 1);
+                    moros::h2::writeFrame(out, moros::h2::Frame::DATA,
+                                          moros::h2::FLAG_END_STREAM, pending[i], "ok", 2);
+                }
+                answered_ += answer;
+                pending.clear();
+            }
+            ::send(fd, out.data(), out.size(), MSG_NOSIGNAL);
+            // 读完客户端剩余的数据再关闭, 以免 RST 冲掉尚未读取的响应
+            if (closing && !shut) {
+                ::shutdown(fd, SHUT_WR);
+                shut = true;
+            }
+        }
+    }
+
+    const std::size_t batch_;
+    const std::int64_t frame_size_;
+    const std::string greeting_;
+    const bool goaway_after_;
+    int lfd_;
+    std::uint16_t port_;
+    std::thread thread_;
+    std::atomic_bool stop_{false};
+    std::atomic_size_t max_concurrent_{0};
+    std::atomic<std::int64_t> goaway_{-1};
+    std::atomic_size_t requested_{0};
+    std::atomic_size_t answered_{0};
+};
+
+// TLS 替身服务端, 使用临时生成的自签名证书. h2 为 true 时经 ALPN 选择 h2,
+// 否则不协商任何协议. 只完成握手并统计其后收到的数据, 不作响应
+class TlsServer {
+public:
+    explicit TlsServer(bool h2) : ctx_(SSL_CTX_new(TLS_server_method()), SSL_CTX_free) {
+        EVP_PKEY* key = nullptr;
+        EVP_PKEY_CTX* kctx = EVP_PKEY_CTX_new_id(EVP_PKEY_EC, nullptr);
+        EVP_PKEY_keygen_init(kctx);
+        EVP_PKEY_CTX_set_ec_paramgen_curve_nid(kctx, NID_X9_62_prime256v1);
+        EVP_PKEY_keygen(kctx, &key);
+        EVP_PKEY_CTX_free(kctx);
+
+        X509* cert = X509_new();
+        ASN1_INTEGER_set(X509_get_serialNumber(cert), 1);
+        X509_gmtime_adj(X509_getm_notBefore(cert), 0);
+        X509_gmtime_adj(X509_getm_notAfter(cert), 3600);
+        X509_set_pubkey(cert, key);
+        X509_NAME* name = X509_get_subject_name(cert);
+        X509_NAME_add_entry_by_txt(name, "CN", MBSTRING_ASC,
+                                   reinterpret_cast<const unsigned char*>("localhost"), -1, -1, 0);
+        X509_set_issuer_name(cert, name);
+        X509_sign(cert, key, EVP_sha256());
+        BOOST_REQUIRE_EQUAL(SSL_CTX_use_certificate(ctx_.get(), cert), 1);
+        BOOST_REQUIRE_EQUAL(SSL_CTX_use_PrivateKey(ctx_.get(), key), 1);
+        X509_free(cert);
+        EVP_PKEY_free(key);
+
+        if (h2) {
+            SSL_CTX_set_alpn_select_cb(
+                ctx_.get(),
+                [](SSL*, const unsigned char** out, unsigned char* outlen,
+                   const unsigned char* in, unsigned int inlen, void*) {
+                    static const unsigned char protos[] = "\x02h2";
+                    unsigned char* selected = nullptr;
+                    if (SSL_select_next_proto(&selected, outlen, protos, sizeof(protos) - 1,
+                                              in, inlen) != OPENSSL_NPN_NEGOTIATED) {
+                        return SSL_TLSEXT_ERR_NOACK;
+                    }
+                    *out = selected;
+                    return SSL_TLSEXT_ERR_OK;
+                },
+                nullptr);
+        }
+
+        lfd_ = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(lfd_, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        ::listen(lfd_, 16);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(lfd_, reinterpret_cast<struct sockaddr*>(&addr), &len);
+        port_ = ntohs(addr.sin_port);
+
+        thread_ = std::thread([this] { serve(); });
+    }
+
+    ~TlsServer() {
+        stop_ = true;
+        ::shutdown(lfd_, SHUT_RDWR);
+        thread_.join();
+        ::close(lfd_);
+    }
+
+    std::string port() const {
+        return std::to_string(port_);
+    }
+
+    std::size_t handshakes() const noexcept {
+        return handshakes_;
+    }
+
+    // 握手后收到的字节数, 其中以 h2 preface 开头的连接数
+    std::size_t received() const noexcept {
+        return received_;
+    }
+
+    std::size_t prefaces() const noexcept {
+        return prefaces_;
+    }
+
+private:
+    void serve() {
+        while (!stop_) {
+            const int fd = ::accept(lfd_, nullptr, nullptr);
+            if (fd == -1) {
+                return;
+            }
+
+            struct timeval tv = {0, 100000};
+            ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+            std::unique_ptr<SSL, void (*)(SSL*)> ssl(SSL_new(ctx_.get()), SSL_free);
+            SSL_set_fd(ssl.get(), fd);
+            if (SSL_accept(ssl.get()) == 1) {
+                ++handshakes_;
+                handle(ssl.get());
+            }
+            ::close(fd);
+        }
+    }
+
+    void handle(SSL* ssl) {
+        std::string in;
+        char buf[4096];
+        while (!stop_) {
+            const int n = SSL_read(ssl, buf, sizeof(buf));
+            if (n > 0) {
+                const bool partial = in.size() < sizeof(moros::h2::PREFACE) - 1;
+                in.append(buf, n);
+                received_ += n;
+                if (partial && in.compare(0, sizeof(moros::h2::PREFACE) - 1,
+                                         moros::h2::PREFACE) == 0) {
+                    ++prefaces_;
+                }
+            } else if (SSL_get_error(ssl, n) != SSL_ERROR_WANT_READ) {
+                break;
+            }
+        }
+    }
+
+    std::unique_ptr<SSL_CTX, void (*)(SSL_CTX*)> ctx_;
+    int lfd_;
+    std::uint16_t port_;
+    std::thread thread_;
+    std::atomic_bool stop_{false};
+    std::atomic_size_t handshakes_{0};
+    std::atomic_size_t received_{0};
+    std::atomic_size_t prefaces_{0};
+};
+
+}
+
+BOOST_AUTO_TEST_CASE(hpack_integer) {
+    std::string out;
+    moros::hpack::encodeInteger(out, 0x00, 5, 10);
+    moros::hpack::encodeInteger(out, 0x00, 5, 1337);
+    BOOST_CHECK_EQUAL(out, unhex("0a1f9a0a"));
+}
+
+BOOST_AUTO_TEST_CASE(hpack_rfc7541_c4) {
+    moros::hpack::Decoder d;
+
+    auto hs = decode(d, unhex("828684418cf1e3c2e5f23a6ba0ab90f4ff"));
+    BOOST_REQUIRE_EQUAL(hs.size(), 4u);
+    BOOST_CHECK_EQUAL(hs[3].first, ":authority");
+    BOOST_CHECK_EQUAL(hs[3].second, "www.example.com");
+
+    // 依赖上一个 block 插入动态表的 :authority
+    hs = decode(d, unhex("828684be5886a8eb10649cbf"));
+    BOOST_REQUIRE_EQUAL(hs.size(), 5u);
+    BOOST_CHECK_EQUAL(hs[3].second, "www.example.com");
+    BOOST_CHECK_EQUAL(hs[4].first, "cache-control");
+    BOOST_CHECK_EQUAL(hs[4].second, "no-cache");
+
+    hs = decode(d, unhex("828785bf408825a849e95ba97d7f8925a849e95bb8e8b4bf"));
+    BOOST_REQUIRE_EQUAL(hs.size(), 5u);
+    BOOST_CHECK_EQUAL(hs[2].second, "/index.html");
+    BOOST_CHECK_EQUAL(hs[4].first, "custom-key");
+    BOOST_CHECK_EQUAL(hs[4].second, "custom-value");
+}
+
+BOOST_AUTO_TEST_CASE(encode_request) {
+    std::string block, body;
+    BOOST_REQUIRE(moros::h2::encodeRequest(
+        "POST /submit HTTP/1.1\r\nHost: example.com\r\nConnection: keep-alive\r\n"
+        "X-Token: abc\r\n\r\npayload",
+        "http", block, body));
+    BOOST_CHECK_EQUAL(body, "payload");
+
+    moros::hpack::Decoder d;
+    const auto hs = decode(d, block);
+    BOOST_REQUIRE_EQUAL(hs.size(), 5u);
+    BOOST_CHECK_EQUAL(hs[0].second, "POST");
+    BOOST_CHECK_EQUAL(hs[1].second, "http");
+    BOOST_CHECK_EQUAL(hs[2].second, "example.com");
+    BOOST_CHECK_EQUAL(hs[3].second, "/submit");
+    BOOST_CHECK_EQUAL(hs[4].first, "x-token");
+}
+
+BOOST_AUTO_TEST_CASE(h2c_multiplexing) {
+    H2cServer server(4);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config cfg = {};
+    cfg.connections = 1;
+    cfg.streams = 4;
+    cfg.timeout = std::chrono::seconds(2);
+    cfg.protocol = moros::Protocol::H2C;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "127.0.0.1", server.port(), server.port(), "", {});
+    moros::Bencher b(cfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    b.stop();
+    t.join();
+
+    BOOST_CHECK_EQUAL(server.maxConcurrent(), 4u);
+    BOOST_CHECK_GE(moros::Metrics::getInstance()[moros::Metrics::Kind::COMPLETES], 4u);
+    BOOST_CHECK_EQUAL(moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD], 0u);
+    BOOST_CHECK_EQUAL(moros::Metrics::getInstance()[moros::Metrics::Kind::ESTATUS], 0u);
+
+    // 明文连接没有 TLS 阶段, 每个完成的 stream 都有 TTFB 与 transfer
+    BOOST_CHECK_GE(b.phase(moros::Phase::CONNECT).count(), 1u);
+    BOOST_CHECK_EQUAL(b.phase(moros::Phase::TLS).count(), 0u);
+    BOOST_CHECK_EQUAL(b.phase(moros::Phase::TTFB).count(), b.completes());
+    BOOST_CHECK_EQUAL(b.phase(moros::Phase::TRANSFER).count(), b.completes());
+}
+
+// 每条连接只打开 4 个 stream, 全部完成后换一条新连接
+BOOST_AUTO_TEST_CASE(h2c_requests_per_conn) {
+    H2cServer server(2);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config cfg = {};
+    cfg.connections = 1;
+    cfg.streams = 2;
+    cfg.requests_per_conn = 4;
+    cfg.trace = "unused";
+    cfg.trace_size = 1024;
+    cfg.timeout = std::chrono::seconds(2);
+    cfg.protocol = moros::Protocol::H2C;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    const std::uint64_t read = moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD];
+
+    moros::Plugin plugin("http", "127.0.0.1", server.port(), server.port(), "", {});
+    moros::Bencher b(cfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    b.stop();
+    t.join();
+
+    // 最后一条连接可能未用满
+    const std::uint64_t conns = (b.completes() + 3) / 4;
+    BOOST_CHECK_GE(b.completes(), 8u);
+    BOOST_CHECK_GE(b.phase(moros::Phase::CONNECT).count(), conns);
+    BOOST_CHECK_LE(b.phase(moros::Phase::CONNECT).count(), conns + 1);
+    // 每条连接的第一个 stream 计入 accept
+    BOOST_CHECK_EQUAL(b.phase(moros::Phase::ACCEPT).count(), conns);
+    BOOST_CHECK_EQUAL(moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD], read);
+
+    // 环中保留最近的记录, 其中只有各连接 stream 1 的记录带有建立连接的耗时
+    std::vector<moros::TraceRecord> records;
+    b.traceRing()->snapshot(records);
+    BOOST_CHECK_EQUAL(b.traceRing()->pushed(), b.completes());
+    BOOST_CHECK_EQUAL(records.size(), std::min<std::uint64_t>(b.completes(), 1024));
+    const auto connected =
+        std::count_if(records.begin(), records.end(),
+                      [](const moros::TraceRecord& r) { return r.connect > 0; });
+    BOOST_CHECK(connected > 0);
+    BOOST_CHECK(connected <= static_cast<std::ptrdiff_t>(records.size() / 4 + 2));
+    BOOST_CHECK(std::all_of(records.begin(), records.end(),
+                            [](const moros::TraceRecord& r) { return r.bytes > 0; }));
+}
+
+// SETTINGS_MAX_FRAME_SIZE 超出 16384..16777215 是连接错误
+BOOST_AUTO_TEST_CASE(h2c_invalid_max_frame_size) {
+    for (std::int64_t size : {0, 16383, 16777216}) {
+        H2cServer server(1, size);
+
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* result = nullptr;
+        BOOST_REQUIRE_EQUAL(
+            ::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+        std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result,
+                                                                          ::freeaddrinfo);
+
+        moros::Config cfg = {};
+        cfg.connections = 1;
+        cfg.streams = 4;
+        cfg.timeout = std::chrono::seconds(2);
+        cfg.protocol = moros::Protocol::H2C;
+
+        std::vector<moros::Endpoint> endpoints;
+        endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+        const std::uint64_t read = moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD];
+
+        moros::Plugin plugin("http", "127.0.0.1", server.port(), server.port(), "", {});
+        moros::Bencher b(cfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+        std::thread t([&] { b.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        b.stop();
+        t.join();
+
+        BOOST_CHECK_EQUAL(b.completes(), 0u);
+        BOOST_CHECK_GT(moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD], read);
+        BOOST_CHECK_EQUAL(server.goaway(), moros::h2::PROTOCOL_ERROR);
+    }
+}
+
+// 对端 GOAWAY 后 last stream 之前的响应照常完成, 之后未处理的 stream
+// 在新连接上重新发出, 都不计为错误
+BOOST_AUTO_TEST_CASE(h2c_goaway_in_flight) {
+    H2cServer server(4, -1, "", true);
+
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config cfg = {};
+    cfg.connections = 1;
+    cfg.streams = 4;
+    cfg.timeout = std::chrono::seconds(2);
+    cfg.protocol = moros::Protocol::H2C;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t errors = m[moros::Metrics::Kind::EREAD] + m[moros::Metrics::Kind::EWRITE];
+
+    moros::Plugin plugin("http", "127.0.0.1", server.port(), server.port(), "", {});
+    moros::Bencher b(cfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    b.stop();
+    t.join();
+
+    // 每条连接完成 2 个 stream, 另外 2 个在下一条连接上重发. 停止时
+    // 可能还有一批响应尚未读取
+    BOOST_CHECK_GE(b.completes(), 4u);
+    BOOST_CHECK_LE(b.completes(), server.answered());
+    BOOST_CHECK_GE(b.completes() + 2, server.answered());
+    BOOST_CHECK_GE(b.phase(moros::Phase::CONNECT).count(), b.completes() / 2);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::EREAD] + m[moros::Metrics::Kind::EWRITE], errors);
+}
+
+// RST_STREAM 的长度必须为 4 且不能在 stream 0 上, 否则是连接错误
+BOOST_AUTO_TEST_CASE(h2c_invalid_rst_stream) {
+    struct Case {
+        std::uint32_t stream;
+        std::size_t len;
+        std::uint32_t error;
+    };
+    for (const Case& c : {Case{1, 3, moros::h2::FRAME_SIZE_ERROR},
+                          Case{1, 5, moros::h2::FRAME_SIZE_ERROR},
+                          Case{0, 4, moros::h2::PROTOCOL_ERROR}}) {
+        std::string rst;
+        moros::h2::writeFrame(rst, moros::h2::Frame::RST_STREAM, 0, c.stream,
+                              "\0\0\0\x08\0", c.len);
+        H2cServer server(1, -1, rst);
+
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* result = nullptr;
+        BOOST_REQUIRE_EQUAL(
+            ::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+        std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result,
+                                                                          ::freeaddrinfo);
+
+        moros::Config cfg = {};
+        cfg.connections = 1;
+        cfg.streams = 1;
+        cfg.timeout = std::chrono::seconds(2);
+        cfg.protocol = moros::Protocol::H2C;
+
+        std::vector<moros::Endpoint> endpoints;
+        endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+        const std::uint64_t read = moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD];
+
+        moros::Plugin plugin("http", "127.0.0.1", server.port(), server.port(), "", {});
+        moros::Bencher b(cfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+        std::thread t([&] { b.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(200));
+        b.stop();
+        t.join();
+
+        BOOST_CHECK_GT(moros::Metrics::getInstance()[moros::Metrics::Kind::EREAD], read);
+        BOOST_CHECK_EQUAL(server.goaway(), c.error);
+    }
+}
+
+// 对端没有经 ALPN 同意 h2 时不发出任何 h2 数据, 连接按建立失败退避重试;
+// 同意时握手完成后才发出 preface
+BOOST_AUTO_TEST_CASE(h2_alpn_required) {
+    // 与 main 一致, 服务端写已放弃的连接返回 EPIPE 而不是终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (bool h2 : {false, true}) {
+        TlsServer server(h2);
+
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_STREAM;
+        struct addrinfo* result = nullptr;
+        BOOST_REQUIRE_EQUAL(
+            ::getaddrinfo("127.0.0.1", server.port().c_str(), &hints, &result), 0);
+        std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result,
+                                                                          ::freeaddrinfo);
+
+        moros::Config cfg = {};
+        cfg.connections = 1;
+        cfg.streams = 4;
+        cfg.timeout = std::chrono::seconds(2);
+        cfg.protocol = moros::Protocol::H2;
+
+        moros::SslContext ssl_ctx;
+        ssl_ctx.alpn({"h2"});
+
+        std::vector<moros::Endpoint> endpoints;
+        endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+        const std::uint64_t failed = moros::Metrics::getInstance()[moros::Metrics::Kind::ECONNECT];
+
+        moros::Plugin plugin("https", "localhost", server.port(), server.port(), "", {});
+        moros::Bencher b(cfg, 0, *rptr, "localhost", endpoints, &ssl_ctx, plugin);
+
+        std::thread t([&] { b.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        b.stop();
+        t.join();
+
+        BOOST_CHECK_EQUAL(b.completes(), 0u);
+        BOOST_CHECK_EQUAL(b.h2Refused(), !h2);
+        BOOST_CHECK_EQUAL(b.phase(moros::Phase::TLS).count(), server.handshakes());
+        if (h2) {
+            BOOST_CHECK_EQUAL(server.handshakes(), 1u);
+            BOOST_CHECK_EQUAL(server.prefaces(), 1u);
+        } else {
+            // 10ms 起指数退避, 300ms 内至多重试 6 次左右
+            BOOST_CHECK_GE(server.handshakes(), 2u);
+            BOOST_CHECK_LE(server.handshakes(), 8u);
+            BOOST_CHECK_EQUAL(server.received(), 0u);
+            BOOST_CHECK_GE(moros::Metrics::getInstance()[moros::Metrics::Kind::ECONNECT] - failed,
+                           server.handshakes() - 1);
+        }
+    }
+}
@@ -0,0 +1,45 @@
+#define BOOST_TEST_MODULE HISTLOG
+#include "histlog.hpp"
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(roundtrip) {
+    moros::Stats st(2000);
+    for (std::uint64_t i = 0; i < 100; ++i) {
+        st.record(i % 10);
+    }
+    st.record(1999);
+
+    const std::string s = moros::encodeHistogram(st);
+    BOOST_CHECK_EQUAL(s.substr(0, 6), "HISTFA");
+
+    const auto decoded = moros::decodeHistogram(s);
+    BOOST_REQUIRE(decoded);
+    BOOST_CHECK_EQUAL(decoded->count(), 101u);
+    BOOST_CHECK_EQUAL(decoded->highest(), 1999u);
+    BOOST_CHECK_EQUAL(decoded->max(), 1999);
+    BOOST_CHECK(decoded->counts() == st.counts());
+}
+
+BOOST_AUTO_TEST_CASE(merge_decoded) {
+    moros::Stats a(2000), b(1000000);
+    a.record(5);
+    b.record(500000);
+
+    auto merged = moros::decodeHistogram(moros::encodeHistogram(b));
+    BOOST_REQUIRE(merged);
+    merged->merge(*moros::decodeHistogram(moros::encodeHistogram(a)));
+    BOOST_CHECK_EQUAL(merged->count(), 2u);
+    BOOST_CHECK_EQUAL(merged->derank(0.5), 5u);
+    BOOST_CHECK_CLOSE(1.0 * merged->derank(1.0), 500000.0, 0.1);
+}
+
+BOOST_AUTO_TEST_CASE(empty_and_invalid) {
+    moros::Stats st(100);
+    const auto decoded = moros::decodeHistogram(moros::encodeHistogram(st));
+    BOOST_REQUIRE(decoded);
+    BOOST_CHECK_EQUAL(decoded->count(), 0u);
+
+    BOOST_CHECK(!moros::decodeHistogram(""));
+    BOOST_CHECK(!moros::decodeHistogram("not a histogram"));
+    BOOST_CHECK(!moros::decodeHistogram("HISTFAAAAAA="));
+}
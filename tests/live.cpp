@@ -0,0 +1,120 @@
+#define BOOST_TEST_MODULE LIVE
+#include "live.hpp"
+#include <atomic>
+#include <fstream>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+using Kind = moros::Metrics::Kind;
+
+std::string tmpPath(const char* name) {
+    return "/tmp/moros-live-" + std::to_string(::getpid()) + "-" + name;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(publish_and_read) {
+    const std::string path = tmpPath("basic");
+    moros::Metrics::getInstance().reset();
+    moros::Stats latency(2000);
+
+    moros::LiveStats live(path, "http://localhost/", latency);
+    moros::LiveReader reader(path);
+
+    moros::LiveSnapshot snap;
+    BOOST_TEST(reader.read(snap));
+    BOOST_TEST(snap.pid == static_cast<std::uint64_t>(::getpid()));
+    BOOST_TEST(snap.url == "http://localhost/");
+    BOOST_TEST(snap.latency->count() == 0u);
+
+    moros::Metrics::getInstance().count(Kind::COMPLETES, 3);
+    moros::Metrics::getInstance().count(Kind::ETIMEOUT);
+    latency.record(5);
+    latency.record(7);
+    latency.record(1500);
+    live.publish(moros::LiveState::RUNNING, std::chrono::milliseconds(1200));
+
+    BOOST_TEST(reader.read(snap));
+    BOOST_TEST((snap.state == moros::LiveState::RUNNING));
+    BOOST_TEST(snap.elapsed.count() == 1200);
+    BOOST_TEST(snap[Kind::COMPLETES] == 3u);
+    BOOST_TEST(snap[Kind::ETIMEOUT] == 1u);
+    BOOST_TEST(snap.latency->count() == 3u);
+    BOOST_TEST(snap.latency->max() == 1500);
+    BOOST_TEST(snap.latency->highest() == latency.highest());
+
+    live.publish(moros::LiveState::DONE, std::chrono::milliseconds(2000));
+    BOOST_TEST(reader.read(snap));
+    BOOST_TEST((snap.state == moros::LiveState::DONE));
+
+    ::unlink(path.c_str());
+    moros::Metrics::getInstance().reset();
+}
+
+// 新的测试重新创建文件, 旧的映射仍可读
+BOOST_AUTO_TEST_CASE(recreated_file) {
+    const std::string path = tmpPath("recreate");
+    moros::Stats latency(2000);
+
+    auto live = std::make_unique<moros::LiveStats>(path, "a", latency);
+    moros::LiveReader reader(path);
+    BOOST_TEST(!reader.stale());
+
+    live = std::make_unique<moros::LiveStats>(path, "b", latency);
+    BOOST_TEST(reader.stale());
+
+    moros::LiveSnapshot snap;
+    BOOST_TEST(reader.read(snap));
+    BOOST_TEST(snap.url == "a");
+    BOOST_TEST(moros::LiveReader(path).read(snap));
+    BOOST_TEST(snap.url == "b");
+
+    ::unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(invalid_file) {
+    const std::string path = tmpPath("invalid");
+    BOOST_CHECK_THROW(moros::LiveReader r(path), std::runtime_error);
+
+    std::ofstream(path) << std::string(4096, 'x');
+    BOOST_CHECK_THROW(moros::LiveReader r(path), std::runtime_error);
+
+    ::unlink(path.c_str());
+}
+
+// 写入方不停发布时, 读到的计数与直方图总是来自同一次发布
+BOOST_AUTO_TEST_CASE(consistent_under_writes) {
+    const std::string path = tmpPath("seqlock");
+    moros::Metrics::getInstance().reset();
+    moros::Stats latency(2000);
+    moros::LiveStats live(path, "", latency);
+
+    std::atomic_bool stop{false};
+    std::thread writer([&] {
+        while (!stop.load()) {
+            moros::Metrics::getInstance().count(Kind::COMPLETES);
+            latency.record(1);
+            live.publish(moros::LiveState::RUNNING, std::chrono::milliseconds(0));
+        }
+    });
+
+    moros::LiveReader reader(path);
+    std::size_t reads = 0;
+    for (int i = 0; i < 200; ++i) {
+        moros::LiveSnapshot snap;
+        if (reader.read(snap)) {
+            BOOST_REQUIRE(snap[Kind::COMPLETES] == snap.latency->count());
+            ++reads;
+        }
+    }
+    stop = true;
+    writer.join();
+    BOOST_TEST(reads > 0u);
+
+    ::unlink(path.c_str());
+    moros::Metrics::getInstance().reset();
+}
@@ -0,0 +1,66 @@
+#define BOOST_TEST_MODULE PERF
+#include "perf.hpp"
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(sample_arithmetic) {
+    moros::PerfSample a, b;
+    a.counts[static_cast<std::size_t>(moros::PerfEvent::CYCLES)] = 1000;
+    a.counts[static_cast<std::size_t>(moros::PerfEvent::SYSCALLS)] = 30;
+    a.mask = (1u << static_cast<unsigned>(moros::PerfEvent::CYCLES)) |
+             (1u << static_cast<unsigned>(moros::PerfEvent::SYSCALLS));
+    BOOST_CHECK(a.has(moros::PerfEvent::CYCLES));
+    BOOST_CHECK(!a.has(moros::PerfEvent::INSTRUCTIONS));
+
+    // 计数器打开之前的采样是空的, 差值即为全部计数
+    auto d = a - b;
+    BOOST_CHECK_EQUAL(d[moros::PerfEvent::CYCLES], 1000u);
+    BOOST_CHECK_EQUAL(d.mask, a.mask);
+
+    b = a;
+    a.counts[static_cast<std::size_t>(moros::PerfEvent::CYCLES)] = 1500;
+    d = a - b;
+    BOOST_CHECK_EQUAL(d[moros::PerfEvent::CYCLES], 500u);
+    BOOST_CHECK_EQUAL(d[moros::PerfEvent::SYSCALLS], 0u);
+
+    moros::PerfSample total;
+    total += d;
+    total += d;
+    BOOST_CHECK_EQUAL(total[moros::PerfEvent::CYCLES], 1000u);
+    BOOST_CHECK_EQUAL(total.mask, a.mask);
+
+    BOOST_CHECK_EQUAL(moros::perfEventName(moros::PerfEvent::SYSCALLS), "syscalls");
+}
+
+BOOST_AUTO_TEST_CASE(open_or_degrade) {
+    moros::PerfCounters pc;
+    BOOST_CHECK_EQUAL(pc.read().mask, 0u);
+
+    // 容器与虚拟机中可能一个计数器都打不开, 此时只要求给出原因
+    if (pc.open() == 0) {
+        BOOST_CHECK_NE(pc.error(), 0);
+        BOOST_CHECK_EQUAL(pc.read().mask, 0u);
+        return;
+    }
+    BOOST_CHECK_EQUAL(pc.error(), 0);
+
+    const auto before = pc.read();
+    BOOST_CHECK_NE(before.mask, 0u);
+    for (int i = 0; i < 5; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    // 计数器只增不减, 每次 sleep 都让出 CPU
+    const auto d = pc.read() - before;
+    BOOST_CHECK_EQUAL(d.mask, before.mask);
+    if (d.has(moros::PerfEvent::CONTEXT_SWITCHES)) {
+        BOOST_CHECK_GE(d[moros::PerfEvent::CONTEXT_SWITCHES], 5u);
+    }
+    if (d.has(moros::PerfEvent::SYSCALLS)) {
+        BOOST_CHECK_GE(d[moros::PerfEvent::SYSCALLS], 5u);
+    }
+
+    // 其它线程读取的是同一个线程的计数
+    std::thread t([&] { BOOST_CHECK_EQUAL(pc.read().mask, before.mask); });
+    t.join();
+}
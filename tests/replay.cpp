@@ -0,0 +1,94 @@
+#define BOOST_TEST_MODULE REPLAY
+#include "replay.hpp"
+#include <fstream>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+std::string tmpPath(const char* name) {
+    return "/tmp/moros-replay-" + std::to_string(::getpid()) + "-" + name;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(combined_format) {
+    const std::string path = tmpPath("combined");
+    std::ofstream(path)
+        << "127.0.0.1 - - [10/Oct/2000:13:55:36 -0700] \"GET /a.gif HTTP/1.0\" 200 2326 "
+           "\"http://example.com/\" \"Mozilla/4.08 \\\"x\\\"\"\n"
+        // 时区不同, 实际晚 1.5 秒
+        << "10.0.0.2 - frank [10/Oct/2000:21:55:37 +0100] \"POST /api?q=1 HTTP/1.1\" 201 0\r\n"
+        << "\n"
+        << "garbage\n"
+        << "10.0.0.3 - - [10/Oct/2000:13:55:37 -0700] \"\\x16\\x03\" 400 0 \"-\" \"-\"\n"
+        << "10.0.0.3 - - [10/Oct/2000:13:55:40 -0700] \"DELETE /x HTTP/1.1\" 204 0 \"-\" \"-\"";
+
+    moros::AccessLog log(path);
+    moros::ReplayEntry e;
+
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 0);
+    BOOST_TEST(e.method == "GET");
+    BOOST_TEST(e.uri == "/a.gif");
+    BOOST_REQUIRE(e.headers.size() == 2u);
+    BOOST_TEST(e.headers[0] == "Referer: http://example.com/");
+    BOOST_TEST(e.headers[1] == "User-Agent: Mozilla/4.08 \\\"x\\\"");
+
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 1000000);
+    BOOST_TEST(e.method == "POST");
+    BOOST_TEST(e.uri == "/api?q=1");
+    BOOST_TEST(e.headers.empty());
+
+    // 无法解析的行被跳过, 最后一行没有换行
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 4000000);
+    BOOST_TEST(e.method == "DELETE");
+    BOOST_TEST(e.headers.empty());
+    BOOST_TEST(!log.next(e));
+    BOOST_TEST(log.skipped() == 2u);
+
+    ::unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(tab_separated) {
+    const std::string path = tmpPath("tsv");
+    std::ofstream(path) << "1500000000.25\tGET\t/\tAccept: */*\tX-Id: 1\n"
+                        << "1500000000.5\tPUT\t/item/2\n"
+                        << "1500000000.0\tGET\t/early\n"
+                        << "1500000001\tGET\t/bad header\n"
+                        << "1500000001\tget\t/\n"
+                        << "1500000001\tGET\t/\tno colon\n"
+                        << "x\tGET\t/\n";
+
+    moros::AccessLog log(path);
+    moros::ReplayEntry e;
+
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 0);
+    BOOST_REQUIRE(e.headers.size() == 2u);
+    BOOST_TEST(e.headers[1] == "X-Id: 1");
+
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 250000);
+    BOOST_TEST(e.method == "PUT");
+    BOOST_TEST(e.uri == "/item/2");
+
+    // 早于第一条的记录立即发出
+    BOOST_REQUIRE(log.next(e));
+    BOOST_TEST(e.offset.count() == 0);
+    BOOST_TEST(!log.next(e));
+    BOOST_TEST(log.skipped() == 4u);
+
+    ::unlink(path.c_str());
+}
+
+BOOST_AUTO_TEST_CASE(unreadable_log) {
+    const std::string path = tmpPath("empty");
+    BOOST_CHECK_THROW(moros::AccessLog log(path), std::runtime_error);
+    std::ofstream(path).flush();
+    BOOST_CHECK_THROW(moros::AccessLog log(path), std::runtime_error);
+    ::unlink(path.c_str());
+}
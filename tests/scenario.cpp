@@ -0,0 +1,100 @@
+#define BOOST_TEST_MODULE SCENARIO
+#include "scenario.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+std::string write(const std::string& content) {
+    char path[] = "/tmp/moros-scenario-XXXXXX";
+    ::close(::mkstemp(path));
+    std::ofstream(path) << content;
+    return path;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(build_request) {
+    BOOST_CHECK_EQUAL(moros::buildHead("GET", "/a?b=1", "example.com", {"X-A: 1"}),
+                      "GET /a?b=1 HTTP/1.1\r\nHost: example.com\r\nX-A: 1\r\n");
+
+    const moros::Endpoint post("post", 1, moros::buildHead("POST", "/", "example.com", {"host: other"}),
+                               "hi", 10);
+    BOOST_CHECK(!post.dynamic());
+    BOOST_CHECK_EQUAL(post.req, "POST / HTTP/1.1\r\nhost: other\r\nContent-Length: 2\r\n\r\nhi");
+
+    const moros::Endpoint fixed("fixed", 1, "PUT / HTTP/1.1\r\ncontent-length: 2\r\n", "hi", 10);
+    BOOST_CHECK_EQUAL(fixed.req, "PUT / HTTP/1.1\r\ncontent-length: 2\r\n\r\nhi");
+}
+
+BOOST_AUTO_TEST_CASE(dynamic_body) {
+    const moros::Endpoint ep("ep", 1, "POST /{{seq}} HTTP/1.1\r\n", "id={{seq}}", 10);
+    BOOST_REQUIRE(ep.dynamic());
+
+    moros::TemplateState st(1, 9, 3);
+    std::string out, scratch;
+    ep.render(out, scratch, st);
+    BOOST_CHECK_EQUAL(out, "POST /9 HTTP/1.1\r\nContent-Length: 4\r\n\r\nid=9");
+    ep.render(out, scratch, st);
+    BOOST_CHECK_EQUAL(out, "POST /12 HTTP/1.1\r\nContent-Length: 5\r\n\r\nid=12");
+}
+
+BOOST_AUTO_TEST_CASE(load) {
+    const std::string path = write(
+        "# comment\n"
+        "[cached]\n"
+        "weight = 7\n"
+        "request = GET /static\n"
+        "\n"
+        "[submit]\n"
+        "weight = 3\n"
+        "request = POST /submit\n"
+        "header = Content-Type: application/json\n"
+        "body = {\"a\": 1}\n");
+    const auto eps = moros::loadScenario(path, "example.com", {"X-Global: 1"}, 2000);
+    std::remove(path.c_str());
+
+    BOOST_REQUIRE_EQUAL(eps.size(), 2u);
+    BOOST_CHECK_EQUAL(eps[0].name, "cached");
+    BOOST_CHECK_EQUAL(eps[0].weight, 7u);
+    BOOST_CHECK_EQUAL(eps[0].req,
+                      "GET /static HTTP/1.1\r\nHost: example.com\r\nX-Global: 1\r\n\r\n");
+    BOOST_CHECK_EQUAL(eps[1].req,
+                      "POST /submit HTTP/1.1\r\nHost: example.com\r\nX-Global: 1\r\n"
+                      "Content-Type: application/json\r\nContent-Length: 8\r\n\r\n"
+                      "{\"a\": 1}");
+}
+
+BOOST_AUTO_TEST_CASE(invalid) {
+    for (const char* content : {"weight = 1\n", "[a]\nweight = x\nrequest = GET /\n",
+                                "[a]\nfoo = bar\n", "[a]\nweight = 1\n",
+                                "[a]\nweight = 0\nrequest = GET /\n"}) {
+        const std::string path = write(content);
+        BOOST_CHECK_THROW(moros::loadScenario(path, "h", {}, 2000), std::runtime_error);
+        std::remove(path.c_str());
+    }
+}
+
+BOOST_AUTO_TEST_CASE(picker) {
+    std::vector<moros::Endpoint> eps;
+    eps.emplace_back("a", 70, "", "", 10);
+    eps.emplace_back("none", 0, "", "", 10);
+    eps.emplace_back("b", 20, "", "", 10);
+    eps.emplace_back("c", 10, "", "", 10);
+
+    moros::Picker picker(eps, 42);
+    std::size_t hits[4] = {};
+    for (int i = 0; i < 100000; ++i) {
+        ++hits[picker.pick()];
+    }
+
+    BOOST_CHECK_EQUAL(hits[1], 0u);
+    BOOST_CHECK_CLOSE(hits[0] / 1000.0, 70.0, 2);
+    BOOST_CHECK_CLOSE(hits[2] / 1000.0, 20.0, 3);
+    BOOST_CHECK_CLOSE(hits[3] / 1000.0, 10.0, 5);
+}
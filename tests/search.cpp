@@ -0,0 +1,143 @@
+#define BOOST_TEST_MODULE SEARCH
+#include "search.hpp"
+#include <array>
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+namespace {
+
+using Kind = moros::Metrics::Kind;
+
+constexpr std::size_t KINDS = static_cast<std::size_t>(Kind::MAX);
+
+// 替身服务: c 个连接时每个请求耗时 c / 10 + 1 ms, 吞吐在 200 个连接后不再增长
+moros::StepResult step(std::size_t c, moros::Stats& latency) {
+    latency.reset();
+    const std::uint64_t n = std::min<std::uint64_t>(c, 200) * 10;
+    for (std::uint64_t i = 0; i < n; ++i) {
+        latency.record(c / 10 + 1);
+    }
+    std::uint64_t counters[KINDS] = {};
+    counters[static_cast<std::size_t>(Kind::COMPLETES)] = n;
+    return moros::measure(c, std::chrono::milliseconds(1000), counters, latency);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(measure_step) {
+    moros::Stats latency(2000);
+    for (int i = 1; i <= 100; ++i) {
+        latency.record(i);
+    }
+    std::uint64_t counters[KINDS] = {};
+    counters[static_cast<std::size_t>(Kind::COMPLETES)] = 100;
+    counters[static_cast<std::size_t>(Kind::ESTATUS)] = 5;
+    counters[static_cast<std::size_t>(Kind::ETIMEOUT)] = 25;
+
+    const moros::StepResult r =
+        moros::measure(8, std::chrono::milliseconds(2000), counters, latency);
+    BOOST_TEST(r.connections == 8u);
+    BOOST_TEST(r.rps == 50);
+    BOOST_TEST(r.mean == 50.5);
+    BOOST_TEST(r.p50 == 50);
+    BOOST_TEST(r.p99 == 99);
+    // 5 个非 2xx 与 25 个超时, 共 125 个请求
+    BOOST_TEST(r.errors == 30.0 / 125);
+
+    const moros::StepResult none =
+        moros::measure(8, std::chrono::milliseconds(2000),
+                       std::array<std::uint64_t, KINDS>{}.data(), moros::Stats(2000));
+    BOOST_TEST(none.rps == 0);
+    BOOST_TEST(none.errors == 1);
+}
+
+BOOST_AUTO_TEST_CASE(slo_spec) {
+    moros::Stats latency(2000);
+    for (int i = 1; i <= 100; ++i) {
+        latency.record(i);
+    }
+    std::uint64_t counters[KINDS] = {};
+    counters[static_cast<std::size_t>(Kind::COMPLETES)] = 999;
+    counters[static_cast<std::size_t>(Kind::EREAD)] = 1;
+    moros::StepResult r = moros::measure(1, std::chrono::milliseconds(1000), counters, latency);
+
+    moros::Slo("p99<100ms,errors<0.2%").check(r, latency);
+    BOOST_TEST(r.pass);
+    BOOST_TEST(r.violation.empty());
+
+    moros::Slo("p99.9<0.1s").check(r, latency);
+    BOOST_TEST(!r.pass);
+    BOOST_TEST(r.violation == "p99.9 100ms");
+
+    moros::Slo("p50<1s,errors<0.1%").check(r, latency);
+    BOOST_TEST(!r.pass);
+    BOOST_TEST(r.violation == "errors 0.10%");
+
+    for (const char* bad : {"", "p99", "p99<50", "p0<1ms", "p101<1ms", "q99<1ms",
+                            "errors<1", "errors<200%", "p99<50ms,,errors<1%"}) {
+        BOOST_CHECK_THROW(moros::Slo s(bad), std::invalid_argument);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(converges_on_capacity) {
+    // p99 < 50ms 要求 c / 10 + 1 < 50, 即 c < 490
+    moros::Slo slo("p99<50ms");
+    moros::LoadSearch search(slo, 10, 10000);
+    moros::Stats latency(2000);
+
+    std::vector<std::size_t> tried;
+    for (std::size_t c; search.next(c);) {
+        tried.push_back(c);
+        search.record(step(c, latency), latency);
+        BOOST_REQUIRE(tried.size() < 32u);
+    }
+
+    // 先倍增到 640, 再在 320 与 640 之间二分
+    BOOST_TEST(tried[0] == 10u);
+    BOOST_TEST(tried[6] == 640u);
+    const moros::StepResult* best = search.best();
+    BOOST_REQUIRE(best);
+    BOOST_TEST(best->connections < 490u);
+    BOOST_TEST(best->connections >= 465u);
+
+    // 吞吐在 200 之后不再增长, 拐点在此之前
+    const moros::StepResult* knee = search.knee();
+    BOOST_REQUIRE(knee);
+    BOOST_TEST(knee->connections <= 200u);
+
+    std::ostringstream os;
+    search.summary(os);
+    BOOST_TEST(os.str().find("Max sustainable: -c " + std::to_string(best->connections)) == 0u);
+}
+
+BOOST_AUTO_TEST_CASE(bounded_search) {
+    moros::Slo slo("p99<50ms");
+    moros::Stats latency(2000);
+
+    // 到达上限仍满足 SLO
+    moros::LoadSearch high(slo, 10, 100);
+    std::size_t n = 0;
+    for (std::size_t c; high.next(c); ++n) {
+        high.record(step(c, latency), latency);
+    }
+    BOOST_TEST(n == 5u); // 10 20 40 80 100
+    BOOST_TEST(high.best()->connections == 100u);
+
+    // 第一步就违反时向下二分
+    moros::LoadSearch low(slo, 1000, 1000);
+    for (std::size_t c; low.next(c);) {
+        low.record(step(c, latency), latency);
+    }
+    BOOST_TEST(low.steps().front().connections == 1000u);
+    BOOST_REQUIRE(low.best());
+    BOOST_TEST(low.best()->connections < 490u);
+
+    // 一直违反时停在 1
+    moros::Slo strict("p99<1ms");
+    moros::LoadSearch none(strict, 64, 64);
+    for (std::size_t c; none.next(c);) {
+        none.record(step(c, latency), latency);
+    }
+    BOOST_TEST(!none.best());
+    BOOST_TEST(!none.knee());
+}
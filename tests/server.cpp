@@ -0,0 +1,737 @@
+#define BOOST_TEST_MODULE Server
+#include "server.hpp"
+#include "bencher.hpp"
+#include "url.hpp"
+#include <csignal>
+#include <fstream>
+#include <functional>
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <netdb.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+std::unique_ptr<moros::Stats> requests = std::make_unique<moros::Stats>(1000000);
+std::unique_ptr<moros::Stats> latency = std::make_unique<moros::Stats>(2000);
+
+namespace {
+
+moros::ServerConfig loopback() {
+    moros::ServerConfig cfg;
+    cfg.loopback = true;
+    return cfg;
+}
+
+int connectTo(std::uint16_t port) {
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    addr.sin_port = htons(port);
+    BOOST_REQUIRE_EQUAL(::connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)), 0);
+
+    struct timeval tv = {2, 0};
+    ::setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+    return fd;
+}
+
+// 读到对端关闭或超时
+std::string readAll(int fd) {
+    std::string out;
+    char buf[4096];
+    ssize_t n;
+    while ((n = ::read(fd, buf, sizeof(buf))) > 0) {
+        out.append(buf, n);
+    }
+    return out;
+}
+
+std::size_t occurrences(const std::string& s, const std::string& what) {
+    std::size_t n = 0;
+    for (auto pos = s.find(what); pos != std::string::npos; pos = s.find(what, pos + 1)) {
+        ++n;
+    }
+    return n;
+}
+
+const std::string request = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n\r\n";
+
+}
+
+BOOST_AUTO_TEST_CASE(pipelined_responses) {
+    auto cfg = loopback();
+    cfg.response_size = 5;
+    moros::Server server(cfg);
+    BOOST_REQUIRE_NE(server.port(), 0);
+    server.start();
+
+    // 最后一个请求要求关闭, 之前的依次得到响应
+    const int fd = connectTo(server.port());
+    const std::string reqs = request + request +
+                             "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+    BOOST_REQUIRE_EQUAL(::write(fd, reqs.data(), reqs.size()), static_cast<ssize_t>(reqs.size()));
+
+    const std::string out = readAll(fd);
+    ::close(fd);
+
+    BOOST_CHECK_EQUAL(occurrences(out, "HTTP/1.1 200 OK\r\nContent-Length: 5\r\n"), 3u);
+    BOOST_CHECK_EQUAL(occurrences(out, "xxxxx"), 3u);
+    BOOST_CHECK_EQUAL(occurrences(out, "Connection: close"), 1u);
+    BOOST_CHECK_EQUAL(server.served(), 3u);
+}
+
+BOOST_AUTO_TEST_CASE(keep_alive_limit) {
+    auto cfg = loopback();
+    cfg.keep_alive = 2;
+    moros::Server server(cfg);
+    server.start();
+
+    // 第 2 个响应后关闭连接, 其后的请求被丢弃
+    const int fd = connectTo(server.port());
+    const std::string reqs = request + request + request;
+    BOOST_REQUIRE_EQUAL(::write(fd, reqs.data(), reqs.size()), static_cast<ssize_t>(reqs.size()));
+
+    const std::string out = readAll(fd);
+    ::close(fd);
+
+    BOOST_CHECK_EQUAL(occurrences(out, "HTTP/1.1 200 OK"), 2u);
+    BOOST_CHECK_EQUAL(occurrences(out, "Connection: close"), 1u);
+    BOOST_CHECK_EQUAL(server.served(), 2u);
+}
+
+BOOST_AUTO_TEST_CASE(fixed_delay) {
+    auto cfg = loopback();
+    cfg.delay = "fixed:50";
+    moros::Server server(cfg);
+    server.start();
+
+    const int fd = connectTo(server.port());
+    const std::string req = "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\nConnection: close\r\n\r\n";
+
+    const auto start = std::chrono::steady_clock::now();
+    BOOST_REQUIRE_EQUAL(::write(fd, req.data(), req.size()), static_cast<ssize_t>(req.size()));
+    const std::string out = readAll(fd);
+    const auto elapsed = std::chrono::steady_clock::now() - start;
+    ::close(fd);
+
+    BOOST_CHECK_EQUAL(occurrences(out, "HTTP/1.1 200 OK"), 1u);
+    BOOST_CHECK(elapsed >= std::chrono::milliseconds(50));
+    BOOST_CHECK(elapsed < std::chrono::seconds(1));
+}
+
+BOOST_AUTO_TEST_CASE(invalid_config) {
+    auto cfg = loopback();
+    cfg.delay = "sometimes";
+    BOOST_CHECK_THROW(moros::Server{cfg}, std::invalid_argument);
+
+    // 端口已被其他 socket 独占
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    ::bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+    ::listen(fd, 1);
+    socklen_t len = sizeof(addr);
+    ::getsockname(fd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+
+    cfg = loopback();
+    cfg.port = ntohs(addr.sin_port);
+    BOOST_CHECK_THROW(moros::Server{cfg}, std::runtime_error);
+    ::close(fd);
+}
+
+// bencher 对内置服务施压, 与 --calibrate 相同
+BOOST_AUTO_TEST_CASE(bencher_against_server) {
+    auto cfg = loopback();
+    cfg.threads = 2;
+    cfg.response_size = 100;
+    cfg.keep_alive = 10;
+    moros::Server server(cfg);
+    server.start();
+
+    const std::string port = std::to_string(server.port());
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", port.c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config bcfg = {};
+    bcfg.connections = 4;
+    bcfg.timeout = std::chrono::seconds(2);
+    bcfg.protocol = moros::Protocol::HTTP1;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "127.0.0.1", port, port, "", {});
+    moros::Bencher b(bcfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(300));
+    b.stop();
+    t.join();
+
+    // 连接每 10 个请求被关闭一次, 重连不算错误
+    const auto& m = moros::Metrics::getInstance();
+    BOOST_CHECK_GE(m[moros::Metrics::Kind::COMPLETES], 100u);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::ESTATUS], 0u);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::ECONNECT], 0u);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::EREAD], 0u);
+    BOOST_CHECK_GE(b.phase(moros::Phase::CONNECT).count(), m[moros::Metrics::Kind::COMPLETES] / 10);
+    BOOST_CHECK_GE(server.served(), m[moros::Metrics::Kind::COMPLETES]);
+}
+
+BOOST_AUTO_TEST_CASE(unix_url) {
+    moros::UnixUrl u;
+    BOOST_REQUIRE(moros::parseUnixUrl("http+unix:///run/app.sock:/api?x=1", u));
+    BOOST_CHECK_EQUAL(u.schema, "http");
+    BOOST_CHECK_EQUAL(u.path, "/run/app.sock");
+    BOOST_CHECK_EQUAL(u.uri, "/api?x=1");
+
+    BOOST_REQUIRE(moros::parseUnixUrl("https+unix://app.sock", u));
+    BOOST_CHECK_EQUAL(u.schema, "https");
+    BOOST_CHECK_EQUAL(u.path, "app.sock");
+    BOOST_CHECK_EQUAL(u.uri, "/");
+
+    BOOST_CHECK(!moros::parseUnixUrl("http://localhost/", u));
+    BOOST_CHECK(!moros::parseUnixUrl("ftp+unix:///run/app.sock", u));
+    BOOST_CHECK(!moros::parseUnixUrl("http+unix://", u));
+    BOOST_CHECK(!moros::parseUnixUrl("http+unix:///run/app.sock:api", u));
+
+    struct sockaddr_un sun;
+    struct addrinfo addr;
+    BOOST_CHECK(!moros::unixAddr(std::string(sizeof(sun.sun_path), 'x'), sun, addr));
+}
+
+// 经 Unix socket 施压, 多个服务线程共用一个监听 fd
+BOOST_AUTO_TEST_CASE(bencher_over_unix_socket) {
+    const std::string path =
+        "/tmp/moros-test-" + std::to_string(::getpid()) + ".sock";
+
+    auto cfg = loopback();
+    cfg.threads = 2;
+    cfg.unix_path = path;
+    std::uint64_t served;
+    {
+        moros::Server server(cfg);
+        server.start();
+
+        moros::UnixUrl u;
+        BOOST_REQUIRE(moros::parseUnixUrl("http+unix://" + path + ":/", u));
+        struct sockaddr_un sun;
+        struct addrinfo addr;
+        BOOST_REQUIRE(moros::unixAddr(u.path, sun, addr));
+
+        moros::Config bcfg = {};
+        bcfg.connections = 4;
+        bcfg.timeout = std::chrono::seconds(2);
+        bcfg.protocol = moros::Protocol::HTTP1;
+
+        std::vector<moros::Endpoint> endpoints;
+        endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+        moros::Plugin plugin("http", "localhost", "", "http", "", {});
+        moros::Bencher b(bcfg, 0, addr, "localhost", endpoints, nullptr, plugin);
+
+        const auto& m = moros::Metrics::getInstance();
+        const std::uint64_t before = m[moros::Metrics::Kind::COMPLETES];
+        const std::uint64_t errors = m[moros::Metrics::Kind::ECONNECT];
+
+        std::thread t([&] { b.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        b.stop();
+        t.join();
+
+        BOOST_CHECK_GE(m[moros::Metrics::Kind::COMPLETES] - before, 100u);
+        BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::ECONNECT], errors);
+        served = server.served();
+    }
+    BOOST_CHECK_GT(served, 0u);
+
+    // 服务结束时删除 socket 文件
+    struct stat st;
+    BOOST_CHECK_NE(::stat(path.c_str(), &st), 0);
+}
+
+namespace {
+
+// 对 127.0.0.1:port 运行一个 bencher 一段时间, 结束后交给 inspect 检查
+void bench(std::uint16_t port, moros::Config& bcfg, std::chrono::milliseconds d,
+           moros::Stats* connects = nullptr,
+           const std::function<void(const moros::Bencher&)>& inspect = nullptr) {
+    const std::string service = std::to_string(port);
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", service.c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    bcfg.timeout = std::chrono::seconds(2);
+    bcfg.protocol = moros::Protocol::HTTP1;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "127.0.0.1", service, service, "", {});
+    moros::Bencher b(bcfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(d);
+    b.stop();
+    t.join();
+
+    if (connects) {
+        connects->merge(b.phase(moros::Phase::CONNECT));
+    }
+    if (inspect) {
+        inspect(b);
+    }
+}
+
+}
+
+// 被拒绝的连接退避后重试, 而不是立即重连
+BOOST_AUTO_TEST_CASE(refused_connect_backoff) {
+    // 取一个随即关闭的端口
+    std::uint16_t port;
+    {
+        moros::Server server(loopback());
+        port = server.port();
+    }
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t connect = m[moros::Metrics::Kind::ECONNECT];
+    const std::uint64_t write = m[moros::Metrics::Kind::EWRITE];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 4;
+    bench(port, bcfg, std::chrono::milliseconds(300));
+
+    // 10ms 起翻倍的退避下, 300ms 内每个连接至多尝试 7 次
+    BOOST_CHECK_GE(m[moros::Metrics::Kind::ECONNECT] - connect, 4u);
+    BOOST_CHECK_LE(m[moros::Metrics::Kind::ECONNECT] - connect, 4u * 7);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::EWRITE], write);
+}
+
+// 同时只允许一个连接在建立中, 所有连接仍能建立
+BOOST_AUTO_TEST_CASE(connect_concurrency) {
+    moros::Server server(loopback());
+    server.start();
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t connect = m[moros::Metrics::Kind::ECONNECT];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 50;
+    bcfg.connect_concurrency = 1;
+    moros::Stats connects(2000000);
+    bench(server.port(), bcfg, std::chrono::milliseconds(300), &connects);
+
+    BOOST_CHECK_EQUAL(connects.count(), 50u);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::ECONNECT], connect);
+}
+
+// 1s 内匀速建立 20 个连接, 全部建立后 10ms 的 timer 随即停止
+BOOST_AUTO_TEST_CASE(ramp_up) {
+    moros::Server server(loopback());
+    server.start();
+
+    moros::Config bcfg = {};
+    bcfg.connections = 20;
+    bcfg.ramp_up = std::chrono::seconds(1);
+    moros::Stats early(2000000);
+    bench(server.port(), bcfg, std::chrono::milliseconds(400), &early);
+    BOOST_CHECK_GE(early.count(), 4u);
+    BOOST_CHECK_LE(early.count(), 12u);
+
+    moros::Stats all(2000000);
+    std::uint64_t timers = 0;
+    bench(server.port(), bcfg, std::chrono::milliseconds(1500), &all,
+          [&](const moros::Bencher& b) { timers = b.loop().lag.count(); });
+    BOOST_CHECK_EQUAL(all.count(), 20u);
+    // 约 100 次建立连接与 15 次 Req/Sec 的 timer, 未停止时会再多 50 次
+    BOOST_CHECK_LE(timers, 130u);
+}
+
+// 与 main 相同地在 warmup 后清零再打开统计, 各 endpoint 的计数之和与
+// 全局一致, warmup 期间的请求都不计入
+BOOST_AUTO_TEST_CASE(warmup_endpoint_metrics) {
+    auto cfg = loopback();
+    cfg.keep_alive = 5;
+    moros::Server server(cfg);
+    server.start();
+
+    const std::string port = std::to_string(server.port());
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", port.c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config bcfg = {};
+    bcfg.connections = 4;
+    bcfg.timeout = std::chrono::seconds(2);
+    bcfg.protocol = moros::Protocol::HTTP1;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/a", 1, "GET /a HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+    endpoints.emplace_back("/b", 1, "GET /b HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    moros::Plugin plugin("http", "127.0.0.1", port, port, "", {});
+    moros::Bencher b(bcfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    auto& m = moros::Metrics::getInstance();
+    m.enable(false);
+    std::thread t([&] { b.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+
+    for (auto& ep : endpoints) {
+        BOOST_CHECK_EQUAL((*ep.metrics)[moros::Metrics::Kind::COMPLETES], 0u);
+        ep.latency->reset();
+        ep.metrics->reset();
+    }
+    m.reset();
+    m.enable(true);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(200));
+    b.stop();
+    t.join();
+
+    BOOST_CHECK_GT(m[moros::Metrics::Kind::COMPLETES], 0u);
+    for (auto k : {moros::Metrics::Kind::COMPLETES, moros::Metrics::Kind::ESTATUS,
+                   moros::Metrics::Kind::EREAD, moros::Metrics::Kind::EWRITE}) {
+        BOOST_CHECK_EQUAL((*endpoints[0].metrics)[k] + (*endpoints[1].metrics)[k], m[k]);
+    }
+    BOOST_CHECK_EQUAL(endpoints[0].latency->count() + endpoints[1].latency->count(),
+                      b.completes());
+}
+
+namespace {
+
+// 接受连接后立即以 RST 关闭的服务. over_unix 为 true 时经 Unix socket 监听,
+// 此时客户端的第一次写入即失败
+class ResetServer {
+public:
+    ResetServer(bool over_unix, const std::string& path) : path_(path) {
+        lfd_ = ::socket(over_unix ? AF_UNIX : AF_INET, SOCK_STREAM, 0);
+        if (over_unix) {
+            ::unlink(path.c_str());
+            BOOST_REQUIRE(moros::unixAddr(path, sun_, addr_));
+        } else {
+            sin_.sin_family = AF_INET;
+            sin_.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            addr_ = {};
+            addr_.ai_family = AF_INET;
+            addr_.ai_socktype = SOCK_STREAM;
+            addr_.ai_addr = reinterpret_cast<struct sockaddr*>(&sin_);
+            addr_.ai_addrlen = sizeof(sin_);
+        }
+        BOOST_REQUIRE_EQUAL(::bind(lfd_, addr_.ai_addr, addr_.ai_addrlen), 0);
+        BOOST_REQUIRE_EQUAL(::listen(lfd_, 64), 0);
+        socklen_t len = addr_.ai_addrlen;
+        ::getsockname(lfd_, addr_.ai_addr, &len);
+
+        thread_ = std::thread([this] {
+            for (int fd; (fd = ::accept(lfd_, nullptr, nullptr)) != -1;) {
+                const struct linger lg = {1, 0};
+                ::setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+                ::close(fd);
+                ++accepted_;
+            }
+        });
+    }
+
+    ~ResetServer() {
+        ::shutdown(lfd_, SHUT_RDWR);
+        thread_.join();
+        ::close(lfd_);
+        ::unlink(path_.c_str());
+    }
+
+    const struct addrinfo& addr() const noexcept {
+        return addr_;
+    }
+
+    std::size_t accepted() const noexcept {
+        return accepted_;
+    }
+
+private:
+    std::string path_;
+    int lfd_;
+    struct sockaddr_un sun_ = {};
+    struct sockaddr_in sin_ = {};
+    struct addrinfo addr_ = {};
+    std::thread thread_;
+    std::atomic_size_t accepted_{0};
+};
+
+}
+
+// 连接不断被重置, 排队等待名额的重连不能再写已关闭的 fd
+BOOST_AUTO_TEST_CASE(connect_concurrency_reset) {
+    // 与 main 一致, 写已重置的连接返回 EPIPE 而不是终止进程
+    std::signal(SIGPIPE, SIG_IGN);
+
+    for (bool over_unix : {false, true}) {
+        ResetServer server(over_unix, "/tmp/moros-reset-" + std::to_string(::getpid()) + ".sock");
+
+        moros::Config bcfg = {};
+        bcfg.connections = 20;
+        bcfg.connect_concurrency = 1;
+        bcfg.timeout = std::chrono::seconds(2);
+        bcfg.protocol = moros::Protocol::HTTP1;
+
+        std::vector<moros::Endpoint> endpoints;
+        endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\nHost: localhost\r\n", "", 2000);
+
+        moros::Plugin plugin("http", "localhost", "", "http", "", {});
+        moros::Bencher b(bcfg, 0, server.addr(), "localhost", endpoints, nullptr, plugin);
+
+        const auto& m = moros::Metrics::getInstance();
+        const std::uint64_t before = m[moros::Metrics::Kind::EWRITE] +
+                                     m[moros::Metrics::Kind::EREAD] +
+                                     m[moros::Metrics::Kind::ECONNECT];
+
+        std::thread t([&] { b.run(); });
+        std::this_thread::sleep_for(std::chrono::milliseconds(300));
+        b.stop();
+        t.join();
+
+        // 每次失败都对应服务端的一次 accept, 而不是对同一个 fd 反复重试
+        const std::uint64_t errors = m[moros::Metrics::Kind::EWRITE] +
+                                     m[moros::Metrics::Kind::EREAD] +
+                                     m[moros::Metrics::Kind::ECONNECT] - before;
+        BOOST_CHECK_GT(server.accepted(), 20u);
+        BOOST_CHECK_LE(errors, server.accepted() + bcfg.connections);
+        BOOST_CHECK_EQUAL(b.completes(), 0u);
+    }
+}
+
+// 每个响应后等待 20ms, 300ms 内每个连接至多约 15 个请求
+BOOST_AUTO_TEST_CASE(think_time) {
+    moros::Server server(loopback());
+    server.start();
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t completes = m[moros::Metrics::Kind::COMPLETES];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 2;
+    bcfg.think = "fixed:20";
+    bench(server.port(), bcfg, std::chrono::milliseconds(300));
+
+    BOOST_CHECK_GE(m[moros::Metrics::Kind::COMPLETES] - completes, 2u * 5);
+    BOOST_CHECK_LE(m[moros::Metrics::Kind::COMPLETES] - completes, 2u * 16);
+}
+
+// 每个响应后关闭连接, 重连排队等待名额时 think time 已到期, resume 不能写旧 fd
+BOOST_AUTO_TEST_CASE(think_time_connect_concurrency) {
+    auto cfg = loopback();
+    cfg.keep_alive = 1;
+    moros::Server server(cfg);
+    server.start();
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t completes = m[moros::Metrics::Kind::COMPLETES];
+    const std::uint64_t errors = m[moros::Metrics::Kind::EWRITE] + m[moros::Metrics::Kind::EREAD];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 20;
+    bcfg.connect_concurrency = 1;
+    bcfg.think = "fixed:1";
+    bench(server.port(), bcfg, std::chrono::milliseconds(300));
+
+    BOOST_CHECK_GE(m[moros::Metrics::Kind::COMPLETES] - completes, 20u);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::EWRITE] + m[moros::Metrics::Kind::EREAD] - errors, 0u);
+}
+
+// 每 10ms 计划一个请求而服务需要 30ms, 排队的时间计入 latency
+BOOST_AUTO_TEST_CASE(open_loop_arrival) {
+    auto cfg = loopback();
+    cfg.delay = "fixed:30";
+    moros::Server server(cfg);
+    server.start();
+
+    moros::Config bcfg = {};
+    bcfg.connections = 1;
+    bcfg.arrival = "fixed:10";
+    latency->reset();
+    bench(server.port(), bcfg, std::chrono::milliseconds(400));
+
+    // 第 n 个请求晚于计划约 20 * n ms
+    BOOST_CHECK_GE(latency->count(), 5u);
+    BOOST_CHECK_GE(latency->max(), 30u + 20 * (latency->count() - 2));
+}
+
+// 日志跨 1s, 以 2 倍速重放时 300ms 内只发出前 13 条左右
+BOOST_AUTO_TEST_CASE(replay_on_schedule) {
+    const std::string path = "/tmp/moros-replay-" + std::to_string(::getpid());
+    {
+        std::ofstream os(path);
+        for (int i = 0; i < 20; ++i) {
+            os << std::fixed << 1500000000 + i * 0.05 << "\tGET\t/" << i << '\n';
+        }
+    }
+
+    moros::Server server(loopback());
+    server.start();
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t completes = m[moros::Metrics::Kind::COMPLETES];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 2;
+    bcfg.threads = 1;
+    bcfg.replay = path;
+    bcfg.replay_speed = 2;
+    bench(server.port(), bcfg, std::chrono::milliseconds(300));
+
+    BOOST_CHECK_GE(m[moros::Metrics::Kind::COMPLETES] - completes, 8u);
+    BOOST_CHECK_LE(m[moros::Metrics::Kind::COMPLETES] - completes, 16u);
+    // 停止时每个连接上至多有一个请求已送达但还没收到响应
+    BOOST_CHECK_GE(server.served(), m[moros::Metrics::Kind::COMPLETES] - completes);
+    BOOST_CHECK_LE(server.served(), m[moros::Metrics::Kind::COMPLETES] - completes + 2);
+    ::unlink(path.c_str());
+}
+
+// 客户端每 5 个请求关闭一次连接, 不算错误
+BOOST_AUTO_TEST_CASE(requests_per_conn) {
+    moros::Server server(loopback());
+    server.start();
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t completes = m[moros::Metrics::Kind::COMPLETES];
+    const std::uint64_t read = m[moros::Metrics::Kind::EREAD];
+
+    moros::Config bcfg = {};
+    bcfg.connections = 2;
+    bcfg.requests_per_conn = 5;
+    moros::Stats connects(2000000);
+    bench(server.port(), bcfg, std::chrono::milliseconds(300), &connects);
+
+    const std::uint64_t n = m[moros::Metrics::Kind::COMPLETES] - completes;
+    BOOST_CHECK_GE(n, 100u);
+    BOOST_CHECK_GE(connects.count(), n / 5);
+    BOOST_CHECK_LE(connects.count(), n / 5 + 2);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::EREAD], read);
+}
+
+// 每秒共关闭 100 个连接, 300ms 内约 30 次重连
+BOOST_AUTO_TEST_CASE(conn_churn) {
+    moros::Server server(loopback());
+    server.start();
+
+    moros::Config bcfg = {};
+    bcfg.connections = 2;
+    bcfg.threads = 1;
+    bcfg.conn_churn = 100;
+    moros::Stats connects(2000000);
+    bench(server.port(), bcfg, std::chrono::milliseconds(300), &connects);
+
+    BOOST_CHECK_GE(connects.count(), 2u + 20);
+    BOOST_CHECK_LE(connects.count(), 2u + 32);
+}
+
+// 迁移的连接在另一个 bencher 上继续发送请求, 不重连也不出错
+BOOST_AUTO_TEST_CASE(rebalance_migrate) {
+    moros::Server server(loopback());
+    server.start();
+
+    const std::string service = std::to_string(server.port());
+    struct addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    struct addrinfo* result = nullptr;
+    BOOST_REQUIRE_EQUAL(::getaddrinfo("127.0.0.1", service.c_str(), &hints, &result), 0);
+    std::unique_ptr<struct addrinfo, void (*)(struct addrinfo*)> rptr(result, ::freeaddrinfo);
+
+    moros::Config bcfg = {};
+    bcfg.connections = 3;
+    bcfg.threads = 2;
+    bcfg.timeout = std::chrono::seconds(2);
+    bcfg.protocol = moros::Protocol::HTTP1;
+    bcfg.rebalance = true;
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET /{{seq}} HTTP/1.1\r\nHost: 127.0.0.1\r\n", "", 2000);
+
+    const auto& m = moros::Metrics::getInstance();
+    const std::uint64_t errors = m[moros::Metrics::Kind::ECONNECT] +
+                                 m[moros::Metrics::Kind::EREAD] +
+                                 m[moros::Metrics::Kind::EWRITE];
+
+    moros::Plugin plugin("http", "127.0.0.1", service, service, "", {});
+    moros::Bencher from(bcfg, 0, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+    moros::Bencher to(bcfg, 1, *rptr, "127.0.0.1", endpoints, nullptr, plugin);
+
+    std::thread t1([&] { from.run(); });
+    std::thread t2([&] { to.run(); });
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    from.migrate(to, 2);
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    const moros::BencherLoad before = to.load();
+    std::this_thread::sleep_for(std::chrono::milliseconds(100));
+    from.stop();
+    to.stop();
+    t1.join();
+    t2.join();
+
+    BOOST_CHECK_EQUAL(from.load().connections, 1u);
+    BOOST_CHECK_EQUAL(before.connections, 5u);
+    BOOST_CHECK_EQUAL(to.load().connections, 5u);
+    BOOST_CHECK_EQUAL(from.phase(moros::Phase::CONNECT).count(), 3u);
+    BOOST_CHECK_EQUAL(to.phase(moros::Phase::CONNECT).count(), 3u);
+    BOOST_CHECK_GT(to.load().completes, before.completes);
+    BOOST_CHECK_EQUAL(m[moros::Metrics::Kind::ECONNECT] + m[moros::Metrics::Kind::EREAD] +
+                          m[moros::Metrics::Kind::EWRITE],
+                      errors);
+}
+
+// 环形缓冲保留最近的请求, 每个连接的第一个请求带有建立连接的耗时
+BOOST_AUTO_TEST_CASE(trace_records) {
+    auto cfg = loopback();
+    cfg.response_size = 10;
+    moros::Server server(cfg);
+    server.start();
+
+    moros::Config bcfg = {};
+    bcfg.connections = 2;
+    bcfg.trace = "unused";
+    bcfg.trace_size = 64;
+    bcfg.slowest = 3;
+    bench(server.port(), bcfg, std::chrono::milliseconds(200), nullptr,
+          [](const moros::Bencher& b) {
+              BOOST_REQUIRE(b.traceRing());
+              BOOST_TEST(b.traceRing()->pushed() > 64u);
+
+              std::vector<moros::TraceRecord> records;
+              b.traceRing()->snapshot(records);
+              BOOST_REQUIRE(records.size() == 64u);
+              for (std::size_t i = 0; i < records.size(); ++i) {
+                  BOOST_TEST(records[i].conn < 2u);
+                  BOOST_TEST(records[i].status == 200u);
+                  BOOST_TEST(records[i].bytes > 10u);
+                  BOOST_TEST(records[i].connect == 0u);
+                  BOOST_TEST(records[i].wait == 0u);
+                  if (i) {
+                      BOOST_TEST(records[i].start >= records[i - 1].start);
+                  }
+              }
+
+              const std::vector<moros::SlowRequest> slowest = b.slowest().sorted();
+              BOOST_REQUIRE(slowest.size() == 3u);
+              BOOST_TEST(slowest[0].record.latency() >= slowest[2].record.latency());
+              BOOST_TEST(slowest[0].request == "GET / HTTP/1.1");
+          });
+}
@@ -0,0 +1,142 @@
+#define BOOST_TEST_MODULE SHM
+#include "shm.hpp"
+#include <boost/test/unit_test.hpp>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+std::unique_ptr<moros::Stats> requests = std::make_unique<moros::Stats>(1000000);
+std::unique_ptr<moros::Stats> latency = std::make_unique<moros::Stats>(2000);
+
+namespace {
+
+using Kind = moros::Metrics::Kind;
+
+constexpr std::size_t KINDS = static_cast<std::size_t>(Kind::MAX);
+
+// 第 w 个 worker: 一个 interval 中 10 个请求, latency 均为 w + 1 ms,
+// 另有 w 个读错误; 结束时的结果与该 interval 相同
+void runWorker(moros::SharedResults& shared, std::size_t w) {
+    std::uint64_t delta[KINDS] = {};
+    delta[static_cast<std::size_t>(Kind::COMPLETES)] = 10;
+    delta[static_cast<std::size_t>(Kind::EREAD)] = w;
+    moros::Stats latency(2000);
+    for (int n = 0; n < 10; ++n) {
+        latency.record(w + 1);
+    }
+    shared.publishInterval(w, 1, delta, latency);
+
+    moros::Metrics total;
+    total.count(Kind::COMPLETES, 10);
+    total.count(Kind::EREAD, w);
+
+    moros::Stats requests(1000000);
+    requests.record(10);
+
+    std::vector<moros::Endpoint> endpoints;
+    endpoints.emplace_back("/", 1, "GET / HTTP/1.1\r\n\r\n", "", 2000);
+    endpoints[0].metrics->count(Kind::COMPLETES, 10);
+    endpoints[0].latency->merge(latency);
+
+    std::vector<moros::Stats> phases(static_cast<std::size_t>(moros::Phase::MAX),
+                                     moros::Stats(2000000));
+    phases[static_cast<std::size_t>(moros::Phase::CONNECT)].record(100 * (w + 1));
+
+    shared.publishDone(w, std::chrono::milliseconds(1000 + w), total, latency, requests,
+                       std::list<moros::Bencher>(), endpoints, phases);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(workers_across_fork) {
+    moros::SharedResults shared(2, 0, 1, std::chrono::seconds(2));
+    BOOST_TEST(shared.size() == 2u);
+
+    std::vector<pid_t> pids;
+    for (std::size_t w = 0; w < shared.size(); ++w) {
+        const pid_t pid = ::fork();
+        BOOST_REQUIRE(pid != -1);
+        if (pid == 0) {
+            runWorker(shared, w);
+            ::_exit(0);
+        }
+        pids.push_back(pid);
+    }
+    for (pid_t pid : pids) {
+        int status = 0;
+        BOOST_TEST(::waitpid(pid, &status, 0) == pid);
+        BOOST_TEST(WIFEXITED(status));
+    }
+
+    moros::Snapshot snap;
+    for (std::size_t w = 0; w < shared.size(); ++w) {
+        BOOST_TEST(shared.done(w));
+        BOOST_TEST(shared.interval(w, 1, snap));
+        BOOST_TEST(!shared.interval(w, 2, snap));
+    }
+    BOOST_TEST(snap[Kind::COMPLETES] == 20u);
+    BOOST_TEST(snap[Kind::EREAD] == 1u);
+    BOOST_TEST(snap.latency->count() == 20u);
+    BOOST_TEST(snap.latency->max() == 2);
+
+    const moros::ClusterResult res = shared.collect();
+    BOOST_TEST(res.runtime.count() == 1001);
+    BOOST_TEST(res.total[Kind::COMPLETES] == 20u);
+    BOOST_TEST(res.total[Kind::EREAD] == 1u);
+    BOOST_TEST(res.total.latency->count() == 20u);
+    BOOST_TEST(res.requests->count() == 2u);
+    BOOST_TEST(res.threads.empty());
+    BOOST_REQUIRE(res.endpoints.size() == 1u);
+    BOOST_TEST(res.endpoints[0][Kind::COMPLETES] == 20u);
+    BOOST_TEST(res.endpoints[0].latency->count() == 20u);
+    BOOST_TEST(res.phases[static_cast<std::size_t>(moros::Phase::CONNECT)]->count() == 2u);
+    BOOST_TEST(res.phases[static_cast<std::size_t>(moros::Phase::CONNECT)]->max() == 200);
+}
+
+// 没有完成的 worker 不计入, 但汇总仍有完整的直方图
+BOOST_AUTO_TEST_CASE(unfinished_worker) {
+    moros::SharedResults shared(2, 0, 1, std::chrono::seconds(2));
+    moros::Snapshot snap;
+    BOOST_TEST(!shared.done(0));
+    BOOST_TEST(!shared.interval(0, 1, snap));
+
+    runWorker(shared, 1);
+    BOOST_TEST(!shared.done(0));
+    BOOST_TEST(shared.done(1));
+
+    const moros::ClusterResult res = shared.collect();
+    BOOST_TEST(res.total[Kind::COMPLETES] == 10u);
+    BOOST_TEST(res.total[Kind::EREAD] == 1u);
+    BOOST_TEST(res.total.latency->count() == 10u);
+    BOOST_REQUIRE(res.endpoints.size() == 1u);
+    BOOST_TEST(res.endpoints[0].latency->count() == 10u);
+
+    const moros::ClusterResult none = moros::SharedResults(1, 0, 1, std::chrono::seconds(2)).collect();
+    BOOST_TEST(none.total.latency->count() == 0u);
+    BOOST_TEST(none.endpoints[0].latency->count() == 0u);
+}
+
+// worker 领先两个 interval 时第 1 个已被第 3 个覆盖, 不能当作第 1 个合并
+BOOST_AUTO_TEST_CASE(reader_behind) {
+    moros::SharedResults shared(1, 0, 1, std::chrono::seconds(2));
+    moros::Stats latency(2000);
+    for (std::uint64_t k = 1; k <= 3; ++k) {
+        std::uint64_t delta[KINDS] = {};
+        delta[static_cast<std::size_t>(Kind::COMPLETES)] = k;
+        shared.publishInterval(0, k, delta, latency);
+    }
+
+    moros::Snapshot lost;
+    BOOST_TEST(shared.interval(0, 1, lost));
+    BOOST_TEST(lost[Kind::COMPLETES] == 0u);
+    BOOST_TEST(!lost.latency);
+
+    for (std::uint64_t k = 2; k <= 3; ++k) {
+        moros::Snapshot snap;
+        BOOST_TEST(shared.interval(0, k, snap));
+        BOOST_TEST(snap[Kind::COMPLETES] == k);
+    }
+
+    moros::Snapshot snap;
+    BOOST_TEST(!shared.interval(0, 4, snap));
+}
@@ -0,0 +1,78 @@
+#define BOOST_TEST_MODULE SOCKOPT
+#include "sockopt.hpp"
+#include <cstring>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+int getInt(int fd, int level, int name) {
+    int v = -1;
+    socklen_t len = sizeof(v);
+    BOOST_REQUIRE_EQUAL(::getsockopt(fd, level, name, &v, &len), 0);
+    return v;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(parse_spec) {
+    const moros::SocketOptions none = moros::parseSocketOptions("");
+    BOOST_TEST(!none.fastopen);
+    BOOST_TEST(none.sndbuf == 0);
+    BOOST_TEST(none.congestion.empty());
+
+    const moros::SocketOptions opts = moros::parseSocketOptions(
+        "fastopen,quickack,linger-rst,sndbuf=65536,rcvbuf=131072,congestion=reno");
+    BOOST_TEST(opts.fastopen);
+    BOOST_TEST(opts.quickack);
+    BOOST_TEST(opts.linger_rst);
+    BOOST_TEST(opts.sndbuf == 65536);
+    BOOST_TEST(opts.rcvbuf == 131072);
+    BOOST_TEST(opts.congestion == "reno");
+
+    for (const char* bad : {"nodelay", "fastopen=1", "sndbuf", "sndbuf=", "sndbuf=0",
+                            "rcvbuf=1k", "rcvbuf=99999999999", "congestion=", "fastopen,,quickack"}) {
+        BOOST_CHECK_THROW(moros::parseSocketOptions(bad), std::invalid_argument);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(apply_tcp) {
+    const moros::SocketOptions opts =
+        moros::parseSocketOptions("fastopen,linger-rst,sndbuf=65536,congestion=reno");
+    const int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    BOOST_REQUIRE(fd != -1);
+    BOOST_REQUIRE(moros::applySocketOptions(fd, AF_INET, opts));
+
+    // 内核把缓冲区大小翻倍以留出管理开销
+    BOOST_TEST(getInt(fd, SOL_SOCKET, SO_SNDBUF) >= 65536);
+    BOOST_TEST(getInt(fd, IPPROTO_TCP, TCP_FASTOPEN_CONNECT) == 1);
+
+    struct linger l = {};
+    socklen_t len = sizeof(l);
+    BOOST_REQUIRE_EQUAL(::getsockopt(fd, SOL_SOCKET, SO_LINGER, &l, &len), 0);
+    BOOST_TEST(l.l_onoff == 1);
+    BOOST_TEST(l.l_linger == 0);
+
+    char cc[16] = {};
+    len = sizeof(cc);
+    BOOST_REQUIRE_EQUAL(::getsockopt(fd, IPPROTO_TCP, TCP_CONGESTION, cc, &len), 0);
+    BOOST_TEST(std::strcmp(cc, "reno") == 0);
+    ::close(fd);
+
+    BOOST_CHECK_NO_THROW(moros::probeSocketOptions(AF_INET, opts));
+    BOOST_CHECK_THROW(moros::probeSocketOptions(
+                          AF_INET, moros::parseSocketOptions("congestion=no-such-cc")),
+                      std::runtime_error);
+}
+
+// Unix socket 上 TCP 选项被忽略
+BOOST_AUTO_TEST_CASE(apply_unix) {
+    const moros::SocketOptions opts =
+        moros::parseSocketOptions("fastopen,quickack,rcvbuf=65536,congestion=no-such-cc");
+    const int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    BOOST_REQUIRE(fd != -1);
+    BOOST_TEST(moros::applySocketOptions(fd, AF_UNIX, opts));
+    BOOST_TEST(getInt(fd, SOL_SOCKET, SO_RCVBUF) >= 65536);
+    ::close(fd);
+}
@@ -0,0 +1,99 @@
+#define BOOST_TEST_MODULE STATS
+#include "stats.hpp"
+#include <algorithm>
+#include <boost/test/unit_test.hpp>
+
+BOOST_AUTO_TEST_CASE(record) {
+    moros::Stats st(100);
+    for (std::uint64_t i = 1; i <= 10; ++i) {
+        BOOST_CHECK(st.record(i));
+    }
+    BOOST_CHECK(!st.record(100));
+
+    BOOST_CHECK_EQUAL(st.max(), 10);
+    BOOST_CHECK_CLOSE(st.mean(), 5.5, 1e-9);
+    BOOST_CHECK_EQUAL(st.derank(0.5), 5u);
+    BOOST_CHECK_EQUAL(st.derank(0.99), 10u);
+}
+
+BOOST_AUTO_TEST_CASE(merge_and_reset) {
+    moros::Stats a(100), b(100);
+    a.record(1);
+    a.record(2);
+    b.record(50);
+
+    a.merge(b);
+    BOOST_CHECK_EQUAL(a.max(), 50);
+    BOOST_CHECK_EQUAL(a.derank(1.0), 50u);
+    BOOST_CHECK_CLOSE(a.mean(), 53.0 / 3, 1e-9);
+
+    b.reset();
+    BOOST_CHECK_EQUAL(b.max(), 0);
+    BOOST_CHECK_EQUAL(b.mean(), 0.0);
+
+    b.record(7);
+    BOOST_CHECK_EQUAL(b.derank(0.5), 7u);
+}
+
+// warmup 由记录者检查, Stats 本身不受 Metrics 开关影响
+BOOST_AUTO_TEST_CASE(independent_of_metrics) {
+    moros::Stats st(100);
+
+    moros::Metrics::getInstance().enable(false);
+    BOOST_CHECK(st.record(1));
+    moros::Metrics::getInstance().enable(true);
+
+    BOOST_CHECK_EQUAL(st.count(), 1u);
+    BOOST_CHECK_EQUAL(st.mean(), 1.0);
+}
+
+BOOST_AUTO_TEST_CASE(reset) {
+    moros::Stats st(1000000);
+    for (std::uint64_t n : {1u, 3000u, 999999u}) {
+        st.record(n);
+    }
+
+    st.reset();
+    BOOST_CHECK_EQUAL(st.count(), 0u);
+    BOOST_CHECK_EQUAL(st.max(), 0);
+    BOOST_CHECK_EQUAL(st.derank(0.99), 0u);
+    BOOST_CHECK(std::all_of(st.counts().begin(), st.counts().end(),
+                            [](std::uint64_t c) { return c == 0; }));
+
+    // min 与 max 也已清除, 之后只反映新的样本
+    st.record(5);
+    st.record(7);
+    BOOST_CHECK_EQUAL(st.max(), 7);
+    BOOST_CHECK_EQUAL(st.derank(0.0), 5u);
+    BOOST_CHECK_CLOSE(st.mean(), 6.0, 1e-9);
+
+    // 清零后合并到别处不带入旧的样本
+    moros::Stats other(1000000);
+    st.reset();
+    other.merge(st);
+    BOOST_CHECK_EQUAL(other.count(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(log_linear_buckets) {
+    moros::Stats st(1000000);
+
+    // 2048 以下精确记录
+    BOOST_CHECK_EQUAL(moros::Stats::countsIndex(2047), 2047u);
+    BOOST_CHECK_EQUAL(moros::Stats::valueAt(moros::Stats::countsIndex(1500)), 1500u);
+
+    // 之后保留 3 位有效数字
+    for (std::uint64_t v : {2048u, 4097u, 123456u, 999999u}) {
+        const std::size_t idx = moros::Stats::countsIndex(v);
+        BOOST_CHECK_LE(moros::Stats::valueAt(idx), v);
+        BOOST_CHECK_GT(moros::Stats::valueAt(idx) + moros::Stats::rangeAt(idx), v);
+        BOOST_CHECK_LE(moros::Stats::rangeAt(idx) * 1000, v);
+    }
+    BOOST_CHECK_LT(moros::Stats::countsIndex(999999), st.counts().size());
+
+    st.record(123456);
+    st.record(999999);
+    BOOST_CHECK_EQUAL(st.max(), 999999);
+    BOOST_CHECK_EQUAL(st.derank(1.0), 999999u);
+    BOOST_CHECK_CLOSE(1.0 * st.derank(0.5), 123456.0, 0.1);
+    BOOST_CHECK(!st.record(1000000));
+}
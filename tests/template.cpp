@@ -0,0 +1,89 @@
+#define BOOST_TEST_MODULE TEMPLATE
+#include "template.hpp"
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <regex>
+#include <set>
+#include <stdexcept>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+std::string render(const moros::Template& t, moros::TemplateState& st) {
+    std::string out;
+    t.render(out, st);
+    st.seq += st.stride;
+    return out;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(literal) {
+    const moros::Template t("GET /index.html HTTP/1.1\r\n");
+    BOOST_CHECK(!t.dynamic());
+
+    moros::TemplateState st(1, 0, 1);
+    BOOST_CHECK_EQUAL(render(t, st), "GET /index.html HTTP/1.1\r\n");
+    BOOST_CHECK(moros::Template("").empty());
+}
+
+BOOST_AUTO_TEST_CASE(seq) {
+    const moros::Template t("/item/{{seq}}?again={{seq}}");
+    BOOST_CHECK(t.dynamic());
+
+    // 第 2 条连接, 共 4 条
+    moros::TemplateState st(1, 2, 4);
+    BOOST_CHECK_EQUAL(render(t, st), "/item/2?again=2");
+    BOOST_CHECK_EQUAL(render(t, st), "/item/6?again=6");
+    BOOST_CHECK_EQUAL(render(t, st), "/item/10?again=10");
+}
+
+BOOST_AUTO_TEST_CASE(rand_and_uuid) {
+    const moros::Template r("{{rand:5..7}}");
+    const moros::Template u("{{uuid}}");
+    const std::regex uuid("[0-9a-f]{8}-[0-9a-f]{4}-4[0-9a-f]{3}-[89ab][0-9a-f]{3}-[0-9a-f]{12}");
+
+    moros::TemplateState st(42, 0, 1);
+    std::set<std::string> seen;
+    for (int i = 0; i < 1000; ++i) {
+        seen.insert(render(r, st));
+        BOOST_CHECK(std::regex_match(render(u, st), uuid));
+    }
+    BOOST_CHECK(seen == std::set<std::string>({"5", "6", "7"}));
+}
+
+BOOST_AUTO_TEST_CASE(deterministic) {
+    const moros::Template t("{{rand:0..1000000}}-{{uuid}}");
+
+    moros::TemplateState a(moros::deriveSeed(7, 1), 0, 1), b(moros::deriveSeed(7, 1), 0, 1),
+        c(moros::deriveSeed(7, 2), 0, 1);
+    const std::string first = render(t, a);
+    BOOST_CHECK_EQUAL(first, render(t, b));
+    BOOST_CHECK_NE(first, render(t, c));
+}
+
+BOOST_AUTO_TEST_CASE(pick) {
+    char path[] = "/tmp/moros-pick-XXXXXX";
+    ::close(::mkstemp(path));
+    std::ofstream(path) << "alpha\r\n\nbeta\n";
+
+    const moros::Template t(std::string("/{{pick:") + path + "}}");
+    std::remove(path);
+
+    moros::TemplateState st(3, 0, 1);
+    std::set<std::string> seen;
+    for (int i = 0; i < 100; ++i) {
+        seen.insert(render(t, st));
+    }
+    BOOST_CHECK(seen == std::set<std::string>({"/alpha", "/beta"}));
+}
+
+BOOST_AUTO_TEST_CASE(invalid) {
+    for (const char* src : {"{{seq", "{{nope}}", "{{rand:9..1}}", "{{rand:1}}",
+                            "{{rand:a..b}}", "{{pick:/nonexistent/file}}", "{{seq:1}}"}) {
+        BOOST_CHECK_THROW(moros::Template{src}, std::runtime_error);
+    }
+}
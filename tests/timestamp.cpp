@@ -0,0 +1,106 @@
+#define BOOST_TEST_MODULE TIMESTAMP
+#include "timestamp.hpp"
+#include <thread>
+#include <boost/test/unit_test.hpp>
+
+#include <poll.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+namespace {
+
+// localhost 上一对已连接的 TCP socket
+struct TcpPair {
+    TcpPair() {
+        const int lfd = ::socket(AF_INET, SOCK_STREAM, 0);
+
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        ::bind(lfd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        ::listen(lfd, 1);
+
+        socklen_t len = sizeof(addr);
+        ::getsockname(lfd, reinterpret_cast<struct sockaddr*>(&addr), &len);
+
+        client = ::socket(AF_INET, SOCK_STREAM, 0);
+        ::connect(client, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr));
+        server = ::accept(lfd, nullptr, nullptr);
+        ::close(lfd);
+    }
+
+    ~TcpPair() {
+        ::close(client);
+        ::close(server);
+    }
+
+    int client, server;
+};
+
+void waitReadable(int fd) {
+    struct pollfd p = {fd, POLLIN, 0};
+    ::poll(&p, 1, 1000);
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(wire_time) {
+    moros::WireStamp tx, rx;
+    std::chrono::nanoseconds d;
+    BOOST_CHECK(!moros::wireTime(tx, rx, d));
+
+    tx.sw = 1000;
+    rx.sw = 5000;
+    BOOST_REQUIRE(moros::wireTime(tx, rx, d));
+    BOOST_CHECK_EQUAL(d.count(), 4000);
+
+    // 两端都有硬件时间戳时优先使用
+    tx.hw = 100;
+    rx.hw = 300;
+    BOOST_REQUIRE(moros::wireTime(tx, rx, d));
+    BOOST_CHECK_EQUAL(d.count(), 200);
+
+    // 只有一端有硬件时间戳时退回软件时间戳
+    rx.hw = 0;
+    BOOST_REQUIRE(moros::wireTime(tx, rx, d));
+    BOOST_CHECK_EQUAL(d.count(), 4000);
+
+    rx.sw = 500;
+    BOOST_CHECK(!moros::wireTime(tx, rx, d));
+}
+
+BOOST_AUTO_TEST_CASE(loopback_software_stamps) {
+    TcpPair p;
+    BOOST_REQUIRE(moros::enableTimestamping(p.client));
+
+    const char req[] = "ping";
+    BOOST_REQUIRE_EQUAL(::write(p.client, req, 4), 4);
+
+    char buf[16];
+    waitReadable(p.server);
+    BOOST_REQUIRE_EQUAL(::read(p.server, buf, sizeof(buf)), 4);
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(5));
+    BOOST_REQUIRE_EQUAL(::write(p.server, "pong", 4), 4);
+
+    // 发送时间戳在响应到达之前就已进入错误队列
+    moros::WireStamp tx, rx;
+    waitReadable(p.client);
+    moros::drainTxStamps(p.client, tx);
+    BOOST_REQUIRE_EQUAL(moros::recvStamped(p.client, buf, sizeof(buf), rx), 4);
+    BOOST_CHECK_EQUAL(std::string(buf, 4), "pong");
+    BOOST_CHECK_NE(tx.sw, 0);
+    BOOST_CHECK_NE(rx.sw, 0);
+
+    std::chrono::nanoseconds d;
+    BOOST_REQUIRE(moros::wireTime(tx, rx, d));
+    BOOST_CHECK_GE(d.count(), 5000000);
+    BOOST_CHECK_LT(d.count(), 1000000000);
+
+    // 错误队列已取空
+    moros::WireStamp again;
+    moros::drainTxStamps(p.client, again);
+    BOOST_CHECK_EQUAL(again.sw, 0);
+}
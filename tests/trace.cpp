@@ -0,0 +1,117 @@
+#define BOOST_TEST_MODULE TRACE
+#include "trace.hpp"
+#include <sstream>
+#include <boost/test/unit_test.hpp>
+
+#include <unistd.h>
+
+namespace {
+
+moros::TraceRecord record(std::uint64_t start, std::uint32_t ttfb) {
+    moros::TraceRecord r = {};
+    r.start = start;
+    r.conn = static_cast<std::uint32_t>(start % 7);
+    r.bytes = 100;
+    r.ttfb = ttfb;
+    r.transfer = 10;
+    r.status = 200;
+    return r;
+}
+
+}
+
+BOOST_AUTO_TEST_CASE(ring_keeps_latest) {
+    moros::TraceRing ring(5);
+    BOOST_TEST(ring.capacity() == 8u);
+
+    std::vector<moros::TraceRecord> out;
+    ring.snapshot(out);
+    BOOST_TEST(out.empty());
+
+    for (std::uint64_t i = 0; i < 20; ++i) {
+        ring.push(record(i, 1));
+    }
+    BOOST_TEST(ring.pushed() == 20u);
+
+    // 已有的内容保留, 追加最近的 8 条
+    out.push_back(record(100, 1));
+    ring.snapshot(out);
+    BOOST_REQUIRE(out.size() == 9u);
+    BOOST_TEST(out[0].start == 100u);
+    for (std::size_t i = 1; i < out.size(); ++i) {
+        BOOST_TEST(out[i].start == 11 + i);
+    }
+}
+
+BOOST_AUTO_TEST_CASE(slowest_requests) {
+    moros::SlowestRequests none(0);
+    BOOST_TEST(!none.qualifies(1000000));
+
+    moros::SlowestRequests top(3), other(3);
+    for (std::uint32_t i = 0; i < 10; ++i) {
+        top.add(record(i, i * 100), "GET /" + std::to_string(i) + " HTTP/1.1\r\nHost: x\r\n\r\n");
+    }
+    // 堆顶为第 3 慢的 710
+    BOOST_TEST(!top.qualifies(710));
+    BOOST_TEST(top.qualifies(711));
+
+    other.add(record(50, 850), "GET /other HTTP/1.1\r\n\r\n");
+    top.merge(other);
+
+    const std::vector<moros::SlowRequest> s = top.sorted();
+    BOOST_REQUIRE(s.size() == 3u);
+    BOOST_TEST(s[0].record.latency() == 910u);
+    BOOST_TEST(s[0].request == "GET /9 HTTP/1.1");
+    BOOST_TEST(s[1].request == "GET /other HTTP/1.1");
+    BOOST_TEST(s[2].record.start == 8u);
+
+    std::ostringstream os;
+    moros::reportSlowest(os, s, 0, {"/"});
+    BOOST_TEST(os.str().find("910us") != std::string::npos);
+    BOOST_TEST(os.str().find("GET /other HTTP/1.1") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(file_round_trip) {
+    const std::string path = "/tmp/moros-trace-" + std::to_string(::getpid());
+
+    moros::TraceFile t;
+    t.start = 1000;
+    t.wall = 1500000000000000;
+    t.endpoints = {"home", "api, v2"};
+    t.records = {record(1000, 300), record(2500, 40)};
+    t.records[1].endpoint = 1;
+    t.records[1].connect = 120;
+    t.records[1].thread = 3;
+    t.dropped = 7;
+    moros::writeTrace(path, t);
+
+    const moros::TraceFile r = moros::readTrace(path);
+    ::unlink(path.c_str());
+    BOOST_TEST(r.start == t.start);
+    BOOST_TEST(r.wall == t.wall);
+    BOOST_TEST(r.dropped == 7u);
+    BOOST_TEST(r.endpoints == t.endpoints);
+    BOOST_REQUIRE(r.records.size() == 2u);
+    BOOST_TEST(r.records[1].connect == 120u);
+    BOOST_TEST(r.records[1].thread == 3u);
+
+    std::ostringstream csv;
+    moros::traceCsv(csv, r);
+    BOOST_TEST(csv.str().find("\n1500,3,") != std::string::npos);
+    BOOST_TEST(csv.str().find(",\"api, v2\",200,100,120,0,40,10,50\n") != std::string::npos);
+
+    // 每个请求一个事件与 ttfb, transfer, 有建立连接时另加一个
+    std::ostringstream chrome;
+    moros::traceChrome(chrome, r);
+    const std::string json = chrome.str();
+    std::size_t events = 0;
+    for (auto pos = json.find("\"ph\":\"X\""); pos != std::string::npos;
+         pos = json.find("\"ph\":\"X\"", pos + 1)) {
+        ++events;
+    }
+    BOOST_TEST(events == 7u);
+    BOOST_TEST(json.find("\"name\":\"connect\",\"cat\":\"connect\",\"ph\":\"X\",\"pid\":3,"
+                         "\"tid\":1,\"ts\":1380,\"dur\":120") != std::string::npos);
+
+    BOOST_CHECK_THROW(moros::readTrace(path), std::runtime_error);
+}